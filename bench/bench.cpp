@@ -0,0 +1,181 @@
+// Runs the benchmarks and prints their results, one JSON object per line.
+
+#include "bench.h"
+
+#include <dcpp/SettingsManager.h>
+#include <dcpp/version.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+using namespace std;
+using namespace bench;
+using dcpp::SettingsManager;
+
+namespace {
+
+map<string, Function>& getBenchmarks() {
+	static map<string, Function> benchmarks;
+	return benchmarks;
+}
+
+const char* sink;
+
+void help() {
+	printf("Arguments to run bench with:\n\tbench [--min-time=<ms>] [--repetitions=<n>] [--list] [filter...]\n"
+		"<ms> (default: 500) is how long each repetition should take at least.\n"
+		"<n> (default: 5) is the amount of repetitions; the fastest one gives min_ns_per_op.\n"
+		"[filter] only runs the benchmarks whose name contains one of the filters.\n");
+}
+
+} // unnamed namespace
+
+namespace bench {
+
+int add(const char* name, Function f) {
+	getBenchmarks()[name] = f;
+	return 0;
+}
+
+void use(const void* p) {
+	sink = static_cast<const char*>(p);
+}
+
+double State::time(const function<void ()>& op, uint64_t n) const {
+	auto start = chrono::steady_clock::now();
+	for(uint64_t i = 0; i < n; ++i) {
+		op();
+	}
+	return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+void State::run(const function<void ()>& op) {
+	// grow the iteration count until one batch fills the minimum time
+	const double target = minTime * 1e6;
+	uint64_t n = 1;
+	double ns;
+	while((ns = time(op, n)) < target) {
+		auto grow = ns > 0 ? target * 1.2 / ns : 10.;
+		n = static_cast<uint64_t>(n * min(max(grow, 1.5), 10.)) + 1;
+	}
+
+	double total = 0;
+	minNsPerOp = ns / n;
+	for(int i = 0; i < repetitions; ++i) {
+		ns = time(op, n);
+		total += ns;
+		minNsPerOp = min(minNsPerOp, ns / n);
+	}
+
+	iterations = n * repetitions;
+	nsPerOp = total / iterations;
+}
+
+string State::toJSON(const string& name) const {
+	char buf[512];
+	auto len = snprintf(buf, sizeof(buf), "{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.1f,\"min_ns_per_op\":%.1f",
+		name.c_str(), static_cast<unsigned long long>(iterations), nsPerOp, minNsPerOp);
+	string ret(buf, len);
+
+	if(bytes > 0 && minNsPerOp > 0) {
+		len = snprintf(buf, sizeof(buf), ",\"bytes_per_second\":%.0f", bytes * 1e9 / minNsPerOp);
+		ret.append(buf, len);
+	}
+	if(items > 0 && minNsPerOp > 0) {
+		len = snprintf(buf, sizeof(buf), ",\"items_per_second\":%.0f", items * 1e9 / minNsPerOp);
+		ret.append(buf, len);
+	}
+
+	ret += '}';
+	return ret;
+}
+
+string makeData(size_t size, uint32_t seed) {
+	string data(size, 0);
+	Random r(seed);
+	for(auto& c: data) {
+		c = static_cast<char>(r.next());
+	}
+	return data;
+}
+
+vector<string> makeFileNames(size_t count, uint32_t seed) {
+	static const char* words[] = { "Artist", "album", "Live", "remastered", "Track", "disc",
+		"Sánchez", "Ørsted", "Über", "mix", "Season", "episode", "THE", "of", "and", "Björk" };
+	static const char* exts[] = { ".mp3", ".flac", ".avi", ".mkv", ".jpg", ".txt", ".nfo", ".iso" };
+
+	vector<string> ret;
+	ret.reserve(count);
+
+	Random r(seed);
+	for(size_t i = 0; i < count; ++i) {
+		string name;
+		auto n = 2 + r.next(4);
+		for(uint32_t j = 0; j < n; ++j) {
+			name += words[r.next(sizeof(words) / sizeof(words[0]))];
+			name += ' ';
+		}
+		name += to_string(i);
+		name += exts[r.next(sizeof(exts) / sizeof(exts[0]))];
+		ret.push_back(move(name));
+	}
+	return ret;
+}
+
+} // namespace bench
+
+int main(int argc, char** argv) {
+	double minTime = 500;
+	int repetitions = 5;
+	bool list = false;
+	vector<string> filters;
+
+	for(int i = 1; i < argc; ++i) {
+		if(strncmp(argv[i], "--min-time=", 11) == 0) {
+			minTime = atof(argv[i] + 11);
+		} else if(strncmp(argv[i], "--repetitions=", 14) == 0) {
+			repetitions = atoi(argv[i] + 14);
+		} else if(strcmp(argv[i], "--list") == 0) {
+			list = true;
+		} else if(argv[i][0] == '-') {
+			help();
+			return 1;
+		} else {
+			filters.emplace_back(argv[i]);
+		}
+	}
+
+	if(minTime <= 0 || repetitions <= 0) {
+		help();
+		return 1;
+	}
+
+	// the queue and socket code read their settings; the defaults are what gets measured
+	SettingsManager::newInstance();
+
+	if(!list) printf("{\"program\":\"%s\",\"version\":\"%s\",\"min_time_ms\":%.0f,\"repetitions\":%d}\n",
+		APPNAME, VERSIONSTRING, minTime, repetitions);
+
+	for(auto& i: getBenchmarks()) {
+		if(!filters.empty() && none_of(filters.begin(), filters.end(), [&](const string& f) { return i.first.find(f) != string::npos; })) {
+			continue;
+		}
+
+		if(list) {
+			printf("%s\n", i.first.c_str());
+			continue;
+		}
+
+		State state(minTime, repetitions);
+		i.second(state);
+		printf("%s\n", state.toJSON(i.first).c_str());
+		fflush(stdout);
+	}
+
+	SettingsManager::deleteInstance();
+	return 0;
+}
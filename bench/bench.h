@@ -0,0 +1,85 @@
+// Benchmark harness: each benchmark registers itself with BENCH, prepares its data and then
+// hands the operation to measure to State::run, which times it over enough iterations.
+
+#ifndef DCPLUSPLUS_BENCH_BENCH_H
+#define DCPLUSPLUS_BENCH_BENCH_H
+
+#include <dcpp/stdinc.h>
+
+#ifdef _WIN32
+#include <dcpp/w.h>
+#endif
+
+#include <dcpp/typedefs.h>
+
+#include <functional>
+
+#define _(x)
+
+namespace bench {
+
+using std::function;
+using std::string;
+
+class State {
+public:
+	State(double aMinTime, int aRepetitions) : minTime(aMinTime), repetitions(aRepetitions),
+		bytes(0), items(0), iterations(0), nsPerOp(0), minNsPerOp(0) { }
+
+	/** Bytes / items processed by each call of the operation, for the throughput. */
+	void setBytes(int64_t aBytes) { bytes = aBytes; }
+	void setItems(int64_t aItems) { items = aItems; }
+
+	/** Run the operation until the timings settle: first as many times as it takes to fill
+	minTime, then that many times again for each repetition. */
+	void run(const function<void ()>& op);
+
+	/** One JSON object on a line. */
+	string toJSON(const string& name) const;
+
+private:
+	double time(const function<void ()>& op, uint64_t n) const;
+
+	double minTime;
+	int repetitions;
+
+	int64_t bytes;
+	int64_t items;
+
+	uint64_t iterations;
+	double nsPerOp;
+	double minNsPerOp;
+};
+
+typedef function<void (State&)> Function;
+
+int add(const char* name, Function f);
+
+/** Keeps the compiler from optimizing away a result. */
+void use(const void* p);
+template<typename T> void use(const T& x) { use(static_cast<const void*>(&x)); }
+
+/** Deterministic pseudo-random numbers, so that every run works on the same data. */
+class Random {
+public:
+	explicit Random(uint32_t seed = 1) : x(seed) { }
+	uint32_t next() { x = x * 1103515245 + 12345; return x >> 8; }
+	uint32_t next(uint32_t n) { return next() % n; }
+
+private:
+	uint32_t x;
+};
+
+/** Bytes that don't compress. */
+string makeData(size_t size, uint32_t seed = 1);
+/** File names made of words, numbers and a few accented letters, with common extensions. */
+std::vector<string> makeFileNames(size_t count, uint32_t seed = 1);
+
+} // namespace bench
+
+#define BENCH(name) \
+	static void bench_##name(bench::State& state); \
+	static int bench_registered_##name = bench::add(#name, &bench_##name); \
+	static void bench_##name(bench::State& state)
+
+#endif // !defined(DCPLUSPLUS_BENCH_BENCH_H)
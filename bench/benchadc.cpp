@@ -0,0 +1,113 @@
+#include "bench.h"
+
+#include <dcpp/AdcCommand.h>
+
+using namespace dcpp;
+
+namespace {
+
+const string binf = "BINF AAAB IDKAY6BI76T6XFIQXZNRYXZH4YKMQ2DUJOHSHYKOQ PDPCIPOUMKFE4BAKVYQ2ZZKSKHPP7QRQOF5AAJDZI"
+	" NIsome\\suser\\swith\\sspaces DEa\\sdescription\\nover\\stwo\\slines SL3 SS1234567890123 SF123456"
+	" HN12 HR0 HO1 VEFearDC\\s1.3.2.2 US1048576 I4192.168.1.2 U43000 SUTCP4,UDP4,ADC0,SEGA KPSHA256/"
+	"T6XFIQXZNRYXZH4YKMQ2DUJOHSHYKOQPDPCIPOUMKFE4BAKVYQ2ZZ";
+
+const string sch = "BSCH AAAB ANsome ANsearch ANterms NOexcluded EXmp3 EXflac TOauto123456";
+
+/** What a busy hub sends: user updates, searches, results and chat. */
+const std::vector<string> traffic = {
+	binf,
+	sch,
+	"BSCH AAAC TRKAZGOXVHQDOL6QEKZX3LPLPOCUEQUG3WT5YHABDY TOauto5678",
+	"DRES AAAB AAAC FN/Music/Some\\sArtist/Some\\sAlbum/01\\s-\\sA\\sTrack.flac SI31415926 SL3 TOauto1234 TRKAZGOXVHQDOL6QEKZX3LPLPOCUEQUG3WT5YHABDY",
+	"EMSG AAAB AAAC hello\\sthere,\\show\\sis\\sit\\sgoing? PMAAAB",
+	"IMSG Welcome\\sto\\sthe\\shub.\\nPlease\\sread\\sthe\\srules.",
+	"BINF AAAC SS1256812349900 SF12346",
+	"FSCH AAAD +TCP4-NAT0 TOauto91011 ANlinux ANiso"
+};
+
+size_t getBytes(const std::vector<string>& lines) {
+	size_t ret = 0;
+	for(auto& line: lines) {
+		ret += line.size();
+	}
+	return ret;
+}
+
+}
+
+BENCH(adc_parse_binf)
+{
+	state.setBytes(binf.size());
+	state.run([&] {
+		AdcCommand c(binf);
+		bench::use(c);
+	});
+}
+
+BENCH(adc_parse_sch)
+{
+	state.setBytes(sch.size());
+	state.run([&] {
+		AdcCommand c(sch);
+		bench::use(c);
+	});
+}
+
+BENCH(adc_view_parse_binf)
+{
+	AdcCommand::View v;
+	string param;
+	state.setBytes(binf.size());
+	state.run([&] {
+		v.parse(binf);
+		v.getParam("NI", 0, param);
+		bench::use(param);
+	});
+}
+
+BENCH(adc_parse_traffic)
+{
+	state.setBytes(getBytes(traffic));
+	state.setItems(traffic.size());
+	state.run([&] {
+		for(auto& line: traffic) {
+			AdcCommand c(line);
+			bench::use(c);
+		}
+	});
+}
+
+BENCH(adc_view_parse_traffic)
+{
+	AdcCommand::View v;
+	string param;
+	state.setBytes(getBytes(traffic));
+	state.setItems(traffic.size());
+	state.run([&] {
+		for(auto& line: traffic) {
+			v.parse(line);
+			v.getParam("NI", 0, param);
+			bench::use(param);
+		}
+	});
+}
+
+BENCH(adc_serialize_traffic)
+{
+	// feature broadcasts can't be sent back as they are
+	std::vector<AdcCommand> commands;
+	for(auto& line: traffic) {
+		if(line[0] != AdcCommand::TYPE_FEATURE) {
+			commands.emplace_back(line);
+		}
+	}
+
+	string out;
+	state.setItems(commands.size());
+	state.run([&] {
+		for(auto& c: commands) {
+			c.toString(c.getFrom(), false, out);
+			bench::use(out);
+		}
+	});
+}
@@ -0,0 +1,57 @@
+#include "bench.h"
+
+#include <dcpp/BloomFilter.h>
+#include <dcpp/HashBloom.h>
+#include <dcpp/HashValue.h>
+#include <dcpp/TigerHash.h>
+
+using namespace dcpp;
+
+namespace {
+
+const size_t FILES = 200000;
+
+}
+
+BENCH(hash_bloom_build_200k)
+{
+	std::vector<TTHValue> tths;
+	for(size_t i = 0; i < FILES; ++i) {
+		TigerHash th;
+		th.update(&i, sizeof(i));
+		tths.push_back(TTHValue(th.finalize()));
+	}
+
+	auto k = HashBloom::get_k(FILES, 24);
+	auto m = HashBloom::get_m(FILES, k);
+
+	ByteVector v;
+	state.setItems(FILES);
+	state.run([&] {
+		HashBloom bloom;
+		bloom.reset(k, m, 24);
+		for(auto& tth: tths) {
+			bloom.add(tth);
+		}
+		bloom.copy_to(v);
+		bench::use(v);
+	});
+}
+
+BENCH(share_bloom_add_match_200k)
+{
+	auto names = bench::makeFileNames(FILES);
+
+	state.setItems(FILES);
+	state.run([&] {
+		BloomFilter<5> filter(1 << 20);
+		for(auto& name: names) {
+			filter.add(name);
+		}
+		size_t hits = 0;
+		for(auto& name: names) {
+			hits += filter.match(name);
+		}
+		bench::use(hits);
+	});
+}
@@ -0,0 +1,49 @@
+#include "bench.h"
+
+#include <dcpp/MerkleTree.h>
+
+using namespace dcpp;
+
+namespace {
+
+std::vector<TTHValue> makeTTHs() {
+	std::vector<TTHValue> ret(1000);
+	bench::Random r;
+	for(auto& tth: ret) {
+		for(auto& b: tth.data) {
+			b = static_cast<uint8_t>(r.next());
+		}
+	}
+	return ret;
+}
+
+}
+
+BENCH(tth_to_base32)
+{
+	auto tths = makeTTHs();
+	string tmp;
+	state.setItems(tths.size());
+	state.run([&] {
+		for(auto& tth: tths) {
+			tmp.clear();
+			bench::use(tth.toBase32(tmp));
+		}
+	});
+}
+
+BENCH(tth_from_base32)
+{
+	std::vector<string> encoded;
+	for(auto& tth: makeTTHs()) {
+		encoded.push_back(tth.toBase32());
+	}
+
+	state.setItems(encoded.size());
+	state.run([&] {
+		for(auto& s: encoded) {
+			TTHValue tth(s);
+			bench::use(tth);
+		}
+	});
+}
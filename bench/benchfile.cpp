@@ -0,0 +1,50 @@
+#include "bench.h"
+
+#include <dcpp/File.h>
+#include <dcpp/Util.h>
+
+using namespace dcpp;
+
+namespace {
+
+const size_t SIZE = 64 * 1024 * 1024;
+
+string tempPath(const string& name) {
+#ifdef _WIN32
+	return Util::getTempPath() + name;
+#else
+	return "/tmp/dcpp-bench-" + name;
+#endif
+}
+
+}
+
+BENCH(file_copy_64MiB)
+{
+	auto source = tempPath("source"), target = tempPath("target");
+	{
+		File f(source, File::WRITE, File::CREATE | File::TRUNCATE);
+		f.write(bench::makeData(SIZE));
+	}
+
+	state.setBytes(SIZE);
+	state.run([&] {
+		File::copyFile(source, target);
+	});
+
+	File::deleteFile(source);
+	File::deleteFile(target);
+}
+
+BENCH(file_allocate_64MiB)
+{
+	auto target = tempPath("target");
+
+	state.setBytes(SIZE);
+	state.run([&] {
+		File f(target, File::WRITE, File::CREATE | File::TRUNCATE);
+		f.setSize(SIZE, File::ALLOC_FULL);
+	});
+
+	File::deleteFile(target);
+}
@@ -0,0 +1,29 @@
+#include "bench.h"
+
+#include <dcpp/MerkleTree.h>
+#include <dcpp/TigerHash.h>
+
+using namespace dcpp;
+
+BENCH(tiger_hash_1MiB)
+{
+	auto data = bench::makeData(1024 * 1024);
+	state.setBytes(data.size());
+	state.run([&] {
+		TigerHash h;
+		h.update(data.data(), data.size());
+		bench::use(*h.finalize());
+	});
+}
+
+BENCH(tiger_tree_16MiB)
+{
+	auto data = bench::makeData(16 * 1024 * 1024);
+	state.setBytes(data.size());
+	state.run([&] {
+		TigerTree tt(TigerTree::calcBlockSize(data.size(), 10));
+		tt.update(data.data(), data.size());
+		tt.finalize();
+		bench::use(tt.getRoot());
+	});
+}
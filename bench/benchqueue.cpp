@@ -0,0 +1,34 @@
+#include "bench.h"
+
+#include <dcpp/QueueItem.h>
+
+using namespace dcpp;
+
+namespace {
+
+const int64_t BLOCK_SIZE = 1024 * 1024;
+
+/** A big download that was resumed a lot: every other block of the first three quarters is done. */
+QueueItem makeItem(int64_t size) {
+	QueueItem qi("bench", size, QueueItem::NORMAL, QueueItem::FLAG_NORMAL, 0, TTHValue());
+	for(int64_t pos = 0; pos < size * 3 / 4; pos += 2 * BLOCK_SIZE) {
+		qi.addSegment(Segment(pos, BLOCK_SIZE));
+	}
+	return qi;
+}
+
+}
+
+BENCH(queue_next_segment_1GiB)
+{
+	auto qi = makeItem(1024 * BLOCK_SIZE);
+	state.run([&] { bench::use(qi.getNextSegment(BLOCK_SIZE, 16 * BLOCK_SIZE)); });
+}
+
+BENCH(queue_next_segment_1GiB_partial)
+{
+	auto qi = makeItem(1024 * BLOCK_SIZE);
+	// a partial source that only has the second half
+	QueueItem::PartsInfo parts = { 512, 1024 };
+	state.run([&] { bench::use(qi.getNextSegment(BLOCK_SIZE, 16 * BLOCK_SIZE, &parts)); });
+}
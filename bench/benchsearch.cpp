@@ -0,0 +1,50 @@
+#include "bench.h"
+
+#include <dcpp/StringSearch.h>
+
+using namespace dcpp;
+
+namespace {
+
+const size_t FILES = 1000000;
+
+/** Checks each name of a share against the terms of a search, as ShareManager::Directory::search
+does; the share itself would need a hashed tree on disk. */
+size_t search(const std::vector<string>& names, const StringSearch::List& include) {
+	size_t ret = 0;
+	for(auto& name: names) {
+		if(include.matchAll(name, 0)) {
+			++ret;
+		}
+	}
+	return ret;
+}
+
+const std::vector<string>& getNames() {
+	static auto names = bench::makeFileNames(FILES);
+	return names;
+}
+
+}
+
+BENCH(share_search_1M_one_term)
+{
+	auto& names = getNames();
+	StringSearch::List include;
+	include.emplace_back("remastered");
+
+	state.setItems(names.size());
+	state.run([&] { bench::use(search(names, include)); });
+}
+
+BENCH(share_search_1M_three_terms)
+{
+	auto& names = getNames();
+	StringSearch::List include;
+	include.emplace_back("live");
+	include.emplace_back("björk");
+	include.emplace_back("season");
+
+	state.setItems(names.size());
+	state.run([&] { bench::use(search(names, include)); });
+}
@@ -0,0 +1,75 @@
+#include "bench.h"
+
+#include <dcpp/BufferedSocket.h>
+#include <dcpp/SemaphoreDCpp.h>
+
+#include <atomic>
+
+using namespace dcpp;
+
+namespace {
+
+const size_t LINES = 4096;
+
+/** Counts the lines a BufferedSocket splits off and wakes the writer once a batch is through. */
+struct LineCounter : BufferedSocketListener {
+	void on(Line, const string& line) noexcept {
+		bytes += line.size();
+		if(++lines == LINES) {
+			lines = 0;
+			done.signal();
+		}
+	}
+
+	void on(Failed, const string& error) noexcept {
+		failed = error;
+		done.signal();
+	}
+
+	std::atomic<size_t> lines { 0 };
+	size_t bytes = 0;
+	string failed;
+	Semaphore done;
+};
+
+}
+
+/** Line framing of a BufferedSocket fed ADC traffic through a loopback connection, which works
+the same on every platform unlike a socketpair. */
+BENCH(buffered_socket_lines)
+{
+	string batch;
+	bench::Random r;
+	for(size_t i = 0; i < LINES; ++i) {
+		batch += "BMSG AAAB some\\schat\\smessage\\sof\\svarying\\slength" + string(r.next(200), 'x') + '\n';
+	}
+
+	Socket srv(Socket::TYPE_TCP);
+	srv.setV4only(true);
+	srv.setLocalIp4("127.0.0.1");
+	auto port = srv.listen("0");
+
+	Socket client(Socket::TYPE_TCP);
+	client.setV4only(true);
+	client.connect("127.0.0.1", port);
+
+	LineCounter counter;
+	auto sock = BufferedSocket::getSocket('\n', true);
+	sock->addListener(&counter);
+	sock->accept(srv, false, false);
+	client.waitConnected(30000);
+
+	state.setBytes(batch.size());
+	state.setItems(LINES);
+	state.run([&] {
+		client.writeAll(batch.data(), static_cast<int>(batch.size()));
+		counter.done.wait();
+	});
+
+	BufferedSocket::putSocket(sock);
+	BufferedSocket::waitShutdown();
+
+	if(!counter.failed.empty()) {
+		fprintf(stderr, "buffered_socket_lines: %s\n", counter.failed.c_str());
+	}
+}
@@ -0,0 +1,65 @@
+#include "bench.h"
+
+#include <dcpp/Speaker.h>
+#include <dcpp/Thread.h>
+
+#include <atomic>
+#include <memory>
+
+using namespace dcpp;
+
+namespace {
+
+struct CountListener {
+	template<int I> struct X { enum { TYPE = I }; };
+
+	typedef X<0> Event;
+
+	void on(Event, int n) noexcept { calls += n; }
+
+	std::atomic<int> calls { 0 };
+};
+
+/** Keeps firing on another thread until destroyed. */
+struct Firing : public Thread {
+	explicit Firing(Speaker<CountListener>& speaker) : speaker(speaker), stop(false) { start(); }
+	~Firing() { stop = true; join(); }
+
+	int run() {
+		while(!stop) {
+			speaker.fire(CountListener::Event(), 1);
+		}
+		return 0;
+	}
+
+	Speaker<CountListener>& speaker;
+	std::atomic<bool> stop;
+};
+
+void fire(bench::State& state, int otherThreads) {
+	Speaker<CountListener> speaker;
+	CountListener listeners[4];
+	for(auto& l: listeners) {
+		speaker.addListener(&l);
+	}
+
+	std::vector<std::unique_ptr<Firing>> others;
+	for(int i = 0; i < otherThreads; ++i) {
+		others.emplace_back(new Firing(speaker));
+	}
+
+	state.run([&] { speaker.fire(CountListener::Event(), 1); });
+}
+
+}
+
+BENCH(speaker_fire)
+{
+	fire(state, 0);
+}
+
+/** With 3 other threads firing on the same speaker at the same time. */
+BENCH(speaker_fire_4_threads)
+{
+	fire(state, 3);
+}
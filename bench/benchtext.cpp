@@ -0,0 +1,89 @@
+#include "bench.h"
+
+#include <dcpp/Text.h>
+#include <dcpp/Util.h>
+
+using namespace dcpp;
+
+namespace {
+
+const std::vector<string>& getNames() {
+	static auto names = bench::makeFileNames(10000);
+	return names;
+}
+
+size_t getBytes(const std::vector<string>& names) {
+	size_t ret = 0;
+	for(auto& name: names) {
+		ret += name.size();
+	}
+	return ret;
+}
+
+/** Chat lines as an NMDC hub in a legacy charset sends them. */
+void convert(bench::State& state, const string& text) {
+	Text::initialize();
+
+	std::vector<string> lines;
+	for(int i = 0; i < 100; ++i) {
+		lines.push_back("<someone" + Util::toString(i) + "> " + text);
+	}
+
+	string tmp;
+	state.setBytes(getBytes(lines));
+	state.setItems(lines.size());
+	state.run([&] {
+		for(auto& line: lines) {
+			bench::use(Text::toUtf8(line, "CP1252", tmp));
+		}
+	});
+}
+
+}
+
+BENCH(text_to_lower)
+{
+	auto& names = getNames();
+	string lower;
+	state.setBytes(getBytes(names));
+	state.setItems(names.size());
+	state.run([&] {
+		for(auto& name: names) {
+			bench::use(Text::toLower(name, lower));
+		}
+	});
+}
+
+BENCH(util_stricmp)
+{
+	auto& names = getNames();
+	// the same names, upper cased where it's cheap, so that most comparisons go all the way
+	auto other = names;
+	for(auto& name: other) {
+		for(auto& c: name) {
+			if(c >= 'a' && c <= 'z') {
+				c -= 'a' - 'A';
+			}
+		}
+	}
+
+	state.setBytes(getBytes(names));
+	state.setItems(names.size());
+	state.run([&] {
+		int ret = 0;
+		for(size_t i = 0; i < names.size(); ++i) {
+			ret += Util::stricmp(names[i].c_str(), other[i].c_str());
+		}
+		bench::use(ret);
+	});
+}
+
+BENCH(text_to_utf8_ascii)
+{
+	convert(state, "has anyone got the new release of that album? thanks in advance");
+}
+
+BENCH(text_to_utf8_latin)
+{
+	convert(state, "d\xe9j\xe0 vu, \xe7\xe0 va tr\xe8s bien, merci \xe0 tous");
+}
@@ -0,0 +1,57 @@
+#include "bench.h"
+
+#include <dcpp/File.h>
+#include <dcpp/MerkleTree.h>
+#include <dcpp/TreeChecker.h>
+#include <dcpp/Util.h>
+
+using namespace dcpp;
+
+namespace {
+
+const size_t SIZE = 64 * 1024 * 1024;
+
+/** Checks a finished download against its tree, as QueueManager does on recheck. */
+void check(bench::State& state, size_t threads) {
+#ifdef _WIN32
+	auto path = Util::getTempPath() + "treechecker";
+#else
+	string path = "/tmp/dcpp-bench-treechecker";
+#endif
+
+	TigerTree tt(1024 * 1024);
+	{
+		auto data = bench::makeData(SIZE);
+		tt.update(data.data(), data.size());
+		tt.finalize();
+
+		File f(path, File::WRITE, File::CREATE | File::TRUNCATE);
+		f.write(data);
+	}
+
+	state.setBytes(SIZE);
+	state.run([&] {
+		int64_t good = 0;
+		TreeChecker(path, tt).check(TreeChecker::getRanges(SIZE, tt.getBlockSize()), threads, [&](const std::vector<Segment>& verified) {
+			for(auto& i: verified) {
+				good += i.getSize();
+			}
+			return true;
+		});
+		bench::use(good);
+	});
+
+	File::deleteFile(path);
+}
+
+}
+
+BENCH(tree_checker_64MiB)
+{
+	check(state, 1);
+}
+
+BENCH(tree_checker_64MiB_4_threads)
+{
+	check(state, 4);
+}
@@ -0,0 +1,81 @@
+#include "bench.h"
+
+#include <dcpp/BZUtils.h>
+#include <dcpp/FilteredFile.h>
+#include <dcpp/ParallelUnBZ.h>
+#include <dcpp/Streams.h>
+#include <dcpp/Util.h>
+
+#include <thread>
+
+using namespace dcpp;
+
+namespace {
+
+/** Reads the stream to its end; returns how many bytes came out. */
+size_t drain(InputStream& is, string* out = nullptr) {
+	size_t ret = 0;
+	char buf[64 * 1024];
+	for(;;) {
+		size_t len = sizeof(buf);
+		auto n = is.read(buf, len);
+		if(n == 0) {
+			break;
+		}
+		if(out) {
+			out->append(buf, n);
+		}
+		ret += n;
+	}
+	return ret;
+}
+
+/** A files.xml.bz2 of about 16 MiB once unpacked, so made of many 900 KiB blocks. */
+const string& getListing(size_t& size) {
+	static size_t textSize = 0;
+	static string compressed = [] {
+		auto names = bench::makeFileNames(100000);
+		bench::Random r;
+
+		string text;
+		while(text.size() < 16 * 1024 * 1024) {
+			text += "<File Name=\"" + names[r.next(names.size())] + "\" Size=\"" +
+				Util::toString(static_cast<int64_t>(r.next(1u << 30))) + "\"/>\r\n";
+		}
+		textSize = text.size();
+
+		MemoryInputStream mis(text);
+		FilteredInputStream<BZFilter, false> f(&mis);
+		string ret;
+		drain(f, &ret);
+		return ret;
+	}();
+	size = textSize;
+	return compressed;
+}
+
+}
+
+BENCH(unbz_filter_16MiB)
+{
+	size_t size;
+	auto& compressed = getListing(size);
+	state.setBytes(size);
+	state.run([&] {
+		MemoryInputStream mis(compressed);
+		FilteredInputStream<UnBZFilter, false> f(&mis);
+		bench::use(drain(f));
+	});
+}
+
+BENCH(parallel_unbz_16MiB)
+{
+	size_t size;
+	auto& compressed = getListing(size);
+	state.setBytes(size);
+	state.run([&] {
+		// the reader takes its own copy of the data, as it does when given a file list
+		ParallelUnBZ unbz(string(compressed), std::max(std::thread::hardware_concurrency(), 1u));
+		bench::use(drain(unbz));
+	});
+}
@@ -0,0 +1,91 @@
+#include "bench.h"
+
+#include <dcpp/CompactListing.h>
+#include <dcpp/SimpleXMLReader.h>
+#include <dcpp/Streams.h>
+#include <dcpp/Util.h>
+
+using namespace dcpp;
+
+namespace {
+
+const int DIRS = 2000, FILES = 100;
+
+/** A files.xml as big as the share of a large user. */
+string makeListing() {
+	auto names = bench::makeFileNames(DIRS * FILES);
+	bench::Random r;
+
+	string xml = "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\"?>\r\n"
+		"<FileListing Version=\"1\" CID=\"KAY6BI76T6XFIQXZNRYXZH4YKMQ2DUJOHSHYKOQ\" Base=\"/\" Generator=\"bench\">\r\n";
+	for(int i = 0; i < DIRS; ++i) {
+		xml += "<Directory Name=\"Some Artist &amp; Friends - Album " + Util::toString(i) + "\">\r\n";
+		for(int j = 0; j < FILES; ++j) {
+			xml += "<File Name=\"" + names[i * FILES + j] + "\" Size=\"" + Util::toString(static_cast<int64_t>(r.next())) +
+				"\" TTH=\"" + string(39, 'A' + r.next(26)) + "\"/>\r\n";
+		}
+		xml += "</Directory>\r\n";
+	}
+	xml += "</FileListing>";
+	return xml;
+}
+
+struct TagCounter : SimpleXMLReader::CallBack {
+	void startTag(std::string_view, const AttribViewList& attribs, bool) {
+		++tags;
+		this->attribs += attribs.size();
+	}
+
+	size_t tags = 0;
+	size_t attribs = 0;
+};
+
+/** The same count through the older callback, which gets copies of the attributes. */
+struct CopyingTagCounter : SimpleXMLReader::CallBack {
+	void startTag(const string&, StringPairList& attribs, bool) {
+		++tags;
+		this->attribs += attribs.size();
+	}
+
+	size_t tags = 0;
+	size_t attribs = 0;
+};
+
+}
+
+BENCH(xml_reader_listing)
+{
+	auto xml = makeListing();
+	state.setBytes(xml.size());
+	state.setItems(DIRS * FILES);
+	state.run([&] {
+		TagCounter c;
+		SimpleXMLReader(&c).parse(xml);
+		bench::use(c.attribs);
+	});
+}
+
+BENCH(xml_reader_listing_copied_attribs)
+{
+	auto xml = makeListing();
+	state.setBytes(xml.size());
+	state.setItems(DIRS * FILES);
+	state.run([&] {
+		CopyingTagCounter c;
+		SimpleXMLReader(&c).parse(xml);
+		bench::use(c.attribs);
+	});
+}
+
+BENCH(compact_listing_load)
+{
+	auto xml = makeListing();
+	state.setBytes(xml.size());
+	state.setItems(DIRS * FILES);
+	state.run([&] {
+		CompactListing l(HintedUser(UserPtr(), Util::emptyString));
+		MemoryInputStream mis(xml);
+		l.loadXML(mis);
+		bench::use(l.getFileCount());
+	});
+}
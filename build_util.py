@@ -364,6 +364,8 @@ class Dev:
         if self.is_win32():
             env.Append(CPPPATH=["#/bzip2"])
         env.Append(CPPPATH=["#/maxminddb", "#/zlib"])
+        if env["zlib_ng"]:
+            env.Append(LIBS=["z"])
 
         if self.is_win32():
             env.Append(LIBS=["gdi32", "iphlpapi", "ole32", "ws2_32"])
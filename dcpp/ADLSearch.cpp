@@ -27,9 +27,15 @@
 #include "File.h"
 #include "QueueManager.h"
 #include "SimpleXML.h"
+#include "StringTokenizer.h"
+
+#include <thread>
 
 namespace dcpp {
 
+using std::max;
+using std::min;
+
 ADLSearch::ADLSearch() :
 searchString(_("<Enter string>")),
 isActive(true),
@@ -89,7 +95,7 @@ string ADLSearch::SizeTypeToString(SizeType t) {
 	}
 }
 
-int64_t ADLSearch::GetSizeBase() {
+int64_t ADLSearch::GetSizeBase() const {
 	switch(typeFileSize) {
 	default:
 	case SizeBytes:		return (int64_t)1;
@@ -112,48 +118,395 @@ void ADLSearch::prepare(ParamMap& params) {
 	match.prepare();
 }
 
-bool ADLSearch::matchesFile(const string& f, const string& fp, int64_t size) {
-	// Check status
-	if(!isActive) {
+bool ADLSearch::matchesSize(int64_t size) const {
+	if(minFileSize >= 0 && size < minFileSize * GetSizeBase()) {
+		// Too small
 		return false;
 	}
+	if(maxFileSize >= 0 && size > maxFileSize * GetSizeBase()) {
+		// Too large
+		return false;
+	}
+	return true;
+}
 
-	// Check size for files
-	if(size >= 0 && (sourceType == OnlyFile || sourceType == FullPath)) {
-		if(minFileSize >= 0 && size < minFileSize * GetSizeBase()) {
-			// Too small
-			return false;
+namespace {
+
+// Position of the bracket closing the bracket expression that starts at i.
+size_t skipBracket(const string& re, size_t i) {
+	++i;
+	if(i < re.size() && re[i] == '^') {
+		++i;
+	}
+	if(i < re.size() && re[i] == ']') {
+		++i;
+	}
+	for(; i < re.size(); ++i) {
+		if(re[i] == '\\') {
+			++i;
+		} else if(re[i] == '[' && i + 1 < re.size() && re[i + 1] == ':') {
+			i = re.find(":]", i + 2);
+			if(i == string::npos) {
+				return i;
+			}
+			++i;
+		} else if(re[i] == ']') {
+			return i;
 		}
-		if(maxFileSize >= 0 && size > maxFileSize * GetSizeBase()) {
-			// Too large
-			return false;
+	}
+	return string::npos;
+}
+
+// Position of the parenthesis closing the group that starts at i.
+size_t skipGroup(const string& re, size_t i) {
+	int depth = 0;
+	for(; i < re.size(); ++i) {
+		switch(re[i]) {
+		case '\\': ++i; break;
+		case '[': i = skipBracket(re, i); if(i == string::npos) { return i; } break;
+		case '(': ++depth; break;
+		case ')': if(--depth == 0) { return i; } break;
 		}
 	}
+	return string::npos;
+}
 
-	// Do search
-	switch(sourceType) {
-	default:
-	case OnlyDirectory:	return false;
-	case OnlyFile:		return searchAll(f);
-	case FullPath:		return searchAll(fp);
+/* The longest run of ASCII characters that any text matching the regular expression contains,
+lowercased; empty when there is none. Only the top level of the expression is looked at, and
+anything unusual (alternatives, options, quoting, odd escapes) gives up. */
+string requiredLiteral(const string& re) {
+	if(re.find("(?") != string::npos || re.find("\\Q") != string::npos) {
+		return string();
 	}
+
+	string best, run;
+	auto commit = [&] {
+		if(run.size() > best.size()) {
+			best = run;
+		}
+		run.clear();
+	};
+
+	for(size_t i = 0; i < re.size(); ++i) {
+		auto c = re[i];
+		switch(c) {
+		case '|': case ')': case ']': return string();
+		case '*': case '?': case '{':
+			{
+				// the previous character may not be there at all
+				if(!run.empty()) {
+					run.pop_back();
+				}
+				commit();
+				if(c == '{') {
+					// only {n}, {n,} and {n,m}
+					auto end = re.find('}', i);
+					if(end == string::npos || end == i + 1 || re.find_first_not_of("0123456789,", i + 1) != end
+						|| !isdigit(static_cast<unsigned char>(re[i + 1])) || std::count(re.begin() + i, re.begin() + end, ',') > 1)
+					{
+						return string();
+					}
+					i = end;
+				}
+				break;
+			}
+		case '+': commit(); break;
+		case '.': case '^': case '$': commit(); break;
+		case '(':
+			{
+				commit();
+				i = skipGroup(re, i);
+				if(i == string::npos) {
+					return string();
+				}
+				break;
+			}
+		case '[':
+			{
+				commit();
+				i = skipBracket(re, i);
+				if(i == string::npos) {
+					return string();
+				}
+				break;
+			}
+		case '\\':
+			{
+				if(++i == re.size() || (re[i] & 0x80)) {
+					return string();
+				}
+				c = re[i];
+				if(isalnum(static_cast<unsigned char>(c))) {
+					// classes and assertions; anything else (back-references, hex codes...) is not worth it
+					if(!strchr("dDwWsSbBAzZ", c)) {
+						return string();
+					}
+					commit();
+				} else {
+					run += c;
+				}
+				break;
+			}
+		default:
+			{
+				if(c & 0x80) {
+					commit();
+				} else {
+					run += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+				}
+				break;
+			}
+		}
+	}
+	commit();
+	return best;
 }
 
-bool ADLSearch::matchesDirectory(const string& d) {
-	// Check status
-	if(!isActive) {
-		return false;
+} // unnamed namespace
+
+class ADLSearchManager::Rules {
+public:
+	explicit Rules(const SearchCollection& collection);
+
+	/** Find the searches matching a directory, its files and its subdirectories. */
+	void matchTree(DirectoryListing& filelist, DirectoryListing::Directory* aDir, const string& aPath, Matches& matches) const;
+	/** Find the searches matching the files of a directory. */
+	void matchFiles(DirectoryListing& filelist, DirectoryListing::Directory* aDir, const string& aPath, Matches& matches) const;
+
+private:
+	struct Rule {
+		uint32_t search;
+		/// Distinct terms to find; for a regular expression, the literal it requires if any
+		uint32_t terms;
+	};
+
+	/// The searches of one source type
+	struct Set {
+		void add(uint32_t search, const StringList& searchTerms, bool regEx);
+
+		StringSearch::List terms;
+		/// Rules (indexes in rules) that need each term
+		vector<vector<uint32_t>> termRules;
+		vector<Rule> rules;
+		/// Regular expressions without any literal to look for, that have to be tried on every name
+		vector<uint32_t> unfiltered;
+
+		StringList pending;
+		unordered_map<string, uint32_t> termIndex;
+	};
+
+	/// Terms and rules seen in the name being matched, per thread
+	struct Scratch {
+		Scratch(size_t terms, size_t rules) : termSeen(terms, 0), ruleSeen(rules, 0), hits(rules, 0), generation(0) { }
+
+		uint32_t next();
+
+		vector<uint32_t> termSeen;
+		vector<uint32_t> ruleSeen;
+		vector<uint32_t> hits;
+		uint32_t generation;
+		vector<uint32_t> candidates;
+	};
+
+	void match(const Set& set, const string& text, int64_t size, Scratch& scratch, vector<uint32_t>& ret) const;
+	void matchTree(DirectoryListing& filelist, DirectoryListing::Directory* aDir, const string& aPath, Matches& matches, Scratch& scratch) const;
+	void matchFiles(DirectoryListing& filelist, DirectoryListing::Directory* aDir, const string& aPath, Matches& matches, Scratch& scratch) const;
+	Scratch makeScratch() const;
+
+	const SearchCollection& collection;
+	Set files;
+	Set paths;
+	Set directories;
+};
+
+ADLSearchManager::Rules::Rules(const SearchCollection& collection) : collection(collection) {
+	for(uint32_t i = 0; i < collection.size(); ++i) {
+		auto& search = collection[i];
+		if(!search.isActive) {
+			continue;
+		}
+
+		Set* set;
+		switch(search.sourceType) {
+		case ADLSearch::OnlyFile: set = &files; break;
+		case ADLSearch::FullPath: set = &paths; break;
+		case ADLSearch::OnlyDirectory: set = &directories; break;
+		default: continue;
+		}
+
+		StringList terms;
+		if(search.isRegEx()) {
+			auto literal = requiredLiteral(search.match.pattern);
+			if(!literal.empty()) {
+				terms.push_back(std::move(literal));
+			}
+		} else {
+			// same tokens as StringMatch
+			StringTokenizer<string> st(search.match.pattern, ' ');
+			for(auto& term: st.getTokens()) {
+				if(!term.empty()) {
+					terms.push_back(term);
+				}
+			}
+		}
+
+		set->add(i, terms, search.isRegEx());
 	}
-	if(sourceType != OnlyDirectory) {
-		return false;
+
+	for(auto set: { &files, &paths, &directories }) {
+		set->terms.assign(set->pending.begin(), set->pending.end());
+		set->pending.clear();
+		set->termIndex.clear();
+	}
+}
+
+void ADLSearchManager::Rules::Set::add(uint32_t search, const StringList& searchTerms, bool regEx) {
+	if(searchTerms.empty() && !regEx) {
+		// never matches
+		return;
+	}
+
+	auto rule = static_cast<uint32_t>(rules.size());
+	Rule r = { search, 0 };
+	rules.push_back(r);
+	if(searchTerms.empty()) {
+		unfiltered.push_back(rule);
 	}
 
-	// Do search
-	return searchAll(d);
+	for(auto& term: searchTerms) {
+		auto lower = Text::toLower(term);
+		auto i = termIndex.emplace(lower, static_cast<uint32_t>(pending.size()));
+		if(i.second) {
+			pending.push_back(lower);
+			termRules.emplace_back();
+		}
+
+		auto& needing = termRules[i.first->second];
+		if(needing.empty() || needing.back() != rule) {
+			needing.push_back(rule);
+			++rules.back().terms;
+		}
+	}
 }
 
-bool ADLSearch::searchAll(const string& s) {
-	return match.match(s);
+uint32_t ADLSearchManager::Rules::Scratch::next() {
+	if(++generation == 0) {
+		fill(termSeen.begin(), termSeen.end(), 0);
+		fill(ruleSeen.begin(), ruleSeen.end(), 0);
+		generation = 1;
+	}
+	return generation;
+}
+
+ADLSearchManager::Rules::Scratch ADLSearchManager::Rules::makeScratch() const {
+	size_t terms = 0, rules = 0;
+	for(auto set: { &files, &paths, &directories }) {
+		terms = max(terms, set->terms.size());
+		rules = max(rules, set->rules.size());
+	}
+	return Scratch(terms, rules);
+}
+
+void ADLSearchManager::Rules::match(const Set& set, const string& text, int64_t size, Scratch& scratch, vector<uint32_t>& ret) const {
+	if(set.rules.empty()) {
+		return;
+	}
+
+	auto generation = scratch.next();
+	auto& candidates = scratch.candidates;
+	candidates = set.unfiltered;
+
+	if(!set.terms.empty()) {
+		// a single pass over the name finds the terms of all the searches
+		set.terms.find(text, [&](size_t term) {
+			if(scratch.termSeen[term] == generation) {
+				return;
+			}
+			scratch.termSeen[term] = generation;
+
+			for(auto rule: set.termRules[term]) {
+				if(scratch.ruleSeen[rule] != generation) {
+					scratch.ruleSeen[rule] = generation;
+					scratch.hits[rule] = 0;
+				}
+				if(++scratch.hits[rule] == set.rules[rule].terms) {
+					candidates.push_back(rule);
+				}
+			}
+		});
+	}
+
+	for(auto rule: candidates) {
+		auto& search = collection[set.rules[rule].search];
+		if(size >= 0 && !search.matchesSize(size)) {
+			continue;
+		}
+		if(search.isRegEx() && !search.match.match(text)) {
+			continue;
+		}
+		ret.push_back(set.rules[rule].search);
+	}
+}
+
+void ADLSearchManager::Rules::matchTree(DirectoryListing& filelist, DirectoryListing::Directory* aDir, const string& aPath, Matches& matches) const {
+	auto scratch = makeScratch();
+	matchTree(filelist, aDir, aPath, matches, scratch);
+}
+
+void ADLSearchManager::Rules::matchFiles(DirectoryListing& filelist, DirectoryListing::Directory* aDir, const string& aPath, Matches& matches) const {
+	auto scratch = makeScratch();
+	matchFiles(filelist, aDir, aPath, matches, scratch);
+}
+
+void ADLSearchManager::Rules::matchTree(DirectoryListing& filelist, DirectoryListing::Directory* aDir, const string& aPath, Matches& matches, Scratch& scratch) const {
+	if(!aDir->getName().empty()) {
+		vector<uint32_t> found;
+		match(directories, aDir->getName(), -1, scratch, found);
+		if(!found.empty()) {
+			sort(found.begin(), found.end());
+			matches[aDir] = std::move(found);
+		}
+	}
+
+	for(auto dir: aDir->directories) {
+		if(filelist.getAbort()) { return; }
+		matchTree(filelist, dir, aPath + "\\" + dir->getName(), matches, scratch);
+	}
+
+	matchFiles(filelist, aDir, aPath, matches, scratch);
+}
+
+void ADLSearchManager::Rules::matchFiles(DirectoryListing& filelist, DirectoryListing::Directory* aDir, const string& aPath, Matches& matches, Scratch& scratch) const {
+	for(auto file: aDir->files) {
+		if(filelist.getAbort()) { return; }
+		if(file->getName().empty()) {
+			continue;
+		}
+
+		vector<uint32_t> found;
+		match(files, file->getName(), file->getSize(), scratch, found);
+		if(!paths.rules.empty()) {
+			match(paths, aPath + "\\" + file->getName(), file->getSize(), scratch, found);
+		}
+		if(!found.empty()) {
+			sort(found.begin(), found.end());
+			matches[file] = std::move(found);
+		}
+	}
+}
+
+ADLSearchManager::Matcher::Matcher(const Rules& rules, DirectoryListing& filelist, const vector<DirectoryListing::Directory*>& dirs,
+	const string& path, std::atomic<size_t>& nextDir) :
+rules(rules), filelist(filelist), dirs(dirs), path(path), nextDir(nextDir)
+{
+	start();
+}
+
+int ADLSearchManager::Matcher::run() {
+	for(size_t i; (i = nextDir++) < dirs.size() && !filelist.getAbort();) {
+		rules.matchTree(filelist, dirs[i], path + "\\" + dirs[i]->getName(), matches);
+	}
+	return 0;
 }
 
 ADLSearchManager::ADLSearchManager() : user(UserPtr(), Util::emptyString) {
@@ -279,7 +632,7 @@ void ADLSearchManager::save() {
 	} catch(const SimpleXMLException&) { }
 }
 
-void ADLSearchManager::matchesFile(DestDirList& destDirVector, DirectoryListing::File *currentFile, string& fullPath) {
+void ADLSearchManager::matchesFile(DestDirList& destDirVector, DirectoryListing::File *currentFile, const Matches& matches) {
 	// Add to any substructure being stored
 	for(auto& id: destDirVector) {
 		if(id.subdir != NULL) {
@@ -291,38 +644,37 @@ void ADLSearchManager::matchesFile(DestDirList& destDirVector, DirectoryListing:
 		id.fileAdded = false;	// Prepare for next stage
 	}
 
-	// Prepare to match searches
-	if(currentFile->getName().size() < 1) {
+	auto found = matches.find(currentFile);
+	if(found == matches.end()) {
 		return;
 	}
 
-	string filePath = fullPath + "\\" + currentFile->getName();
-	// Match searches
-	for(auto& is: collection) {
+	// Apply the matching searches, in collection order
+	for(auto i: found->second) {
+		auto& is = collection[i];
 		if(destDirVector[is.ddIndex].fileAdded) {
 			continue;
 		}
-		if(is.matchesFile(currentFile->getName(), filePath, currentFile->getSize())) {
-			DirectoryListing::File *copyFile = new DirectoryListing::File(*currentFile, true);
-			destDirVector[is.ddIndex].dir->files.insert(copyFile);
-			destDirVector[is.ddIndex].fileAdded = true;
-
-			if(is.isAutoQueue){
-				try {
-					QueueManager::getInstance()->add(SETTING(DOWNLOAD_DIRECTORY) + currentFile->getName(),
-						currentFile->getSize(), currentFile->getTTH(), getUser());
-				} catch(const Exception&) { }
-			}
 
-			if(breakOnFirst) {
-				// Found a match, search no more
-				break;
-			}
+		DirectoryListing::File *copyFile = new DirectoryListing::File(*currentFile, true);
+		destDirVector[is.ddIndex].dir->files.insert(copyFile);
+		destDirVector[is.ddIndex].fileAdded = true;
+
+		if(is.isAutoQueue){
+			try {
+				QueueManager::getInstance()->add(SETTING(DOWNLOAD_DIRECTORY) + currentFile->getName(),
+					currentFile->getSize(), currentFile->getTTH(), getUser());
+			} catch(const Exception&) { }
+		}
+
+		if(breakOnFirst) {
+			// Found a match, search no more
+			break;
 		}
 	}
 }
 
-void ADLSearchManager::matchesDirectory(DestDirList& destDirVector, DirectoryListing::Directory* currentDir, string& fullPath) {
+void ADLSearchManager::matchesDirectory(DestDirList& destDirVector, DirectoryListing::Directory* currentDir, string& fullPath, const Matches& matches) {
 	// Add to any substructure being stored
 	for(auto& id: destDirVector) {
 		if(id.subdir != NULL) {
@@ -333,24 +685,24 @@ void ADLSearchManager::matchesDirectory(DestDirList& destDirVector, DirectoryLis
 		}
 	}
 
-	// Prepare to match searches
-	if(currentDir->getName().size() < 1) {
+	auto found = matches.find(currentDir);
+	if(found == matches.end()) {
 		return;
 	}
 
-	// Match searches
-	for(auto& is: collection) {
+	// Apply the matching searches, in collection order
+	for(auto i: found->second) {
+		auto& is = collection[i];
 		if(destDirVector[is.ddIndex].subdir != NULL) {
 			continue;
 		}
-		if(is.matchesDirectory(currentDir->getName())) {
-			destDirVector[is.ddIndex].subdir =
-				new DirectoryListing::AdlDirectory(fullPath, destDirVector[is.ddIndex].dir, currentDir->getName());
-			destDirVector[is.ddIndex].dir->directories.insert(destDirVector[is.ddIndex].subdir);
-			if(breakOnFirst) {
-				// Found a match, search no more
-				break;
-			}
+
+		destDirVector[is.ddIndex].subdir =
+			new DirectoryListing::AdlDirectory(fullPath, destDirVector[is.ddIndex].dir, currentDir->getName());
+		destDirVector[is.ddIndex].dir->directories.insert(destDirVector[is.ddIndex].subdir);
+		if(breakOnFirst) {
+			// Found a match, search no more
+			break;
 		}
 	}
 }
@@ -435,22 +787,48 @@ void ADLSearchManager::matchListing(DirectoryListing& aDirList) {
 	setBreakOnFirst(SETTING(ADLS_BREAK_ON_FIRST));
 
 	string path(root->getName());
-	matchRecurse(destDirs, aDirList, root, path);
+
+	// Find out which searches match each name first; top-level directories are spread over a few
+	// threads, which only read the listing.
+	Rules rules(collection);
+	Matches matches;
+	rules.matchFiles(aDirList, root, path, matches);
+
+	{
+		vector<DirectoryListing::Directory*> dirs(root->directories.begin(), root->directories.end());
+		std::atomic<size_t> nextDir(0);
+		auto threads = min(static_cast<size_t>(max(std::thread::hardware_concurrency(), 1u)), dirs.size());
+
+		vector<unique_ptr<Matcher>> matchers;
+		for(size_t i = 0; i < threads; ++i) {
+			matchers.emplace_back(new Matcher(rules, aDirList, dirs, path, nextDir));
+		}
+
+		for(auto& matcher: matchers) {
+			matcher->join();
+			matches.insert(make_move_iterator(matcher->matches.begin()), make_move_iterator(matcher->matches.end()));
+		}
+	}
+
+	if(aDirList.getAbort()) { throw Exception(); }
+
+	// Then build the destination directories, in listing order.
+	matchRecurse(destDirs, aDirList, root, path, matches);
 
 	finalizeDestinationDirectories(destDirs, root);
 }
 
-void ADLSearchManager::matchRecurse(DestDirList& aDestList, DirectoryListing& filelist, DirectoryListing::Directory* aDir, string& aPath) {
+void ADLSearchManager::matchRecurse(DestDirList& aDestList, DirectoryListing& filelist, DirectoryListing::Directory* aDir, string& aPath, const Matches& matches) {
 	for(auto& dirIt: aDir->directories) {
 		if(filelist.getAbort()) { throw Exception(); }
 		string tmpPath = aPath + "\\" + dirIt->getName();
-		matchesDirectory(aDestList, dirIt, tmpPath);
-		matchRecurse(aDestList, filelist, dirIt, tmpPath);
+		matchesDirectory(aDestList, dirIt, tmpPath, matches);
+		matchRecurse(aDestList, filelist, dirIt, tmpPath, matches);
 	}
 
 	for(auto& fileIt: aDir->files) {
 		if(filelist.getAbort()) { throw Exception(); }
-		matchesFile(aDestList, fileIt, aPath);
+		matchesFile(aDestList, fileIt, matches);
 	}
 
 	stepUpDirectory(aDestList);
@@ -27,6 +27,9 @@
 #include "SettingsManager.h"
 #include "Singleton.h"
 #include "StringMatch.h"
+#include "Thread.h"
+
+#include <atomic>
 
 namespace dcpp {
 
@@ -75,7 +78,7 @@ public:
 
 	SizeType StringToSizeType(const string& s);
 	string SizeTypeToString(SizeType t);
-	int64_t GetSizeBase();
+	int64_t GetSizeBase() const;
 
 	/// Name of the destination directory (empty = 'ADLSearch') and its index
 	string destDir;
@@ -92,12 +95,8 @@ private:
 	/// Prepare search
 	void prepare(ParamMap& params);
 
-	/// Search for file match
-	bool matchesFile(const string& f, const string& fp, int64_t size);
-	/// Search for directory match
-	bool matchesDirectory(const string& d);
-
-	bool searchAll(const string& s);
+	/// Check the size limits of file searches
+	bool matchesSize(int64_t size) const;
 };
 
 /// Class that holds all active searches
@@ -132,12 +131,39 @@ public:
 	void matchListing(DirectoryListing& aDirList);
 
 private:
+	/// The active searches compiled into one automaton per source type, so that each name is
+	/// only scanned once whatever the number of searches.
+	class Rules;
+
+	/// Indexes in the collection of the searches matching each file / directory, in collection
+	/// order; files and directories without any match are left out.
+	typedef unordered_map<const void*, vector<uint32_t>> Matches;
+
+	/// Matches the top-level directories of a listing in parallel.
+	class Matcher : public Thread {
+	public:
+		Matcher(const Rules& rules, DirectoryListing& filelist, const vector<DirectoryListing::Directory*>& dirs,
+			const string& path, std::atomic<size_t>& nextDir);
+		virtual ~Matcher() { join(); }
+
+		Matches matches;
+
+	private:
+		virtual int run();
+
+		const Rules& rules;
+		DirectoryListing& filelist;
+		const vector<DirectoryListing::Directory*>& dirs;
+		const string& path;
+		std::atomic<size_t>& nextDir;
+	};
+
 	// Recurse through the directories and files of a directory.
-	void matchRecurse(DestDirList& aDestList, DirectoryListing& filelist, DirectoryListing::Directory* aDir, string& aPath);
-	// Search for file match
-	void matchesFile(DestDirList& destDirVector, DirectoryListing::File *currentFile, string& fullPath);
-	// Search for directory match
-	void matchesDirectory(DestDirList& destDirVector, DirectoryListing::Directory* currentDir, string& fullPath);
+	void matchRecurse(DestDirList& aDestList, DirectoryListing& filelist, DirectoryListing::Directory* aDir, string& aPath, const Matches& matches);
+	// Apply the searches matching a file
+	void matchesFile(DestDirList& destDirVector, DirectoryListing::File *currentFile, const Matches& matches);
+	// Apply the searches matching a directory
+	void matchesDirectory(DestDirList& destDirVector, DirectoryListing::Directory* currentDir, string& fullPath, const Matches& matches);
 	// Step up directory
 	void stepUpDirectory(DestDirList& destDirVector);
 
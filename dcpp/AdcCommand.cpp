@@ -33,9 +33,37 @@ AdcCommand::AdcCommand(const string& aLine, bool nmdc /* = false */) : cmdInt(0)
 	parse(aLine, nmdc);
 }
 
+AdcCommand::AdcCommand(const View& view) : cmdInt(0), type(TYPE_CLIENT) {
+	assign(view);
+}
+
 void AdcCommand::parse(const string& aLine, bool nmdc /* = false */) {
+	assign(View(aLine, nmdc));
+}
+
+void AdcCommand::assign(const View& view) {
+	cmdInt = view.getCommand();
+	type = view.getType();
+	from = view.getFrom();
+	to = view.getTo();
+
+	parameters.reserve(parameters.size() + view.getParamCount());
+	for(size_t i = 0, n = view.getParamCount(); i < n; ++i) {
+		parameters.emplace_back();
+		view.getParam(i, parameters.back());
+	}
+}
+
+void AdcCommand::View::parse(std::string_view aLine, bool aNmdc /* = false */) {
 	string::size_type i = 5;
 
+	nmdc = aNmdc;
+	cmdInt = 0;
+	from = 0;
+	to = 0;
+	parameters.clear();
+	features = std::string_view();
+
 	if(nmdc) {
 		// "$ADCxxx ..."
 		if(aLine.length() < 7)
@@ -63,87 +91,67 @@ void AdcCommand::parse(const string& aLine, bool nmdc /* = false */) {
 		from = HUB_SID;
 	}
 
-	string::size_type len = aLine.length();
-	const char* buf = aLine.c_str();
-	string cur;
-	cur.reserve(128);
-
 	bool toSet = false;
 	bool featureSet = false;
 	bool fromSet = nmdc; // $ADCxxx never have a from CID...
 
-	while(i < len) {
-		switch(buf[i]) {
-		case '\\':
-			++i;
-			if(i == len)
-				throw ParseException("Escape at eol");
-			if(buf[i] == 's')
-				cur += ' ';
-			else if(buf[i] == 'n')
-				cur += '\n';
-			else if(buf[i] == '\\')
-				cur += '\\';
-			else if(buf[i] == ' ' && nmdc)	// $ADCGET escaping, leftover from old specs
-				cur += ' ';
-			else
-				throw ParseException("Unknown escape");
-			break;
-		case ' ':
-			// New parameter...
-			{
-				if((type == TYPE_BROADCAST || type == TYPE_DIRECT || type == TYPE_ECHO || type == TYPE_FEATURE) && !fromSet) {
-					if(cur.length() != 4) {
-						throw ParseException("Invalid SID length");
-					}
-					from = toSID(cur);
-					fromSet = true;
-				} else if((type == TYPE_DIRECT || type == TYPE_ECHO) && !toSet) {
-					if(cur.length() != 4) {
-						throw ParseException("Invalid SID length");
-					}
-					to = toSID(cur);
-					toSet = true;
-				} else if(type == TYPE_FEATURE && !featureSet) {
-					if(cur.length() % 5 != 0) {
-						throw ParseException("Invalid feature length");
-					}
-					// Skip...
-					featureSet = true;
-				} else {
-					parameters.push_back(cur);
-				}
-				cur.clear();
-			}
-			break;
-		default:
-			cur += buf[i];
-		}
-		++i;
-	}
-	if(!cur.empty()) {
+	// the header fields are checked on their unescaped length
+	string tmp;
+	auto unescaped = [&](std::string_view str) -> std::string_view {
+		if(str.find('\\') == std::string_view::npos)
+			return str;
+		tmp.clear();
+		unescape(str, tmp);
+		return tmp;
+	};
+
+	auto field = [&](std::string_view str) {
 		if((type == TYPE_BROADCAST || type == TYPE_DIRECT || type == TYPE_ECHO || type == TYPE_FEATURE) && !fromSet) {
-			if(cur.length() != 4) {
+			auto sid = unescaped(str);
+			if(sid.length() != 4) {
 				throw ParseException("Invalid SID length");
 			}
-			from = toSID(cur);
+			from = toFourCC(sid.data());
 			fromSet = true;
 		} else if((type == TYPE_DIRECT || type == TYPE_ECHO) && !toSet) {
-			if(cur.length() != 4) {
+			auto sid = unescaped(str);
+			if(sid.length() != 4) {
 				throw ParseException("Invalid SID length");
 			}
-			to = toSID(cur);
+			to = toFourCC(sid.data());
 			toSet = true;
 		} else if(type == TYPE_FEATURE && !featureSet) {
-			if(cur.length() % 5 != 0) {
+			if(unescaped(str).length() % 5 != 0) {
 				throw ParseException("Invalid feature length");
 			}
-            // Skip...
+			features = str;
 			featureSet = true;
 		} else {
-			parameters.push_back(cur);
+			parameters.push_back(str);
+		}
+	};
+
+	const char* buf = aLine.data();
+	string::size_type len = aLine.length();
+	string::size_type start = i;
+
+	for(; i < len; ++i) {
+		if(buf[i] == ' ') {
+			// New parameter...
+			field(std::string_view(buf + start, i - start));
+			start = i + 1;
+		} else if(buf[i] == '\\') {
+			// escapes are validated here so that unescaping later on can't fail
+			++i;
+			if(i == len)
+				throw ParseException("Escape at eol");
+			if(buf[i] != 's' && buf[i] != 'n' && buf[i] != '\\' && !(buf[i] == ' ' && nmdc))	// $ADCGET escaping, leftover from old specs
+				throw ParseException("Unknown escape");
 		}
 	}
+	if(start < len) {
+		field(std::string_view(buf + start, len - start));
+	}
 
 	if((type == TYPE_BROADCAST || type == TYPE_DIRECT || type == TYPE_ECHO || type == TYPE_FEATURE) && !fromSet) {
 		throw ParseException("Missing from_sid");
@@ -158,82 +166,151 @@ void AdcCommand::parse(const string& aLine, bool nmdc /* = false */) {
 	}
 }
 
+void AdcCommand::View::unescape(std::string_view str, string& out) const {
+	// the escapes have been validated by parse
+	for(string::size_type i = 0;;) {
+		auto j = str.find('\\', i);
+		if(j == std::string_view::npos) {
+			out.append(str.data() + i, str.size() - i);
+			return;
+		}
+		out.append(str.data() + i, j - i);
+		switch(str[j + 1]) {
+			case 's': out += ' '; break;
+			case 'n': out += '\n'; break;
+			default: out += str[j + 1]; break; // '\\', or ' ' in $ADC commands
+		}
+		i = j + 2;
+	}
+}
+
+void AdcCommand::View::getParam(size_t n, string& ret) const {
+	ret.clear();
+	unescape(parameters[n], ret);
+}
+
+bool AdcCommand::View::getParam(const char* name, size_t start, string& ret) const {
+	for(auto i = start; i < parameters.size(); ++i) {
+		auto& p = parameters[i];
+		// a backslash can't be part of a name, so the escaped code compares just as well
+		if(p.size() >= 2 && toCode(name) == toCode(p.data())) {
+			ret.clear();
+			unescape(p.substr(2), ret);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool AdcCommand::View::hasFlag(const char* name, size_t start) const {
+	for(auto i = start; i < parameters.size(); ++i) {
+		auto& p = parameters[i];
+		if(p.size() == 3 && toCode(name) == toCode(p.data()) && p[2] == '1') {
+			return true;
+		}
+	}
+	return false;
+}
+
 string AdcCommand::toString(const CID& aCID) const {
-	return getHeaderString(aCID) + getParamString(false);
+	string tmp;
+	getHeaderString(aCID, tmp);
+	getParamString(false, tmp);
+	return tmp;
 }
 
 string AdcCommand::toString(uint32_t sid /* = 0 */, bool nmdc /* = false */) const {
-	return getHeaderString(sid, nmdc) + getParamString(nmdc);
+	string tmp;
+	toString(sid, nmdc, tmp);
+	return tmp;
+}
+
+void AdcCommand::toString(uint32_t sid, bool nmdc, string& out) const {
+	out.clear();
+	getHeaderString(sid, nmdc, out);
+	getParamString(nmdc, out);
 }
 
 string AdcCommand::escape(const string& str, bool old) {
-	string tmp = str;
-	string::size_type i = 0;
-	while( (i = tmp.find_first_of(" \n\\", i)) != string::npos) {
+	string tmp;
+	tmp.reserve(str.size());
+	escape(str, old, tmp);
+	return tmp;
+}
+
+void AdcCommand::escape(std::string_view str, bool old, string& out) {
+	for(string::size_type i = 0;;) {
+		auto j = str.find_first_of(" \n\\", i);
+		if(j == std::string_view::npos) {
+			out.append(str.data() + i, str.size() - i);
+			return;
+		}
+		out.append(str.data() + i, j - i);
+		out += '\\';
 		if(old) {
-			tmp.insert(i, "\\");
+			out += str[j];
 		} else {
-			switch(tmp[i]) {
-				case ' ': tmp.replace(i, 1, "\\s"); break;
-				case '\n': tmp.replace(i, 1, "\\n"); break;
-				case '\\': tmp.replace(i, 1, "\\\\"); break;
+			switch(str[j]) {
+				case ' ': out += 's'; break;
+				case '\n': out += 'n'; break;
+				case '\\': out += '\\'; break;
 			}
 		}
-		i+=2;
+		i = j + 1;
 	}
-	return tmp;
 }
 
-string AdcCommand::getHeaderString(uint32_t sid, bool nmdc) const {
-	string tmp;
+void AdcCommand::getHeaderString(uint32_t sid, bool nmdc, string& out) const {
 	if(nmdc) {
-		tmp += "$ADC";
+		out += "$ADC";
 	} else {
-		tmp += getType();
+		out += getType();
 	}
 
-	tmp += cmdChar;
+	out.append(cmdChar, 3);
 
 	if(type == TYPE_BROADCAST || type == TYPE_DIRECT || type == TYPE_ECHO || type == TYPE_FEATURE) {
-		tmp += ' ';
-		tmp += fromSID(sid);
+		out += ' ';
+		out.append(reinterpret_cast<const char*>(&sid), sizeof(sid));
 	}
 
 	if(type == TYPE_DIRECT || type == TYPE_ECHO) {
-		tmp += ' ';
-		tmp += fromSID(to);
+		out += ' ';
+		out.append(reinterpret_cast<const char*>(&to), sizeof(to));
 	}
 
 	if(type == TYPE_FEATURE) {
-		tmp += ' ';
-		tmp += features;
+		out += ' ';
+		out += features;
 	}
-	return tmp;
 }
 
-string AdcCommand::getHeaderString(const CID& cid) const {
+void AdcCommand::getHeaderString(const CID& cid, string& out) const {
 	dcassert(type == TYPE_UDP);
-	string tmp;
 
-	tmp += getType();
-	tmp += cmdChar;
-	tmp += ' ';
-	tmp += cid.toBase32();
-	return tmp;
+	out += getType();
+	out.append(cmdChar, 3);
+	out += ' ';
+	out += cid.toBase32();
 }
 
-string AdcCommand::getParamString(bool nmdc) const {
-	string tmp;
+void AdcCommand::getParamString(bool nmdc, string& out) const {
+	// most parameters need no escaping, so this is usually the only allocation
+	auto size = out.size() + 1;
 	for(auto& i: getParameters()) {
-		tmp += ' ';
-		tmp += escape(i, nmdc);
+		size += i.size() + 1;
+	}
+	out.reserve(size);
+
+	for(auto& i: getParameters()) {
+		out += ' ';
+		escape(i, nmdc, out);
 	}
 	if(nmdc) {
-		tmp += '|';
+		out += '|';
 	} else {
-		tmp += '\n';
+		out += '\n';
 	}
-	return tmp;
 }
 
 const string& AdcCommand::getParam(size_t n) const {
@@ -243,7 +320,7 @@ const string& AdcCommand::getParam(size_t n) const {
 bool AdcCommand::getParam(const char* name, size_t start, string& ret) const {
 	for(auto i = start; i < getParameters().size(); ++i) {
 		if(toCode(name) == toCode(getParameters()[i].c_str())) {
-			ret = getParameters()[i].substr(2);
+			ret.assign(getParameters()[i], 2, string::npos);
 			return true;
 		}
 	}
@@ -19,6 +19,7 @@
 #define DCPLUSPLUS_DCPP_ADC_COMMAND_H
 
 #include <string>
+#include <string_view>
 
 #include "forward.h"
 #include "Exception.h"
@@ -111,6 +112,7 @@ public:
 	C(RNT, 'R','N','T');
 	C(ZON, 'Z','O','N');
 	C(ZOF, 'Z','O','F');
+	C(PSR, 'P','S','R');
 #undef C
 
 	static const uint32_t HUB_SID = 0xffffffff;		// No client will have this sid
@@ -124,6 +126,47 @@ public:
 	explicit AdcCommand(const string& aLine, bool nmdc = false);
 	void parse(const string& aLine, bool nmdc = false);
 
+	/** A parsed command that keeps its parameters as slices of the line it was read from; they
+	are only unescaped when asked for. The line must outlive the view. */
+	class View {
+	public:
+		View() : cmdInt(0), from(0), to(0), type(TYPE_CLIENT), nmdc(false) { }
+		explicit View(std::string_view aLine, bool nmdc = false) { parse(aLine, nmdc); }
+		/** Parse a new line, reusing the parameter storage of the previous one. */
+		void parse(std::string_view aLine, bool nmdc = false);
+
+		uint32_t getCommand() const { return cmdInt; }
+		char getType() const { return type; }
+		uint32_t getFrom() const { return from; }
+		uint32_t getTo() const { return to; }
+		std::string_view getFeatures() const { return features; }
+
+		size_t getParamCount() const { return parameters.size(); }
+		/** The parameter as it appears on the line, escapes included */
+		std::string_view getRawParam(size_t n) const { return parameters[n]; }
+		/** Unescape a parameter into ret, reusing its storage */
+		void getParam(size_t n, string& ret) const;
+		bool getParam(const char* name, size_t start, string& ret) const;
+		bool hasFlag(const char* name, size_t start) const;
+
+	private:
+		void unescape(std::string_view str, string& out) const;
+
+		vector<std::string_view> parameters;
+		std::string_view features;
+		union {
+			char cmdChar[4];
+			uint8_t cmd[4];
+			uint32_t cmdInt;
+		};
+		uint32_t from;
+		uint32_t to;
+		char type;
+		bool nmdc;
+	};
+
+	explicit AdcCommand(const View& view);
+
 	uint32_t getCommand() const { return cmdInt; }
 	char getType() const { return type; }
 	void setType(char t) { type = t; }
@@ -137,6 +180,8 @@ public:
 
 	string toString(const CID& aCID) const;
 	string toString(uint32_t sid, bool nmdc = false) const;
+	/** Serialize into out, replacing its contents but keeping its storage. */
+	void toString(uint32_t sid, bool nmdc, string& out) const;
 
 	AdcCommand& addParam(const string& name, const string& value) {
 		parameters.push_back(name);
@@ -156,6 +201,8 @@ public:
 	bool operator==(uint32_t aCmd) { return cmdInt == aCmd; }
 
 	static string escape(const string& str, bool old);
+	/** Append the escaped form of str to out. */
+	static void escape(std::string_view str, bool old, string& out);
 	uint32_t getTo() const { return to; }
 	AdcCommand& setTo(const uint32_t sid) { to = sid; return *this; }
 	uint32_t getFrom() const { return from; }
@@ -163,9 +210,10 @@ public:
 	static uint32_t toSID(const string& aSID) { return *reinterpret_cast<const uint32_t*>(aSID.data()); }
 	static string fromSID(const uint32_t aSID) { return string(reinterpret_cast<const char*>(&aSID), sizeof(aSID)); }
 private:
-	string getHeaderString(const CID& cid) const;
-	string getHeaderString(uint32_t sid, bool nmdc) const;
-	string getParamString(bool nmdc) const;
+	void assign(const View& view);
+	void getHeaderString(const CID& cid, string& out) const;
+	void getHeaderString(uint32_t sid, bool nmdc, string& out) const;
+	void getParamString(bool nmdc, string& out) const;
 	StringList parameters;
 	string features;
 	union {
@@ -189,39 +237,46 @@ public:
 	template<typename... ArgT>
 	void dispatch(const string& aLine, bool nmdc, ArgT&&... args) noexcept {
 		try {
-			AdcCommand c(aLine, nmdc);
+			dispatch(AdcCommand::View(aLine, nmdc), std::forward<ArgT>(args)...);
+		} catch(const ParseException&) {
+			dcdebug("Invalid ADC command: %.50s\n", aLine.c_str());
+			return;
+		}
+	}
+
+	/** Dispatch a line that has already been parsed into a view. */
+	template<typename... ArgT>
+	void dispatch(const AdcCommand::View& view, ArgT&&... args) {
+		AdcCommand c(view);
 
 #define C(n) case AdcCommand::CMD_##n: ((T*)this)->handle(AdcCommand::n(), c, std::forward<ArgT>(args)...); break;
-			switch(c.getCommand()) {
-				C(SUP);
-				C(STA);
-				C(INF);
-				C(MSG);
-				C(SCH);
-				C(RES);
-				C(CTM);
-				C(RCM);
-				C(GPA);
-				C(PAS);
-				C(QUI);
-				C(GET);
-				C(GFI);
-				C(SND);
-				C(SID);
-				C(CMD);
-				C(NAT);
-				C(RNT);
-				C(ZON);
-				C(ZOF);
-			default:
-				dcdebug("Unknown ADC command: %.50s\n", aLine.c_str());
-				break;
+		switch(c.getCommand()) {
+			C(SUP);
+			C(STA);
+			C(INF);
+			C(MSG);
+			C(SCH);
+			C(RES);
+			C(CTM);
+			C(RCM);
+			C(GPA);
+			C(PAS);
+			C(QUI);
+			C(GET);
+			C(GFI);
+			C(SND);
+			C(SID);
+			C(CMD);
+			C(NAT);
+			C(RNT);
+			C(ZON);
+			C(ZOF);
+			C(PSR);
+		default:
+			dcdebug("Unknown ADC command: %s\n", c.getFourCC().c_str());
+			break;
 #undef C
 
-			}
-		} catch(const ParseException&) {
-			dcdebug("Invalid ADC command: %.50s\n", aLine.c_str());
-			return;
 		}
 	}
 };
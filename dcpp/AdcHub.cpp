@@ -145,8 +145,8 @@ void AdcHub::clearUsers() {
 	}
 }
 
-void AdcHub::handle(AdcCommand::INF, AdcCommand& c) noexcept {
-	if(c.getParameters().empty())
+void AdcHub::handle(AdcCommand::INF, const AdcCommand::View& c) noexcept {
+	if(c.getParamCount() == 0)
 		return;
 
 	string cid;
@@ -180,11 +180,13 @@ void AdcHub::handle(AdcCommand::INF, AdcCommand& c) noexcept {
 		return;
 	}
 
-	for(auto& i: c.getParameters()) {
-		if(i.length() < 2)
+	string param;
+	for(size_t i = 0, n = c.getParamCount(); i < n; ++i) {
+		if(c.getRawParam(i).length() < 2)
 			continue;
 
-		u->getIdentity().set(i.c_str(), i.substr(2));
+		c.getParam(i, param);
+		u->getIdentity().set(param.c_str(), param.substr(2));
 	}
 
 	if(u->getIdentity().supports(ADCS_FEATURE)) {
@@ -506,23 +508,32 @@ void AdcHub::handle(AdcCommand::STA, AdcCommand& c) noexcept {
 	fire(ClientListener::Message(), this, ChatMessage(c.getParam(1), u));
 }
 
-void AdcHub::handle(AdcCommand::SCH, AdcCommand& c) noexcept {
+void AdcHub::handle(AdcCommand::SCH, const AdcCommand::View& c) noexcept {
 	OnlineUser* ou = findUser(c.getFrom());
 	if(!ou) {
 		dcdebug("Invalid user in AdcHub::onSCH\n");
 		return;
 	}
 
-	fire(ClientListener::AdcSearch(), this, c, *ou);
+	fire(ClientListener::AdcSearch(), this, AdcCommand(c), *ou);
 }
 
-void AdcHub::handle(AdcCommand::RES, AdcCommand& c) noexcept {
+void AdcHub::handle(AdcCommand::RES, const AdcCommand::View& c) noexcept {
 	OnlineUser* ou = findUser(c.getFrom());
 	if(!ou) {
 		dcdebug("Invalid user in AdcHub::onRES\n");
 		return;
 	}
-	SearchManager::getInstance()->onRES(c, ou->getUser());
+	SearchManager::getInstance()->onRES(AdcCommand(c), ou->getUser());
+}
+
+void AdcHub::handle(AdcCommand::PSR, AdcCommand& c) noexcept {
+	OnlineUser* ou = findUser(c.getFrom());
+	if(!ou) {
+		dcdebug("Invalid user in AdcHub::onPSR\n");
+		return;
+	}
+	SearchManager::getInstance()->onPSR(c, HintedUser(ou->getUser(), getHubUrl()));
 }
 
 void AdcHub::handle(AdcCommand::GET, AdcCommand& c) noexcept {
@@ -946,10 +957,20 @@ static void addParam(StringMap& lastInfoMap, AdcCommand& c, const string& var, c
 	}
 }
 
+/** Address to announce for an IP or host name set by the user. Host names are looked up in the
+background; our info is sent again once the address is known. */
+string AdcHub::resolveUserIp(const string& host, int af) {
+	string ip;
+	if(!Socket::resolveCached(host, af, ip)) {
+		resolveAsync(host, af, [this](const string&) { info(); });
+	}
+	return ip;
+}
+
 void AdcHub::appendConnectivity(StringMap& lastInfoMap, AdcCommand& c, bool v4, bool v6) {
 	if (v4) {
 		if(CONNSETTING(NO_IP_OVERRIDE) && !getUserIp4().empty()) {
-			addParam(lastInfoMap, c, "I4", Socket::resolve(getUserIp4(), AF_INET));
+			addParam(lastInfoMap, c, "I4", resolveUserIp(getUserIp4(), AF_INET));
 		} else {
 			addParam(lastInfoMap, c, "I4", "0.0.0.0");
 		}
@@ -966,7 +987,7 @@ void AdcHub::appendConnectivity(StringMap& lastInfoMap, AdcCommand& c, bool v4,
 
 	if (v6) {
 		if (CONNSETTING(NO_IP_OVERRIDE6) && !getUserIp6().empty()) {
-			addParam(lastInfoMap, c, "I6", Socket::resolve(getUserIp6(), AF_INET6));
+			addParam(lastInfoMap, c, "I6", resolveUserIp(getUserIp6(), AF_INET6));
 		} else {
 			addParam(lastInfoMap, c, "I6", "::");
 		}
@@ -1090,7 +1111,14 @@ void AdcHub::send(const AdcCommand& cmd) {
 	if(forbiddenCommands.find(AdcCommand::toFourCC(cmd.getFourCC().c_str())) == forbiddenCommands.end()) {
 		if(cmd.getType() == AdcCommand::TYPE_UDP)
 			sendUDP(cmd);
-		send(cmd.toString(sid));
+		// serialized into storage kept by the calling thread; it is taken out while in use, in
+		// case a plugin sends something else from within the hook.
+		static thread_local string buf;
+		string line;
+		line.swap(buf);
+		cmd.toString(sid, false, line);
+		send(line);
+		buf.swap(line);
 	}
 }
 
@@ -1141,7 +1169,20 @@ void AdcHub::on(Line l, const string& aLine) noexcept {
 	if(PluginManager::getInstance()->runHook(HOOK_NETWORK_HUB_IN, this, aLine))
 		return;
 
-	dispatch(aLine);
+	// user info and searches come by the thousands; they are read straight from the view, the
+	// others go through an AdcCommand.
+	try {
+		lineView.parse(aLine);
+
+		switch(lineView.getCommand()) {
+		case AdcCommand::CMD_INF: handle(AdcCommand::INF(), lineView); break;
+		case AdcCommand::CMD_SCH: handle(AdcCommand::SCH(), lineView); break;
+		case AdcCommand::CMD_RES: handle(AdcCommand::RES(), lineView); break;
+		default: dispatch(lineView); break;
+		}
+	} catch(const ParseException&) {
+		dcdebug("Invalid ADC command: %.50s\n", aLine.c_str());
+	}
 }
 
 void AdcHub::on(Failed f, const string& aLine) noexcept {
@@ -94,6 +94,9 @@ private:
 
 	std::unordered_set<uint32_t> forbiddenCommands;
 
+	/** The line being handled, kept to reuse its storage from one line to the next. */
+	AdcCommand::View lineView;
+
 	static const vector<StringList> searchExts;
 
 	virtual void checkNick(string& nick);
@@ -104,25 +107,27 @@ private:
 	void putUser(const uint32_t sid, bool disconnect);
 
 	void clearUsers();
+	string resolveUserIp(const string& host, int af);
 	void appendConnectivity(StringMap& lastInfoMap, AdcCommand& c, bool v4, bool v6);
 
 	void handle(AdcCommand::SUP, AdcCommand& c) noexcept;
 	void handle(AdcCommand::SID, AdcCommand& c) noexcept;
 	void handle(AdcCommand::MSG, AdcCommand& c) noexcept;
-	void handle(AdcCommand::INF, AdcCommand& c) noexcept;
+	void handle(AdcCommand::INF, const AdcCommand::View& c) noexcept;
 	void handle(AdcCommand::GPA, AdcCommand& c) noexcept;
 	void handle(AdcCommand::QUI, AdcCommand& c) noexcept;
 	void handle(AdcCommand::CTM, AdcCommand& c) noexcept;
 	void handle(AdcCommand::RCM, AdcCommand& c) noexcept;
 	void handle(AdcCommand::STA, AdcCommand& c) noexcept;
-	void handle(AdcCommand::SCH, AdcCommand& c) noexcept;
+	void handle(AdcCommand::SCH, const AdcCommand::View& c) noexcept;
 	void handle(AdcCommand::CMD, AdcCommand& c) noexcept;
-	void handle(AdcCommand::RES, AdcCommand& c) noexcept;
+	void handle(AdcCommand::RES, const AdcCommand::View& c) noexcept;
 	void handle(AdcCommand::GET, AdcCommand& c) noexcept;
 	void handle(AdcCommand::NAT, AdcCommand& c) noexcept;
 	void handle(AdcCommand::RNT, AdcCommand& c) noexcept;
 	void handle(AdcCommand::ZON, AdcCommand& c) noexcept;
 	void handle(AdcCommand::ZOF, AdcCommand& c) noexcept;
+	void handle(AdcCommand::PSR, AdcCommand& c) noexcept;
 
 	template<typename T> void handle(T, AdcCommand&) { }
 
@@ -22,13 +22,26 @@
 
 namespace dcpp {
 
-template<size_t N>
+/** Bloom filter over the N-grams of strings. It is blocked at word level: each N-gram picks one
+64-bit word and sets K bits in it, so adding or testing one costs a single memory access. */
+template<size_t N, size_t K = 3>
 class BloomFilter {
+	static_assert(N > 0 && N <= sizeof(uint64_t), "N-grams must fit in a word");
+	static_assert(K > 0 && K <= 5, "The bits in a word are taken from 32 bits of the hash");
+
 public:
-	BloomFilter(size_t tableSize) { table.resize(tableSize); }
+	BloomFilter(size_t tableSize) : table((tableSize + 63) / 64) { }
 	~BloomFilter() { }
 
-	void add(const string& s) { xadd(s, N); }
+	void add(const string& s) {
+		if(s.length() >= N) {
+			string::size_type l = s.length() - N;
+			for(string::size_type i = 0; i <= l; ++i) {
+				auto h = hash(s.data() + i);
+				table[getPos(h)] |= getMask(h);
+			}
+		}
+	}
 	bool match(const StringList& s) const {
 		for(auto& i: s) {
 			if(!match(i))
@@ -40,7 +53,9 @@ public:
 		if(s.length() >= N) {
 			string::size_type l = s.length() - N;
 			for(string::size_type i = 0; i <= l; ++i) {
-				if(!table[getPos(s, i, N)]) {
+				auto h = hash(s.data() + i);
+				auto mask = getMask(h);
+				if((table[getPos(h)] & mask) != mask) {
 					return false;
 				}
 			}
@@ -48,42 +63,48 @@ public:
 		return true;
 	}
 	void clear() {
-		size_t s = table.size();
-		table.clear();
-		table.resize(s);
+		std::fill(table.begin(), table.end(), 0);
 	}
 #ifdef TESTER
 	void print_table_status() {
-		int tot = 0;
-		for (unsigned int i = 0; i < table.size(); ++i) if (table[i] == true) ++tot;
+		size_t tot = 0;
+		for(auto w: table) for(; w; w &= w - 1) ++tot;
 
-		std::cout << "table status: " << tot << " of " << table.size()
-			<< " filled, for an occupancy percentage of " << (100.*tot)/table.size()
+		std::cout << "table status: " << tot << " of " << table.size() * 64
+			<< " filled, for an occupancy percentage of " << (100.*tot)/(table.size() * 64)
 			<< "%" << std::endl;
 	}
 #endif
 private:
-	void xadd(const string& s, size_t n) {
-		if(s.length() >= n) {
-			string::size_type l = s.length() - n;
-			for(string::size_type i = 0; i <= l; ++i) {
-				table[getPos(s, i, n)] = true;
-			}
+	/* The N bytes are read as one word and mixed with a multiply, which leaves the high bits
+	well distributed: the top ones pick the word, the ones below the bits within it. */
+	static uint64_t hash(const char* c) {
+		uint64_t x = 0;
+		if(N >= 4) {
+			// two loads that may overlap rather than a partial copy, which would stall the load
+			uint32_t a, b;
+			memcpy(&a, c, 4);
+			memcpy(&b, c + N - 4, 4);
+			x = a | (static_cast<uint64_t>(b) << 32);
+		} else {
+			memcpy(&x, c, N);
 		}
+		return (x ^ (x >> 29)) * 0x9e3779b97f4a7c15ULL;
+	}
+
+	size_t getPos(uint64_t h) const {
+		return static_cast<size_t>(((h >> 32) * table.size()) >> 32);
 	}
 
-	/* This is roughly how boost::hash does it */
-	size_t getPos(const string& s, size_t i, size_t l) const {
-		size_t h = 0;
-		const char* c = s.data() + i;
-		const char* end = s.data() + i + l;
-		for(; c < end; ++c) {
-			h ^= *c + 0x9e3779b9 + (h<<6) + (h>>2);
+	static uint64_t getMask(uint64_t h) {
+		uint64_t mask = 0;
+		for(size_t i = 0; i < K; ++i) {
+			mask |= static_cast<uint64_t>(1) << ((h >> (26 - 6 * i)) & 63);
 		}
-		return (h % table.size());
+		return mask;
 	}
 
-	vector<bool> table;
+	vector<uint64_t> table;
 };
 
 } // namespace dcpp
@@ -34,7 +34,7 @@ public:
 
 	CID() { memset(cid, 0, sizeof(cid)); }
 	explicit CID(const uint8_t* data) { memcpy(cid, data, sizeof(cid)); }
-	explicit CID(const string& base32) { Encoder::fromBase32(base32.c_str(), cid, sizeof(cid)); }
+	explicit CID(const string& base32) { Encoder::fromBase32(base32.data(), base32.size(), cid, sizeof(cid)); }
 
 	bool operator==(const CID& rhs) const { return memcmp(cid, rhs.cid, sizeof(cid)) == 0; }
 	bool operator<(const CID& rhs) const { return memcmp(cid, rhs.cid, sizeof(cid)) < 0; }
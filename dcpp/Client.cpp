@@ -22,6 +22,7 @@
 #include "ClientManager.h"
 #include "ConnectivityManager.h"
 #include "FavoriteManager.h"
+#include "Resolver.h"
 #include "TimerManager.h"
 #include "UserMatchManager.h"
 #include "PluginManager.h"
@@ -45,6 +46,8 @@ Client::Client(const string& hubURL, char separator_, bool secure_) :
 	Util::decodeUrl(hubURL, proto, address, port, file, query, fragment);
 	keyprint = Util::decodeQuery(query)["kp"];
 
+	Metrics::addValue("hub.lines." + hubUrl, this, [this] { return lines.get(); });
+
 	TimerManager::getInstance()->addListener(this);
 }
 
@@ -55,6 +58,8 @@ Client::~Client() {
 	FavoriteManager::getInstance()->removeUserCommand(getHubUrl());
 	TimerManager::getInstance()->removeListener(this);
 	updateCounts(true);
+
+	Metrics::removeValue("hub.lines." + hubUrl, this);
 }
 
 void Client::reconnect() {
@@ -64,10 +69,19 @@ void Client::reconnect() {
 }
 
 void Client::shutdown() {
-	if(sock) {
-		BufferedSocket::putSocket(sock);
+	putSocket();
+}
+
+void Client::putSocket() {
+	BufferedSocket* s;
+	{
+		auto lock = ClientManager::getInstance()->lock();
+		s = sock;
 		sock = 0;
 	}
+	if(s) {
+		BufferedSocket::putSocket(s);
+	}
 }
 
 void Client::reloadSettings(bool updateNick) {
@@ -122,10 +136,7 @@ bool Client::isActiveV6() const {
 }
 
 void Client::connect() {
-	if(sock) {
-		BufferedSocket::putSocket(sock);
-		sock = 0;
-	}
+	putSocket();
 
 	setAutoReconnect(true);
 	setReconnDelay(120 + Util::rand(0, 60));
@@ -137,9 +148,13 @@ void Client::connect() {
 	state = STATE_CONNECTING;
 
 	try {
-		sock = BufferedSocket::getSocket(separator, v4only());
-		sock->addListener(this);
-		sock->connect(address, port, secure, SETTING(ALLOW_UNTRUSTED_HUBS), true, keyprint);
+		auto s = BufferedSocket::getSocket(separator, v4only());
+		s->addListener(this);
+		{
+			auto lock = ClientManager::getInstance()->lock();
+			sock = s;
+		}
+		s->connect(address, port, secure, SETTING(ALLOW_UNTRUSTED_HUBS), true, keyprint);
 	} catch(const Exception& e) {
 		state = STATE_DISCONNECTED;
 		fire(ClientListener::Failed(), this, e.getError());
@@ -250,6 +265,22 @@ void Client::updateUsers() {
 	if(sock) sock->callAsync([this] { auto users = getUsers(); updated(users); });
 }
 
+void Client::resolveAsync(const string& host, int af, function<void (const string&)> f) {
+	string ip;
+	if(Socket::resolveCached(host, af, ip)) {
+		f(ip);
+		return;
+	}
+
+	Resolver::getInstance()->resolve(host, af, [this, f](const string& ip) {
+		auto cm = ClientManager::getInstance();
+		auto lock = cm->lock();
+		if(cm->getClients().count(this) && sock) {
+			sock->callAsync([f, ip] { f(ip); });
+		}
+	});
+}
+
 void Client::updated(OnlineUser& user) {
 	UserMatchManager::getInstance()->match(user);
 
@@ -263,6 +294,10 @@ void Client::updated(OnlineUserList& users) {
 }
 
 void Client::on(Line, const string& aLine) noexcept {
+	static auto& allLines = Metrics::counter("hub.lines");
+	allLines.add();
+	lines.add();
+
 	updateActivity();
 }
 
@@ -25,6 +25,7 @@
 #include "ConnectionType.h"
 #include "forward.h"
 #include "HubSettings.h"
+#include "Metrics.h"
 #include "OnlineUser.h"
 #include "PluginEntity.h"
 #include "Speaker.h"
@@ -32,9 +33,12 @@
 
 #include <boost/core/noncopyable.hpp>
 #include <atomic>
+#include <functional>
 
 namespace dcpp {
 
+using std::function;
+
 /** Yes, this should probably be called a Hub */
 class Client :
 	public PluginEntity<HubData>,
@@ -80,6 +84,10 @@ public:
 	/** Send a ClientListener::Updated signal for every connected user. */
 	void updateUsers();
 
+	/** Resolve a host name without blocking. f is called right away when the address is already
+	known, otherwise later on from this hub's thread (and not at all if the hub is gone by then). */
+	void resolveAsync(const string& host, int af, function<void (const string&)> f);
+
 	static string getCounts();
 
 	void setActive();
@@ -177,6 +185,13 @@ private:
 	virtual OnlineUserList getUsers() const = 0;
 	virtual void infoImpl() = 0;
 
+	/** Let go of the socket; it is set and cleared under the lock of ClientManager, which
+	resolveAsync holds to reach the socket from a resolver thread. */
+	void putSocket();
+
+	/// Lines received from the hub
+	Counter lines;
+
 	string hubUrl;
 	string address;
 	string ip;
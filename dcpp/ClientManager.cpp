@@ -29,6 +29,7 @@
 #include "SearchResult.h"
 #include "ShareManager.h"
 #include "PluginManager.h"
+#include "QueueManager.h"
 #include "SimpleXML.h"
 #include "UserCommand.h"
 
@@ -513,23 +514,49 @@ void ClientManager::on(NmdcSearch, Client* aClient, const string& aSeeker, int a
 				aClient->send(str);
 
 		} else {
-			string ip, port;
-
 			auto ipPortPair = NmdcHub::parseIpPort(aSeeker);
 
-			port = ipPortPair.second;
-			ip = Socket::resolve(ipPortPair.first, AF_INET);
-
-			if(static_cast<NmdcHub*>(aClient)->isProtectedIP(ip))
-				return;
-
+			string port = ipPortPair.second;
 			if(port.empty())
 				port = "412";
 
+			StringList results;
 			for(const auto& sr: l) {
-				sendUDP(ip, port, sr->toSR(*aClient));
+				results.push_back(sr->toSR(*aClient));
 			}
+
+			// the seeker may have given a host name; don't hold up the hub while it's looked up.
+			aClient->resolveAsync(ipPortPair.first, AF_INET, [this, aClient, port, results](const string& ip) {
+				if(static_cast<NmdcHub*>(aClient)->isProtectedIP(ip))
+					return;
+
+				for(const auto& sr: results) {
+					sendUDP(ip, port, sr);
+				}
+			});
 		}
+
+	} else if(!isPassive && aFileType == SearchManager::TYPE_TTH && aString.compare(0, 4, "TTH:") == 0 && aString.size() == 43) {
+		// no complete file, but we may be downloading it and have parts to share
+		QueueItem::PartsInfo parts;
+		if(!QueueManager::getInstance()->getPartsInfo(TTHValue(aString.substr(4)), parts))
+			return;
+
+		auto ipPortPair = NmdcHub::parseIpPort(aSeeker);
+
+		string port = ipPortPair.second;
+		if(port.empty())
+			port = "412";
+
+		auto psr = SearchManager::getInstance()->toPSR(true, aClient->getMyNick(), aClient->getIpPort(), aString.substr(4), parts);
+		auto data = psr.toString(getMe()->getCID());
+
+		aClient->resolveAsync(ipPortPair.first, AF_INET, [this, aClient, port, data](const string& ip) {
+			if(static_cast<NmdcHub*>(aClient)->isProtectedIP(ip))
+				return;
+
+			sendUDP(ip, port, data);
+		});
 	}
 }
 
@@ -122,6 +122,7 @@ public:
 	UserPtr& getMe();
 
 	void sendUDP(AdcCommand& cmd, const OnlineUser& user, const string& aKey = Util::emptyString);
+	void sendUDP(const string& ip, const string& port, const string& data, const string& aKey = Util::emptyString);
 
 	void connect(const HintedUser& user, const string& token, ConnectionType type = CONNECTION_TYPE_LAST);
 	void privateMessage(const HintedUser& user, const string& msg, bool thirdPerson);
@@ -183,8 +184,6 @@ private:
 	*/
 	OnlineUser* findOnlineUserHint(const CID& cid, const string& hintUrl, OnlinePairC& p) const;
 
-	void sendUDP(const string& ip, const string& port, const string& data, const string& aKey = Util::emptyString);
-
 	string getUsersFile() const { return Util::getPath(Util::PATH_USER_LOCAL) + "Users.xml"; }
 
 	// ClientListener
@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stdinc.h"
+#include "CompactListing.h"
+
+#include "File.h"
+#include "format.h"
+#include "ParallelUnBZ.h"
+#include "QueueManager.h"
+#include "SettingsManager.h"
+#include "SimpleXML.h"
+#include "SimpleXMLReader.h"
+#include "StringTokenizer.h"
+
+#include <numeric>
+#include <thread>
+
+namespace dcpp {
+
+using std::string_view;
+
+namespace {
+
+/** Writes what is read from a stream to a file. */
+class SavingInputStream : public InputStream {
+public:
+	SavingInputStream(InputStream& is, OutputStream& os) : is(is), os(os) { }
+
+	size_t read(void* buf, size_t& len) {
+		auto ret = is.read(buf, len);
+		os.write(buf, ret);
+		return ret;
+	}
+
+	/** Copy what the reader left, so that the file is complete. */
+	void finish() {
+		char buf[64 * 1024];
+		for(;;) {
+			size_t len = sizeof(buf);
+			if(read(buf, len) == 0) {
+				break;
+			}
+		}
+	}
+
+private:
+	InputStream& is;
+	OutputStream& os;
+};
+
+}
+
+/** Collects directories and files in the order they come in, then sorts them into place once
+the whole list has been read. */
+class CompactListing::Loader : public SimpleXMLReader::CallBack {
+public:
+	explicit Loader(CompactListing& list);
+
+	void startTag(string_view name, const AttribViewList& attribs, bool simple);
+	void endTag(const string& name);
+
+	void finish();
+
+private:
+	struct RawDirectory {
+		Index name;
+		Index parent;
+		bool complete;
+	};
+
+	struct RawFile {
+		Index name;
+		Index parent;
+		int64_t size;
+	};
+
+	Index addName(string_view name);
+	Index addDirectory(string_view name, Index parent, bool complete);
+
+	/** Sort children by name and reject duplicates, as complete file lists may not have any. */
+	template<typename F>
+	void sortChildren(vector<Index>::iterator begin, vector<Index>::iterator end, F getName) const;
+
+	CompactListing& list;
+
+	vector<RawDirectory> dirs;
+	vector<RawFile> files;
+	vector<TTHValue> tths;
+
+	Index cur;
+	bool inListing;
+};
+
+namespace {
+
+const string sFileListing = "FileListing";
+const string sBase = "Base";
+const string sDirectory = "Directory";
+const string sIncomplete = "Incomplete";
+const string sFile = "File";
+const string sName = "Name";
+const string sSize = "Size";
+const string sTTH = "TTH";
+
+} // unnamed namespace
+
+CompactListing::Loader::Loader(CompactListing& list) : list(list), cur(0), inListing(false) {
+	list.directories.clear();
+	list.files.clear();
+	list.tths.clear();
+	list.names.clear();
+
+	addDirectory(Util::emptyString, 0, false);
+}
+
+CompactListing::Index CompactListing::Loader::addName(string_view name) {
+	auto ret = static_cast<Index>(list.names.size());
+	list.names.append(name);
+	list.names.append(1, '\0');
+	return ret;
+}
+
+CompactListing::Index CompactListing::Loader::addDirectory(string_view name, Index parent, bool complete) {
+	RawDirectory d = { addName(name), parent, complete };
+	dirs.push_back(d);
+	return static_cast<Index>(dirs.size() - 1);
+}
+
+void CompactListing::Loader::startTag(string_view name, const AttribViewList& attribs, bool simple) {
+	if(list.getAbort()) { throw Exception(); }
+
+	if(inListing) {
+		if(name == sFile) {
+			auto n = getAttrib(attribs, sName, 0);
+			if(n.empty())
+				return;
+
+			auto s = getAttrib(attribs, sSize, 1);
+			if(s.empty())
+				return;
+
+			auto h = getAttrib(attribs, sTTH, 2);
+			if(h.empty())
+				return;
+
+			RawFile f = { addName(n), cur, Util::toInt64(s) };
+			files.push_back(f);
+			tths.emplace_back(h);
+
+		} else if(name == sDirectory) {
+			auto n = getAttrib(attribs, sName, 0);
+			if(n.empty()) {
+				throw SimpleXMLException(_("Directory missing name attribute"));
+			}
+
+			cur = addDirectory(n, cur, getAttrib(attribs, sIncomplete, 1) != "1");
+
+			if(simple) {
+				// To handle <Directory Name="..." />
+				endTag(sDirectory);
+			}
+		}
+
+	} else if(name == sFileListing) {
+		auto b = getAttrib(attribs, sBase, 2);
+		if(b.size() >= 1 && b[0] == '/' && *(b.end() - 1) == '/') {
+			StringTokenizer<string> st(string(b.substr(1)), '/');
+			for(auto& i: st.getTokens()) {
+				cur = addDirectory(i, cur, false);
+			}
+		}
+		dirs[cur].complete = true;
+		inListing = true;
+
+		if(simple) {
+			endTag(sFileListing);
+		}
+	}
+}
+
+void CompactListing::Loader::endTag(const string& name) {
+	if(inListing) {
+		if(name == sDirectory) {
+			cur = dirs[cur].parent;
+		} else if(name == sFileListing) {
+			inListing = false;
+		}
+	}
+}
+
+template<typename F>
+void CompactListing::Loader::sortChildren(vector<Index>::iterator begin, vector<Index>::iterator end, F getName) const {
+	const auto& names = list.names;
+	auto less = [&](Index a, Index b) { return Util::stricmp(&names[getName(a)], &names[getName(b)]) < 0; };
+
+	sort(begin, end, less);
+
+	if(std::adjacent_find(begin, end, [&](Index a, Index b) { return !less(a, b); }) != end) {
+		throw Exception(_("Duplicate item in the file list"));
+	}
+}
+
+void CompactListing::Loader::finish() {
+	const auto dirCount = dirs.size();
+
+	// group the subdirectories and the files of each directory with counting sorts
+	vector<Index> dirStart(dirCount + 1, 0), fileStart(dirCount + 1, 0);
+	for(size_t i = 1; i < dirCount; ++i) {
+		++dirStart[dirs[i].parent + 1];
+	}
+	for(auto& f: files) {
+		++fileStart[f.parent + 1];
+	}
+	std::partial_sum(dirStart.begin(), dirStart.end(), dirStart.begin());
+	std::partial_sum(fileStart.begin(), fileStart.end(), fileStart.begin());
+
+	vector<Index> children(dirCount - 1), fileOrder(files.size());
+	{
+		auto pos = dirStart;
+		for(size_t i = 1; i < dirCount; ++i) {
+			children[pos[dirs[i].parent]++] = static_cast<Index>(i);
+		}
+		pos = fileStart;
+		for(size_t i = 0; i < files.size(); ++i) {
+			fileOrder[pos[files[i].parent]++] = static_cast<Index>(i);
+		}
+	}
+
+	// lay the directories out breadth first, so that the subdirectories of each directory follow
+	// each other
+	vector<Index> order;
+	order.reserve(dirCount);
+	order.push_back(0);
+
+	vector<Index> newIndex(dirCount);
+	list.directories.resize(dirCount);
+
+	for(size_t pos = 0; pos < order.size(); ++pos) {
+		auto raw = order[pos];
+		newIndex[raw] = static_cast<Index>(pos);
+
+		auto begin = children.begin() + dirStart[raw], end = children.begin() + dirStart[raw + 1];
+		sortChildren(begin, end, [this](Index i) { return dirs[i].name; });
+
+		auto& d = list.directories[pos];
+		d.name = dirs[raw].name;
+		d.parent = pos == 0 ? 0 : newIndex[dirs[raw].parent];
+		d.dirs = static_cast<Index>(order.size());
+		d.dirCount = static_cast<Index>(end - begin);
+		d.complete = dirs[raw].complete;
+
+		order.insert(order.end(), begin, end);
+	}
+
+	// then the files, in the same order as their directories
+	list.files.reserve(files.size());
+	list.tths.reserve(tths.size());
+
+	for(size_t pos = 0; pos < dirCount; ++pos) {
+		auto raw = order[pos];
+
+		auto begin = fileOrder.begin() + fileStart[raw], end = fileOrder.begin() + fileStart[raw + 1];
+		sortChildren(begin, end, [this](Index i) { return files[i].name; });
+
+		auto& d = list.directories[pos];
+		d.files = static_cast<Index>(list.files.size());
+		d.fileCount = static_cast<Index>(end - begin);
+
+		for(auto i = begin; i != end; ++i) {
+			File f = { files[*i].name, static_cast<Index>(pos), files[*i].size };
+			list.files.push_back(f);
+			list.tths.push_back(tths[*i]);
+		}
+	}
+
+	list.names.shrink_to_fit();
+}
+
+CompactListing::CompactListing(const HintedUser& aUser) :
+user(aUser),
+abort(false)
+{
+	Directory root = { 0, 0, 0, 0, 0, 0, false };
+	directories.push_back(root);
+	names.append(1, '\0');
+}
+
+void CompactListing::loadFile(const string& path) {
+	string actualPath = path;
+	if(dcpp::File::getSize(path + ".bz2") != -1) {
+		actualPath += ".bz2";
+	}
+
+	auto ext = Util::getFileExt(actualPath);
+	auto maxSize = SETTING(MAX_FILELIST_SIZE) ? static_cast<size_t>(SETTING(MAX_FILELIST_SIZE)) * 1024 * 1024 : 0;
+
+	if(Util::stricmp(ext, ".bz2") == 0) {
+		{
+			// keep the uncompressed file, as DirectoryListing does; it is written as it is read.
+			ParallelUnBZ f(dcpp::File(actualPath, dcpp::File::READ, dcpp::File::OPEN).read(), std::thread::hardware_concurrency());
+			dcpp::File xml(path, dcpp::File::WRITE, dcpp::File::CREATE | dcpp::File::TRUNCATE);
+			SavingInputStream saving(f, xml);
+			try {
+				loadXML(saving, maxSize);
+				saving.finish();
+			} catch(const Exception&) {
+				xml.close();
+				dcpp::File::deleteFile(path);
+				throw;
+			}
+		}
+		dcpp::File::deleteFile(actualPath);
+	} else if(Util::stricmp(ext, ".xml") == 0) {
+		dcpp::File file(actualPath, dcpp::File::READ, dcpp::File::OPEN);
+		loadXML(file, maxSize);
+	} else {
+		throw Exception(_("Invalid file list extension (must be .xml or .bz2)"));
+	}
+}
+
+void CompactListing::loadXML(InputStream& is, size_t maxSize) {
+	Loader loader(*this);
+	SimpleXMLReader(&loader).parse(is, maxSize);
+	loader.finish();
+}
+
+CompactListing::Directories CompactListing::getDirectories(const Directory& d) const {
+	auto begin = directories.data() + d.dirs;
+	return boost::make_iterator_range(begin, begin + d.dirCount);
+}
+
+CompactListing::Files CompactListing::getFiles(const Directory& d) const {
+	auto begin = files.data() + d.files;
+	return boost::make_iterator_range(begin, begin + d.fileCount);
+}
+
+const CompactListing::Directory* CompactListing::findDirectory(const string& aPath) const {
+	auto d = &getRoot();
+
+	StringTokenizer<string> st(aPath, '\\');
+	for(auto& name: st.getTokens()) {
+		if(name.empty()) {
+			continue;
+		}
+
+		auto range = getDirectories(*d);
+		auto i = std::lower_bound(range.begin(), range.end(), name, [this](const Directory& a, const string& b) {
+			return Util::stricmp(getName(a), b.c_str()) < 0;
+		});
+		if(i == range.end() || Util::stricmp(getName(*i), name.c_str()) != 0) {
+			return nullptr;
+		}
+		d = i;
+	}
+
+	return d;
+}
+
+const CompactListing::File* CompactListing::findFile(const Directory& d, const string& aName) const {
+	auto range = getFiles(d);
+	auto i = std::lower_bound(range.begin(), range.end(), aName, [this](const File& a, const string& b) {
+		return Util::stricmp(getName(a), b.c_str()) < 0;
+	});
+	if(i == range.end() || Util::stricmp(getName(*i), aName.c_str()) != 0) {
+		return nullptr;
+	}
+	return i;
+}
+
+void CompactListing::download(const string& aDir, const string& aTarget, bool highPrio) {
+	dcassert(aDir.size() > 2);
+	dcassert(aDir[aDir.size() - 1] == '\\'); // This should not be PATH_SEPARATOR
+	auto d = findDirectory(aDir);
+	if(d)
+		download(*d, aTarget, highPrio);
+}
+
+void CompactListing::download(const Directory& aDir, const string& aTarget, bool highPrio) {
+	string target = (&aDir == &getRoot()) ? aTarget : aTarget + getName(aDir) + PATH_SEPARATOR;
+	// First, recurse over the directories
+	for(auto& d: getDirectories(aDir)) {
+		download(d, target, highPrio);
+	}
+	// Then add the files
+	for(auto& f: getFiles(aDir)) {
+		try {
+			auto fileTarget = target + getName(f);
+			QueueManager::getInstance()->add(fileTarget, f.size, getTTH(f), getUser());
+			if(highPrio)
+				QueueManager::getInstance()->setPriority(fileTarget, QueueItem::HIGHEST);
+		} catch(const QueueException&) {
+			// Catch it here to allow parts of directories to be added...
+		} catch(const FileException&) {
+			//..
+		}
+	}
+}
+
+} // namespace dcpp
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_COMPACT_LISTING_H
+#define DCPLUSPLUS_DCPP_COMPACT_LISTING_H
+
+#include <boost/core/noncopyable.hpp>
+#include <boost/range/iterator_range.hpp>
+
+#include "forward.h"
+
+#include "GetSet.h"
+#include "HintedUser.h"
+#include "MerkleTree.h"
+
+namespace dcpp {
+
+/** A read-only file list for when a list only has to be looked through (queue matching,
+directory downloads) rather than browsed. Instead of one allocation per file and directory, it
+is held in a few flat arrays: names share one string pool, the children of a directory are a
+range of indexes sorted by name, and TTHs are packed in their own array. */
+class CompactListing : boost::noncopyable
+{
+public:
+	typedef uint32_t Index;
+
+	struct Directory {
+		/// Offset of the name in the name pool
+		Index name;
+		Index parent;
+		/// Subdirectories: [dirs, dirs + dirCount) in the directory array
+		Index dirs;
+		Index dirCount;
+		/// Files: [files, files + fileCount) in the file array
+		Index files;
+		Index fileCount;
+		bool complete;
+	};
+
+	struct File {
+		/// Offset of the name in the name pool
+		Index name;
+		Index parent;
+		int64_t size;
+	};
+
+	typedef boost::iterator_range<const Directory*> Directories;
+	typedef boost::iterator_range<const File*> Files;
+
+	explicit CompactListing(const HintedUser& aUser);
+
+	void loadFile(const string& path);
+	void loadXML(InputStream& is, size_t maxSize = 0);
+
+	const Directory& getRoot() const { return directories.front(); }
+	const Directory& getParent(const Directory& d) const { return directories[d.parent]; }
+	const Directory& getParent(const File& f) const { return directories[f.parent]; }
+	Directories getDirectories(const Directory& d) const;
+	Files getFiles(const Directory& d) const;
+
+	const char* getName(const Directory& d) const { return &names[d.name]; }
+	const char* getName(const File& f) const { return &names[f.name]; }
+	const TTHValue& getTTH(const File& f) const { return tths[&f - &files.front()]; }
+
+	/** @param aPath NMDC path of the directory, ending with a backslash. */
+	const Directory* findDirectory(const string& aPath) const;
+	const File* findFile(const Directory& d, const string& aName) const;
+
+	size_t getDirectoryCount() const { return directories.size(); }
+	size_t getFileCount() const { return files.size(); }
+	const vector<TTHValue>& getTTHs() const { return tths; }
+	const File& getFile(size_t i) const { return files[i]; }
+
+	void download(const string& aDir, const string& aTarget, bool highPrio);
+	void download(const Directory& aDir, const string& aTarget, bool highPrio);
+
+	GETSET(HintedUser, user, User);
+	GETSET(bool, abort, Abort);
+
+private:
+	class Loader;
+
+	vector<Directory> directories;
+	vector<File> files;
+	vector<TTHValue> tths;
+	/// Names, each followed by a null character
+	string names;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_COMPACT_LISTING_H)
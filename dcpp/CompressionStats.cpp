@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "stdinc.h"
+#include "CompressionStats.h"
+
+#include "Text.h"
+#include "Util.h"
+#include "ZUtils.h"
+
+namespace dcpp {
+
+bool CompressionStats::worthCompressing(const TTHValue& tth, const string& path) const {
+	Lock l(cs);
+	auto i = files.find(tth);
+	if(i != files.end()) {
+		return i->second;
+	}
+
+	auto j = extensions.find(getExtension(path));
+	if(j != extensions.end() && j->second.in >= MIN_EXTENSION_SAMPLE) {
+		return worthIt(j->second.in, j->second.out);
+	}
+
+	return true;
+}
+
+void CompressionStats::add(const TTHValue& tth, const string& path, int64_t in, int64_t out) {
+	if(in < MIN_SAMPLE) {
+		return;
+	}
+
+	Lock l(cs);
+	if(files.size() >= MAX_FILES && files.find(tth) == files.end()) {
+		// any file will do; the extensions still give a good guess for the ones forgotten
+		files.erase(files.begin());
+	}
+	files[tth] = worthIt(in, out);
+
+	auto& totals = extensions[getExtension(path)];
+	totals.in += in;
+	totals.out += out;
+}
+
+void CompressionStats::clear() {
+	Lock l(cs);
+	files.clear();
+	extensions.clear();
+}
+
+bool CompressionStats::worthIt(int64_t in, int64_t out) {
+	return static_cast<double>(out) <= static_cast<double>(in) * ZFilter::MIN_COMPRESSION_LEVEL;
+}
+
+string CompressionStats::getExtension(const string& path) {
+	return Text::toLower(Util::getFileExt(path));
+}
+
+} // namespace dcpp
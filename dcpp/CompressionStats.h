@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DCPLUSPLUS_DCPP_COMPRESSION_STATS_H
+#define DCPLUSPLUS_DCPP_COMPRESSION_STATS_H
+
+#include <boost/core/noncopyable.hpp>
+
+#include "CriticalSection.h"
+#include "MerkleTree.h"
+
+namespace dcpp {
+
+/** How well the files uploaded so far compressed, so that an upload asked to be compressed can
+be sent as it is right away when its file is known not to compress, instead of deflating the
+first part of it to find out again. Files that haven't been uploaded compressed yet are judged by
+how the files with the same extension did. */
+class CompressionStats : boost::noncopyable
+{
+public:
+	/// Bytes an upload must have read before it says anything about its file
+	static const int64_t MIN_SAMPLE = 64 * 1024;
+	/// Bytes the files of an extension must have read before the extension is trusted
+	static const int64_t MIN_EXTENSION_SAMPLE = 1024 * 1024;
+	static const size_t MAX_FILES = 16384;
+
+	CompressionStats() { }
+
+	/** @return Whether compressing the file is likely to save enough to be worth the trouble. */
+	bool worthCompressing(const TTHValue& tth, const string& path) const;
+
+	/** Record how a compressed upload went.
+	@param in Bytes read from the file
+	@param out Bytes sent once compressed */
+	void add(const TTHValue& tth, const string& path, int64_t in, int64_t out);
+
+	void clear();
+
+	size_t getFileCount() const { Lock l(cs); return files.size(); }
+
+private:
+	struct Totals {
+		int64_t in;
+		int64_t out;
+	};
+
+	static bool worthIt(int64_t in, int64_t out);
+	static string getExtension(const string& path);
+
+	/// Whether each file compressed well the last time it was uploaded
+	unordered_map<TTHValue, bool> files;
+	unordered_map<string, Totals> extensions;
+
+	mutable CriticalSection cs;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_COMPRESSION_STATS_H)
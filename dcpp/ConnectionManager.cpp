@@ -18,6 +18,8 @@
 #include "stdinc.h"
 #include "ConnectionManager.h"
 
+#include <limits>
+
 #include "Client.h"
 #include "ClientManager.h"
 #include "ConnectivityManager.h"
@@ -33,6 +35,7 @@ namespace dcpp {
 ConnectionManager::ConnectionManager() :
 	downloads(cqis[CONNECTION_TYPE_DOWNLOAD]),
 	floodCounter(0),
+	nextAttempt(0),
 	shuttingDown(false)
 {
 	TimerManager::getInstance()->addListener(this);
@@ -114,6 +117,9 @@ void ConnectionManager::getDownloadConnection(const HintedUser& aUser) {
 		auto i = find(downloads.begin(), downloads.end(), aUser.user);
 		if(i == downloads.end()) {
 			getCQI(aUser,  CONNECTION_TYPE_DOWNLOAD);
+
+			// don't wait for the next timer tick to try the new source.
+			attemptDownloads(GET_TICK());
 		} else {
 			DownloadManager::getInstance()->checkIdle(aUser.user);
 		}
@@ -159,6 +165,168 @@ void ConnectionManager::putConnection(UserConnection* aConn) {
 	userConnections.erase(remove(userConnections.begin(), userConnections.end(), aConn), userConnections.end());
 }
 
+namespace {
+
+/** Delay before retrying a download connection; doubled for each consecutive failure. */
+const uint64_t RETRY_DELAY = 60 * 1000;
+const int MAX_RETRY_SHIFT = 4;
+
+/** Time an attempt may stay in the CONNECTING state before it is considered failed. */
+const uint64_t CONNECT_TIMEOUT = 50 * 1000;
+
+const uint64_t NEVER = std::numeric_limits<uint64_t>::max();
+
+uint64_t retryDelay(int errors) {
+	return RETRY_DELAY << min(max(errors - 1, 0), MAX_RETRY_SHIFT);
+}
+
+} // namespace
+
+/**
+ * Start pending download connection attempts, highest queue priority first, while keeping at
+ * most CONCURRENT_CONNECT_ATTEMPTS of them in flight. Users that are not due yet (because of
+ * their retry delay) or that have nothing left to download are skipped. Call with cs held.
+ */
+void ConnectionManager::attemptDownloads(uint64_t aTick) {
+	int inFlight = count_if(downloads.begin(), downloads.end(), [](const ConnectionQueueItem& cqi) {
+		return cqi.getState() == ConnectionQueueItem::CONNECTING; });
+	const int maxInFlight = max(SETTING(CONCURRENT_CONNECT_ATTEMPTS), 1);
+
+	vector<pair<QueueItem::Priority, ConnectionQueueItem*>> candidates;
+	for(auto& cqi: downloads) {
+		if(cqi.getState() != ConnectionQueueItem::WAITING && cqi.getState() != ConnectionQueueItem::NO_DOWNLOAD_SLOTS)
+			continue;
+
+		// a user waiting for a free attempt only needs its priority looked up when one is free.
+		if(cqi.getState() == ConnectionQueueItem::WAITING && inFlight >= maxInFlight)
+			continue;
+
+		if(!cqi.getUser().user->isOnline())
+			continue;
+
+		if(cqi.getLastAttempt() != 0) {
+			if(cqi.getErrors() == -1) {
+				// protocol error, don't reconnect except after a forced attempt
+				continue;
+			}
+			if(cqi.getLastAttempt() + retryDelay(cqi.getErrors()) >= aTick) {
+				continue;
+			}
+		}
+
+		candidates.emplace_back(QueueManager::getInstance()->hasDownload(cqi.getUser()), &cqi);
+	}
+
+	if(candidates.empty())
+		return;
+
+	stable_sort(candidates.begin(), candidates.end(), [](const pair<QueueItem::Priority, ConnectionQueueItem*>& a,
+		const pair<QueueItem::Priority, ConnectionQueueItem*>& b) { return a.first > b.first; });
+
+	vector<UserPtr> removed;
+
+	for(auto& i: candidates) {
+		auto prio = i.first;
+		auto& cqi = *i.second;
+
+		if(prio == QueueItem::PAUSED) {
+			removed.push_back(cqi.getUser());
+			continue;
+		}
+
+		bool startDown = DownloadManager::getInstance()->startDownload(prio);
+
+		if(cqi.getState() == ConnectionQueueItem::NO_DOWNLOAD_SLOTS) {
+			if(!startDown) {
+				cqi.setLastAttempt(aTick);
+				continue;
+			}
+			cqi.setState(ConnectionQueueItem::WAITING);
+		}
+
+		if(!startDown) {
+			cqi.setLastAttempt(aTick);
+			cqi.setState(ConnectionQueueItem::NO_DOWNLOAD_SLOTS);
+			fire(ConnectionManagerListener::Failed(), &cqi, _("All download slots taken"));
+			continue;
+		}
+
+		if(inFlight >= maxInFlight) {
+			// stays due; it will be picked up as soon as an attempt finishes.
+			continue;
+		}
+
+		cqi.setLastAttempt(aTick);
+		cqi.setState(ConnectionQueueItem::CONNECTING);
+		ClientManager::getInstance()->connect(cqi.getUser(), cqi.getToken());
+		fire(ConnectionManagerListener::StatusChanged(), &cqi);
+		++inFlight;
+	}
+
+	removeDownloads(removed);
+	scheduleAttempts(aTick);
+}
+
+/**
+ * Arm a timer for the next time a download connection attempt times out or a retry delay
+ * expires. Timers that are already armed for an earlier time are kept; those that fire for
+ * nothing are harmless. Users whose retry delay has already passed but who couldn't be tried
+ * (no free attempt, or offline) don't get a timer: attemptDownloads picks them up when an
+ * attempt finishes or a user leaves, so the timer never spins. Call with cs held.
+ */
+void ConnectionManager::scheduleAttempts(uint64_t aTick) {
+	uint64_t due = NEVER;
+	for(auto& cqi: downloads) {
+		if(cqi.getState() == ConnectionQueueItem::CONNECTING) {
+			// an attempt that ran out before the timer got to it still has to be failed.
+			due = min(due, max(cqi.getLastAttempt() + CONNECT_TIMEOUT + 1, aTick + 1));
+		} else if(cqi.getState() != ConnectionQueueItem::ACTIVE && cqi.getLastAttempt() != 0 && cqi.getErrors() != -1) {
+			auto retry = cqi.getLastAttempt() + retryDelay(cqi.getErrors()) + 1;
+			if(retry > aTick) {
+				due = min(due, retry);
+			}
+		}
+	}
+
+	if(due == NEVER || (nextAttempt > aTick && nextAttempt <= due))
+		return;
+
+	nextAttempt = due;
+	TimerManager::getInstance()->schedule(due - aTick, [this, due](uint64_t tick) {
+		Lock l(cs);
+		if(nextAttempt == due) {
+			nextAttempt = 0;
+		}
+		expireAttempts(tick);
+		attemptDownloads(tick);
+	});
+}
+
+/** Fail the connection attempts that have been going on for too long. Call with cs held. */
+void ConnectionManager::expireAttempts(uint64_t aTick) {
+	for(auto& cqi: downloads) {
+		if(cqi.getState() == ConnectionQueueItem::CONNECTING && cqi.getLastAttempt() + CONNECT_TIMEOUT < aTick) {
+			cqi.setErrors(cqi.getErrors() + 1);
+			fire(ConnectionManagerListener::Failed(), &cqi, _("Connection timeout"));
+			cqi.setState(ConnectionQueueItem::WAITING);
+		}
+	}
+}
+
+void ConnectionManager::removeDownloads(const vector<UserPtr>& removed) {
+	if(removed.empty())
+		return;
+
+	// imitate putCQI but for multiple items at once.
+	downloads.erase(std::remove_if(downloads.begin(), downloads.end(), [this, &removed](ConnectionQueueItem& cqi) {
+		if(std::find(removed.begin(), removed.end(), cqi.getUser().user) != removed.end()) {
+			fire(ConnectionManagerListener::Removed(), &cqi);
+			return true;
+		}
+		return false;
+	}), downloads.end());
+}
+
 void ConnectionManager::on(TimerManagerListener::Second, uint64_t aTick) noexcept {
 	UserList passiveUsers;
 	vector<UserPtr> removed;
@@ -166,8 +334,6 @@ void ConnectionManager::on(TimerManagerListener::Second, uint64_t aTick) noexcep
 	{
 		Lock l(cs);
 
-		bool attemptDone = false;
-
 		for(auto& cqi: downloads) {
 
 			if(cqi.getState() != ConnectionQueueItem::ACTIVE) {
@@ -182,55 +348,17 @@ void ConnectionManager::on(TimerManagerListener::Second, uint64_t aTick) noexcep
 					removed.push_back(cqi.getUser());
 					continue;
 				}
+			}
+		}
 
-				if(cqi.getErrors() == -1 && cqi.getLastAttempt() != 0) {
-					// protocol error, don't reconnect except after a forced attempt
-					continue;
-				}
+		if(!removed.empty()) {
+			removeDownloads(removed);
 
-				if(cqi.getLastAttempt() == 0 || (!attemptDone &&
-					cqi.getLastAttempt() + 60 * 1000 * max(1, cqi.getErrors()) < aTick))
-				{
-					cqi.setLastAttempt(aTick);
-
-					QueueItem::Priority prio = QueueManager::getInstance()->hasDownload(cqi.getUser());
-
-					if(prio == QueueItem::PAUSED) {
-						removed.push_back(cqi.getUser());
-						continue;
-					}
-
-					bool startDown = DownloadManager::getInstance()->startDownload(prio);
-
-					if(cqi.getState() == ConnectionQueueItem::WAITING) {
-						if(startDown) {
-							cqi.setState(ConnectionQueueItem::CONNECTING);
-							ClientManager::getInstance()->connect(cqi.getUser(), cqi.getToken());
-							fire(ConnectionManagerListener::StatusChanged(), &cqi);
-							attemptDone = true;
-						} else {
-							cqi.setState(ConnectionQueueItem::NO_DOWNLOAD_SLOTS);
-							fire(ConnectionManagerListener::Failed(), &cqi, _("All download slots taken"));
-						}
-					} else if(cqi.getState() == ConnectionQueueItem::NO_DOWNLOAD_SLOTS && startDown) {
-						cqi.setState(ConnectionQueueItem::WAITING);
-					}
-				} else if(cqi.getState() == ConnectionQueueItem::CONNECTING && cqi.getLastAttempt() + 50 * 1000 < aTick) {
-					cqi.setErrors(cqi.getErrors() + 1);
-					fire(ConnectionManagerListener::Failed(), &cqi, _("Connection timeout"));
-					cqi.setState(ConnectionQueueItem::WAITING);
-				}
-			}
+			// attempts of users that just left may have been in flight.
+			attemptDownloads(aTick);
 		}
 
-		// imitate putCQI but for multiple items at once.
-		downloads.erase(std::remove_if(downloads.begin(), downloads.end(), [this, &removed](ConnectionQueueItem& cqi) {
-			if(std::find(removed.begin(), removed.end(), cqi.getUser().user) != removed.end()) {
-				fire(ConnectionManagerListener::Removed(), &cqi);
-				return true;
-			}
-			return false;
-		}), downloads.end());
+		// timeouts and retry delays are handled by the timer armed in scheduleAttempts.
 	}
 
 	for(auto& ui: passiveUsers) {
@@ -630,6 +758,9 @@ void ConnectionManager::addDownloadConnection(UserConnection* uc) {
 
 				dcdebug("ConnectionManager::addDownloadConnection, leaving to downloadmanager\n");
 				addConn = true;
+
+				// one less attempt in flight; let the next user in.
+				attemptDownloads(GET_TICK());
 			}
 		}
 	}
@@ -780,6 +911,7 @@ void ConnectionManager::force(const UserPtr& aUser) {
 	auto i = find(downloads.begin(), downloads.end(), aUser);
 	if(i != downloads.end()) {
 		i->setLastAttempt(0);
+		attemptDownloads(GET_TICK());
 	}
 }
 
@@ -831,6 +963,9 @@ void ConnectionManager::failed(UserConnection* aSource, const string& aError, bo
 			cqi.setErrors(protocolError ? -1 : (cqi.getErrors() + 1));
 			fire(ConnectionManagerListener::Failed(), &cqi, aError);
 
+			// arm the retry, and let in anyone who was due meanwhile.
+			attemptDownloads(cqi.getLastAttempt());
+
 		} else {
 			auto type = aSource->isSet(UserConnection::FLAG_UPLOAD) ? CONNECTION_TYPE_UPLOAD :
 				aSource->isSet(UserConnection::FLAG_PM) ? CONNECTION_TYPE_PM : CONNECTION_TYPE_LAST;
@@ -165,6 +165,10 @@ private:
 	ExpectedMap expectedConnections;
 
 	uint32_t floodCounter;
+
+	/** When the timer armed by scheduleAttempts fires; 0 if there is none pending. */
+	uint64_t nextAttempt;
+
 	unordered_set<string> hubsBlockingCC;
 
 	unique_ptr<Server> server;
@@ -186,6 +190,11 @@ private:
 	ConnectionQueueItem& getCQI(const HintedUser& user, ConnectionType type);
 	void putCQI(ConnectionQueueItem& cqi);
 
+	void attemptDownloads(uint64_t aTick);
+	void scheduleAttempts(uint64_t aTick);
+	void expireAttempts(uint64_t aTick);
+	void removeDownloads(const vector<UserPtr>& removed);
+
 	void accept(const Socket& sock, bool secure) noexcept;
 
 	bool checkKeyprint(UserConnection* aSource);
@@ -31,8 +31,10 @@
 #include "HttpManager.h"
 #include "LogManager.h"
 #include "MappingManager.h"
+#include "MetricsManager.h"
 #include "PluginApiImpl.h"
 #include "QueueManager.h"
+#include "Resolver.h"
 #include "ResourceManager.h"
 #include "SearchManager.h"
 #include "SettingsManager.h"
@@ -66,6 +68,7 @@ void startup() {
 
 	LogManager::newInstance();
 	TimerManager::newInstance();
+	Resolver::newInstance();
 	HashManager::newInstance();
 	CryptoManager::newInstance();
 	SearchManager::newInstance();
@@ -85,6 +88,7 @@ void startup() {
 	GeoManager::newInstance();
 	UserMatchManager::newInstance();
 	WindowManager::newInstance();
+	MetricsManager::newInstance();
 	PluginManager::newInstance();
 	PluginApiImpl::init();
 }
@@ -139,6 +143,7 @@ void shutdown() {
 	ThrottleManager::getInstance()->shutdown();
 	ConnectionManager::getInstance()->shutdown();
 	HttpManager::getInstance()->shutdown();
+	Resolver::getInstance()->shutdown();
 	MappingManager::getInstance()->close();
 	GeoManager::getInstance()->close();
 	BufferedSocket::waitShutdown();
@@ -151,6 +156,7 @@ void shutdown() {
 
 	PluginApiImpl::shutdown();
 	PluginManager::deleteInstance();
+	MetricsManager::deleteInstance();
 	WindowManager::deleteInstance();
 	UserMatchManager::deleteInstance();
 	GeoManager::deleteInstance();
@@ -170,6 +176,7 @@ void shutdown() {
 	FavoriteManager::deleteInstance();
 	ClientManager::deleteInstance();
 	HashManager::deleteInstance();
+	Resolver::deleteInstance();
 	LogManager::deleteInstance();
 	SettingsManager::deleteInstance();
 	TimerManager::deleteInstance();
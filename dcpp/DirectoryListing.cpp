@@ -18,24 +18,32 @@
 #include "stdinc.h"
 #include "DirectoryListing.h"
 
-#include "BZUtils.h"
 #include "ClientManager.h"
 #include "CryptoManager.h"
 #include "File.h"
-#include "FilteredFile.h"
+#include "ParallelUnBZ.h"
 #include "QueueManager.h"
+#include "ScopedFunctor.h"
 #include "ShareManager.h"
 #include "SimpleXML.h"
 #include "SimpleXMLReader.h"
 #include "StringTokenizer.h"
+#include "TimerManager.h"
 #include "version.h"
 
+#include <thread>
+
 namespace dcpp {
 
+using std::string_view;
+
 DirectoryListing::DirectoryListing(const HintedUser& aUser) :
 user(aUser),
 abort(false),
-root(new Directory(nullptr, Util::emptyString, false, false))
+root(new Directory(nullptr, Util::emptyString, false, false)),
+loadPos(0),
+loadSize(0),
+loadTime(0)
 {
 }
 
@@ -76,6 +84,8 @@ UserPtr DirectoryListing::getUserFromFilename(const string& fileName) {
 }
 
 void DirectoryListing::loadFile(const string& path) {
+	auto start = GET_TICK();
+
 	string actualPath;
 	if(dcpp::File::getSize(path + ".bz2") != -1) {
 		actualPath = path + ".bz2";
@@ -87,14 +97,23 @@ void DirectoryListing::loadFile(const string& path) {
 	{
 		dcpp::File file(actualPath.empty() ? path : actualPath, dcpp::File::READ, dcpp::File::OPEN);
 
+		loadPos = 0;
+		loadSize = file.getSize();
+		ScopedFunctor([this] { loadPosF = nullptr; });
+
 		if(Util::stricmp(ext, ".bz2") == 0) {
-			FilteredInputStream<UnBZFilter, false> f(&file);
+			// decompress on other threads while the list is being parsed
+			ParallelUnBZ f(file.read(), std::thread::hardware_concurrency());
+			loadPosF = [&f] { return f.getPos(); };
 			loadXML(f, false);
 		} else if(Util::stricmp(ext, ".xml") == 0) {
+			loadPosF = [&file] { return file.getPos(); };
 			loadXML(file, false);
 		} else {
 			throw Exception(_("Invalid file list extension (must be .xml or .bz2)"));
 		}
+
+		loadPos = loadSize.load();
 	}
 
 	if(!actualPath.empty()) {
@@ -102,6 +121,14 @@ void DirectoryListing::loadFile(const string& path) {
 		save(path);
 		dcpp::File::deleteFile(actualPath);
 	}
+
+	loadTime = GET_TICK() - start;
+	dcdebug("File list %s loaded in %u ms\n", path.c_str(), static_cast<unsigned>(loadTime));
+}
+
+float DirectoryListing::getLoadProgress() const {
+	auto size = loadSize.load();
+	return size > 0 ? static_cast<float>(loadPos) / static_cast<float>(size) : 0;
 }
 
 class ListLoader : public SimpleXMLReader::CallBack {
@@ -110,6 +137,7 @@ public:
 	list(list),
 	cur(root),
 	base("/"),
+	tags(0),
 	inListing(false),
 	updating(aUpdating)
 	{
@@ -122,7 +150,7 @@ public:
 		}
 	}
 
-	void startTag(const string& name, StringPairList& attribs, bool simple);
+	void startTag(string_view name, const AttribViewList& attribs, bool simple);
 	void endTag(const string& name);
 
 	const string& getBase() const { return base; }
@@ -133,6 +161,7 @@ private:
 
 	StringMap params;
 	string base;
+	uint32_t tags;
 	bool inListing;
 	bool updating;
 };
@@ -159,26 +188,30 @@ static const string sName = "Name";
 static const string sSize = "Size";
 static const string sTTH = "TTH";
 
-void ListLoader::startTag(const string& name, StringPairList& attribs, bool simple) {
+void ListLoader::startTag(string_view name, const AttribViewList& attribs, bool simple) {
 	if(list->getAbort()) { throw Exception(); }
 
+	if((++tags & 1023) == 0 && list->loadPosF) {
+		list->loadPos = list->loadPosF();
+	}
+
 	if(inListing) {
 		if(name == sFile) {
-			const string& n = getAttrib(attribs, sName, 0);
+			auto n = getAttrib(attribs, sName, 0);
 			if(n.empty())
 				return;
 
-			const string& s = getAttrib(attribs, sSize, 1);
+			auto s = getAttrib(attribs, sSize, 1);
 			if(s.empty())
 				return;
 			auto size = Util::toInt64(s);
 
-			const string& h = getAttrib(attribs, sTTH, 2);
+			auto h = getAttrib(attribs, sTTH, 2);
 			if(h.empty())
 				return;
 			TTHValue tth(h); /// @todo verify validity?
 
-			auto f = new DirectoryListing::File(cur, n, size, tth);
+			auto f = new DirectoryListing::File(cur, string(n), size, tth);
 			auto insert = cur->files.insert(f);
 
 			if(!insert.second) {
@@ -187,7 +220,7 @@ void ListLoader::startTag(const string& name, StringPairList& attribs, bool simp
 				if(updating) {
 					// partial file list
 					f = *insert.first;
-					f->setName(n); // the casing might have changed
+					f->setName(string(n)); // the casing might have changed
 					f->setSize(size);
 					f->setTTH(tth);
 				} else {
@@ -197,14 +230,14 @@ void ListLoader::startTag(const string& name, StringPairList& attribs, bool simp
 			}
 
 		} else if(name == sDirectory) {
-			const string& n = getAttrib(attribs, sName, 0);
+			auto n = getAttrib(attribs, sName, 0);
 			if(n.empty()) {
 				throw SimpleXMLException(_("Directory missing name attribute"));
 			}
 
 			bool incomp = getAttrib(attribs, sIncomplete, 1) == "1";
 
-			auto d = new DirectoryListing::Directory(cur, n, false, !incomp);
+			auto d = new DirectoryListing::Directory(cur, string(n), false, !incomp);
 			auto insert = cur->directories.insert(d);
 
 			if(!insert.second) {
@@ -225,12 +258,12 @@ void ListLoader::startTag(const string& name, StringPairList& attribs, bool simp
 
 			if(simple) {
 				// To handle <Directory Name="..." />
-				endTag(name);
+				endTag(sDirectory);
 			}
 		}
 
 	} else if(name == sFileListing) {
-		const string& b = getAttrib(attribs, sBase, 2);
+		auto b = getAttrib(attribs, sBase, 2);
 		if(b.size() >= 1 && b[0] == '/' && *(b.end() - 1) == '/') {
 			base = b;
 			if(list->base.empty() || base.size() < list->base.size()) {
@@ -258,7 +291,7 @@ void ListLoader::startTag(const string& name, StringPairList& attribs, bool simp
 
 		if(simple) {
 			// To handle <Directory Name="..." />
-			endTag(name);
+			endTag(sFileListing);
 		}
 	}
 }
@@ -18,6 +18,8 @@
 #ifndef DCPLUSPLUS_DCPP_DIRECTORY_LISTING_H
 #define DCPLUSPLUS_DCPP_DIRECTORY_LISTING_H
 
+#include <atomic>
+#include <functional>
 #include <set>
 
 #include <boost/core/noncopyable.hpp>
@@ -120,6 +122,10 @@ public:
 	~DirectoryListing();
 
 	void loadFile(const string& path);
+	/** How far loadFile has got, from 0 to 1; may be called from any thread while it runs. */
+	float getLoadProgress() const;
+	/** How long the last loadFile took, in milliseconds. */
+	uint64_t getLoadTime() const { return loadTime; }
 
 	string updateXML(const std::string&);
 	string loadXML(InputStream& xml, bool updating);
@@ -158,6 +164,13 @@ private:
 	Directory* root;
 	string base;
 
+	/// Bytes of the file being loaded that have been read so far, and its size
+	std::atomic<int64_t> loadPos;
+	std::atomic<int64_t> loadSize;
+	std::atomic<uint64_t> loadTime;
+	/// Where reading the file being loaded has got; only called on the loading thread
+	std::function<int64_t ()> loadPosF;
+
 	Directory* find(const string& aName, Directory* current) const;
 };
 
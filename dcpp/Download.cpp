@@ -26,6 +26,7 @@
 #include "MerkleTreeOutputStream.h"
 #include "File.h"
 #include "FilteredFile.h"
+#include "SharedFile.h"
 #include "ZUtils.h"
 
 namespace dcpp {
@@ -44,7 +45,8 @@ Download::Download(UserConnection& conn, QueueItem& qi) noexcept : Transfer(conn
 	if(qi.getSize() != -1) {
 		if(HashManager::getInstance()->getTree(getTTH(), tt)) {
 			setTreeValid(true);
-			setSegment(qi.getNextSegment(getTigerTree().getBlockSize(), conn.getChunkSize()));
+			setSegment(qi.getNextSegment(getTigerTree().getBlockSize(), conn.getChunkSize(),
+				qi.getSource(conn.getUser())->getPartsInfo()));
 		} else if(conn.supportsTrees() && !qi.getSource(conn.getUser())->isSet(QueueItem::Source::FLAG_NO_TREE) && qi.getSize() > HashManager::MIN_BLOCK_SIZE) {
 			// Get the tree unless the file is small (for small files, we'd probably only get the root anyway)
 			setType(TYPE_TREE);
@@ -57,6 +59,10 @@ Download::Download(UserConnection& conn, QueueItem& qi) noexcept : Transfer(conn
 			setSegment(qi.getNextSegment(getTigerTree().getBlockSize(), 0));
 		}
 	}
+
+	if(getType() == TYPE_FILE) {
+		file = qi.getSharedFile();
+	}
 }
 
 Download::~Download() {
@@ -106,25 +112,17 @@ const string& Download::getDownloadTarget() const {
 void Download::open(int64_t bytes, bool z) {
 	if(getType() == Transfer::TYPE_FILE) {
 		auto target = getDownloadTarget();
-		auto fullSize = tt.getFileSize();
-
-		if(getSegment().getStart() > 0) {
-			if(File::getSize(target) != fullSize) {
-				// When trying the download the next time, the resume pos will be reset
-				throw Exception(_("Target file is missing or wrong size"));
-			}
-		} else {
-			File::ensureDirectory(target);
-		}
-
-		unique_ptr<File> f(new File(target, File::WRITE, File::OPEN | File::CREATE | File::SHARED));
-
-		if(f->getSize() != fullSize) {
-			f->setSize(fullSize);
+		auto allocation = static_cast<File::Allocation>(std::min(std::max(SETTING(PREALLOCATION),
+			static_cast<int>(SettingsManager::PREALLOCATION_NONE)), static_cast<int>(SettingsManager::PREALLOCATION_FULL)));
+		auto resume = getSegment().getStart() > 0;
+
+		// the other segments have the file open elsewhere if its target changed since
+		if(!file || !file->open(target, tt.getFileSize(), allocation, resume)) {
+			file = std::make_shared<SharedFile>();
+			file->open(target, tt.getFileSize(), allocation, resume);
 		}
 
-		f->setPos(getSegment().getStart());
-		output = move(f);
+		output.reset(new SharedFileStream(file, getSegment().getStart()));
 		tempTarget = target;
 	} else if(getType() == Transfer::TYPE_FULL_LIST) {
 		auto target = getPath();
@@ -167,6 +165,8 @@ void Download::open(int64_t bytes, bool z) {
 void Download::close()
 {
 	output.reset();
+	// the file may be moved once the last segment lets go of it
+	file.reset();
 }
 
 } // namespace dcpp
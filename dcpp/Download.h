@@ -75,6 +75,8 @@ private:
 	const string& getDownloadTarget() const;
 
 	unique_ptr<OutputStream> output;
+	/// Shared with the other segments of the file being downloaded
+	std::shared_ptr<SharedFile> file;
 	TigerTree tt;
 	string pfs;
 };
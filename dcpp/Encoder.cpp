@@ -24,8 +24,132 @@
 
 #include "debug.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DCPP_ENCODER_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace dcpp {
 
+using std::min;
+
+namespace {
+
+/* 5 bytes make 8 base32 characters. The 40 bits of such a group fit in a word, so they are split
+up or put back together with a few shifts instead of bit by bit. */
+
+inline void splitGroup(const uint8_t* src, size_t n, uint8_t* dst) {
+	uint8_t bytes[5] = { 0 };
+	// a constant size is copied inline
+	if(n == 5) {
+		memcpy(bytes, src, 5);
+	} else {
+		memcpy(bytes, src, n);
+	}
+	uint64_t x = static_cast<uint64_t>(bytes[0]) << 32 | static_cast<uint64_t>(bytes[1]) << 24 |
+		static_cast<uint64_t>(bytes[2]) << 16 | static_cast<uint64_t>(bytes[3]) << 8 | bytes[4];
+
+	// the 40 bits are split in halves of 20 bits, then 10, then 5, each going to its own byte
+	x = (x >> 20) | ((x & 0xfffffULL) << 32);
+	x = ((x >> 10) & 0x000003ff000003ffULL) | ((x & 0x000003ff000003ffULL) << 16);
+	x = ((x >> 5) & 0x001f001f001f001fULL) | ((x & 0x001f001f001f001fULL) << 8);
+	for(size_t i = 0; i < 8; ++i) {
+		dst[i] = static_cast<uint8_t>(x >> (8 * i));
+	}
+}
+
+inline void joinGroup(const uint8_t* src, uint8_t* dst, size_t n) {
+	// the 8 values of 5 bits are merged pairwise: into 4 of 10 bits, 2 of 20 bits, then 40 bits
+	uint64_t x = static_cast<uint64_t>(src[0]) | static_cast<uint64_t>(src[1]) << 8 |
+		static_cast<uint64_t>(src[2]) << 16 | static_cast<uint64_t>(src[3]) << 24 |
+		static_cast<uint64_t>(src[4]) << 32 | static_cast<uint64_t>(src[5]) << 40 |
+		static_cast<uint64_t>(src[6]) << 48 | static_cast<uint64_t>(src[7]) << 56;
+	x = ((x & 0x00ff00ff00ff00ffULL) << 5) | ((x >> 8) & 0x00ff00ff00ff00ffULL);
+	x = ((x & 0x0000ffff0000ffffULL) << 10) | ((x >> 16) & 0x0000ffff0000ffffULL);
+	x = ((x & 0xffffffffULL) << 20) | (x >> 32);
+
+	uint8_t bytes[5] = {
+		static_cast<uint8_t>(x >> 32), static_cast<uint8_t>(x >> 24), static_cast<uint8_t>(x >> 16),
+		static_cast<uint8_t>(x >> 8), static_cast<uint8_t>(x)
+	};
+	if(n == 5) {
+		memcpy(dst, bytes, 5);
+	} else {
+		memcpy(dst, bytes, n);
+	}
+}
+
+/** Turn values 0-31 into base32 characters, in place. */
+void toChars(uint8_t* p, size_t n) {
+	size_t i = 0;
+#ifdef DCPP_ENCODER_SSE2
+	for(; i + 16 <= n; i += 16) {
+		// 'A' + x for letters, '2' + x - 26 for digits
+		auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+		auto digits = _mm_cmpgt_epi8(x, _mm_set1_epi8(25));
+		x = _mm_add_epi8(x, _mm_set1_epi8('A'));
+		x = _mm_sub_epi8(x, _mm_and_si128(digits, _mm_set1_epi8('A' - '2' + 26)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), x);
+	}
+#endif
+	for(; i < n; ++i) {
+		p[i] = static_cast<uint8_t>(p[i] < 26 ? 'A' + p[i] : '2' + p[i] - 26);
+	}
+}
+
+#ifdef DCPP_ENCODER_SSE2
+inline bool toValues16(const char* src, uint8_t* dst, bool lower) {
+	// bytes above 127 compare as negative and fall outside all ranges
+	auto c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+	auto inRange = [&c](char first, char last) {
+		return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(first - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(last + 1), c));
+	};
+	auto up = inRange('A', 'Z');
+	auto low = lower ? inRange('a', 'z') : _mm_setzero_si128();
+	auto digit = inRange('2', '7');
+	if(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(up, low), digit)) != 0xffff) {
+		return false;
+	}
+	auto x = _mm_and_si128(up, _mm_sub_epi8(c, _mm_set1_epi8('A')));
+	x = _mm_or_si128(x, _mm_and_si128(low, _mm_sub_epi8(c, _mm_set1_epi8('a'))));
+	x = _mm_or_si128(x, _mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('2' - 26))));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), x);
+	return true;
+}
+#endif
+
+/** Turn base32 characters into their values.
+@param lower Whether lowercase letters are accepted as well.
+@return false if any of the characters is not base32. */
+bool toValues(const char* src, uint8_t* dst, size_t n, bool lower) {
+#ifdef DCPP_ENCODER_SSE2
+	if(n >= 16) {
+		for(size_t i = 0; i + 16 <= n; i += 16) {
+			if(!toValues16(src + i, dst + i, lower)) {
+				return false;
+			}
+		}
+		// the last characters overlap those already done
+		return n % 16 == 0 || toValues16(src + n - 16, dst + n - 16, lower);
+	}
+#endif
+	for(size_t i = 0; i < n; ++i) {
+		auto c = src[i];
+		if(c >= 'A' && c <= 'Z') {
+			dst[i] = c - 'A';
+		} else if(lower && c >= 'a' && c <= 'z') {
+			dst[i] = c - 'a';
+		} else if(c >= '2' && c <= '7') {
+			dst[i] = c - '2' + 26;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // unnamed namespace
+
 const int8_t Encoder::base32Table[] = {
 	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
 	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
@@ -48,39 +172,72 @@ const int8_t Encoder::base32Table[] = {
 const char Encoder::base32Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
 
 string& Encoder::toBase32(const uint8_t* src, size_t len, string& dst) {
-	// Code snagged from the bitzi bitcollider
-	size_t i, index;
-	uint8_t word;
-	dst.reserve(((len * 8) / 5) + 1);
-
-	for(i = 0, index = 0; i < len;) {
-		/* Is the current word going to span a byte boundary? */
-		if (index > 3) {
-			word = (uint8_t)(src[i] & (0xFF >> index));
-			index = (index + 5) % 8;
-			word <<= index;
-			if ((i + 1) < len)
-				word |= src[i + 1] >> (8 - index);
+	auto chars = (len * 8 + 4) / 5;
+	auto groups = (len + 4) / 5;
 
-			i++;
-		} else {
-			word = (uint8_t)(src[i] >> (8 - (index + 5))) & 0x1F;
-			index = (index + 5) % 8;
-			if (index == 0)
-				i++;
-		}
+	// the values are put in place first, then turned into characters
+	auto pos = dst.size();
+	dst.resize(pos + groups * 8);
+	auto p = reinterpret_cast<uint8_t*>(&dst[pos]);
 
-		dcassert(word < 32);
-		dst += base32Alphabet[word];
+	for(size_t i = 0; i < groups; ++i) {
+		splitGroup(src + i * 5, min(len - i * 5, static_cast<size_t>(5)), p + i * 8);
 	}
+	toChars(p, chars);
+
+	dst.resize(pos + chars);
 	return dst;
 }
 
 void Encoder::fromBase32(const char* src, uint8_t* dst, size_t len) {
+	fromBase32(src, strlen(src), dst, len, false);
+}
+
+void Encoder::fromBase32(const char* src, size_t srcLen, uint8_t* dst, size_t len) {
+	fromBase32(src, srcLen, dst, len, false);
+}
+
+bool Encoder::fromBase32(const char* src, size_t srcLen, uint8_t* dst, size_t len, bool strict) {
+	auto chars = (len * 8 + 4) / 5;
+
+	if(srcLen == chars) {
+		// the usual case: up to 64 characters (hashes and CIDs take 39) are turned into values at
+		// once, then put together
+		uint8_t values[64 + 8];
+		bool valid = true;
+		for(size_t i = 0; i < chars && valid; i += 64) {
+			auto n = min(chars - i, static_cast<size_t>(64));
+			valid = toValues(src + i, values, n, !strict);
+			if(!valid) {
+				break;
+			}
+
+			memset(values + n, 0, 8);
+			for(size_t j = 0; j < n; j += 8) {
+				auto byte = (i + j) / 8 * 5;
+				joinGroup(values + j, dst + byte, min(len - byte, static_cast<size_t>(5)));
+			}
+
+			if(strict && i + n == chars) {
+				// the bits past the end must be 0
+				auto padding = chars * 5 - len * 8;
+				valid = (values[n - 1] & ((1 << padding) - 1)) == 0;
+			}
+		}
+
+		if(valid) {
+			return true;
+		}
+	}
+
+	if(strict) {
+		return false;
+	}
+
 	size_t i, index, offset;
 
 	memset(dst, 0, len);
-	for(i = 0, index = 0, offset = 0; src[i]; i++) {
+	for(i = 0, index = 0, offset = 0; i < srcLen; i++) {
 		// Skip what we don't recognise
 		int8_t tmp = base32Table[(unsigned char)src[i]];
 
@@ -106,6 +263,7 @@ void Encoder::fromBase32(const char* src, uint8_t* dst, size_t len) {
 			dst[offset] |= tmp << (8 - index);
 		}
 	}
+	return true;
 }
 
 bool Encoder::isBase32(const string& str) {
@@ -34,6 +34,11 @@ public:
 		return toBase32(src, len, tmp);
 	}
 	static void fromBase32(const char* src, uint8_t* dst, size_t len);
+	static void fromBase32(const char* src, size_t srcLen, uint8_t* dst, size_t len);
+	/** @param strict Only accept exactly the characters needed for len bytes, all from the base32
+	alphabet, with the padding bits unset; otherwise, what isn't recognised is skipped.
+	@return Whether the string was accepted. */
+	static bool fromBase32(const char* src, size_t srcLen, uint8_t* dst, size_t len, bool strict);
 	static bool isBase32(const string& str);
 
 	static void fromBase16(const char* src, uint8_t *dst, size_t len);
@@ -37,7 +37,7 @@ using std::swap;
 
 using boost::none;
 
-FavoriteManager::FavoriteManager() : lastId(0), useHttp(false), running(false), c(nullptr), lastServer(0), listType(TYPE_NORMAL), dontSave(false) {
+FavoriteManager::FavoriteManager() : lastId(0), usersVersion(0), useHttp(false), running(false), c(nullptr), lastServer(0), listType(TYPE_NORMAL), dontSave(false) {
 	ClientManager::getInstance()->addListener(this);
 	HttpManager::getInstance()->addListener(this);
 	SettingsManager::getInstance()->addListener(this);
@@ -212,6 +212,7 @@ void FavoriteManager::addFavoriteUser(const UserPtr& aUser) {
 				nicks.push_back(Util::emptyString);
 
 			auto i = users.emplace(aUser->getCID(), FavoriteUser(aUser, nicks[0], urls[0])).first;
+			++usersVersion;
 			fire(FavoriteManagerListener::UserAdded(), i->second);
 			save();
 		}
@@ -226,6 +227,7 @@ void FavoriteManager::removeFavoriteUser(const UserPtr& aUser) {
 	if(i != users.end()) {
 		fire(FavoriteManagerListener::UserRemoved(), i->second);
 		users.erase(i);
+		++usersVersion;
 		save();
 	}
 }
@@ -547,6 +549,7 @@ void FavoriteManager::load(SimpleXML& aXml) {
 
 			ClientManager::getInstance()->saveUser(u->getCID());
 			auto i = users.emplace(u->getCID(), FavoriteUser(u, nick, hubUrl)).first;
+			++usersVersion;
 
 			if(aXml.getBoolChildAttrib("GrantSlot"))
 				i->second.setFlag(FavoriteUser::FLAG_GRANTSLOT);
@@ -18,6 +18,8 @@
 #ifndef DCPLUSPLUS_DCPP_FAVORITE_MANAGER_H
 #define DCPLUSPLUS_DCPP_FAVORITE_MANAGER_H
 
+#include <atomic>
+
 #include <boost/optional.hpp>
 
 #include "SettingsManager.h"
@@ -74,6 +76,8 @@ public:
 	void addFavoriteUser(const UserPtr& aUser);
 	bool isFavoriteUser(const UserPtr& aUser) const { Lock l(cs); return users.find(aUser->getCID()) != users.end(); }
 	void removeFavoriteUser(const UserPtr& aUser);
+	/** Changes whenever a user is added to or removed from the favorites. */
+	uint32_t getUsersVersion() const { return usersVersion; }
 
 	optional<FavoriteUser> getFavoriteUser(const UserPtr& aUser) const;
 	bool hasSlot(const UserPtr& aUser) const;
@@ -132,6 +136,7 @@ private:
 	int lastId;
 
 	FavoriteMap users;
+	std::atomic<uint32_t> usersVersion;
 
 	mutable CriticalSection cs;
 
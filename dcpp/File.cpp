@@ -20,8 +20,23 @@
 
 #include <boost/scoped_array.hpp>
 
+#ifdef _WIN32
+#include <winioctl.h>
+#elif defined(__linux__)
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
 namespace dcpp {
 
+namespace {
+
+/** Progress is reported once per chunk, so that long copies can be followed without the caller
+being flooded. */
+const int64_t COPY_CHUNK = 32 * 1024 * 1024;
+
+}
+
 #ifdef _WIN32
 File::File(const string& aFileName, int access, int mode) {
 	dcassert(access == static_cast<int>(WRITE) || access == static_cast<int>(READ) || access == static_cast<int>((READ | WRITE)));
@@ -102,6 +117,16 @@ void File::setSize(int64_t newSize) {
 	setEOF();
 	setPos(pos);
 }
+
+void File::setSize(int64_t newSize, Allocation allocation) {
+	if(allocation == ALLOC_SPARSE) {
+		// otherwise SetEndOfFile allocates the whole file, which is what ALLOC_FULL wants as well
+		DWORD x;
+		::DeviceIoControl(h, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &x, nullptr);
+	}
+	setSize(newSize);
+}
+
 void File::setPos(int64_t pos) noexcept {
 	LONG x = (LONG) (pos>>32);
 	::SetFilePointer(h, (DWORD)(pos & 0xffffffff), &x, FILE_BEGIN);
@@ -125,6 +150,39 @@ size_t File::read(void* buf, size_t& len) {
 	return x;
 }
 
+size_t File::readAt(void* buf, size_t len, int64_t pos) {
+	OVERLAPPED over = { 0 };
+	over.Offset = static_cast<DWORD>(pos);
+	over.OffsetHigh = static_cast<DWORD>(pos >> 32);
+
+	DWORD x;
+	if(!::ReadFile(h, buf, (DWORD)len, &x, &over)) {
+		auto err = GetLastError();
+		if(err == ERROR_HANDLE_EOF) {
+			return 0;
+		}
+		throw FileException(Util::translateError(err));
+	}
+	return x;
+}
+
+size_t File::writeAt(const void* buf, size_t len, int64_t pos) {
+	OVERLAPPED over = { 0 };
+	over.Offset = static_cast<DWORD>(pos);
+	over.OffsetHigh = static_cast<DWORD>(pos >> 32);
+
+	DWORD x;
+	if(!::WriteFile(h, buf, (DWORD)len, &x, &over)) {
+		throw FileException(Util::translateError(GetLastError()));
+	}
+	dcassert(x == len);
+	return x;
+}
+
+void File::prefetch(int64_t /*pos*/, int64_t /*len*/) noexcept {
+	// the cache manager reads ahead on its own for files read in order
+}
+
 size_t File::write(const void* buf, size_t len) {
 	DWORD x;
 	if(!::WriteFile(h, buf, (DWORD)len, &x, NULL)) {
@@ -146,16 +204,39 @@ size_t File::flush() {
 	return 0;
 }
 
-void File::renameFile(const string& source, const string& target) {
+void File::renameFile(const string& source, const string& target, const CopyProgress& progress) {
 	if(!::MoveFile(Text::toT(source).c_str(), Text::toT(target).c_str())) {
 		// Can't move, try copy/delete...
-		copyFile(source, target);
+		copyFile(source, target, progress);
 		deleteFile(source);
 	}
 }
 
-void File::copyFile(const string& src, const string& target) {
-	if(!::CopyFile(Text::toT(src).c_str(), Text::toT(target).c_str(), FALSE)) {
+namespace {
+
+struct CopyState {
+	const File::CopyProgress& progress;
+	int64_t reported;
+};
+
+DWORD CALLBACK copyProgress(LARGE_INTEGER total, LARGE_INTEGER copied, LARGE_INTEGER, LARGE_INTEGER, DWORD, DWORD,
+	HANDLE, HANDLE, LPVOID data)
+{
+	auto& state = *reinterpret_cast<CopyState*>(data);
+	if(copied.QuadPart - state.reported >= COPY_CHUNK || copied.QuadPart == total.QuadPart) {
+		state.reported = copied.QuadPart;
+		state.progress(copied.QuadPart, total.QuadPart);
+	}
+	return PROGRESS_CONTINUE;
+}
+
+}
+
+void File::copyFile(const string& src, const string& target, const CopyProgress& progress) {
+	CopyState state = { progress, 0 };
+	if(!::CopyFileEx(Text::toT(src).c_str(), Text::toT(target).c_str(), progress ? copyProgress : nullptr, &state,
+		nullptr, 0))
+	{
 		throw FileException(Util::translateError(GetLastError()));
 	}
 }
@@ -273,6 +354,48 @@ size_t File::read(void* buf, size_t& len) {
 	return (size_t)result;
 }
 
+size_t File::readAt(void* buf, size_t len, int64_t pos) {
+	auto pointer = reinterpret_cast<char*>(buf);
+	size_t done = 0;
+
+	while(done < len) {
+		auto result = ::pread(h, pointer + done, len - done, pos + done);
+		if(result == -1) {
+			if(errno != EINTR) {
+				throw FileException(Util::translateError(errno));
+			}
+		} else if(result == 0) {
+			break;
+		} else {
+			done += result;
+		}
+	}
+	return done;
+}
+
+size_t File::writeAt(const void* buf, size_t len, int64_t pos) {
+	auto pointer = reinterpret_cast<const char*>(buf);
+	size_t done = 0;
+
+	while(done < len) {
+		auto result = ::pwrite(h, pointer + done, len - done, pos + done);
+		if(result == -1) {
+			if(errno != EINTR) {
+				throw FileException(Util::translateError(errno));
+			}
+		} else {
+			done += result;
+		}
+	}
+	return len;
+}
+
+void File::prefetch(int64_t pos, int64_t len) noexcept {
+#ifdef POSIX_FADV_WILLNEED
+	posix_fadvise(h, pos, len, POSIX_FADV_WILLNEED);
+#endif
+}
+
 size_t File::write(const void* buf, size_t len) {
 	ssize_t result;
 	char* pointer = (char*)buf;
@@ -327,6 +450,27 @@ void File::setSize(int64_t newSize) {
 	setPos(pos);
 }
 
+void File::setSize(int64_t newSize, Allocation allocation) {
+	if(allocation == ALLOC_FULL && newSize > getSize()) {
+#ifdef __linux__
+		// file systems that can't reserve blocks without writing them fail with EOPNOTSUPP; leave
+		// those be rather than writing gigabytes of zeros
+		if(::fallocate(h, 0, 0, (off_t)newSize) == 0) {
+			return;
+		}
+		if(errno == ENOSPC) {
+			throw FileException(Util::translateError(errno));
+		}
+#endif
+	} else if(allocation == ALLOC_SPARSE) {
+		// extending with ftruncate leaves a hole
+		if(::ftruncate(h, (off_t)newSize) == 0) {
+			return;
+		}
+	}
+	setSize(newSize);
+}
+
 size_t File::flush() {
 	if(isOpen() && fsync(h) == -1)
 		throw FileException(Util::translateError(errno));
@@ -340,32 +484,89 @@ size_t File::flush() {
  * filesystem to be mounted at multiple points, but rename(2) does not
  * work across different mount points, even if the same filesystem is mounted on both.)
 */
-void File::renameFile(const string& source, const string& target) {
+void File::renameFile(const string& source, const string& target, const CopyProgress& progress) {
 	int ret = ::rename(Text::fromUtf8(source).c_str(), Text::fromUtf8(target).c_str());
 	if(ret != 0 && errno == EXDEV) {
-		copyFile(source, target);
+		copyFile(source, target, progress);
 		deleteFile(source);
 	} else if(ret != 0)
 		throw FileException(source + Util::translateError(errno));
 }
 
-// This doesn't assume all bytes are written in one write call, it is a bit safer
-void File::copyFile(const string& source, const string& target) {
+/* In order of preference: share the extents of the source on copy-on-write file systems, have the
+kernel copy the data (which network file systems may do server side), then copy it through a
+buffer. */
+void File::copyFile(const string& source, const string& target, const CopyProgress& progress) {
+	File src(source, File::READ, 0);
+	File dst(target, File::WRITE, File::CREATE | File::TRUNCATE);
+
+	const auto total = src.getSize();
+	int64_t copied = 0;
+
+#ifdef __linux__
+#ifdef FICLONE
+	if(::ioctl(dst.h, FICLONE, src.h) == 0) {
+		if(progress) {
+			progress(total, total);
+		}
+		return;
+	}
+#endif
+
+	while(true) {
+		auto ret = ::copy_file_range(src.h, nullptr, dst.h, nullptr, COPY_CHUNK, 0);
+		if(ret > 0) {
+			copied += ret;
+			if(progress) {
+				progress(copied, total);
+			}
+		} else if(ret == 0) {
+			if(copied >= total) {
+				return;
+			}
+			// some file systems give up without copying anything; the buffer takes it from there
+			break;
+		} else if(errno != EINTR) {
+			// across file systems before Linux 5.3 and on some file systems; both files are
+			// positioned at what has been copied so far, so the buffer takes it from there
+			if(errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP) {
+				break;
+			}
+			throw FileException(Util::translateError(errno));
+		}
+	}
+#endif
+
+	if(copied == 0 && total > 0) {
+		dst.setSize(total, ALLOC_FULL);
+	}
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise(src.h, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
 	const size_t BUF_SIZE = 64 * 1024;
 	boost::scoped_array<char> buffer(new char[BUF_SIZE]);
 	size_t count = BUF_SIZE;
-	File src(source, File::READ, 0);
-	File dst(target, File::WRITE, File::CREATE | File::TRUNCATE);
+	auto reported = copied;
 
+	// This doesn't assume all bytes are written in one write call, it is a bit safer
 	while(src.read(&buffer[0], count) > 0) {
-		char* p = &buffer[0];
-		while(count > 0) {
-			size_t ret = dst.write(p, count);
-			p += ret;
-			count -= ret;
+		dst.write(&buffer[0], count);
+		copied += count;
+		if(progress && copied - reported >= COPY_CHUNK) {
+			reported = copied;
+			progress(copied, total);
 		}
 		count = BUF_SIZE;
 	}
+
+	// the source may have changed size since the space was reserved
+	if(dst.getSize() != copied) {
+		dst.setSize(copied);
+	}
+	if(progress && reported != copied) {
+		progress(copied, total);
+	}
 }
 
 void File::deleteFile(const string& aFileName) noexcept {
@@ -18,6 +18,8 @@
 #ifndef DCPLUSPLUS_DCPP_FILE_H
 #define DCPLUSPLUS_DCPP_FILE_H
 
+#include <functional>
+
 #include "Streams.h"
 
 #ifdef _WIN32
@@ -49,6 +51,20 @@ public:
 		SHARED = 0x08
 	};
 
+	/** How space is set aside for a file whose size is set before it is written to. */
+	enum Allocation {
+		/// Leave it to the file system: NTFS allocates the whole file, POSIX systems leave a hole
+		ALLOC_NONE,
+		/// Take no space until written
+		ALLOC_SPARSE,
+		/// Reserve all the blocks right away (without writing them where the file system allows),
+		/// so that the file isn't fragmented and a full disk shows up at once
+		ALLOC_FULL
+	};
+
+	/** Called now and then while copying with the bytes copied so far and the size of the file. */
+	typedef std::function<void (int64_t, int64_t)> CopyProgress;
+
 #ifdef _WIN32
 	enum {
 		READ = GENERIC_READ,
@@ -78,6 +94,7 @@ public:
 	virtual void close() noexcept;
 	virtual int64_t getSize() noexcept;
 	virtual void setSize(int64_t newSize);
+	void setSize(int64_t newSize, Allocation allocation);
 
 	virtual int64_t getPos() noexcept;
 	virtual void setPos(int64_t pos) noexcept;
@@ -89,10 +106,22 @@ public:
 	virtual size_t write(const void* buf, size_t len);
 	virtual size_t flush();
 
+	/** Read from a given position, leaving the file pointer alone on POSIX systems; several
+	threads may read from the same file this way.
+	@return The number of bytes read, less than len at the end of the file */
+	size_t readAt(void* buf, size_t len, int64_t pos);
+	/** Write at a given position, leaving the file pointer alone on POSIX systems; several
+	threads may write to different parts of the same file this way. */
+	size_t writeAt(const void* buf, size_t len, int64_t pos);
+	/** Hint that a range of the file will be read soon so that the system may start reading it
+	ahead; does nothing where there is no such hint. */
+	void prefetch(int64_t pos, int64_t len) noexcept;
+
 	uint32_t getLastModified() noexcept;
 
-	static void copyFile(const string& src, const string& target);
-	static void renameFile(const string& source, const string& target);
+	static void copyFile(const string& src, const string& target, const CopyProgress& progress = CopyProgress());
+	/** Moves the file, copying it when it has to go to another volume. */
+	static void renameFile(const string& source, const string& target, const CopyProgress& progress = CopyProgress());
 	static void deleteFile(const string& aFileName) noexcept;
 
 	static int64_t getSize(const string& aFileName) noexcept;
@@ -42,7 +42,8 @@ uint64_t HashBloom::get_m(size_t n, size_t k) {
 
 void HashBloom::add(const TTHValue& tth) {
 	for(size_t i = 0; i < k; ++i) {
-		bloom[pos(tth, i)] = true;
+		auto p = pos(tth, i);
+		bloom[p / 64] |= static_cast<uint64_t>(1) << (p % 64);
 	}
 }
 
@@ -51,7 +52,8 @@ bool HashBloom::match(const TTHValue& tth) const {
 		return false;
 	}
 	for(size_t i = 0; i < k; ++i) {
-		if(!bloom[pos(tth, i)]) {
+		auto p = pos(tth, i);
+		if(!(bloom[p / 64] & (static_cast<uint64_t>(1) << (p % 64)))) {
 			return false;
 		}
 	}
@@ -59,39 +61,56 @@ bool HashBloom::match(const TTHValue& tth) const {
 }
 
 void HashBloom::push_back(bool v) {
-	bloom.push_back(v);
+	if(bits % 64 == 0) {
+		bloom.push_back(0);
+	}
+	if(v) {
+		bloom.back() |= static_cast<uint64_t>(1) << (bits % 64);
+	}
+	++bits;
 }
 
 void HashBloom::reset(size_t k_, size_t m, size_t h_) {
-	bloom.resize(m);
+	bloom.assign((m + 63) / 64, 0);
+	bits = m;
 	k = k_;
 	h = h_;
 }
 
+void HashBloom::clear() {
+	std::fill(bloom.begin(), bloom.end(), 0);
+}
+
 size_t HashBloom::pos(const TTHValue& tth, size_t n) const {
 	if((n+1)*h > TTHValue::BITS) {
 		return 0;
 	}
 
-	uint64_t x = 0;
-
+	// the h bits starting at bit n * h, least significant first; they span at most 9 bytes
 	size_t start = n * h;
-	for(size_t i = 0; i < h; ++i) {
-		size_t bit = start + i;
-		size_t byte = bit / 8;
-		size_t pos = bit % 8;
+	size_t byte = start / 8;
+	size_t shift = start % 8;
 
-		if(tth.data[byte] & (1 << pos)) {
-			x |= (1LL << i);
-		}
+	uint64_t x = 0;
+	size_t end = std::min(byte + 8, static_cast<size_t>(TTHValue::BYTES));
+	for(size_t i = byte; i < end; ++i) {
+		x |= static_cast<uint64_t>(tth.data[i]) << ((i - byte) * 8);
+	}
+	x >>= shift;
+	if(shift > 0 && byte + 8 < TTHValue::BYTES) {
+		x |= static_cast<uint64_t>(tth.data[byte + 8]) << (64 - shift);
 	}
-	return x % bloom.size();
+	if(h < 64) {
+		x &= (static_cast<uint64_t>(1) << h) - 1;
+	}
+
+	return x % bits;
 }
 
 void HashBloom::copy_to(ByteVector& v) const {
-	v.resize(bloom.size() / 8);
-	for(size_t i = 0; i < bloom.size(); ++i) {
-		v[i/8] |= bloom[i] << (i % 8);
+	v.resize(bits / 8);
+	for(size_t i = 0; i < v.size(); ++i) {
+		v[i] = static_cast<uint8_t>(bloom[i / 8] >> (i % 8 * 8));
 	}
 }
 
@@ -33,7 +33,7 @@ namespace dcpp {
  */
 class HashBloom {
 public:
-	HashBloom() : k(0), h(0) { }
+	HashBloom() : bits(0), k(0), h(0) { }
 
 	/** Return a suitable value for k based on n */
 	static size_t get_k(size_t n, size_t h);
@@ -43,14 +43,22 @@ public:
 	void add(const TTHValue& tth);
 	bool match(const TTHValue& tth) const;
 	void reset(size_t k, size_t m, size_t h);
+	/** Unset all bits, keeping k, m and h */
+	void clear();
 	void push_back(bool v);
 
+	size_t get_k() const { return k; }
+	size_t get_m() const { return bits; }
+	size_t get_h() const { return h; }
+
 	void copy_to(ByteVector& v) const;
 private:
 
 	size_t pos(const TTHValue& tth, size_t n) const;
 
-	std::vector<bool> bloom;
+	/// Bit i is bit i % 64 of word i / 64, which is also the order in which they are sent
+	vector<uint64_t> bloom;
+	size_t bits;
 	size_t k;
 	size_t h;
 };
@@ -23,6 +23,7 @@
 #include "File.h"
 #include "FileReader.h"
 #include "LogManager.h"
+#include "Metrics.h"
 #include "ScopedFunctor.h"
 #include "SimpleXML.h"
 #include "SFVReader.h"
@@ -43,7 +44,7 @@ static const uint32_t HASH_FILE_VERSION = 3;
 const int64_t HashManager::MIN_BLOCK_SIZE = 64 * 1024;
 
 optional<TTHValue> HashManager::getTTH(const string& aFileName, int64_t aSize, uint32_t aTimeStamp) noexcept {
-	Lock l(cs);
+	WriteLock l(cs);
 	auto tth = store.getTTH(aFileName, aSize, aTimeStamp);
 	if(!tth) {
 		hasher.hashFile(aFileName, aSize);
@@ -52,18 +53,42 @@ optional<TTHValue> HashManager::getTTH(const string& aFileName, int64_t aSize, u
 }
 
 bool HashManager::getTree(const TTHValue& root, TigerTree& tt) {
-	Lock l(cs);
-	return store.getTree(root, tt);
+	if(treeCache.get(root, tt)) {
+		return true;
+	}
+
+	{
+		ReadLock l(cs);
+		if(!store.getTree(root, tt)) {
+			return false;
+		}
+	}
+
+	treeCache.add(tt);
+	return true;
 }
 
 int64_t HashManager::getBlockSize(const TTHValue& root) {
-	Lock l(cs);
+	ReadLock l(cs);
 	return store.getBlockSize(root);
 }
 
+bool HashManager::addTree(const TigerTree& tree) {
+	{
+		WriteLock l(cs);
+		if(!store.addTree(tree)) {
+			return false;
+		}
+	}
+
+	// a tree just downloaded is about to be used for the file's segments
+	treeCache.add(tree);
+	return true;
+}
+
 void HashManager::hashDone(const string& aFileName, uint32_t aTimeStamp, const TigerTree& tth, int64_t speed, int64_t size) {
 	try {
-		Lock l(cs);
+		WriteLock l(cs);
 		store.addFile(aFileName, aTimeStamp, tth, true);
 	} catch (const Exception& e) {
 		LogManager::getInstance()->message(str(F_("Hashing failed: %1%") % e.getError()));
@@ -101,9 +126,13 @@ void HashManager::HashStore::addFile(const string& aFileName, uint32_t aTimeStam
 
 bool HashManager::HashStore::addTree(const TigerTree& tt) noexcept {
 	if (treeIndex.find(tt.getRoot()) == treeIndex.end()) {
+		if (!dataFile) {
+			openDataFile();
+			if (!dataFile)
+				return false;
+		}
 		try {
-			File f(getDataFile(), File::READ | File::WRITE, File::OPEN);
-			int64_t index = saveTree(f, tt);
+			int64_t index = saveTree(*dataFile, tt);
 			treeIndex.emplace(tt.getRoot(), TreeInfo(tt.getFileSize(), index, tt.getBlockSize()));
 			dirty = true;
 		} catch (const FileException& e) {
@@ -139,16 +168,18 @@ int64_t HashManager::HashStore::saveTree(File& f, const TigerTree& tt) {
 	return pos;
 }
 
-bool HashManager::HashStore::loadTree(File& f, const TreeInfo& ti, const TTHValue& root, TigerTree& tt) {
+bool HashManager::HashStore::loadTree(File* f, const TreeInfo& ti, const TTHValue& root, TigerTree& tt) {
 	if (ti.getIndex() == SMALL_TREE) {
 		tt = TigerTree(ti.getSize(), ti.getBlockSize(), root);
 		return true;
 	}
+	if (!f)
+		return false;
 	try {
-		f.setPos(ti.getIndex());
 		size_t datalen = TigerTree::calcBlocks(ti.getSize(), ti.getBlockSize()) * TTHValue::BYTES;
 		boost::scoped_array<uint8_t> buf(new uint8_t[datalen]);
-		f.read(&buf[0], datalen);
+		if (f->readAt(&buf[0], datalen, ti.getIndex()) != datalen)
+			return false;
 		tt = TigerTree(ti.getSize(), ti.getBlockSize(), &buf[0]);
 		if (!(tt.getRoot() == root))
 			return false;
@@ -159,16 +190,11 @@ bool HashManager::HashStore::loadTree(File& f, const TreeInfo& ti, const TTHValu
 	return true;
 }
 
-bool HashManager::HashStore::getTree(const TTHValue& root, TigerTree& tt) {
+bool HashManager::HashStore::getTree(const TTHValue& root, TigerTree& tt) const {
 	auto i = treeIndex.find(root);
 	if (i == treeIndex.end())
 		return false;
-	try {
-		File f(getDataFile(), File::READ, File::OPEN);
-		return loadTree(f, i->second, root, tt);
-	} catch (const Exception&) {
-		return false;
-	}
+	return loadTree(dataFile.get(), i->second, root, tt);
 }
 
 int64_t HashManager::HashStore::getBlockSize(const TTHValue& root) const {
@@ -221,13 +247,15 @@ void HashManager::HashStore::rebuild() {
 
 		createDataFile(tmpName);
 
+		if (!dataFile)
+			throw FileException(_("Unable to read hash data file"));
+
 		{
-			File in(origName, File::READ, File::OPEN);
 			File out(tmpName, File::READ | File::WRITE, File::OPEN);
 
 			for (auto i = newTreeIndex.begin(); i != newTreeIndex.end();) {
 				TigerTree tree;
-				if (loadTree(in, i->second, i->first, tree)) {
+				if (loadTree(dataFile.get(), i->second, i->first, tree)) {
 					i->second.setIndex(saveTree(out, tree));
 					++i;
 				} else {
@@ -250,14 +278,18 @@ void HashManager::HashStore::rebuild() {
 			}
 		}
 
+		dataFile.reset();
 		File::deleteFile(origName);
 		File::renameFile(tmpName, origName);
+		openDataFile();
 		treeIndex = newTreeIndex;
 		fileIndex = newFileIndex;
 		dirty = true;
 		save();
 	} catch (const Exception& e) {
 		LogManager::getInstance()->message(str(F_("Hash data rebuilding failed: %1%") % e.getError()));
+		if (!dataFile)
+			openDataFile();
 	}
 }
 
@@ -496,6 +528,16 @@ HashManager::HashStore::HashStore() :
 			// ?
 		}
 	}
+
+	openDataFile();
+}
+
+void HashManager::HashStore::openDataFile() noexcept {
+	try {
+		dataFile.reset(new File(getDataFile(), File::READ | File::WRITE, File::OPEN));
+	} catch (const FileException& e) {
+		LogManager::getInstance()->message(str(F_("Error opening hash data file: %1%") % e.getError()));
+	}
 }
 
 /**
@@ -661,6 +703,9 @@ int HashManager::Hasher::run() {
 						lastRead = GET_TICK();
 					}
 
+					static auto& hashed = Metrics::counter("hash.bytes");
+					hashed.add(n);
+
 					tt.update(buf, n);
 					if(xcrc32)
 						(*xcrc32)(buf, n);
@@ -714,17 +759,17 @@ HashManager::HashPauser::~HashPauser() {
 }
 
 bool HashManager::pauseHashing() noexcept {
-	Lock l(cs);
+	WriteLock l(cs);
 	return hasher.pause();
 }
 
 void HashManager::resumeHashing() noexcept {
-	Lock l(cs);
+	WriteLock l(cs);
 	hasher.resume();
 }
 
 bool HashManager::isHashingPaused() const noexcept {
-	Lock l(cs);
+	// the hasher guards its state itself
 	return hasher.isPaused();
 }
 
@@ -20,22 +20,28 @@
 
 #include <functional>
 #include <map>
+#include <memory>
 
 #include <boost/optional.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
 
 #include "Singleton.h"
 #include "MerkleTree.h"
 #include "Thread.h"
 #include "CriticalSection.h"
+#include "File.h"
 #include "SemaphoreDCpp.h"
 #include "TimerManager.h"
 #include "HashManagerListener.h"
 #include "GetSet.h"
+#include "TreeCache.h"
 
 namespace dcpp {
 
 using std::function;
 using std::map;
+using std::unique_ptr;
 
 using boost::optional;
 
@@ -51,7 +57,7 @@ public:
 	/** We don't keep leaves for blocks smaller than this... */
 	static const int64_t MIN_BLOCK_SIZE;
 
-	HashManager() {
+	HashManager() : treeCache(TREE_CACHE_SIZE) {
 		TimerManager::getInstance()->addListener(this);
 	}
 	virtual ~HashManager() {
@@ -70,7 +76,7 @@ public:
 	/** Return block size of the tree associated with root, or 0 if no such tree is in the store */
 	int64_t getBlockSize(const TTHValue& root);
 
-	bool addTree(const TigerTree& tree) { Lock l(cs); return store.addTree(tree); }
+	bool addTree(const TigerTree& tree);
 
 	void getStats(string& curFile, uint64_t& bytesLeft, size_t& filesLeft) const {
 		hasher.getStats(curFile, bytesLeft, filesLeft);
@@ -86,7 +92,7 @@ public:
 	void shutdown() {
 		hasher.shutdown();
 		hasher.join();
-		Lock l(cs);
+		WriteLock l(cs);
 		store.save();
 	}
 
@@ -155,7 +161,7 @@ private:
 		optional<TTHValue> getTTH(const string& aFileName, int64_t aSize, uint32_t aTimeStamp) noexcept;
 
 		bool addTree(const TigerTree& tt) noexcept;
-		bool getTree(const TTHValue& root, TigerTree& tth);
+		bool getTree(const TTHValue& root, TigerTree& tth) const;
 		int64_t getBlockSize(const TTHValue& root) const;
 		bool isDirty() { return dirty; }
 	private:
@@ -188,11 +194,15 @@ private:
 		unordered_map<string, vector<FileInfo>> fileIndex;
 		unordered_map<TTHValue, TreeInfo> treeIndex;
 
+		/// Kept open for the trees to be read with positional reads, by several threads at once
+		unique_ptr<File> dataFile;
+
 		bool dirty;
 
 		void createDataFile(const string& name);
+		void openDataFile() noexcept;
 
-		bool loadTree(File& dataFile, const TreeInfo& ti, const TTHValue& root, TigerTree& tt);
+		static bool loadTree(File* dataFile, const TreeInfo& ti, const TTHValue& root, TigerTree& tt);
 		int64_t saveTree(File& dataFile, const TigerTree& tt);
 
 		static string getIndexFile();
@@ -201,10 +211,18 @@ private:
 
 	friend class HashLoader;
 
+	typedef boost::shared_lock<boost::shared_mutex> ReadLock;
+	typedef boost::unique_lock<boost::shared_mutex> WriteLock;
+
+	/** Size of the leaves of the trees kept in memory */
+	static const size_t TREE_CACHE_SIZE = 4 * 1024 * 1024;
+
 	Hasher hasher;
 	HashStore store;
+	TreeCache treeCache;
 
-	mutable CriticalSection cs;
+	/** Shared by lookups (trees, block sizes), exclusive for anything that changes the store */
+	mutable boost::shared_mutex cs;
 
 	/** Single node tree where node = root, no storage in HashData.dat */
 	static const int64_t SMALL_TREE = -1;
@@ -212,12 +230,12 @@ private:
 	void hashDone(const string& aFileName, uint32_t aTimeStamp, const TigerTree& tth, int64_t speed, int64_t size);
 
 	void doRebuild() {
-		Lock l(cs);
+		WriteLock l(cs);
 		store.rebuild();
 	}
 
 	virtual void on(TimerManagerListener::Minute, uint64_t) noexcept {
-		Lock l(cs);
+		WriteLock l(cs);
 		store.save();
 	}
 };
@@ -19,6 +19,7 @@
 #define DCPLUSPLUS_DCPP_HASH_VALUE_H
 
 #include <algorithm>
+#include <string_view>
 
 #include "FastAlloc.h"
 #include "Encoder.h"
@@ -32,7 +33,7 @@ struct HashValue : FastAlloc<HashValue<Hasher> >{
 
 	HashValue() { memset(data, 0, BYTES); }
 	explicit HashValue(const uint8_t* aData) { memcpy(data, aData, BYTES); }
-	explicit HashValue(const std::string& base32) { Encoder::fromBase32(base32.c_str(), data, BYTES); }
+	explicit HashValue(std::string_view base32) { Encoder::fromBase32(base32.data(), base32.size(), data, BYTES); }
 
 	bool operator!=(const HashValue& rhs) const { return !(*this == rhs); }
 	bool operator==(const HashValue& rhs) const { return memcmp(data, rhs.data, BYTES) == 0; }
@@ -19,6 +19,7 @@
 #include "LogManager.h"
 
 #include "File.h"
+#include "format.h"
 #include "TimerManager.h"
 
 namespace dcpp {
@@ -67,15 +68,140 @@ void LogManager::saveSetting(int area, int sel, const string& setting) {
 }
 
 void LogManager::log(const string& area, const string& msg) noexcept {
-	Lock l(cs);
-	try {
-		string aArea = Util::validateFileName(area);
+	writer.write(area, msg + "\r\n");
+}
+
+namespace {
+
+/** Lines waiting to be written beyond this are dropped (the disk must be stalled by then). */
+const size_t MAX_QUEUED_BYTES = 4 * 1024 * 1024;
+/** Files kept open at once; the one written to least recently is closed first. */
+const size_t MAX_OPEN_FILES = 32;
+/** Files not written to for this long are closed, so that they can be moved away or deleted. */
+const uint64_t IDLE_TIMEOUT = 60 * 1000;
+/** How often open files are synced to disk. */
+const uint64_t FLUSH_INTERVAL = 60 * 1000;
+
+} // namespace
+
+LogManager::Writer::Writer() : lines(64), queuedBytes(0), dropped(0), stop(false), lastFlush(0) {
+	signalled.clear();
+	start();
+}
+
+LogManager::Writer::~Writer() {
+	stop = true;
+	s.signal();
+	join();
+
+	// anything logged after the thread was done
+	Line* line;
+	while(lines.pop(line)) {
+		delete line;
+	}
+}
+
+void LogManager::Writer::write(const string& path, string&& line) noexcept {
+	if(queuedBytes + line.size() > MAX_QUEUED_BYTES) {
+		++dropped;
+		return;
+	}
+
+	queuedBytes += line.size();
+	lines.push(new Line(path, move(line)));
+
+	if(!signalled.test_and_set()) {
+		s.signal();
+	}
+}
+
+int LogManager::Writer::run() {
+	while(true) {
+		s.wait(1000);
+		signalled.clear();
+
+		auto tick = GET_TICK();
+		writeQueued(tick);
+
+		if(stop) {
+			writeQueued(tick);
+			flushFiles(tick, true);
+			break;
+		}
+
+		if(tick > lastFlush + FLUSH_INTERVAL) {
+			flushFiles(tick, false);
+			lastFlush = tick;
+		}
+
+		auto n = dropped.exchange(0);
+		if(n > 0) {
+			LogManager::getInstance()->message(str(F_("%1% log lines could not be written in time and have been dropped") % n));
+		}
+	}
+	return 0;
+}
+
+/** Write out everything that has been queued, one write per file. */
+bool LogManager::Writer::writeQueued(uint64_t tick) noexcept {
+	vector<string> order;
+	unordered_map<string, string> batches;
+
+	Line* p;
+	while(lines.pop(p)) {
+		unique_ptr<Line> line(p);
+		queuedBytes -= line->line.size();
+
+		auto& batch = batches[line->path];
+		if(batch.empty()) {
+			order.push_back(line->path);
+		}
+		batch += line->line;
+	}
+
+	for(auto& path: order) {
+		try {
+			getFile(path, tick)->write(batches[path]);
+		} catch(const FileException&) {
+			files.erase(path);
+		}
+	}
+
+	return !order.empty();
+}
+
+File* LogManager::Writer::getFile(const string& path, uint64_t tick) {
+	auto i = files.find(path);
+	if(i == files.end()) {
+		if(files.size() >= MAX_OPEN_FILES) {
+			auto oldest = std::min_element(files.begin(), files.end(), [](const pair<const string, OpenFile>& a,
+				const pair<const string, OpenFile>& b) { return a.second.lastWrite < b.second.lastWrite; });
+			files.erase(oldest);
+		}
+
+		string aArea = Util::validateFileName(path);
 		File::ensureDirectory(aArea);
-		File f(aArea, File::WRITE, File::OPEN | File::CREATE);
-		f.setEndPos(0);
-		f.write(msg + "\r\n");
-	} catch (const FileException&) {
-		// ...
+		unique_ptr<File> f(new File(aArea, File::WRITE, File::OPEN | File::CREATE | File::SHARED));
+		f->setEndPos(0);
+
+		i = files.emplace(path, OpenFile { move(f), tick }).first;
+	}
+
+	i->second.lastWrite = tick;
+	return i->second.f.get();
+}
+
+void LogManager::Writer::flushFiles(uint64_t tick, bool closeAll) noexcept {
+	for(auto i = files.begin(); i != files.end();) {
+		try {
+			i->second.f->flush();
+		} catch(const FileException&) { }
+
+		if(closeAll || i->second.lastWrite + IDLE_TIMEOUT < tick) {
+			i = files.erase(i);
+		} else {
+			++i;
+		}
 	}
 }
 
@@ -18,20 +18,30 @@
 #ifndef DCPLUSPLUS_DCPP_LOG_MANAGER_H
 #define DCPLUSPLUS_DCPP_LOG_MANAGER_H
 
+#include <atomic>
 #include <deque>
+#include <memory>
+#include <unordered_map>
 #include <utility>
 
+#include <boost/lockfree/queue.hpp>
+
 #include "typedefs.h"
 
 #include "CriticalSection.h"
+#include "forward.h"
+#include "SemaphoreDCpp.h"
 #include "Singleton.h"
 #include "Speaker.h"
+#include "Thread.h"
 #include "LogManagerListener.h"
 
 namespace dcpp {
 
 using std::deque;
 using std::pair;
+using std::unique_ptr;
+using std::unordered_map;
 
 class LogManager : public Singleton<LogManager>, public Speaker<LogManagerListener>
 {
@@ -55,12 +65,55 @@ public:
 private:
 	void log(const string& area, const string& msg) noexcept;
 
+	/** Appends log lines to their files on a thread of its own, so that the threads doing the
+	logging never wait on the disk. Lines bound for the same file are written together, and files
+	stay open for as long as they are being written to. */
+	class Writer : public Thread {
+	public:
+		Writer();
+		virtual ~Writer();
+
+		void write(const string& path, string&& line) noexcept;
+
+	private:
+		virtual int run();
+
+		struct Line {
+			Line(const string& path, string&& line) : path(path), line(move(line)) { }
+			string path;
+			string line;
+		};
+
+		struct OpenFile {
+			unique_ptr<File> f;
+			uint64_t lastWrite;
+		};
+
+		bool writeQueued(uint64_t tick) noexcept;
+		File* getFile(const string& path, uint64_t tick);
+		void flushFiles(uint64_t tick, bool closeAll) noexcept;
+
+		boost::lockfree::queue<Line*> lines;
+		std::atomic<size_t> queuedBytes;
+		std::atomic<size_t> dropped;
+		std::atomic_flag signalled;
+		Semaphore s;
+		std::atomic<bool> stop;
+
+		/** Only touched by the writer thread. */
+		unordered_map<string, OpenFile> files;
+		uint64_t lastFlush;
+	};
+
 	friend class Singleton<LogManager>;
 	CriticalSection cs;
 	List lastLogs;
 
 	int options[LAST][2];
 
+	// last, so that its thread is gone before anything it may use is destroyed.
+	Writer writer;
+
 	LogManager();
 	virtual ~LogManager();
 };
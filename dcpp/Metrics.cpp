@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "stdinc.h"
+#include "Metrics.h"
+
+#include <bit>
+#include <cmath>
+#include <map>
+
+#include "Util.h"
+
+namespace dcpp {
+
+using std::map;
+using std::pair;
+using std::unique_ptr;
+
+Histogram::Histogram() : count(0), sum(0), max(0) {
+	for(auto& b: buckets) {
+		b.store(0, std::memory_order_relaxed);
+	}
+}
+
+size_t Histogram::getBucket(uint64_t value) noexcept {
+	if(value < SUB_BUCKETS) {
+		return static_cast<size_t>(value);
+	}
+	auto shift = std::bit_width(value) - 1 - SUB_BITS;
+	return (shift + 1) * SUB_BUCKETS + static_cast<size_t>((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t Histogram::getLowest(size_t bucket) noexcept {
+	if(bucket < SUB_BUCKETS) {
+		return bucket;
+	}
+	return static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << (bucket / SUB_BUCKETS - 1);
+}
+
+void Histogram::record(uint64_t value) noexcept {
+	buckets[getBucket(value)].fetch_add(1, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+	sum.fetch_add(value, std::memory_order_relaxed);
+
+	auto cur = max.load(std::memory_order_relaxed);
+	while(value > cur && !max.compare_exchange_weak(cur, value, std::memory_order_relaxed)) { }
+}
+
+uint64_t Histogram::getPercentile(double p) const noexcept {
+	auto total = getCount();
+	if(total == 0) {
+		return 0;
+	}
+
+	auto wanted = std::max(static_cast<uint64_t>(std::ceil(p * total)), static_cast<uint64_t>(1));
+	uint64_t seen = 0;
+	for(size_t i = 0; i < BUCKETS; ++i) {
+		seen += buckets[i].load(std::memory_order_relaxed);
+		if(seen >= wanted) {
+			return i + 1 < BUCKETS ? std::min(getLowest(i + 1) - 1, getMax()) : getMax();
+		}
+	}
+
+	// records made while counting
+	return getMax();
+}
+
+namespace {
+
+struct Registry {
+	map<string, unique_ptr<Counter>> counters;
+	map<string, unique_ptr<Gauge>> gauges;
+	map<string, unique_ptr<Histogram>> histograms;
+	map<string, pair<const void*, Metrics::ValueF>> values;
+
+	CriticalSection cs;
+};
+
+Registry& getRegistry() {
+	static Registry registry;
+	return registry;
+}
+
+template<typename T>
+T& get(map<string, unique_ptr<T>>& metrics, const string& name) {
+	auto& ret = metrics[name];
+	if(!ret) {
+		ret.reset(new T);
+	}
+	return *ret;
+}
+
+} // unnamed namespace
+
+Counter& Metrics::counter(const string& name) {
+	auto& r = getRegistry();
+	Lock l(r.cs);
+	return get(r.counters, name);
+}
+
+Gauge& Metrics::gauge(const string& name) {
+	auto& r = getRegistry();
+	Lock l(r.cs);
+	return get(r.gauges, name);
+}
+
+Histogram& Metrics::histogram(const string& name) {
+	auto& r = getRegistry();
+	Lock l(r.cs);
+	return get(r.histograms, name);
+}
+
+void Metrics::addValue(const string& name, const void* owner, ValueF f) {
+	auto& r = getRegistry();
+	Lock l(r.cs);
+	r.values[name] = make_pair(owner, std::move(f));
+}
+
+void Metrics::removeValue(const string& name, const void* owner) {
+	auto& r = getRegistry();
+	Lock l(r.cs);
+	auto i = r.values.find(name);
+	if(i != r.values.end() && i->second.first == owner) {
+		r.values.erase(i);
+	}
+}
+
+int64_t Metrics::getValue(const string& name) {
+	auto& r = getRegistry();
+	Lock l(r.cs);
+
+	auto c = r.counters.find(name);
+	if(c != r.counters.end()) {
+		return c->second->get();
+	}
+	auto g = r.gauges.find(name);
+	if(g != r.gauges.end()) {
+		return g->second->get();
+	}
+	auto h = r.histograms.find(name);
+	if(h != r.histograms.end()) {
+		return static_cast<int64_t>(h->second->getCount());
+	}
+	auto v = r.values.find(name);
+	if(v != r.values.end()) {
+		return v->second.second();
+	}
+	return 0;
+}
+
+string Metrics::dump() {
+	auto& r = getRegistry();
+	Lock l(r.cs);
+
+	map<string, string> lines;
+	for(auto& i: r.counters) {
+		lines[i.first] = "counter " + i.first + " " + Util::toString(i.second->get());
+	}
+	for(auto& i: r.gauges) {
+		lines[i.first] = "gauge " + i.first + " " + Util::toString(i.second->get());
+	}
+	for(auto& i: r.values) {
+		lines[i.first] = "gauge " + i.first + " " + Util::toString(i.second.second());
+	}
+	for(auto& i: r.histograms) {
+		auto& h = *i.second;
+		lines[i.first] = "histogram " + i.first +
+			" count=" + Util::toString(static_cast<int64_t>(h.getCount())) +
+			" sum=" + Util::toString(static_cast<int64_t>(h.getSum())) +
+			" p50=" + Util::toString(static_cast<int64_t>(h.getPercentile(0.5))) +
+			" p90=" + Util::toString(static_cast<int64_t>(h.getPercentile(0.9))) +
+			" p99=" + Util::toString(static_cast<int64_t>(h.getPercentile(0.99))) +
+			" max=" + Util::toString(static_cast<int64_t>(h.getMax()));
+	}
+
+	string ret;
+	for(auto& i: lines) {
+		ret += i.second;
+		ret += '\n';
+	}
+	return ret;
+}
+
+} // namespace dcpp
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DCPLUSPLUS_DCPP_METRICS_H
+#define DCPLUSPLUS_DCPP_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "CriticalSection.h"
+#include "typedefs.h"
+
+namespace dcpp {
+
+using std::function;
+
+/** A count that only goes up. */
+class Counter : boost::noncopyable
+{
+public:
+	Counter() : value(0) { }
+
+	void add(int64_t n = 1) noexcept { value.fetch_add(n, std::memory_order_relaxed); }
+	int64_t get() const noexcept { return value.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<int64_t> value;
+};
+
+/** A value that goes up and down. */
+class Gauge : boost::noncopyable
+{
+public:
+	Gauge() : value(0) { }
+
+	void set(int64_t n) noexcept { value.store(n, std::memory_order_relaxed); }
+	void add(int64_t n) noexcept { value.fetch_add(n, std::memory_order_relaxed); }
+	int64_t get() const noexcept { return value.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<int64_t> value;
+};
+
+/** The distribution of a value, such as a duration in microseconds. As in HDR histograms, the
+buckets double in width from one power of two to the next and each power of two is split in
+SUB_BUCKETS, so that percentiles are off by no more than 1/SUB_BUCKETS of the value however
+large it is. Recording takes a few atomic additions and no lock. */
+class Histogram : boost::noncopyable
+{
+public:
+	static const int SUB_BITS = 3;
+	static const size_t SUB_BUCKETS = 1 << SUB_BITS;
+	static const size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+	Histogram();
+
+	void record(uint64_t value) noexcept;
+
+	uint64_t getCount() const noexcept { return count.load(std::memory_order_relaxed); }
+	uint64_t getSum() const noexcept { return sum.load(std::memory_order_relaxed); }
+	uint64_t getMax() const noexcept { return max.load(std::memory_order_relaxed); }
+	/** @param p Between 0 and 1
+	@return The highest value of the bucket holding the percentile */
+	uint64_t getPercentile(double p) const noexcept;
+
+	static size_t getBucket(uint64_t value) noexcept;
+	static uint64_t getLowest(size_t bucket) noexcept;
+
+private:
+	std::atomic<uint64_t> buckets[BUCKETS];
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> sum;
+	std::atomic<uint64_t> max;
+};
+
+/** Records how long it lives in a histogram, in microseconds. */
+class ScopedTimer : boost::noncopyable
+{
+public:
+	explicit ScopedTimer(Histogram& aHistogram) : histogram(aHistogram), start(std::chrono::steady_clock::now()) { }
+	~ScopedTimer() {
+		histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+
+private:
+	Histogram& histogram;
+	std::chrono::steady_clock::time_point start;
+};
+
+/** A Lock that records how long it is held, for the locks worth watching. */
+class TimedLock : boost::noncopyable
+{
+public:
+	TimedLock(CriticalSection& cs, Histogram& aHistogram) : l(cs), timer(aHistogram) { }
+
+private:
+	Lock l;
+	ScopedTimer timer;
+};
+
+/** Named counters, gauges and histograms of the core, for finding out where time goes in a
+running client. Metrics are created the first time they are asked for and then live as long as
+the program; keep the reference rather than looking the name up each time:
+
+	static auto& searches = Metrics::counter("share.searches");
+	searches.add();
+
+Values already kept elsewhere can be added as functions that read them; their owner removes
+them before going away. Names have no spaces. */
+class Metrics : boost::noncopyable
+{
+public:
+	typedef function<int64_t ()> ValueF;
+
+	static Counter& counter(const string& name);
+	static Gauge& gauge(const string& name);
+	static Histogram& histogram(const string& name);
+
+	/** @param owner Identifies who added the value; only they may remove it, so that a value
+	replaced under the same name doesn't get removed by its former owner. */
+	static void addValue(const string& name, const void* owner, ValueF f);
+	static void removeValue(const string& name, const void* owner);
+
+	/** @return The value of a counter, gauge or added value, or the count of a histogram; 0 when
+	there is no such metric. */
+	static int64_t getValue(const string& name);
+
+	/** All the metrics sorted by name, one per line: the type, the name and the values, such as
+		counter share.searches 120
+		histogram share.search_us count=120 sum=5230 p50=31 p90=63 p99=255 max=1022 */
+	static string dump();
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_METRICS_H)
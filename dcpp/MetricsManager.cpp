@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "stdinc.h"
+#include "MetricsManager.h"
+
+#include "File.h"
+#include "Metrics.h"
+#include "SettingsManager.h"
+#include "Socket.h"
+#include "Util.h"
+
+namespace dcpp {
+
+MetricsManager::MetricsManager() : lastDump(GET_TICK()) {
+	Metrics::addValue("socket.bytes_down", this, [] { return static_cast<int64_t>(Socket::getTotalDown()); });
+	Metrics::addValue("socket.bytes_up", this, [] { return static_cast<int64_t>(Socket::getTotalUp()); });
+
+	TimerManager::getInstance()->addListener(this);
+}
+
+MetricsManager::~MetricsManager() {
+	TimerManager::getInstance()->removeListener(this);
+
+	Metrics::removeValue("socket.bytes_down", this);
+	Metrics::removeValue("socket.bytes_up", this);
+}
+
+string MetricsManager::getDumpPath() {
+	return Util::getPath(Util::PATH_USER_LOCAL) + "Metrics.txt";
+}
+
+void MetricsManager::dump() noexcept {
+	auto path = getDumpPath();
+	try {
+		{
+			File f(path + ".tmp", File::WRITE, File::CREATE | File::TRUNCATE);
+			f.write("# " + Util::formatTime("%Y-%m-%d %H:%M:%S", time(NULL)) + "\n");
+			f.write(Metrics::dump());
+		}
+		File::deleteFile(path);
+		File::renameFile(path + ".tmp", path);
+	} catch(const FileException&) {
+		// ...
+	}
+}
+
+void MetricsManager::on(TimerManagerListener::Minute, uint64_t aTick) noexcept {
+	auto interval = SETTING(METRICS_INTERVAL);
+	if(interval > 0 && aTick >= lastDump + static_cast<uint64_t>(interval) * 60 * 1000) {
+		lastDump = aTick;
+		dump();
+	}
+}
+
+} // namespace dcpp
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DCPLUSPLUS_DCPP_METRICS_MANAGER_H
+#define DCPLUSPLUS_DCPP_METRICS_MANAGER_H
+
+#include "Singleton.h"
+#include "TimerManager.h"
+
+namespace dcpp {
+
+/** Writes the metrics of the core to Metrics.txt in the user's local settings directory at the
+interval set (METRICS_INTERVAL, in minutes; 0 not to write them), and adds the values kept by
+parts of the core that don't register their own. */
+class MetricsManager : public Singleton<MetricsManager>, private TimerManagerListener
+{
+public:
+	static string getDumpPath();
+
+	/** Write the metrics now. */
+	void dump() noexcept;
+
+private:
+	friend class Singleton<MetricsManager>;
+
+	MetricsManager();
+	virtual ~MetricsManager();
+
+	uint64_t lastDump;
+
+	// TimerManagerListener
+	void on(TimerManagerListener::Minute, uint64_t aTick) noexcept;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_METRICS_MANAGER_H)
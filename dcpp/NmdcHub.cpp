@@ -24,6 +24,7 @@
 #include "ConnectivityManager.h"
 #include "CryptoManager.h"
 #include "format.h"
+#include "Resolver.h"
 #include "SearchManager.h"
 #include "ShareManager.h"
 #include "Socket.h"
@@ -567,10 +568,7 @@ void NmdcHub::onLine(const string& aLine) noexcept {
 		if (j == string::npos)
 			return;
 
-		string server = Socket::resolve(param.substr(i, j - i), AF_INET);
-
-		if (isProtectedIP(server))
-			return;
+		string server = param.substr(i, j - i);
 
 		if (j + 1 >= param.size())
 			return;
@@ -607,33 +605,9 @@ void NmdcHub::onLine(const string& aLine) noexcept {
 		if (port.empty())
 			return;
 
-		if (SETTING(ALLOW_NAT_TRAVERSAL)) {
-			auto localPort = std::to_string(sock->getLocalPort());
-
-			if (port[port.size() - 1] == 'N') {
-				if (senderNick.empty())
-					return;
-
-				port.erase(port.size() - 1);
-				// trigger connection attempt sequence locally
-				ConnectionManager::getInstance()->nmdcConnect(server, port, localPort, BufferedSocket::NAT_CLIENT, getMyNick(), getHubUrl(), getEncoding(), secure);
-				// signal other client to do likewise
-				send("$ConnectToMe " + fromUtf8(senderNick) + " " + localIp + ":" + localPort + (secure ? "RS" : "R") + "|");
-				return;
-
-			} else if (port[port.size() - 1] == 'R') {
-				port.erase(port.size() - 1);
-				// trigger connection attempt sequence locally
-				ConnectionManager::getInstance()->nmdcConnect(server, port, localPort, BufferedSocket::NAT_SERVER, getMyNick(), getHubUrl(), getEncoding(), secure);
-				return;
-			}
-		}
-
-		if (port.empty())
-			return;
-
-		// for simplicity, we make the assumption that users on a hub have the same character encoding
-		ConnectionManager::getInstance()->nmdcConnect(server, port, getMyNick(), getHubUrl(), getEncoding(), secure);
+		resolveAsync(server, AF_INET, [this, port, senderNick, secure](const string& ip) {
+			acceptConnectToMe(ip, port, senderNick, secure);
+		});
 
 	} else if(cmd == "$RevConnectToMe") {
 		if(state != STATE_NORMAL) {
@@ -1322,8 +1296,47 @@ void NmdcHub::clearFlooders(uint64_t aTick) {
 	}
 }
 
+void NmdcHub::acceptConnectToMe(const string& server, string port, const string& senderNick, bool secure) {
+	if (isProtectedIP(server))
+		return;
+
+	if (SETTING(ALLOW_NAT_TRAVERSAL)) {
+		auto localPort = std::to_string(sock->getLocalPort());
+
+		if (port[port.size() - 1] == 'N') {
+			if (senderNick.empty())
+				return;
+
+			port.erase(port.size() - 1);
+			// trigger connection attempt sequence locally
+			ConnectionManager::getInstance()->nmdcConnect(server, port, localPort, BufferedSocket::NAT_CLIENT, getMyNick(), getHubUrl(), getEncoding(), secure);
+			// signal other client to do likewise
+			send("$ConnectToMe " + fromUtf8(senderNick) + " " + localIp + ":" + localPort + (secure ? "RS" : "R") + "|");
+			return;
+
+		} else if (port[port.size() - 1] == 'R') {
+			port.erase(port.size() - 1);
+			// trigger connection attempt sequence locally
+			ConnectionManager::getInstance()->nmdcConnect(server, port, localPort, BufferedSocket::NAT_SERVER, getMyNick(), getHubUrl(), getEncoding(), secure);
+			return;
+		}
+	}
+
+	if (port.empty())
+		return;
+
+	// for simplicity, we make the assumption that users on a hub have the same character encoding
+	ConnectionManager::getInstance()->nmdcConnect(server, port, getMyNick(), getHubUrl(), getEncoding(), secure);
+}
+
 bool NmdcHub::isProtectedIP(const string& ip) {
-	if(find(protectedIPs.begin(), protectedIPs.end(), ip) != protectedIPs.end()) {
+	bool found;
+	{
+		Lock l(cs);
+		found = find(protectedIPs.begin(), protectedIPs.end(), ip) != protectedIPs.end();
+	}
+
+	if(found) {
 		fire(ClientListener::StatusMessage(), this, str(F_("This hub is trying to use your client to spam %1%, please urge hub owner to fix this") % ip));
 		return true;
 	}
@@ -1338,9 +1351,10 @@ void NmdcHub::refreshLocalIp() noexcept {
 		localIp.clear();
 	}
 	if(localIp.empty()) {
-		localIp = getUserIp4();
-		if(!localIp.empty()) {
-			localIp = Socket::resolve(localIp, AF_INET);
+		auto& userIp = getUserIp4();
+		if(!userIp.empty() && !Socket::resolveCached(userIp, AF_INET, localIp)) {
+			// this is refreshed every second; make do without it until the lookup is done.
+			Resolver::getInstance()->resolve(userIp, AF_INET, nullptr);
 		}
 		if(localIp.empty()) {
 			localIp = sock->getLocalIp();
@@ -1421,20 +1435,24 @@ void NmdcHub::on(Minute, uint64_t aTick) noexcept {
 	refreshLocalIp();
 
 	if (aTick > (lastProtectedIPsUpdate + 24 * 3600 * 1000)) {
-		protectedIPs = {
-			"dchublist.org",
-			"hublist.pwiam.com",
-			"dcbase.org",
-			"dchublist.biz"
-		};
-
-		for (auto i = protectedIPs.begin(); i != protectedIPs.end();) {
-			*i = Socket::resolve(*i, AF_INET);
-
-			if (Util::isPrivateIp(*i, false))
-				i = protectedIPs.erase(i);
-			else
-				i++;
+		static const StringList hosts { "dchublist.org", "hublist.pwiam.com", "dcbase.org", "dchublist.biz" };
+
+		// the addresses are collected apart and replace the current ones once they are all known,
+		// so that the hubs stay protected meanwhile. lookups may answer right here or later on the
+		// socket thread.
+		struct Lookup { StringList ips; size_t pending; };
+		auto lookup = std::make_shared<Lookup>();
+		lookup->pending = hosts.size();
+
+		for (auto& host: hosts) {
+			resolveAsync(host, AF_INET, [this, lookup](const string& ip) {
+				Lock l(cs);
+				if (!ip.empty() && !Util::isPrivateIp(ip, false))
+					lookup->ips.push_back(ip);
+
+				if (--lookup->pending == 0)
+					protectedIPs.swap(lookup->ips);
+			});
 		}
 
 		lastProtectedIPsUpdate = aTick;
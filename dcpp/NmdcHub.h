@@ -121,6 +121,7 @@ private:
 	void myInfo(bool alwaysSend);
 	void supports(const StringList& feat);
 	void clearFlooders(uint64_t tick);
+	void acceptConnectToMe(const string& server, string port, const string& senderNick, bool secure);
 	bool isProtectedIP(const string& ip);
 
 	void updateFromTag(Identity& id, const string& tag);
@@ -55,9 +55,19 @@ public:
 		NAT			= 0x20
 	};
 
-	Identity() : sid(0) { }
-	Identity(const UserPtr& ptr, uint32_t aSID) : user(ptr), sid(aSID) { }
-	Identity(const Identity& rhs) : Flags(), sid(0) { *this = rhs; } // Use operator= since we have to lock before reading...
+	/** Fields that user matching definitions look at. Each has a version that changes along with
+	its value, so users only get matched again when something relevant has changed. */
+	enum MatchField {
+		MATCH_NICK,
+		MATCH_IP,
+		MATCH_TYPE, /// client type, op & bot flags
+
+		MATCH_LAST
+	};
+
+	Identity() : sid(0), versions() { }
+	Identity(const UserPtr& ptr, uint32_t aSID) : user(ptr), sid(aSID), versions() { }
+	Identity(const Identity& rhs) : Flags(), sid(0), versions() { *this = rhs; } // Use operator= since we have to lock before reading...
 	Identity& operator=(const Identity& rhs) {
 		FastLock l(cs);
 		*static_cast<Flags*>(this) = rhs;
@@ -65,6 +75,7 @@ public:
 		sid = rhs.sid;
 		style = rhs.style;
 		info = rhs.info;
+		std::copy(rhs.versions, rhs.versions + MATCH_LAST, versions);
 		return *this;
 	}
 
@@ -110,6 +121,9 @@ public:
 
 	std::map<string, string> getInfo() const;
 	string get(const char* name) const;
+	/** A field without copying it, for the thread of the user's hub only: that thread is the one
+	that sets the fields, so the reference is good until it sets this one again. */
+	const string& getRef(const char* name) const;
 	void set(const char* name, const string& val);
 	bool isSet(const char* name) const;
 	string getSIDString() const { return string((const char*)&sid, 4); }
@@ -131,6 +145,8 @@ public:
 	Style getStyle() const;
 	void setStyle(Style&& style);
 
+	void getVersions(uint32_t (&ret)[MATCH_LAST]) const;
+
 private:
 	enum {
 		// This identity corresponds to this client's user.
@@ -149,9 +165,30 @@ private:
 
 	Style style;
 
+	uint32_t versions[MATCH_LAST];
+
 	static FastCriticalSection cs;
 };
 
+/** What user matching definitions found out the last time an online user was matched. */
+struct UserMatchCache {
+	UserMatchCache() : list(0), favorites(0), fields() { }
+
+	/** Record the versions the user is about to be matched with.
+	@return UserMatch::INPUT_* flags of what changed since the last time; all bits set when the
+	definitions themselves changed, in which case the results are reset to false. */
+	int update(uint32_t aList, size_t definitions, const Identity& identity, uint32_t aFavorites);
+
+	/// Version of the definitions; 0 when the user has never been matched
+	uint32_t list;
+	/// Version of the favorite users
+	uint32_t favorites;
+	/// Versions of the identity fields
+	uint32_t fields[Identity::MATCH_LAST];
+	/// Result of each definition
+	vector<bool> results;
+};
+
 class OnlineUser : public FastAlloc<OnlineUser>, private boost::noncopyable, public PluginEntity<UserData> {
 public:
 	typedef vector<OnlineUser*> List;
@@ -170,9 +207,12 @@ public:
 
 	UserData* getPluginObject() noexcept;
 
+	UserMatchCache& getMatchCache() { return matchCache; }
+
 	GETSET(Identity, identity, Identity);
 private:
 	Client& client;
+	UserMatchCache matchCache;
 };
 
 }
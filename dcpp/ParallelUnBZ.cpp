@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "stdinc.h"
+#include "ParallelUnBZ.h"
+
+#include "BZUtils.h"
+
+namespace dcpp {
+
+using std::max;
+using std::min;
+
+namespace {
+
+const uint64_t BLOCK_MAGIC = 0x314159265359ULL;
+const uint64_t END_MAGIC = 0x177245385090ULL;
+const uint64_t MAGIC_MASK = 0xffffffffffffULL;
+
+/// "BZh" and the block size level come before the first block
+const uint64_t HEADER_BITS = 32;
+
+/// Decompressed data is collected by this much at a time
+const size_t CHUNK_SIZE = 256 * 1024;
+
+/** Read count (up to 32) bits from bit pos on, the most significant bit of a byte first. */
+uint32_t getBits(const string& data, uint64_t pos, int count) {
+	auto byte = pos / 8;
+	const auto skip = static_cast<int>(pos % 8);
+
+	uint64_t bits = 0;
+	int have = 0;
+	for(; have < skip + count; have += 8, ++byte) {
+		bits = (bits << 8) | (byte < data.size() ? static_cast<uint8_t>(data[byte]) : 0);
+	}
+	return static_cast<uint32_t>((bits >> (have - skip - count)) & ((1ULL << count) - 1));
+}
+
+/** Append bits to a string, the most significant bit of a byte first. */
+class BitWriter {
+public:
+	explicit BitWriter(string& out) : out(out), bits(0), count(0) { }
+
+	void put(uint32_t value, int n) {
+		bits = (bits << n) | (value & ((1ULL << n) - 1));
+		count += n;
+		while(count >= 8) {
+			count -= 8;
+			out += static_cast<char>(bits >> count);
+		}
+		bits &= (1ULL << count) - 1;
+	}
+
+	void copy(const string& data, uint64_t begin, uint64_t end) {
+		for(; begin + 32 <= end; begin += 32) {
+			put(getBits(data, begin, 32), 32);
+		}
+		if(begin < end) {
+			put(getBits(data, begin, static_cast<int>(end - begin)), static_cast<int>(end - begin));
+		}
+	}
+
+	void flush() {
+		if(count > 0) {
+			put(0, 8 - count);
+		}
+	}
+
+private:
+	string& out;
+	uint64_t bits;
+	int count;
+};
+
+} // unnamed namespace
+
+ParallelUnBZ::ParallelUnBZ(string&& aData, size_t threads) :
+	data(move(aData)),
+	window(0),
+	next(0),
+	current(0),
+	stop(false),
+	blockPos(0),
+	pos(0)
+{
+	if(!findBlocks()) {
+		// the blocks couldn't be told apart; decompress the stream as a whole
+		blocks.clear();
+		Block whole = { 0, 0, string(), string(), false };
+		blocks.push_back(whole);
+	}
+
+	threads = max<size_t>(1, min(threads, blocks.size()));
+	window = threads * 2;
+
+	try {
+		for(size_t i = 0; i < threads; ++i) {
+			workers.emplace_back(new Worker(*this));
+		}
+	} catch(const ThreadException&) {
+		{
+			Lock l(cs);
+			stop = true;
+		}
+		changed.notify_all();
+		throw;
+	}
+}
+
+ParallelUnBZ::~ParallelUnBZ() {
+	{
+		Lock l(cs);
+		stop = true;
+	}
+	changed.notify_all();
+	workers.clear();
+}
+
+/** Find where each block starts. Each block begins with a 48-bit magic number, which isn't byte
+aligned; a stream ends with another one, followed by a CRC of the CRCs of all blocks. That CRC
+is checked to make sure no block boundary is missing and none has been found where the magic
+number just happened to turn up in compressed data. */
+bool ParallelUnBZ::findBlocks() {
+	if(data.size() < 4 || data.compare(0, 3, "BZh") != 0 || data[3] < '1' || data[3] > '9') {
+		return false;
+	}
+
+	uint64_t bits = 0;
+	uint32_t combinedCRC = 0;
+
+	for(size_t i = 0; i < data.size(); ++i) {
+		bits = (bits << 8) | static_cast<uint8_t>(data[i]);
+		if(i < 7) {
+			continue;
+		}
+
+		// check each of the 8 magic numbers that may end in this byte
+		for(int shift = 7; shift >= 0; --shift) {
+			auto candidate = (bits >> shift) & MAGIC_MASK;
+			if(candidate != BLOCK_MAGIC && candidate != END_MAGIC) {
+				continue;
+			}
+
+			auto start = (i + 1) * 8 - shift - 48;
+			if(blocks.empty() ? start != HEADER_BITS : start <= blocks.back().begin) {
+				return false;
+			}
+			if(!blocks.empty()) {
+				blocks.back().end = start;
+			}
+
+			if(candidate == END_MAGIC) {
+				return start + 48 + 32 <= data.size() * 8 && getBits(data, start + 48, 32) == combinedCRC;
+			}
+
+			Block block = { start, 0, string(), string(), false };
+			blocks.push_back(block);
+			combinedCRC = ((combinedCRC << 1) | (combinedCRC >> 31)) ^ getBits(data, start + 48, 32);
+		}
+	}
+
+	// no end of stream
+	return false;
+}
+
+void ParallelUnBZ::work() {
+	while(true) {
+		Block* block;
+		{
+			Lock l(cs);
+			changed.wait(l, [this] { return stop || next == blocks.size() || next < current + window; });
+			if(stop || next == blocks.size()) {
+				return;
+			}
+			block = &blocks[next++];
+		}
+
+		string out, error;
+		try {
+			out = decompress(*block);
+		} catch(const Exception& e) {
+			error = e.getError();
+		}
+
+		{
+			Lock l(cs);
+			block->data = move(out);
+			block->error = move(error);
+			block->done = true;
+		}
+		changed.notify_all();
+	}
+}
+
+string ParallelUnBZ::decompress(const Block& block) const {
+	// make a stream of its own out of the block: the header, the block, and the end of stream
+	// with the CRC of the block as that of the whole stream
+	string stream;
+	if(block.end != 0) {
+		stream.reserve(4 + (block.end - block.begin) / 8 + 12);
+		stream.append(data, 0, 4);
+
+		BitWriter writer(stream);
+		writer.copy(data, block.begin, block.end);
+		writer.put(static_cast<uint32_t>(END_MAGIC >> 24), 24);
+		writer.put(static_cast<uint32_t>(END_MAGIC), 24);
+		writer.put(getBits(data, block.begin + 48, 32), 32);
+		writer.flush();
+	}
+
+	const string& in = block.end != 0 ? stream : data;
+
+	UnBZFilter filter;
+	string out;
+	size_t inPos = 0;
+	for(bool more = true; more; ) {
+		auto outPos = out.size();
+		out.resize(outPos + CHUNK_SIZE);
+
+		size_t inSize = in.size() - inPos, outSize = CHUNK_SIZE;
+		more = filter(in.data() + inPos, inSize, &out[outPos], outSize);
+
+		inPos += inSize;
+		out.resize(outPos + outSize);
+	}
+
+	return out;
+}
+
+size_t ParallelUnBZ::read(void* buf, size_t& len) {
+	size_t n = 0;
+	while(n < len && current < blocks.size()) {
+		auto& block = blocks[current];
+		{
+			Lock l(cs);
+			changed.wait(l, [&block] { return block.done; });
+		}
+
+		if(!block.error.empty()) {
+			throw Exception(block.error);
+		}
+
+		auto chunk = min(len - n, block.data.size() - blockPos);
+		memcpy(static_cast<char*>(buf) + n, block.data.data() + blockPos, chunk);
+		n += chunk;
+		blockPos += chunk;
+
+		if(blockPos == block.data.size()) {
+			string().swap(block.data);
+			blockPos = 0;
+			pos = block.end != 0 && current + 1 < blocks.size() ? static_cast<int64_t>(block.end / 8) : static_cast<int64_t>(data.size());
+
+			{
+				Lock l(cs);
+				++current;
+			}
+			changed.notify_all();
+		}
+	}
+
+	len = n;
+	return n;
+}
+
+} // namespace dcpp
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DCPLUSPLUS_DCPP_PARALLEL_UNBZ_H
+#define DCPLUSPLUS_DCPP_PARALLEL_UNBZ_H
+
+#include <atomic>
+#include <memory>
+
+#include <boost/thread/condition_variable.hpp>
+
+#include "CriticalSection.h"
+#include "Streams.h"
+#include "Thread.h"
+
+namespace dcpp {
+
+using std::unique_ptr;
+
+/** Reads a bzip2 file held in memory while it is decompressed on other threads. The blocks of a
+bzip2 stream don't depend on each other, so once they have been found, each is decompressed on its
+own; they are handed out in order, and only a few are kept decompressed ahead of the reader.
+Like UnBZFilter, only the first stream of a file is read. */
+class ParallelUnBZ : public InputStream {
+public:
+	/** @param data The whole compressed file.
+	@param threads Number of threads to decompress on. */
+	ParallelUnBZ(string&& data, size_t threads);
+	virtual ~ParallelUnBZ();
+
+	size_t read(void* buf, size_t& len);
+
+	/** Size of the compressed data behind what has been read so far; may be called from any
+	thread. */
+	int64_t getPos() const { return pos; }
+
+private:
+	struct Block {
+		/// Bits of the block in the compressed data, [begin, end)
+		uint64_t begin;
+		uint64_t end;
+		string data;
+		string error;
+		bool done;
+	};
+
+	class Worker : public Thread {
+	public:
+		explicit Worker(ParallelUnBZ& parent) : parent(parent) { start(); }
+		virtual ~Worker() { join(); }
+
+	private:
+		int run() { parent.work(); return 0; }
+
+		ParallelUnBZ& parent;
+	};
+
+	bool findBlocks();
+	void work();
+	string decompress(const Block& block) const;
+
+	const string data;
+	vector<Block> blocks;
+	/// How many blocks may be decompressed ahead of the one being read
+	size_t window;
+
+	CriticalSection cs;
+	boost::condition_variable_any changed;
+	/// Next block to decompress
+	size_t next;
+	/// Block being read
+	size_t current;
+	bool stop;
+
+	/// Position in the block being read
+	size_t blockPos;
+	std::atomic<int64_t> pos;
+
+	vector<unique_ptr<Worker>> workers;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_PARALLEL_UNBZ_H)
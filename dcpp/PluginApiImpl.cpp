@@ -33,6 +33,7 @@
 #include "FavoriteManager.h"
 #include "File.h"
 #include "LogManager.h"
+#include "Metrics.h"
 #include "PluginManager.h"
 #include "QueueManager.h"
 #include "Tagger.h"
@@ -192,6 +193,13 @@ DCDataAccess PluginApiImpl::dcDataAccess = {
 	&PluginApiImpl::releaseData
 };
 
+DCMetrics PluginApiImpl::dcMetrics = {
+	DCINTF_DCPP_METRICS_VER,
+
+	&PluginApiImpl::getMetricValue,
+	&PluginApiImpl::dumpMetrics
+};
+
 Socket* PluginApiImpl::udpSocket = nullptr;
 Socket& PluginApiImpl::getUdpSocket() {
 	if(!udpSocket) {
@@ -225,6 +233,7 @@ void PluginApiImpl::init() {
 	dcCore.register_interface(DCINTF_DCPP_UTILS, &dcUtils);
 	dcCore.register_interface(DCINTF_DCPP_TAGGER, &dcTagger);
 	dcCore.register_interface(DCINTF_DCPP_DATAACCESSOR, &dcDataAccess);
+	dcCore.register_interface(DCINTF_DCPP_METRICS, &dcMetrics);
 
 	// Create provided hooks (since these outlast any plugin they don't need to be explictly released)
 	for(int i = 0; i < IMPL_HOOKS_COUNT; ++i)
@@ -909,4 +918,17 @@ void PluginApiImpl::releaseData(DataArrayPtr val)
 	free(val);
 }
 
+/* Functions for DCMetrics */
+int64_t PluginApiImpl::getMetricValue(const char* name) {
+	return Metrics::getValue(name);
+}
+
+size_t PluginApiImpl::dumpMetrics(char* dst, size_t n) {
+	string str(Metrics::dump());
+	if(n > str.size()) {
+		memcpy(dst, str.c_str(), str.size() + 1);
+	}
+	return str.size() + 1;
+}
+
 } // namespace dcpp
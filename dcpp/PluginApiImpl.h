@@ -126,6 +126,10 @@ private:
 
 	static void DCAPI getHTTPResource(const char* uri, const char* localPath);
 
+	// Functions for DCMetrics
+	static int64_t DCAPI getMetricValue(const char* name);
+	static size_t DCAPI dumpMetrics(char* dst, size_t n);
+
 	static DCHooks dcHooks;
 	static DCConfig dcConfig;
 	static DCLog dcLog;
@@ -136,6 +140,7 @@ private:
 	static DCUtils dcUtils;
 	static DCTagger dcTagger;
 	static DCDataAccess dcDataAccess;
+	static DCMetrics dcMetrics;
 
 	static Socket* udpSocket;
 	static Socket& getUdpSocket();
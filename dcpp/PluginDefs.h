@@ -84,6 +84,9 @@ extern "C" {
 #define DCINTF_DCPP_DATAACCESSOR				"dcpp.dataaccessor.DCDataAccess"				/* Data access */
 #define DCINTF_DCPP_DATAACCESSOR_VER			1
 
+#define DCINTF_DCPP_METRICS			"dcpp.utils.DCMetrics"		/* Runtime metrics */
+#define DCINTF_DCPP_METRICS_VER		1
+
 /* Hook GUID's for Hooks (events) system */
 #define HOOK_CHAT_IN				"dcpp.chat.onIncomingChat"		/* Incoming chat from hub (obj: HubData) */
 #define HOOK_CHAT_OUT				"dcpp.chat.onOutgoingChat"		/* Outgoing chat (obj: HubData) */
@@ -483,6 +486,18 @@ typedef struct DCDataAccess {
 	void			(DCAPI *release)				(DataArrayPtr hCopy);
 } DCDataAcess, *DCDataAccessPtr;
 
+/* Runtime metrics */
+typedef struct tagDCMetrics {
+	/* Metrics API version */
+	uint32_t apiVersion;
+
+	/* The value of a counter or gauge, or the count of a histogram; 0 when there is no such metric. */
+	int64_t		(DCAPI *get_value)					(const char* name);
+	/* All the metrics, one per line, as "type name value(s)"; returns the required buffer size,
+	including the terminating null. */
+	size_t		(DCAPI *dump)						(char* dst, size_t n);
+} DCMetrics, *DCMetricsPtr;
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,6 +21,7 @@
 #include "HashManager.h"
 #include "Download.h"
 #include "File.h"
+#include "SharedFile.h"
 #include "Util.h"
 
 namespace dcpp {
@@ -101,12 +102,31 @@ QueueData* QueueItem::getPluginObject() noexcept {
 	return &pod;
 }
 
-Segment QueueItem::getNextSegment(int64_t blockSize, int64_t wantedSize) const {
+namespace {
+
+/** Whether a partial source has all of a block. */
+bool hasBlock(const QueueItem::PartsInfo& parts, int64_t blockSize, int64_t start, int64_t end) {
+	for(size_t i = 0; i + 1 < parts.size(); i += 2) {
+		if(parts[i] * blockSize <= start && parts[i + 1] * blockSize >= end) {
+			return true;
+		}
+	}
+	return false;
+}
+
+}
+
+Segment QueueItem::getNextSegment(int64_t blockSize, int64_t wantedSize, const PartsInfo* parts) const {
 	if(getSize() == -1 || blockSize == 0) {
 		return Segment(0, -1);
 	}
 
 	if(!SETTING(SEGMENTED_DL)) {
+		// partial sources are only of use when downloading a file in segments
+		if(parts) {
+			return Segment(0, 0);
+		}
+
 		if(!downloads.empty()) {
 			return Segment(0, 0);
 		}
@@ -168,6 +188,11 @@ Segment QueueItem::getNextSegment(int64_t blockSize, int64_t wantedSize) const {
 			overlaps = block.overlaps((*i)->getSegment());
 		}
 
+		if(!overlaps && parts) {
+			// the last block of the file may be short, hence the end rounded up
+			overlaps = !hasBlock(*parts, blockSize, start, Util::roundUp(end, blockSize));
+		}
+
 		if(!overlaps) {
 			return block;
 		}
@@ -183,6 +208,49 @@ Segment QueueItem::getNextSegment(int64_t blockSize, int64_t wantedSize) const {
 	return Segment(0, 0);
 }
 
+QueueItem::PartsInfo QueueItem::getPartsInfo(int64_t blockSize) const {
+	// so that the parts fit in a UDP packet
+	const size_t MAX_PARTS = 255;
+
+	PartsInfo ret;
+	for(auto& i: done) {
+		if(ret.size() == MAX_PARTS * 2) {
+			break;
+		}
+		// only whole blocks, save for the last one of the file which may be short
+		auto start = Util::roundUp(i.getStart(), blockSize) / blockSize;
+		auto end = (i.getEnd() == getSize() ? Util::roundUp(i.getEnd(), blockSize) : i.getEnd()) / blockSize;
+		if(start < end) {
+			ret.push_back(static_cast<uint16_t>(start));
+			ret.push_back(static_cast<uint16_t>(end));
+		}
+	}
+	return ret;
+}
+
+bool QueueItem::isDone(int64_t start, int64_t bytes) const {
+	if(bytes == 0) {
+		return true;
+	}
+
+	// done segments are consolidated, so a range that is done lies within one of them
+	auto i = done.upper_bound(Segment(start, getSize() - start));
+	if(i == done.begin()) {
+		return false;
+	}
+	--i;
+	return i->getStart() <= start && i->getEnd() >= start + bytes;
+}
+
+std::shared_ptr<SharedFile> QueueItem::getSharedFile() {
+	auto ret = sharedFile.lock();
+	if(!ret) {
+		ret = std::make_shared<SharedFile>();
+		sharedFile = ret;
+	}
+	return ret;
+}
+
 int64_t QueueItem::getDownloadedBytes() const {
 	int64_t total = 0;
 	for(auto& i: done) {
@@ -19,6 +19,7 @@
 #define DCPLUSPLUS_DCPP_QUEUE_ITEM_H
 
 #include <list>
+#include <memory>
 #include <set>
 
 #include "User.h"
@@ -79,6 +80,10 @@ public:
 		FLAG_PARTIAL_LIST = 0x200
 	};
 
+	/** Parts of a file, as pairs of block numbers: the first block of the part and the block right
+	after it (partial file sharing). */
+	typedef vector<uint16_t> PartsInfo;
+
 	class Source : public Flags {
 	public:
 		enum {
@@ -94,6 +99,8 @@ public:
 			FLAG_SLOW_SOURCE = 0x100,
 			FLAG_UNTRUSTED = 0x200,
 			FLAG_UNENCRYPTED = 0x400,
+			/** Only has the parts of the file in getParts() */
+			FLAG_PARTIAL = 0x800,
 			FLAG_MASK = FLAG_FILE_NOT_AVAILABLE
 				| FLAG_PASSIVE | FLAG_REMOVED | FLAG_CRC_FAILED | FLAG_CRC_WARN
 				| FLAG_BAD_TREE | FLAG_NO_TREE | FLAG_SLOW_SOURCE | FLAG_UNTRUSTED
@@ -101,11 +108,15 @@ public:
 		};
 
 		Source(const HintedUser& aUser) : user(aUser) { }
-		Source(const Source& aSource) : Flags(aSource), user(aSource.user) { }
+		Source(const Source& aSource) : Flags(aSource), user(aSource.user), parts(aSource.parts) { }
 
 		bool operator==(const UserPtr& aUser) const { return user == aUser; }
 
+		/** @return The parts the source has, or nullptr when it has the whole file */
+		const PartsInfo* getPartsInfo() const { return isSet(FLAG_PARTIAL) ? &parts : nullptr; }
+
 		GETSET(HintedUser, user, User);
+		GETSET(PartsInfo, parts, Parts);
 	};
 
 	typedef std::vector<Source> SourceList;
@@ -125,7 +136,7 @@ public:
 	QueueItem(const QueueItem& rhs) :
 		Flags(rhs), done(rhs.done), downloads(rhs.downloads), target(rhs.target),
 		size(rhs.size), priority(rhs.priority), added(rhs.added), tthRoot(rhs.tthRoot),
-		sources(rhs.sources), badSources(rhs.badSources), tempTarget(rhs.tempTarget)
+		sources(rhs.sources), badSources(rhs.badSources), tempTarget(rhs.tempTarget), sharedFile(rhs.sharedFile)
 	{ }
 
 	virtual ~QueueItem() { }
@@ -160,8 +171,19 @@ public:
 
 	DownloadList& getDownloads() { return downloads; }
 
-	/** Next segment that is not done and not being downloaded, zero-sized segment returned if there is none is found */
-	Segment getNextSegment(int64_t blockSize, int64_t wantedSize) const;
+	/** The file the segments being downloaded write to, opened once for all of them. Each
+	download holds on to it, so it is closed when the last one is done. */
+	std::shared_ptr<SharedFile> getSharedFile();
+
+	/** Next segment that is not done and not being downloaded, zero-sized segment returned if there is none is found
+	@param parts When downloading from a partial source, what it has */
+	Segment getNextSegment(int64_t blockSize, int64_t wantedSize, const PartsInfo* parts = nullptr) const;
+
+	/** The parts that are done, in blocks of blockSize. Done segments end on block boundaries
+	but for the last one, which ends with the file. */
+	PartsInfo getPartsInfo(int64_t blockSize) const;
+	/** Whether all of [start, start + bytes) is done. */
+	bool isDone(int64_t start, int64_t bytes) const;
 
 	void addSegment(const Segment& segment);
 	void resetDownloaded() { done.clear(); }
@@ -198,6 +220,7 @@ private:
 	SourceList sources;
 	SourceList badSources;
 	string tempTarget;
+	std::weak_ptr<SharedFile> sharedFile;
 
 	void addSource(const HintedUser& aUser);
 	void removeSource(const UserPtr& aUser, int reason);
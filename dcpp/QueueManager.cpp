@@ -20,25 +20,29 @@
 
 #include <boost/range/adaptor/map.hpp>
 #include <boost/range/algorithm/for_each.hpp>
-#include <boost/range/algorithm_ext/for_each.hpp>
 
 #include "ClientManager.h"
+#include "CompactListing.h"
 #include "ConnectionManager.h"
 #include "Download.h"
 #include "FileReader.h"
 #include "FinishedManager.h"
 #include "HashManager.h"
 #include "LogManager.h"
+#include "Metrics.h"
 #include "ScopedFunctor.h"
 #include "SearchManager.h"
 #include "SearchResult.h"
 #include "SFVReader.h"
 #include "ShareManager.h"
 #include "SimpleXML.h"
+#include "TreeChecker.h"
 #include "UserConnection.h"
 #include "version.h"
 #include "ZUtils.h"
 
+#include <thread>
+
 #ifdef ff
 #undef ff
 #endif
@@ -194,19 +198,30 @@ QueueItem* QueueManager::UserQueue::getNext(const UserPtr& aUser, QueueItem::Pri
 		if(i != userQueue[p].end()) {
 			dcassert(!i->second.empty());
 			for(auto qi: i->second) {
-				if(qi->isWaiting()) {
+				auto source = qi->getSource(aUser);
+				auto parts = source != qi->getSources().end() ? source->getPartsInfo() : nullptr;
+
+				if(qi->isWaiting() && !parts) {
 					return qi;
 				}
 
 				// No segmented downloading when getting the tree
-				if(qi->getDownloads()[0]->getType() == Transfer::TYPE_TREE) {
+				if(!qi->isWaiting() && qi->getDownloads()[0]->getType() == Transfer::TYPE_TREE) {
 					continue;
 				}
 				if(!qi->isSet(QueueItem::FLAG_USER_LIST)) {
 					auto blockSize = HashManager::getInstance()->getBlockSize(qi->getTTH());
-					if(blockSize == 0)
+					if(blockSize == 0) {
+						// a partial source can give us the tree, and the tree tells where its parts are
+						if(parts) {
+							if(qi->isWaiting() && !source->isSet(QueueItem::Source::FLAG_NO_TREE)) {
+								return qi;
+							}
+							continue;
+						}
 						blockSize = qi->getSize();
-					if(qi->getNextSegment(blockSize, wantedSize).getSize() == 0) {
+					}
+					if(qi->getNextSegment(blockSize, wantedSize, parts).getSize() == 0) {
 						dcdebug("No segment for %s in %s, block " I64_FMT "\n", aUser->getCID().toBase32().c_str(), qi->getTarget().c_str(), blockSize);
 						continue;
 					}
@@ -315,8 +330,8 @@ int QueueManager::FileMover::run() {
 	return 0;
 }
 
-void QueueManager::Rechecker::add(const string& file) {
-	files.push(new string(file));
+void QueueManager::Rechecker::add(const string& file, bool doneOnly) {
+	files.push(new FileMode(file, doneOnly));
 	if(!active.test_and_set()) {
 		start();
 	}
@@ -326,11 +341,12 @@ int QueueManager::Rechecker::run() {
 	ScopedFunctor([this] { active.clear(); });
 
 	while(true) {
-		unique_ptr<string> file;
-		if(!files.pop(file)) {
+		unique_ptr<FileMode> mode;
+		if(!files.pop(mode)) {
 			return 0;
 		}
 
+		const auto& file = mode->first;
 		QueueItem* q;
 		int64_t tempSize;
 		TTHValue tth;
@@ -338,12 +354,12 @@ int QueueManager::Rechecker::run() {
 		{
 			Lock l(qm->cs);
 
-			q = qm->fileQueue.find(*file);
+			q = qm->fileQueue.find(file);
 			if(!q || q->isSet(QueueItem::FLAG_USER_LIST))
 				continue;
 
 			qm->fire(QueueManagerListener::RecheckStarted(), q->getTarget());
-			dcdebug("Rechecking %s\n", file->c_str());
+			dcdebug("Rechecking %s\n", file.c_str());
 
 			tempSize = File::getSize(q->getTempTarget());
 
@@ -373,12 +389,14 @@ int QueueManager::Rechecker::run() {
 		bool gotTree = HashManager::getInstance()->getTree(tth, tt);
 
 		string tempTarget;
+		int64_t size;
+		QueueItem::SegmentSet done;
 
 		{
 			Lock l(qm->cs);
 
 			// get q again in case it has been (re)moved
-			q = qm->fileQueue.find(*file);
+			q = qm->fileQueue.find(file);
 			if(!q)
 				continue;
 
@@ -387,46 +405,51 @@ int QueueManager::Rechecker::run() {
 				continue;
 			}
 
+			if(mode->second) {
+				done = q->getDone();
+			}
+
 			//Clear segments
 			q->resetDownloaded();
 
 			tempTarget = q->getTempTarget();
+			size = q->getSize();
 		}
 
-		TigerTree ttFile(tt.getBlockSize());
+		// the blocks found good go back to the queue item range by range, as they are checked
+		TreeChecker(tempTarget, tt).check(TreeChecker::getRanges(size, tt.getBlockSize(), mode->second ? &done : nullptr),
+			std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), MAX_THREADS),
+			[&](const vector<Segment>& verified) -> bool
+		{
+			Lock l(qm->cs);
 
-		try {
-			FileReader(true).read(tempTarget, [&](const void* x, size_t n) {
-				return ttFile.update(x, n), true;
-			});
-		} catch(const FileException & e) {
-			dcdebug("Error while reading file: %s\n", e.what());
-		}
+			// get q again in case it has been (re)moved
+			auto q = qm->fileQueue.find(file);
+			if(!q)
+				return false;
+
+			if(!verified.empty()) {
+				for(auto& i: verified) {
+					q->addSegment(i);
+				}
+				qm->fire(QueueManagerListener::StatusUpdated(), q);
+			}
+			return true;
+		});
 
 		Lock l(qm->cs);
 
 		// get q again in case it has been (re)moved
-		q = qm->fileQueue.find(*file);
+		q = qm->fileQueue.find(file);
 		if(!q)
 			continue;
 
-		ttFile.finalize();
-
-		if(ttFile.getRoot() == tth) {
+		if(q->isFinished()) {
 			//If no bad blocks then the file probably got stuck in the temp folder for some reason
 			qm->moveStuckFile(q);
 			continue;
 		}
 
-		size_t pos = 0;
-		boost::for_each(tt.getLeaves(), ttFile.getLeaves(), [&](const TTHValue& our, const TTHValue& file) {
-			if(our == file) {
-				q->addSegment(Segment(pos, tt.getBlockSize()));
-			}
-
-			pos += tt.getBlockSize();
-		});
-
 		qm->rechecked(q);
 	}
 
@@ -557,6 +580,9 @@ void QueueManager::add(const string& aTarget, int64_t aSize, const TTHValue& roo
 		return;
 	}
 
+	static auto& adds = Metrics::counter("queue.adds");
+	adds.add();
+
 	{
 		Lock l(cs);
 
@@ -779,6 +805,55 @@ int QueueManager::matchListing(const DirectoryListing& dl) noexcept {
 	return matches;
 }
 
+int QueueManager::matchListing(const CompactListing& dl) noexcept {
+	int matches = 0;
+
+	{
+		Lock l(cs);
+
+		// the queue is usually much smaller than the list, so index the queue and go through the
+		// packed TTHs of the list once
+		unordered_map<TTHValue, QueueItemList> wanted;
+		for(auto& i: fileQueue.getQueue()) {
+			auto qi = i.second;
+			if(qi->isFinished())
+				continue;
+			if(qi->isSet(QueueItem::FLAG_USER_LIST))
+				continue;
+			wanted[qi->getTTH()].push_back(qi);
+		}
+
+		auto& tths = dl.getTTHs();
+		for(size_t i = 0, n = tths.size(); i < n && !wanted.empty(); ++i) {
+			auto j = wanted.find(tths[i]);
+			if(j == wanted.end())
+				continue;
+
+			auto& items = j->second;
+			for(auto k = items.begin(); k != items.end();) {
+				if((*k)->getSize() == dl.getFile(i).size) {
+					try {
+						addSource(*k, dl.getUser(), QueueItem::Source::FLAG_FILE_NOT_AVAILABLE);
+					} catch(...) {
+						// Ignore...
+					}
+					matches++;
+					k = items.erase(k);
+				} else {
+					++k;
+				}
+			}
+
+			if(items.empty()) {
+				wanted.erase(j);
+			}
+		}
+	}
+	if(matches > 0)
+		ConnectionManager::getInstance()->getDownloadConnection(dl.getUser());
+	return matches;
+}
+
 int64_t QueueManager::getPos(const string& target) noexcept {
 	Lock l(cs);
 	QueueItem* qi = fileQueue.find(target);
@@ -864,13 +939,115 @@ StringList QueueManager::getTargets(const TTHValue& tth) {
 	return sl;
 }
 
+QueueItem* QueueManager::findPartial(const TTHValue& tth, int64_t& blockSize) {
+	for(auto qi: fileQueue.find(tth)) {
+		if(qi->isSet(QueueItem::FLAG_USER_LIST) || qi->isFinished() || qi->getDone().empty()) {
+			continue;
+		}
+
+		// parts are only checked as they come in when the full tree is known; they must also be
+		// few enough to be counted in PartsInfo
+		blockSize = HashManager::getInstance()->getBlockSize(tth);
+		if(blockSize > 0 && blockSize < qi->getSize() && qi->getSize() / blockSize < UINT16_MAX) {
+			return qi;
+		}
+	}
+	return nullptr;
+}
+
+bool QueueManager::getPartsInfo(const TTHValue& tth, QueueItem::PartsInfo& parts) noexcept {
+	if(!SETTING(SHARE_PARTIAL_FILES)) {
+		return false;
+	}
+
+	Lock l(cs);
+	int64_t blockSize;
+	auto qi = findPartial(tth, blockSize);
+	if(!qi) {
+		return false;
+	}
+
+	parts = qi->getPartsInfo(blockSize);
+	return true;
+}
+
+bool QueueManager::getPartialFile(const TTHValue& tth, int64_t aStart, int64_t aBytes, string& path, int64_t& size) noexcept {
+	if(!SETTING(SHARE_PARTIAL_FILES)) {
+		return false;
+	}
+
+	Lock l(cs);
+	int64_t blockSize;
+	auto qi = findPartial(tth, blockSize);
+	if(!qi || !qi->isDone(aStart, aBytes == -1 ? qi->getSize() - aStart : aBytes)) {
+		return false;
+	}
+
+	path = qi->getTempTarget().empty() ? qi->getTarget() : qi->getTempTarget();
+	size = qi->getSize();
+	return true;
+}
+
+bool QueueManager::addPartialSource(const HintedUser& aUser, const TTHValue& tth, const QueueItem::PartsInfo& parts,
+	QueueItem::PartsInfo& ours) noexcept
+{
+	bool wantConnection = false;
+	bool haveParts = false;
+
+	{
+		Lock l(cs);
+
+		int64_t blockSize;
+		auto partial = findPartial(tth, blockSize);
+		if(partial && SETTING(SHARE_PARTIAL_FILES)) {
+			ours = partial->getPartsInfo(blockSize);
+			haveParts = true;
+		}
+
+		for(auto qi: fileQueue.find(tth)) {
+			if(qi->isSet(QueueItem::FLAG_USER_LIST) || qi->isFinished()) {
+				continue;
+			}
+
+			auto source = qi->getSource(aUser);
+			if(source == qi->getSources().end()) {
+				try {
+					wantConnection = addSource(qi, aUser, QueueItem::Source::FLAG_FILE_NOT_AVAILABLE);
+				} catch(const Exception&) {
+					break;
+				}
+				source = qi->getSource(aUser);
+				if(source == qi->getSources().end()) {
+					break;
+				}
+				source->setFlag(QueueItem::Source::FLAG_PARTIAL);
+			} else if(source->isSet(QueueItem::Source::FLAG_PARTIAL)) {
+				// what the source has by now; it may have parts we couldn't get from it before
+				wantConnection = qi->getPriority() != QueueItem::PAUSED && !userQueue.getRunning(aUser);
+			}
+
+			if(source->isSet(QueueItem::Source::FLAG_PARTIAL)) {
+				source->setParts(parts);
+			}
+			break;
+		}
+	}
+
+	if(wantConnection && aUser.user->isOnline()) {
+		ConnectionManager::getInstance()->getDownloadConnection(aUser);
+	}
+
+	return haveParts;
+}
+
 void QueueManager::lockedOperation(const function<void (const QueueItem::StringMap&)>& currentQueue) {
 	Lock l(cs);
 	if(currentQueue) currentQueue(fileQueue.getQueue());
 }
 
 Download* QueueManager::getDownload(UserConnection& aSource) noexcept {
-	Lock l(cs);
+	static auto& lockTime = Metrics::histogram("queue.lock_us");
+	TimedLock l(cs, lockTime);
 
 	UserPtr& u = aSource.getUser();
 	dcdebug("Getting download for %s...", u->getCID().toBase32().c_str());
@@ -927,7 +1104,9 @@ void QueueManager::moveFile(const string& source, const string& target) {
 
 void QueueManager::moveFile_(const string& source, const string& target) {
 	try {
-		File::renameFile(source, target);
+		File::renameFile(source, target, [&target](int64_t copied, int64_t total) {
+			getInstance()->fire(QueueManagerListener::FileMoving(), target, copied, total);
+		});
 		getInstance()->fire(QueueManagerListener::FileMoved(), target);
 	} catch(const FileException& e1) {
 		// Try to just rename it to the correct name at least
@@ -982,7 +1161,8 @@ void QueueManager::putDownload(Download* aDownload, bool finished) noexcept {
 	d->close();
 
 	{
-		Lock l(cs);
+		static auto& lockTime = Metrics::histogram("queue.lock_us");
+		TimedLock l(cs, lockTime);
 
 		QueueItem* q = fileQueue.find(d->getPath());
 		if(!q) {
@@ -1113,7 +1293,7 @@ void QueueManager::putDownload(Download* aDownload, bool finished) noexcept {
 }
 
 void QueueManager::processList(const string& name, const HintedUser& user, int flags) {
-	DirectoryListing dirList(user);
+	CompactListing dirList(user);
 	try {
 		dirList.loadFile(name);
 	} catch(const Exception&) {
@@ -1142,8 +1322,8 @@ void QueueManager::processList(const string& name, const HintedUser& user, int f
 	}
 }
 
-void QueueManager::recheck(const string& aTarget) {
-	rechecker.add(aTarget);
+void QueueManager::recheck(const string& aTarget, bool aDoneOnly) {
+	rechecker.add(aTarget, aDoneOnly);
 }
 
 void QueueManager::remove(const string& aTarget) noexcept {
@@ -1155,6 +1335,9 @@ void QueueManager::remove(const string& aTarget) noexcept {
 		if(!q)
 			return;
 
+		static auto& removes = Metrics::counter("queue.removes");
+		removes.add();
+
 		if(q->isSet(QueueItem::FLAG_DIRECTORY_DOWNLOAD)) {
 			dcassert(q->getSources().size() == 1);
 			auto dp = directories.equal_range(q->getSources()[0].getUser());
@@ -1438,6 +1621,11 @@ void QueueManager::saveQueue(bool force) noexcept {
 				}
 
 				for(auto& j: qi->sources) {
+					// what partial sources have will have changed by the next time
+					if(j.isSet(QueueItem::Source::FLAG_PARTIAL)) {
+						continue;
+					}
+
 					const CID& cid = j.getUser().user->getCID();
 					const string& hint = j.getUser().hint;
 
@@ -1639,6 +1827,16 @@ void QueueManager::on(SearchManagerListener::SR, const SearchResultPtr& sr) noex
 
 		for(auto qi: matches) {
 			// Size compare to avoid popular spoof
+			if(qi->getSize() == sr->getSize()) {
+				auto source = qi->getSource(sr->getUser());
+				if(source != qi->getSources().end() && source->isSet(QueueItem::Source::FLAG_PARTIAL)) {
+					// the partial source has got the whole file since
+					source->unsetFlag(QueueItem::Source::FLAG_PARTIAL);
+					source->setParts(QueueItem::PartsInfo());
+					setDirty();
+				}
+			}
+
 			if (qi->getSize() == sr->getSize() && !qi->isSource(sr->getUser()) && !qi->isBadSource(sr->getUser())) {
 				try {
 					if(!SETTING(AUTO_SEARCH_AUTO_MATCH))
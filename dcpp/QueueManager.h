@@ -97,6 +97,7 @@ public:
 		QueueItem::Priority p = QueueItem::DEFAULT) noexcept;
 
 	int matchListing(const DirectoryListing& dl) noexcept;
+	int matchListing(const CompactListing& dl) noexcept;
 
 	bool getTTH(const string& name, TTHValue& tth) noexcept;
 
@@ -111,12 +112,26 @@ public:
 	void removeSource(const string& aTarget, const UserPtr& aUser, int reason, bool removeConn = true) noexcept;
 	void removeSource(const UserPtr& aUser, int reason) noexcept;
 
-	void recheck(const string& aTarget);
+	/** Check the temp file of a download against its tree, keeping the blocks that match.
+	@param aDoneOnly Only check the parts already downloaded, the rest being downloaded again */
+	void recheck(const string& aTarget, bool aDoneOnly = false);
 
 	void setPriority(const string& aTarget, QueueItem::Priority p) noexcept;
 
 	StringList getTargets(const TTHValue& tth);
 
+	/** Partial file sharing: the parts of a file being downloaded that have been checked against
+	its tree. */
+	bool getPartsInfo(const TTHValue& tth, QueueItem::PartsInfo& parts) noexcept;
+	/** Partial file sharing: the file to upload a range of a file being downloaded from, provided
+	the range has been downloaded and checked.
+	@param aBytes -1 for the rest of the file, 0 to only check that the file has parts to share */
+	bool getPartialFile(const TTHValue& tth, int64_t aStart, int64_t aBytes, string& path, int64_t& size) noexcept;
+	/** Partial file sharing: a user has parts of a file we're downloading, add them as a source.
+	@return Whether we have parts of that file ourselves, which are then in ours */
+	bool addPartialSource(const HintedUser& aUser, const TTHValue& tth, const QueueItem::PartsInfo& parts,
+		QueueItem::PartsInfo& ours) noexcept;
+
 	void lockedOperation(const function<void (const QueueItem::StringMap&)>& currentQueue);
 
 	Download* getDownload(UserConnection& aSource) noexcept;
@@ -171,13 +186,18 @@ private:
 		explicit Rechecker(QueueManager* qm_) : qm(qm_), files(8) { }
 		virtual ~Rechecker() { join(); }
 
-		void add(const string& file);
+		void add(const string& file, bool doneOnly);
 		virtual int run();
 
 	private:
+		/** Readers of a file at once; more would only make a disk seek back and forth */
+		static const size_t MAX_THREADS = 4;
+
 		QueueManager* qm;
 		static std::atomic_flag active;
-		boost::lockfree::queue<string*> files;
+		/// Targets, and whether to only check the parts already downloaded
+		typedef pair<string, bool> FileMode;
+		boost::lockfree::queue<FileMode*> files;
 	} rechecker;
 
 	/** All queue items by target */
@@ -255,6 +275,8 @@ private:
 	static string checkTarget(const string& aTarget, bool checkExsistence);
 	/** Add a source to an existing queue item */
 	bool addSource(QueueItem* qi, const HintedUser& aUser, Flags::MaskType addBad);
+	/** A file being downloaded with parts to share, and the block size the parts are counted in */
+	QueueItem* findPartial(const TTHValue& tth, int64_t& blockSize);
 
 	void processList(const string& name, const HintedUser& user, int flags);
 
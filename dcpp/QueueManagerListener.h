@@ -50,6 +50,7 @@ public:
 	typedef X<14> RecheckDone;
 
 	typedef X<15> FileMoved;
+	typedef X<18> FileMoving;
 
 	typedef X<16> CRCFailed;
 	typedef X<17> CRCChecked;
@@ -72,6 +73,8 @@ public:
 	virtual void on(RecheckDone, const string&) noexcept { }
 
 	virtual void on(FileMoved, const string&) noexcept { }
+	/** Progress of a finished download being copied over to another volume. */
+	virtual void on(FileMoving, const string&, int64_t, int64_t) noexcept { }
 
 	virtual void on(CRCFailed, Download*, const string&) noexcept { }
 	virtual void on(CRCChecked, Download*) noexcept { } 
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stdinc.h"
+#include "Resolver.h"
+
+#include "Socket.h"
+
+namespace dcpp {
+
+/** Lookups are mostly waiting on the network; a couple of threads keep one slow name server from
+holding up every other request. */
+static const size_t WORKERS = 2;
+
+Resolver::Resolver() : stop(false) {
+	for(size_t i = 0; i < WORKERS; ++i) {
+		workers.push_back(unique_ptr<Worker>(new Worker(*this)));
+	}
+}
+
+Resolver::~Resolver() {
+	shutdown();
+}
+
+void Resolver::resolve(const string& host, int af, Callback f) {
+	Request request(host, af);
+
+	{
+		Lock l(cs);
+		if(stop)
+			return;
+
+		auto& callbacks = pending[request];
+		bool queued = !callbacks.empty();
+		callbacks.push_back(move(f));
+		if(queued)
+			return;
+
+		requests.push_back(move(request));
+	}
+
+	s.signal();
+}
+
+void Resolver::shutdown() {
+	{
+		Lock l(cs);
+		if(stop)
+			return;
+		stop = true;
+	}
+
+	for(size_t i = 0; i < workers.size(); ++i) {
+		s.signal();
+	}
+	workers.clear();
+}
+
+bool Resolver::next(Request& request) {
+	s.wait();
+
+	Lock l(cs);
+	if(stop || requests.empty())
+		return false;
+
+	request = move(requests.front());
+	requests.pop_front();
+	return true;
+}
+
+vector<Resolver::Callback> Resolver::done(const Request& request) {
+	Lock l(cs);
+	auto i = pending.find(request);
+	if(i == pending.end())
+		return vector<Callback>();
+
+	auto ret = move(i->second);
+	pending.erase(i);
+	return ret;
+}
+
+int Resolver::Worker::run() {
+	Request request;
+	while(resolver.next(request)) {
+		auto ip = Socket::resolve(request.first, request.second);
+
+		for(auto& f: resolver.done(request)) {
+			if(f) {
+				f(ip);
+			}
+		}
+	}
+	return 0;
+}
+
+} // namespace dcpp
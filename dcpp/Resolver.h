@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_RESOLVER_H
+#define DCPLUSPLUS_DCPP_RESOLVER_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "CriticalSection.h"
+#include "SemaphoreDCpp.h"
+#include "Singleton.h"
+#include "Thread.h"
+#include "typedefs.h"
+
+namespace dcpp {
+
+using std::deque;
+using std::function;
+using std::map;
+using std::unique_ptr;
+using std::vector;
+
+/** Resolves host names on a few dedicated threads, so that network threads never have to wait for
+DNS. Results go through the DNS cache of Socket; use Socket::resolveCached first to avoid a round
+trip for names that are already known. */
+class Resolver : public Singleton<Resolver>
+{
+public:
+	typedef function<void (const string&)> Callback;
+
+	/** Resolve a host name in the background. Requests for a name that is already being looked up
+	share that lookup.
+	@param f Called from a resolver thread with the address, or an empty string on failure. */
+	void resolve(const string& host, int af, Callback f);
+
+	void shutdown();
+
+private:
+	friend class Singleton<Resolver>;
+
+	Resolver();
+	virtual ~Resolver();
+
+	class Worker : public Thread {
+	public:
+		explicit Worker(Resolver& resolver) : resolver(resolver) { start(); }
+		virtual ~Worker() { join(); }
+
+	private:
+		virtual int run();
+
+		Resolver& resolver;
+	};
+
+	typedef pair<string, int> Request;
+
+	bool next(Request& request);
+	vector<Callback> done(const Request& request);
+
+	deque<Request> requests;
+	map<Request, vector<Callback>> pending;
+
+	vector<unique_ptr<Worker>> workers;
+	bool stop;
+
+	CriticalSection cs;
+	Semaphore s;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_RESOLVER_H)
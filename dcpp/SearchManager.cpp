@@ -29,8 +29,10 @@
 #include "format.h"
 #include "LogManager.h"
 #include "PluginManager.h"
+#include "QueueManager.h"
 #include "SearchResult.h"
 #include "ShareManager.h"
+#include "StringTokenizer.h"
 #include "CryptoManager.h"
 
 namespace dcpp {
@@ -234,6 +236,27 @@ void SearchManager::handle(AdcCommand::RES, AdcCommand& c, const string& remoteI
 	onRES(c, user, remoteIp);
 }
 
+void SearchManager::handle(AdcCommand::PSR, AdcCommand& c, const string& remoteIp) noexcept {
+	if (c.getParameters().empty())
+		return;
+
+	string cid = c.getParam(0);
+	if (cid.size() != 39)
+		return;
+
+	// NMDC users send a random CID; they are found by their nick and hub instead
+	HintedUser user(ClientManager::getInstance()->findUser(CID(cid)), Util::emptyString);
+	if (user.user) {
+		auto hubs = ClientManager::getInstance()->getHubUrls(user.user->getCID());
+		if (!hubs.empty())
+			user.hint = hubs.front();
+	}
+
+	c.getParameters().erase(c.getParameters().begin());
+
+	onPSR(c, user, remoteIp);
+}
+
 void SearchManager::onSR(const string& x, const string& remoteIp) {
 	string::size_type i, j;
 	// Directories: $SR <nick><0x20><directory><0x20><free slots>/<total slots><0x05><Hubname><0x20>(<Hubip:port>)
@@ -402,6 +425,101 @@ void SearchManager::onRES(const AdcCommand& cmd, const UserPtr& from, const stri
 		type, 0, freeSlots, size, file, hubName, remoteIp, TTHValue(tth), token, style)));
 }
 
+bool SearchManager::parsePSR(const AdcCommand& cmd, string& udpPort, string& nick, string& hubIpPort, string& tth,
+	QueueItem::PartsInfo& parts)
+{
+	int partCount = -1;
+
+	for(auto& str: cmd.getParameters()) {
+		if(str.compare(0, 2, "U4") == 0) {
+			udpPort = str.substr(2);
+		} else if(str.compare(0, 2, "NI") == 0) {
+			nick = str.substr(2);
+		} else if(str.compare(0, 2, "HI") == 0) {
+			hubIpPort = str.substr(2);
+		} else if(str.compare(0, 2, "TR") == 0) {
+			tth = str.substr(2);
+		} else if(str.compare(0, 2, "PC") == 0) {
+			partCount = Util::toInt(str.substr(2));
+		} else if(str.compare(0, 2, "PI") == 0) {
+			StringTokenizer<string> st(str.substr(2), ',');
+			for(auto& i: st.getTokens()) {
+				parts.push_back(static_cast<uint16_t>(Util::toInt(i)));
+			}
+		}
+	}
+
+	return tth.size() == 39 && partCount > 0 && parts.size() == static_cast<size_t>(partCount) * 2;
+}
+
+void SearchManager::onPSR(const AdcCommand& cmd, HintedUser from, const string& remoteIp) {
+	string udpPort;
+	string nick;
+	string hubIpPort;
+	string tth;
+	QueueItem::PartsInfo parts;
+
+	if(!parsePSR(cmd, udpPort, nick, hubIpPort, tth, parts)) { return; }
+
+	string myNick;
+	if(!hubIpPort.empty()) {
+		auto hubUrl = ClientManager::getInstance()->findHub(hubIpPort);
+		if(hubUrl.empty()) { return; }
+
+		from = HintedUser(ClientManager::getInstance()->findUser(nick, hubUrl), hubUrl);
+
+		auto lock = ClientManager::getInstance()->lock();
+		auto& clients = ClientManager::getInstance()->getClients();
+		auto i = boost::find_if(clients, [&hubUrl](const Client* client) { return client->getHubUrl() == hubUrl; });
+		if(i == clients.end()) { return; }
+		myNick = (*i)->getMyNick();
+	}
+
+	if(!from.user || from.hint.empty() || from.user == ClientManager::getInstance()->getMe()) { return; }
+
+	if(!remoteIp.empty()) {
+		// anyone can send a datagram claiming to be anyone; only believe the user's own address,
+		// lest we record bogus sources and send our answer to a third party.
+		auto lock = ClientManager::getInstance()->lock();
+		auto ou = ClientManager::getInstance()->findOnlineUserHint(from);
+		if(!ou || ou->getIdentity().getIp() != remoteIp) { return; }
+	}
+
+	QueueItem::PartsInfo ours;
+	if(QueueManager::getInstance()->addPartialSource(from, TTHValue(tth), parts, ours) &&
+		!remoteIp.empty() && Util::toInt(udpPort) > 0)
+	{
+		// they would like to know which parts we have in return
+		auto psr = toPSR(false, myNick, hubIpPort, tth, ours);
+		ClientManager::getInstance()->sendUDP(remoteIp, udpPort, psr.toString(ClientManager::getInstance()->getMe()->getCID()));
+	}
+}
+
+AdcCommand SearchManager::toPSR(bool wantResponse, const string& myNick, const string& hubIpPort, const string& tth,
+	const QueueItem::PartsInfo& parts) const
+{
+	AdcCommand cmd(AdcCommand::CMD_PSR, AdcCommand::TYPE_UDP);
+
+	if(!myNick.empty()) {
+		cmd.addParam("NI", myNick);
+		cmd.addParam("HI", hubIpPort);
+	}
+
+	cmd.addParam("U4", wantResponse && ClientManager::getInstance()->isActive() ? port : "0");
+	cmd.addParam("TR", tth);
+	cmd.addParam("PC", Util::toString(static_cast<int>(parts.size() / 2)));
+
+	string partInfo;
+	for(auto part: parts) {
+		if(!partInfo.empty())
+			partInfo += ',';
+		partInfo += Util::toString(static_cast<int>(part));
+	}
+	cmd.addParam("PI", partInfo);
+
+	return cmd;
+}
+
 void SearchManager::genSUDPKey(string& aKey) {
 	string keyStr = Util::emptyString;
 	if(SETTING(ENABLE_SUDP)) {
@@ -434,13 +552,22 @@ void SearchManager::respond(const AdcCommand& cmd, const OnlineUser& user) {
 		return;
 
 	auto results = ShareManager::getInstance()->search(cmd.getParameters(), user.getIdentity().isUdpActive() ? 10 : 5);
-	if(results.empty())
-		return;
 
 	string token, key;
 	cmd.getParam("TO", 0, token);
 	cmd.getParam("KY", 0, key);
 
+	if(results.empty()) {
+		// no complete file, but we may be downloading it and have parts to share
+		string tth;
+		QueueItem::PartsInfo parts;
+		if(cmd.getParam("TR", 0, tth) && tth.size() == 39 && QueueManager::getInstance()->getPartsInfo(TTHValue(tth), parts)) {
+			auto psr = toPSR(true, Util::emptyString, Util::emptyString, tth, parts);
+			ClientManager::getInstance()->sendUDP(psr, user, key);
+		}
+		return;
+	}
+
 	for(auto& i: results) {
 		AdcCommand res = i->toRES(AdcCommand::TYPE_UDP);
 		if(!token.empty())
@@ -21,6 +21,7 @@
 #include "SettingsManager.h"
 
 #include "AdcCommand.h"
+#include "QueueItem.h"
 #include "Socket.h"
 #include "Thread.h"
 #include "Singleton.h"
@@ -79,6 +80,24 @@ public:
 	void onData(const string& data, const string& remoteIp = Util::emptyString);
 	void onRES(const AdcCommand& cmd, const UserPtr& from, const string& removeIp = Util::emptyString);
 	void onSR(const string& x, const string& remoteIP = Util::emptyString);
+	/** Partial file sharing: a user tells us which parts of a file they have.
+	@param from Ignored for NMDC users, which are found by the nick and hub in the command.
+	@param remoteIp Where a command received over UDP came from; it is dropped unless that is the
+	user's address. Only those get an answer, commands relayed by a hub don't. */
+	void onPSR(const AdcCommand& cmd, HintedUser from, const string& remoteIp = Util::emptyString);
+
+	/** Partial file sharing: read the fields of a PSR command.
+	@return Whether it names a TTH and has as many parts as it says. */
+	static bool parsePSR(const AdcCommand& cmd, string& udpPort, string& nick, string& hubIpPort, string& tth,
+		QueueItem::PartsInfo& parts);
+
+	/** Partial file sharing: the parts of a file we have, to reply to a TTH search we have no
+	complete file for.
+	@param wantResponse Whether to ask for the parts the other side has in return (only when we
+	can receive UDP).
+	@param myNick Our nick and the hub address, only for NMDC users. */
+	AdcCommand toPSR(bool wantResponse, const string& myNick, const string& hubIpPort, const string& tth,
+		const QueueItem::PartsInfo& parts) const;
 
 	int32_t timeToSearch() {
 		return 5 - (static_cast<int64_t>(GET_TICK() - lastSearch) / 1000);
@@ -95,6 +114,7 @@ private:
 	friend class CommandHandler<SearchManager>;
 
 	void handle(AdcCommand::RES, AdcCommand& c, const string& remoteIp) noexcept;
+	void handle(AdcCommand::PSR, AdcCommand& c, const string& remoteIp) noexcept;
 
 	// Ignore any other ADC commands for now
 	template<typename T> void handle(T, AdcCommand&, const string&) { }
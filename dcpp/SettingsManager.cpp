@@ -86,7 +86,8 @@ const string SettingsManager::settingTags[] =
 	"MaxFilelistSize", "MaxHashSpeed", "MaxMessageLines", "MaxPMWindows", "MinMessageLines",
 	"MinUploadSpeed", "PMLastLogLines", "SearchHistory", "SetMinislotSize",
 	"SettingsSaveInterval", "Slots", "TabStyle", "TabWidth", "ToolbarSize", "AutoSearchInterval",
-	"MaxExtraSlots", "TestingStatus",
+	"MaxExtraSlots", "TestingStatus", "ConcurrentConnectAttempts", "Preallocation",
+	"UploadCacheSize", "MetricsInterval",
 	"SENTRY",
 	// Bools
 	"AddFinishedInstantly", "AdlsBreakOnFirst",
@@ -114,7 +115,7 @@ const string SettingsManager::settingTags[] =
 	"ToggleActiveTab", "UrlHandler", "UseCTRLForLineHistory", "UseSystemIcons",
 	"UsersFilterFavorite", "UsersFilterOnline", "UsersFilterQueue", "UsersFilterWaiting",
 	"RegisterSystemStartup", "DontLogCCPMChat", "AboutCfgDisclaimer", "EnableTaskbarPreview",
-	"EnableSUDP", "BroadDetection", "BroadDetection6",
+	"EnableSUDP", "BroadDetection", "BroadDetection6", "SharePartialFiles",
 	"SENTRY",
 	// Int64
 	"TotalUpload", "TotalDownload", "SharingSkiplistMinSize", "SharingSkiplistMaxSize",
@@ -180,6 +181,7 @@ SettingsManager::SettingsManager() {
 	setDefault(OUTGOING_CONNECTIONS, OUTGOING_DIRECT);
 	setDefault(BROAD_DETECTION, false);
 	setDefault(BROAD_DETECTION6, false);
+	setDefault(SHARE_PARTIAL_FILES, false);
 	setDefault(AUTO_DETECT_CONNECTION, true);
 	setDefault(AUTO_FOLLOW, true);
 	setDefault(CLEAR_SEARCH, true);
@@ -380,6 +382,10 @@ SettingsManager::SettingsManager() {
 	setDefault(REGISTER_SYSTEM_STARTUP, false);
 	setDefault(MAX_EXTRA_SLOTS, 3);
 	setDefault(TESTING_STATUS, TESTING_ENABLED);
+	setDefault(CONCURRENT_CONNECT_ATTEMPTS, 10);
+	setDefault(PREALLOCATION, PREALLOCATION_FULL);
+	setDefault(UPLOAD_CACHE_SIZE, 32);
+	setDefault(METRICS_INTERVAL, 0);
 	setDefault(WHITELIST_OPEN_URIS, "http:;https:;www;mailto:");
 	setDefault(ENABLE_SUDP, true);
 	setDefault(AC_DISCLAIM, true);
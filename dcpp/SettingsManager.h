@@ -120,7 +120,8 @@ public:
 		MAX_FILELIST_SIZE, MAX_HASH_SPEED, MAX_MESSAGE_LINES, MAX_PM_WINDOWS, MIN_MESSAGE_LINES,
 		MIN_UPLOAD_SPEED, PM_LAST_LOG_LINES, SEARCH_HISTORY, SET_MINISLOT_SIZE,
 		SETTINGS_SAVE_INTERVAL, SLOTS, TAB_STYLE, TAB_WIDTH, TOOLBAR_SIZE,
-		AUTO_SEARCH_INTERVAL, MAX_EXTRA_SLOTS, TESTING_STATUS,
+		AUTO_SEARCH_INTERVAL, MAX_EXTRA_SLOTS, TESTING_STATUS, CONCURRENT_CONNECT_ATTEMPTS, PREALLOCATION,
+		UPLOAD_CACHE_SIZE, METRICS_INTERVAL,
 
 		INT_LAST };
 
@@ -150,7 +151,7 @@ public:
 		TOGGLE_ACTIVE_WINDOW, URL_HANDLER, USE_CTRL_FOR_LINE_HISTORY, USE_SYSTEM_ICONS,
 		USERS_FILTER_FAVORITE, USERS_FILTER_ONLINE, USERS_FILTER_QUEUE, USERS_FILTER_WAITING,
 		REGISTER_SYSTEM_STARTUP, DONT_LOG_CCPM, AC_DISCLAIM, ENABLE_TASKBAR_PREVIEW, ENABLE_SUDP,
-		BROAD_DETECTION, BROAD_DETECTION6,
+		BROAD_DETECTION, BROAD_DETECTION6, SHARE_PARTIAL_FILES,
 		BOOL_LAST };
 
 	enum Int64Setting { INT64_FIRST = BOOL_LAST + 1,
@@ -185,6 +186,9 @@ public:
 
 	enum { TESTING_ENABLED, TESTING_SEEN_ONCE, TESTING_DISABLED };
 
+	/// Same order as File::Allocation
+	enum { PREALLOCATION_NONE, PREALLOCATION_SPARSE, PREALLOCATION_FULL };
+
 	const string& get(StrSetting key, bool useDefault = true) const {
 		return (isSet[key] || !useDefault) ? strSettings[key - STR_FIRST] : strDefaults[key - STR_FIRST];
 	}
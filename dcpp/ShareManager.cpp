@@ -26,7 +26,7 @@
 #include "File.h"
 #include "FilteredFile.h"
 #include "LogManager.h"
-#include "HashBloom.h"
+#include "Metrics.h"
 #include "HashManager.h"
 #include "QueueManager.h"
 #include "ScopedFunctor.h"
@@ -66,9 +66,13 @@ ShareManager::ShareManager() : hits(0), sharedSize(0), xmlListLen(0), bzXmlListL
 	TimerManager::getInstance()->addListener(this);
 	QueueManager::getInstance()->addListener(this);
 	HashManager::getInstance()->addListener(this);
+
+	Metrics::addValue("share.hits", this, [this] { return static_cast<int64_t>(getHits()); });
 }
 
 ShareManager::~ShareManager() {
+	Metrics::removeValue("share.hits", this);
+
 	SettingsManager::getInstance()->removeListener(this);
 	TimerManager::getInstance()->removeListener(this);
 	QueueManager::getInstance()->removeListener(this);
@@ -809,6 +813,7 @@ void ShareManager::rebuildIndices() {
 	sharedSize = 0;
 	tthIndex.clear();
 	bloom.clear();
+	tthBloom.clear();
 
 	for(auto& i: directories) {
 		updateIndices(*i.second);
@@ -841,6 +846,7 @@ void ShareManager::updateIndices(Directory& dir, const decltype(std::declval<Dir
 
 	tthIndex[*f.tth] = &f;
 	bloom.add(Text::toLower(f.getName()));
+	tthBloom.add(*f.tth);
 }
 
 void ShareManager::refresh(bool dirs, bool aUpdate, bool block, function<void (float)> progressF) noexcept {
@@ -940,16 +946,17 @@ void ShareManager::runRefresh(function<void (float)> progressF) {
 	refreshing.clear();
 }
 
-void ShareManager::getBloom(ByteVector& v, size_t k, size_t m, size_t h) const {
-	dcdebug("Creating bloom filter, k=%u, m=%u, h=%u\n", k, m, h);
+void ShareManager::getBloom(ByteVector& v, size_t k, size_t m, size_t h) {
 	Lock l(cs);
 
-	HashBloom bloom;
-	bloom.reset(k, m, h);
-	for(auto& i: tthIndex) {
-		bloom.add(i.first);
+	if(tthBloom.get_k() != k || tthBloom.get_m() != m || tthBloom.get_h() != h) {
+		dcdebug("Creating bloom filter, k=%u, m=%u, h=%u\n", k, m, h);
+		tthBloom.reset(k, m, h);
+		for(auto& i: tthIndex) {
+			tthBloom.add(i.first);
+		}
 	}
-	bloom.copy_to(v);
+	tthBloom.copy_to(v);
 }
 
 void ShareManager::generateXmlList() {
@@ -1125,7 +1132,7 @@ void ShareManager::Directory::filesToXml(OutputStream& xmlFile, string& indent,
 }
 
 ShareManager::SearchQuery::SearchQuery() :
-	include(&includeInit),
+	satisfied(0),
 	gt(0),
 	lt(numeric_limits<int64_t>::max()),
 	isDirectory(false)
@@ -1138,6 +1145,9 @@ namespace {
 ShareManager::SearchQuery::SearchQuery(const StringList& adcParams) :
 	SearchQuery()
 {
+	// the automatons are built once all the terms are known
+	StringList includeTerms, excludeTerms;
+
 	for(auto& p: adcParams) {
 		if(p.size() <= 2)
 			continue;
@@ -1145,11 +1155,11 @@ ShareManager::SearchQuery::SearchQuery(const StringList& adcParams) :
 		auto cmd = toCode(p[0], p[1]);
 		if(toCode('T', 'R') == cmd) {
 			root = TTHValue(p.substr(2));
-			return;
+			break;
 		} else if(toCode('A', 'N') == cmd) {
-			includeInit.emplace_back(p.substr(2));
+			includeTerms.push_back(p.substr(2));
 		} else if(toCode('N', 'O') == cmd) {
-			exclude.emplace_back(p.substr(2));
+			excludeTerms.push_back(p.substr(2));
 		} else if(toCode('E', 'X') == cmd) {
 			ext.push_back(Text::toLower(p.substr(2)));
 		} else if(toCode('G', 'R') == cmd) {
@@ -1167,6 +1177,9 @@ ShareManager::SearchQuery::SearchQuery(const StringList& adcParams) :
 			isDirectory = p[2] == '2';
 		}
 	}
+
+	include.assign(includeTerms.begin(), includeTerms.end());
+	exclude.assign(excludeTerms.begin(), excludeTerms.end());
 }
 
 ShareManager::SearchQuery::SearchQuery(const string& nmdcString, int searchType, int64_t size, int fileType) :
@@ -1177,11 +1190,9 @@ ShareManager::SearchQuery::SearchQuery(const string& nmdcString, int searchType,
 
 	} else {
 		StringTokenizer<string> tok(Text::toLower(nmdcString), '$');
-		for(auto& term: tok.getTokens()) {
-			if(!term.empty()) {
-				includeInit.emplace_back(term);
-			}
-		}
+		auto& terms = tok.getTokens();
+		terms.erase(std::remove(terms.begin(), terms.end(), Util::emptyString), terms.end());
+		include.assign(terms.begin(), terms.end());
 
 		if(searchType == SearchManager::SIZE_ATLEAST) {
 			gt = size;
@@ -1202,11 +1213,7 @@ ShareManager::SearchQuery::SearchQuery(const string& nmdcString, int searchType,
 }
 
 bool ShareManager::SearchQuery::isExcluded(const string& str) {
-	for(auto& i: exclude) {
-		if(i.match(str))
-			return true;
-	}
-	return false;
+	return exclude.matchAny(str);
 }
 
 bool ShareManager::SearchQuery::hasExt(const string& name) {
@@ -1222,34 +1229,23 @@ bool ShareManager::SearchQuery::hasExt(const string& name) {
 
 /**
  * Alright, the main point here is that when searching, a search string is most often found in
- * the filename, not directory name, so we want to make that case faster. Also, we want to
- * avoid changing StringLists unless we absolutely have to --> this should only be done if a string
- * has been matched in the directory name. This new stringlist should also be used in all descendants,
- * but not the parents...
+ * the filename, not directory name, so we want to make that case faster. Terms matched in the
+ * directory name are marked as satisfied for all descendants, but not the parents...
  */
 void ShareManager::Directory::search(SearchResultList& results, SearchQuery& query, size_t maxResults) const noexcept {
 	if(query.isExcluded(name))
 		return;
 
-	// Find any matches in the directory name and removed matched terms from the query.
-	unique_ptr<StringSearch::List> newTerms;
-
-	for(auto& term: *query.include) {
-		if(term.match(name)) {
-			if(!newTerms) {
-				newTerms.reset(new StringSearch::List(*query.include));
-			}
-			newTerms->erase(remove(newTerms->begin(), newTerms->end(), term), newTerms->end());
-		}
+	// Find any matches in the directory name; files below don't need to contain these terms.
+	auto const old = query.satisfied;
+	ScopedFunctor(([old, &query] { query.satisfied = old; }));
+	if((query.satisfied & query.include.getAll()) != query.include.getAll()) {
+		query.satisfied |= query.include.match(name);
 	}
 
-	auto const old = query.include;
-	ScopedFunctor(([old, &query] { query.include = old; }));
-	if(newTerms) {
-		query.include = newTerms.get();
-	}
-
-	if(query.include->empty() && query.ext.empty() && query.gt == 0) {
+	if(query.include.size() <= StringSearch::List::MASK_BITS && query.satisfied == query.include.getAll() &&
+		query.ext.empty() && query.gt == 0)
+	{
 		// We satisfied all the search words! Add the directory...
 		/// @todo send the directory hash when we have one
 		results.push_back(new SearchResult(SearchResult::TYPE_DIRECTORY, getSize(), getFullName(), TTHValue(string(39, 'A'))));
@@ -1271,10 +1267,7 @@ void ShareManager::Directory::search(SearchResultList& results, SearchQuery& que
 				continue;
 
 			// check if the name matches
-			auto j = query.include->begin();
-			for(; j != query.include->end() && j->match(i.getName()); ++j)
-				;	// Empty
-			if(j != query.include->end())
+			if(!query.include.matchAll(i.getName(), query.satisfied))
 				continue;
 
 			// check extensions
@@ -1297,6 +1290,11 @@ void ShareManager::Directory::search(SearchResultList& results, SearchQuery& que
 }
 
 SearchResultList ShareManager::search(SearchQuery&& query, size_t maxResults) noexcept {
+	static auto& searches = Metrics::counter("share.searches");
+	static auto& searchTime = Metrics::histogram("share.search_us");
+	searches.add();
+	ScopedTimer timer(searchTime);
+
 	SearchResultList results;
 
 	Lock l(cs);
@@ -1311,7 +1309,7 @@ SearchResultList ShareManager::search(SearchQuery&& query, size_t maxResults) no
 		return results;
 	}
 
-	for(auto& i: query.includeInit) {
+	for(auto& i: query.include) {
 		if(!bloom.match(i.getPattern()))
 			return results;
 	}
@@ -1454,10 +1452,14 @@ void ShareManager::on(HashManagerListener::TTHDone, const string& realPath, cons
 	Lock l(cs);
 	auto f = getFile(realPath);
 	if(f) {
-		if(f->tth && root != f->tth)
+		if(f->tth && root != f->tth) {
 			tthIndex.erase(*f->tth);
+			// the old value can't be taken out of the bloom; build it again on the next request
+			tthBloom.reset(0, 0, 0);
+		}
 		const_cast<Directory::File&>(*f).tth = root;
 		tthIndex[*f->tth] = &f.get();
+		tthBloom.add(root);
 
 		setDirty();
 		forceXmlRefresh = true;
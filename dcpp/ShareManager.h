@@ -39,6 +39,7 @@
 #include "StringSearch.h"
 #include "Singleton.h"
 #include "BloomFilter.h"
+#include "HashBloom.h"
 #include "FastAlloc.h"
 #include "MerkleTree.h"
 #include "Pointer.h"
@@ -105,7 +106,7 @@ public:
 	string getShareSizeString() const { return std::to_string(getShareSize()); }
 	string getShareSizeString(const string& aDir) const { return std::to_string(getShareSize(aDir)); }
 
-	void getBloom(ByteVector& v, size_t k, size_t m, size_t h) const;
+	void getBloom(ByteVector& v, size_t k, size_t m, size_t h);
 
 	SearchManager::TypeModes getType(const string& fileName) const noexcept;
 
@@ -231,8 +232,11 @@ private:
 		bool isExcluded(const string& str);
 		bool hasExt(const string& name);
 
-		StringSearch::List* include;
-		StringSearch::List includeInit;
+		StringSearch::List include;
+		/** Terms found in the names of the directories being searched, which files in them
+		don't need to contain anymore. Only the first 64 terms have a bit: files have to contain
+		the others themselves, and with more terms directories aren't returned at all. */
+		StringSearch::List::Mask satisfied;
 		StringSearch::List exclude;
 		StringList ext;
 		StringList noExt;
@@ -275,6 +279,9 @@ private:
 	unordered_map<TTHValue, const Directory::File*> tthIndex;
 
 	BloomFilter<5> bloom;
+	/** The last TTH bloom handed out, kept up to date as files are indexed so that requests with
+	the same parameters don't go over the whole index again. */
+	HashBloom tthBloom;
 
 	std::list<StringMatch> cachedFilterSkiplistRegEx;
 	std::list<StringMatch> cachedFilterSkiplistFileExtensions;
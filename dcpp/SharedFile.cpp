@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stdinc.h"
+#include "SharedFile.h"
+
+#include "format.h"
+
+namespace dcpp {
+
+bool SharedFile::open(const string& aPath, int64_t aSize, File::Allocation allocation, bool resume) {
+	Lock l(cs);
+
+	if(file) {
+		return aPath == path;
+	}
+
+	if(resume) {
+		if(File::getSize(aPath) != aSize) {
+			// When trying the download the next time, the resume pos will be reset
+			throw Exception(_("Target file is missing or wrong size"));
+		}
+	} else {
+		File::ensureDirectory(aPath);
+	}
+
+	unique_ptr<File> f(new File(aPath, File::WRITE, File::OPEN | File::CREATE | File::SHARED));
+
+	if(f->getSize() != aSize) {
+		f->setSize(aSize, allocation);
+	}
+
+	file = move(f);
+	path = aPath;
+	return true;
+}
+
+} // namespace dcpp
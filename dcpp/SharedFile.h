@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_SHARED_FILE_H
+#define DCPLUSPLUS_DCPP_SHARED_FILE_H
+
+#include <memory>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "CriticalSection.h"
+#include "File.h"
+#include "Streams.h"
+
+namespace dcpp {
+
+using std::shared_ptr;
+using std::unique_ptr;
+
+/** The target of a download, opened once for all the segments of the file being downloaded at
+the same time. Each segment writes at its own position; the file is closed when the last of
+them lets go of it. */
+class SharedFile : boost::noncopyable
+{
+public:
+	SharedFile() { }
+
+	/** Open the file unless another segment already has, making sure it has its full size.
+	@param allocation How to reserve the space of the file when it is created
+	@param resume Whether the segment starts after the beginning of the file, which must then
+	already be there
+	@return false when the file is open under another path */
+	bool open(const string& aPath, int64_t aSize, File::Allocation allocation, bool resume);
+
+	size_t writeAt(const void* buf, size_t len, int64_t pos) { return file->writeAt(buf, len, pos); }
+	size_t flush() { return file->flush(); }
+
+	const string& getPath() const { return path; }
+
+private:
+	unique_ptr<File> file;
+	string path;
+
+	CriticalSection cs;
+};
+
+/** Writes a segment to a shared file, starting at the position given. */
+class SharedFileStream : public OutputStream
+{
+public:
+	SharedFileStream(const shared_ptr<SharedFile>& aFile, int64_t aPos) : file(aFile), pos(aPos) { }
+
+	virtual size_t write(const void* buf, size_t len) {
+		file->writeAt(buf, len, pos);
+		pos += len;
+		return len;
+	}
+
+	virtual size_t flush() { return file->flush(); }
+
+private:
+	shared_ptr<SharedFile> file;
+	int64_t pos;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_SHARED_FILE_H)
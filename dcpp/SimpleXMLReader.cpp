@@ -23,8 +23,16 @@
 #include "Text.h"
 #include "Streams.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DCPP_XML_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace dcpp {
 
+using std::min;
+using std::string_view;
+
 static bool isSpace(int c) {
 	return c == 0x20 || c == 0x09 || c == 0x0d || c == 0x0a;
 }
@@ -66,8 +74,57 @@ static bool isNameChar(int c) {
 		;
 }
 
+/** Offset of the first a or b in [p, p + len), or len if there is none. Most of the input goes
+through here, so where SSE2 is available, 16 characters are checked at once. */
+static size_t findEither(const char* p, size_t len, char a, char b) {
+	size_t i = 0;
+
+#ifdef DCPP_XML_SSE2
+	const auto va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b);
+	for(; i + 16 <= len; i += 16) {
+		auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+		if(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)))) {
+			break;
+		}
+	}
+#endif
+
+	for(; i < len && p[i] != a && p[i] != b; ++i) { }
+	return i;
+}
+
+/** The character an entity reference accepted by entityLength stands for; 0 for the numeric
+ones, which are ignored. */
+static char entityChar(const char* p) {
+	switch(p[1]) {
+	case 'l': return '<';
+	case 'g': return '>';
+	case 'a': return p[2] == 'm' ? '&' : '\'';
+	case 'q': return '"';
+	default: return 0;
+	}
+}
+
+/** Replace the entity references of a value that has been gone over by entityLength already. */
+static void unescape(const char* p, size_t len, string& out) {
+	size_t i = 0;
+	while(i < len) {
+		auto j = i + findEither(p + i, len - i, '&', '&');
+		out.append(p + i, j - i);
+		if(j == len) {
+			break;
+		}
+
+		auto c = entityChar(p + j);
+		if(c) {
+			out += c;
+		}
+		i = static_cast<const char*>(memchr(p + j, ';', len - j)) - p + 1;
+	}
+}
+
 SimpleXMLReader::SimpleXMLReader(SimpleXMLReader::CallBack* callback, int aFlags) :
-	bufPos(0), pos(0), cb(callback), state(STATE_START), flags(aFlags)
+	bufPos(0), pos(0), tagStart(0), cb(callback), state(STATE_START), flags(aFlags)
 {
 	elements.reserve(64);
 	attribs.reserve(16);
@@ -114,6 +171,29 @@ const string& SimpleXMLReader::CallBack::getAttrib(StringPairList& attribs, cons
 	}
 }
 
+string_view SimpleXMLReader::CallBack::getAttrib(const AttribViewList& attribs, string_view name, size_t hint) {
+	hint = min(hint, attribs.size());
+
+	auto isName = [name](const AttribView& a) { return a.first == name; };
+	auto i = find_if(attribs.begin() + hint, attribs.end(), isName);
+	if(i == attribs.end()) {
+		i = find_if(attribs.begin(), attribs.begin() + hint, isName);
+		return ((i == (attribs.begin() + hint)) ? string_view() : i->second);
+	} else {
+		return i->second;
+	}
+}
+
+void SimpleXMLReader::CallBack::startTag(string_view name, const AttribViewList& attribs, bool simple) {
+	nameCopy.assign(name);
+	attribCopies.resize(attribs.size());
+	for(size_t i = 0; i < attribs.size(); ++i) {
+		attribCopies[i].first.assign(attribs[i].first);
+		attribCopies[i].second.assign(attribs[i].second);
+	}
+	startTag(nameCopy, attribCopies, simple);
+}
+
 bool SimpleXMLReader::literal(const char* lit, size_t len, bool withSpace, ParseState newState) {
 	string::size_type n = 0, nend = bufSize();
 	for(; n < nend && n < len; ++n) {
@@ -154,6 +234,7 @@ bool SimpleXMLReader::element() {
 		elements.emplace_back();
 		append(elements.back(), MAX_NAME_SIZE, c);
 
+		tagStart = bufPos;
 		advancePos(2);
 
 		return true;
@@ -182,8 +263,7 @@ bool SimpleXMLReader::elementName() {
 		} else if(c == '>') {
 			append(elements.back(), MAX_NAME_SIZE, buf.begin() + bufPos, buf.begin() + bufPos + i);
 
-			cb->startTag(elements.back(), attribs, false);
-			attribs.clear();
+			startTag(false);
 
 			state = STATE_CONTENT;
 			advancePos(i + 1);
@@ -206,8 +286,8 @@ bool SimpleXMLReader::elementAttr() {
 
 	int c = charAt(0);
 	if(isNameStartChar(c)) {
-		attribs.emplace_back();
-		append(attribs.back().first, MAX_NAME_SIZE, c);
+		Attrib a = { bufPos - tagStart, 1, 0, 0, false, false };
+		attribs.push_back(a);
 
 		state = STATE_ELEMENT_ATTR_NAME;
 		advancePos(1);
@@ -219,20 +299,19 @@ bool SimpleXMLReader::elementAttr() {
 }
 
 bool SimpleXMLReader::elementAttrName() {
+	auto& a = attribs.back();
+
 	size_t i = 0;
 	for(size_t iend = bufSize(); i < iend; ++i) {
 		int c = charAt(i);
 
-		if(isSpace(c)) {
-			append(attribs.back().first, MAX_NAME_SIZE, buf.begin() + bufPos, buf.begin() + bufPos + i);
-
-			state = STATE_ELEMENT_ATTR_EQ;
-			advancePos(i + 1);
-			return true;
-		} else if(c == '=') {
-			append(attribs.back().first, MAX_NAME_SIZE, buf.begin() + bufPos, buf.begin() + bufPos + i);
+		if(isSpace(c) || c == '=') {
+			a.nameLen = bufPos + i - tagStart - a.name;
+			if(a.nameLen > MAX_NAME_SIZE) {
+				error("Buffer overflow");
+			}
 
-			state = STATE_ELEMENT_ATTR_VALUE;
+			state = c == '=' ? STATE_ELEMENT_ATTR_VALUE : STATE_ELEMENT_ATTR_EQ;
 			advancePos(i + 1);
 			return true;
 		} else if(!isNameChar(c)) {
@@ -240,46 +319,117 @@ bool SimpleXMLReader::elementAttrName() {
 		}
 	}
 
-	append(attribs.back().first, MAX_NAME_SIZE, buf.begin() + bufPos, buf.begin() + bufPos + i);
 	advancePos(i);
+	if(bufPos - tagStart - a.name > MAX_NAME_SIZE) {
+		error("Buffer overflow");
+	}
 	return true;
 }
 
+bool SimpleXMLReader::elementAttrValueStart() {
+	if(!needChars(1)) {
+		return true;
+	}
+
+	int c = charAt(0);
+	if(c == '"' || c == '\'') {
+		state = c == '"' ? STATE_ELEMENT_ATTR_VALUE_QUOT : STATE_ELEMENT_ATTR_VALUE_APOS;
+		advancePos(1);
+		attribs.back().value = bufPos - tagStart;
+		return true;
+	}
+
+	return false;
+}
+
 bool SimpleXMLReader::elementAttrValue() {
-	size_t i = 0;
-	for(size_t iend = bufSize(); i < iend; ++i) {
-		int c = charAt(i);
+	const char quote = state == STATE_ELEMENT_ATTR_VALUE_QUOT ? '"' : '\'';
+	auto& a = attribs.back();
 
-		if((state == STATE_ELEMENT_ATTR_VALUE_APOS && c == '\'') || (state == STATE_ELEMENT_ATTR_VALUE_QUOT && c == '"')) {
-			append(attribs.back().second, MAX_VALUE_SIZE, buf.begin() + bufPos, buf.begin() + bufPos + i);
+	// the value stays where it is; entities are only checked here and replaced in startTag
+	size_t i = 0;
+	for(size_t iend = bufSize(); ; ) {
+		i += findEither(&buf[bufPos + i], iend - i, quote, '&');
+		if(i == iend) {
+			break;
+		}
 
-			decodeString(attribs.back().second);
+		if(charAt(i) == quote) {
+			a.valueLen = bufPos + i - tagStart - a.value;
+			if(a.valueLen > MAX_VALUE_SIZE) {
+				error("Buffer overflow");
+			}
 
 			state = STATE_ELEMENT_ATTR;
 			advancePos(i + 1);
 			return true;
-		} else if(c == '&') {
-			append(attribs.back().second, MAX_VALUE_SIZE, buf.begin() + bufPos, buf.begin() + bufPos + i);
-			advancePos(i);
-			return entref(attribs.back().second);
 		}
+
+		auto n = entityLength(i);
+		if(n == string::npos) {
+			break;
+		}
+		if(n == 0) {
+			return false;
+		}
+		a.escaped = true;
+		i += n;
 	}
 
-	append(attribs.back().second, MAX_VALUE_SIZE, buf.begin() + bufPos, buf.begin() + bufPos + i);
 	advancePos(i);
-
+	if(bufPos - tagStart - a.value > MAX_VALUE_SIZE) {
+		error("Buffer overflow");
+	}
 	return true;
 }
 
+void SimpleXMLReader::startTag(bool simple) {
+	const char* tag = buf.data() + tagStart;
+
+	// values that can't be passed as they are go to the decoded buffer first, since it may move
+	// while it grows
+	auto isUtf8 = encoding.empty() || compare(encoding, Text::utf8) == 0;
+	decoded.clear();
+	for(auto& a: attribs) {
+		if(a.escaped || !isUtf8 || !Text::validateUtf8(tag + a.value, a.valueLen)) {
+			string v;
+			if(a.escaped) {
+				unescape(tag + a.value, a.valueLen, v);
+			} else {
+				v.assign(tag + a.value, a.valueLen);
+			}
+			decodeString(v);
+
+			a.value = decoded.size();
+			a.valueLen = v.size();
+			a.decoded = true;
+			decoded += v;
+		}
+	}
+
+	for(auto& a: attribs) {
+		attribViews.emplace_back(string_view(tag + a.name, a.nameLen),
+			string_view((a.decoded ? decoded.data() : tag) + a.value, a.valueLen));
+	}
+
+	cb->startTag(string_view(elements.back()), attribViews, simple);
+
+	attribs.clear();
+	attribViews.clear();
+}
+
+bool SimpleXMLReader::inStartTag() const {
+	return state >= STATE_ELEMENT_NAME && state <= STATE_ELEMENT_END_SIMPLE;
+}
+
 bool SimpleXMLReader::elementEndSimple() {
 	if(!needChars(1)) {
 		return true;
 	}
 
 	if(charAt(0) == '>') {
-		cb->startTag(elements.back(), attribs, true);
+		startTag(true);
 		elements.pop_back();
-		attribs.clear();
 
 		state = STATE_CONTENT;
 		advancePos(1);
@@ -295,8 +445,7 @@ bool SimpleXMLReader::elementEndComplex() {
 	}
 
 	if(charAt(0) == '>') {
-		cb->startTag(elements.back(), attribs, false);
-		attribs.clear();
+		startTag(false);
 
 		state = STATE_CONTENT;
 		advancePos(1);
@@ -377,18 +526,19 @@ bool SimpleXMLReader::declEncodingValue() {
 
 bool SimpleXMLReader::comment() {
 	while(bufSize() > 0) {
-		int c = charAt(0);
+		advancePos(findEither(&buf[bufPos], bufSize(), '-', '-'));
+		if(bufSize() == 0) {
+			break;
+		}
 
 		// TODO We shouldn't allow ---> to end a comment
-		if(c == '-') {
-			if(!needChars(3)) {
-				return true;
-			}
-			if(charAt(1) == '-' && charAt(2) == '>') {
-				state = STATE_CONTENT;
-				advancePos(3);
-				return true;
-			}
+		if(!needChars(3)) {
+			return true;
+		}
+		if(charAt(1) == '-' && charAt(2) == '>') {
+			state = STATE_CONTENT;
+			advancePos(3);
+			return true;
 		}
 
 		advancePos(1);
@@ -399,20 +549,23 @@ bool SimpleXMLReader::comment() {
 
 bool SimpleXMLReader::cdata() {
 	while(bufSize() > 0) {
-		int c = charAt(0);
+		auto n = findEither(&buf[bufPos], bufSize(), ']', ']');
+		append(value, MAX_VALUE_SIZE, buf.begin() + bufPos, buf.begin() + bufPos + n);
+		advancePos(n);
+		if(bufSize() == 0) {
+			break;
+		}
 
-		if(c == ']') {
-			if(!needChars(3)) {
-				return true;
-			}
-			if(charAt(1) == ']' && charAt(2) == '>') {
-				state = STATE_CONTENT;
-				advancePos(3);
-				return true;
-			}
+		if(!needChars(3)) {
+			return true;
+		}
+		if(charAt(1) == ']' && charAt(2) == '>') {
+			state = STATE_CONTENT;
+			advancePos(3);
+			return true;
 		}
 
-		append(value, MAX_VALUE_SIZE, c);
+		append(value, MAX_VALUE_SIZE, ']');
 		advancePos(1);
 	}
 
@@ -429,63 +582,53 @@ bool SimpleXMLReader::entref(string& d) {
 	//	}
 	}
 
-	if(bufSize() > 6) {
-		if(charAt(1) == 'l' && charAt(2) == 't' && charAt(3) == ';') {
-			d.append(1, '<');
-			advancePos(4);
-			return true;
-		} else if(charAt(1) == 'g' && charAt(2) == 't' && charAt(3) == ';') {
-			d.append(1, '>');
-			advancePos(4);
-			return true;
-		} else if(charAt(1) == 'a' && charAt(2) == 'm' && charAt(3) == 'p' && charAt(4) == ';') {
-			d.append(1, '&');
-			advancePos(5);
-			return true;
-		} else if(charAt(1) == 'q' && charAt(2) == 'u' && charAt(3) == 'o' && charAt(4) == 't' && charAt(5) == ';') {
-			d.append(1, '"');
-			advancePos(6);
-			return true;
-		} else if(charAt(1) == 'a' && charAt(2) == 'p' && charAt(3) == 'o' && charAt(4) == 's' && charAt(5) == ';') {
-			d.append(1, '\'');
-			advancePos(6);
-			return true;
+	auto n = entityLength(0);
+	if(n == string::npos) {
+		return true;
+	}
+	if(n == 0) {
+		return false;
+	}
+
+	auto c = entityChar(&buf[bufPos]);
+	if(c) {
+		d.append(1, c);
+	}
+	advancePos(n);
+	return true;
+}
+
+/** Length of the entity reference at n, 0 if it isn't a valid one, or string::npos if more data is
+needed to tell. */
+size_t SimpleXMLReader::entityLength(size_t n) const {
+	if(bufSize() - n <= 6) {
+		return string::npos;
+	}
 
+	auto c = [this, n](size_t i) { return charAt(n + i); };
+
+	if(c(1) == 'l' && c(2) == 't' && c(3) == ';') {
+		return 4;
+	} else if(c(1) == 'g' && c(2) == 't' && c(3) == ';') {
+		return 4;
+	} else if(c(1) == 'a' && c(2) == 'm' && c(3) == 'p' && c(4) == ';') {
+		return 5;
+	} else if(c(1) == 'q' && c(2) == 'u' && c(3) == 'o' && c(4) == 't' && c(5) == ';') {
+		return 6;
+	} else if(c(1) == 'a' && c(2) == 'p' && c(3) == 'o' && c(4) == 's' && c(5) == ';') {
+		return 6;
+	} else if(c(1) == '#') {
 		// Ignore &#00000 decimal and &#x0000 hex values to avoid error, they wouldn't be parsed anyway
-		} else if(charAt(1) == '#' && isdigit(charAt(2)) && charAt(3) == ';') {
-			advancePos(4);
-			return true;
-		} else if(charAt(1) == '#' && isdigit(charAt(2)) && isdigit(charAt(3)) && charAt(4) == ';') {
-			advancePos(5);
-			return true;
-		} else if(charAt(1) == '#' && isdigit(charAt(2)) && isdigit(charAt(3)) && isdigit(charAt(4)) && charAt(5) == ';') {
-			advancePos(6);
-			return true;
-		} else if(charAt(1) == '#' && isdigit(charAt(2)) && isdigit(charAt(3)) && isdigit(charAt(4)) && isdigit(charAt(5)) && charAt(6) == ';') {
-			advancePos(7);
-			return true;
-		} else if(charAt(1) == '#' && isdigit(charAt(2)) && isdigit(charAt(3)) && isdigit(charAt(4)) && isdigit(charAt(5)) && isdigit(charAt(6)) && charAt(7) == ';') {
-			advancePos(8);
-			return true;
-			
-		} else if(charAt(1) == '#' && (charAt(2) == 'x' ||  charAt(2) == 'X') && isxdigit(charAt(3)) && charAt(4) == ';') {
-			advancePos(5);
-			return true;
-		} else if(charAt(1) == '#' && (charAt(2) == 'x' ||  charAt(2) == 'X') && isxdigit(charAt(3)) && isxdigit(charAt(4)) && charAt(5) == ';') {
-			advancePos(6);
-			return true;
-		} else if(charAt(1) == '#' && (charAt(2) == 'x' ||  charAt(2) == 'X') && isxdigit(charAt(3)) && isxdigit(charAt(4)) && isxdigit(charAt(5)) && charAt(6) == ';') {
-			advancePos(7);
-			return true;
-		} else if(charAt(1) == '#' && (charAt(2) == 'x' ||  charAt(2) == 'X') && isxdigit(charAt(3)) && isxdigit(charAt(4)) && isxdigit(charAt(5)) && isxdigit(charAt(6)) && charAt(7) == ';') {
-			advancePos(8);
-			return true;
+		const bool hex = c(2) == 'x' || c(2) == 'X';
+		const size_t first = hex ? 3 : 2, end = first + (hex ? 4 : 5);
+		size_t i = first;
+		for(; i < end && (hex ? isxdigit(static_cast<uint8_t>(c(i))) : isdigit(static_cast<uint8_t>(c(i)))); ++i) { }
+		if(i > first && c(i) == ';') {
+			return i + 1;
 		}
-	} else {
-		return true;
 	}
 
-	return false;
+	return 0;
 }
 
 bool SimpleXMLReader::content() {
@@ -493,16 +636,17 @@ bool SimpleXMLReader::content() {
 		return true;
 	}
 
-	int c = charAt(0);
-
-	if(c == '&') {
+	if(charAt(0) == '&') {
 		return entref(value);
 	}
 
-	append(value, MAX_VALUE_SIZE, c); // todo: patch
-	//append(value, flags & FLAG_SAFE_SOURCE ? MAX_VALUE_SIZE_SAFE : MAX_VALUE_SIZE, c);
+	// take everything up to the next markup or entity; the first character goes in even if it is
+	// a '<', since it would have been taken for markup already otherwise
+	auto n = 1 + findEither(&buf[bufPos + 1], bufSize() - 1, '<', '&');
+	append(value, MAX_VALUE_SIZE, buf.begin() + bufPos, buf.begin() + bufPos + n); // todo: patch
+	//append(value, flags & FLAG_SAFE_SOURCE ? MAX_VALUE_SIZE_SAFE : MAX_VALUE_SIZE, ...);
 
-	advancePos(1);
+	advancePos(n);
 
 	return true;
 }
@@ -547,17 +691,15 @@ bool SimpleXMLReader::skipSpace(bool store) {
 	if(!needChars(1)) {
 		return true;
 	}
-	bool skipped = false;
-	int c;
-	while(needChars(1) && isSpace(c = charAt(0))) {
-		if(store) {
-			append(value, MAX_VALUE_SIZE, c);
-		}
-		advancePos();
-		skipped = true;
+	size_t n = 0;
+	for(size_t nend = bufSize(); n < nend && isSpace(charAt(n)); ++n) { }
+
+	if(store) {
+		append(value, MAX_VALUE_SIZE, buf.begin() + bufPos, buf.begin() + bufPos + n);
 	}
+	advancePos(n);
 
-	return skipped;
+	return n > 0;
 }
 
 bool SimpleXMLReader::needChars(size_t n) const {
@@ -570,8 +712,9 @@ void SimpleXMLReader::parse(InputStream& stream, size_t maxSize) {
 	const size_t BUF_SIZE = 64*1024;
 	size_t bytesRead = 0;
 	do {
+		// a tag being read is kept whole in the buffer, so it may already be well filled
 		size_t old = buf.size();
-		buf.resize(BUF_SIZE);
+		buf.resize(old + BUF_SIZE);
 
 		size_t n = buf.size() - old;
 		size_t len = stream.read(&buf[old], n);
@@ -702,8 +845,7 @@ bool SimpleXMLReader::process() {
 			|| spaceOrError("Expecting attribute =");
 			break;
 		case STATE_ELEMENT_ATTR_VALUE:
-			character('\'', STATE_ELEMENT_ATTR_VALUE_APOS)
-			|| character('"', STATE_ELEMENT_ATTR_VALUE_QUOT)
+			elementAttrValueStart()
 			|| spaceOrError("Expecting attribute value start");
 			break;
 		case STATE_ELEMENT_ATTR_VALUE_APOS:
@@ -738,8 +880,11 @@ bool SimpleXMLReader::process() {
 		if(oldState == state && oldPos == bufPos) {
 			// Need more data...
 			if(bufPos > 0) {
-				buf.erase(buf.begin(), buf.begin() + bufPos);
-				bufPos = 0;
+				// the attributes of a tag being read point into it, keep it
+				auto keep = inStartTag() ? tagStart : bufPos;
+				buf.erase(buf.begin(), buf.begin() + keep);
+				bufPos -= keep;
+				tagStart -= min(tagStart, keep);
 			}
 			return true;
 		}
@@ -20,6 +20,8 @@
 
 #include "typedefs.h"
 
+#include <string_view>
+
 #include <boost/core/noncopyable.hpp>
 
 namespace dcpp {
@@ -27,6 +29,9 @@ namespace dcpp {
 class SimpleXMLReader {
 public:
 	struct CallBack : private boost::noncopyable {
+		typedef std::pair<std::string_view, std::string_view> AttribView;
+		typedef std::vector<AttribView> AttribViewList;
+
 		virtual ~CallBack() { }
 
 		/** A new XML tag has been encountered.
@@ -36,6 +41,13 @@ public:
 		@param simple Whether this tag is void of any data (<example/>). */
 		virtual void startTag(const std::string& name, StringPairList& attribs, bool simple) { }
 
+		/** Same as above, without copying anything: names and values point into the buffer of the
+		reader, or for values that had entities or had to be converted, into storage of the reader.
+		They are only valid until this returns.
+		The default implementation copies them and calls the version above; override this one
+		instead where tags come by the thousand, such as file lists. */
+		virtual void startTag(std::string_view name, const AttribViewList& attribs, bool simple);
+
 		/** Contents of an XML tag have been read.
 		@param data Contents of the tag.
 		@note This may be called several times per tag with partial contents in mixed content
@@ -49,6 +61,11 @@ public:
 
 	protected:
 		static const std::string& getAttrib(StringPairList& attribs, const std::string& name, size_t hint);
+		static std::string_view getAttrib(const AttribViewList& attribs, std::string_view name, size_t hint);
+
+	private:
+		std::string nameCopy;
+		StringPairList attribCopies;
 	};
 
 	enum Flags {
@@ -151,11 +168,30 @@ private:
 	};
 
 
+	/** Where the name and the value of an attribute are, relative to the start of the tag, which
+	stays in the buffer until the whole tag has been read. */
+	struct Attrib {
+		size_t name;
+		size_t nameLen;
+		size_t value;
+		size_t valueLen;
+		/// The value has entity references
+		bool escaped;
+		/// The value has been moved to the decoded buffer
+		bool decoded;
+	};
+
 	std::string buf;
 	std::string::size_type bufPos;
 	uint64_t pos;
 
-	StringPairList attribs;
+	/// Offset in buf of the tag being read
+	std::string::size_type tagStart;
+	std::vector<Attrib> attribs;
+	CallBack::AttribViewList attribViews;
+	/// Values that couldn't be passed straight from the buffer
+	std::string decoded;
+
 	std::string value;
 
 	CallBack* cb;
@@ -188,7 +224,10 @@ private:
 	bool elementEndComplex();
 	bool elementAttr();
 	bool elementAttrName();
+	bool elementAttrValueStart();
 	bool elementAttrValue();
+	void startTag(bool simple);
+	bool inStartTag() const;
 
 	bool comment();
 	bool cdata();
@@ -196,6 +235,7 @@ private:
 	bool content();
 
 	bool entref(std::string& d);
+	size_t entityLength(size_t n) const;
 
 	bool process();
 	bool spaceOrError(const char* error);
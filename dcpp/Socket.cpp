@@ -19,6 +19,7 @@
 #include "Socket.h"
 
 #include "ConnectivityManager.h"
+#include "CriticalSection.h"
 #include "format.h"
 #include "SettingsManager.h"
 #include "TimerManager.h"
@@ -768,19 +769,165 @@ bool Socket::waitAccepted(uint32_t millis) {
 	return true;
 }
 
-string Socket::resolve(const string& aDns, int af) noexcept {
+namespace {
+
+/** Host name lookups shared by all sockets. Answers, including failed ones, are kept for a while
+so that reconnects and repeated search replies don't go through the system resolver again. */
+class DNSCache {
+public:
+	/** @return Whether an answer is known; err is set when the lookup failed. */
+	bool find(const string& name, int af, StringList& ips, int& err) {
+		Lock l(cs);
+		auto i = entries.find(make_pair(name, af));
+		if(i == entries.end())
+			return false;
+
+		if(i->second.expires < GET_TICK()) {
+			entries.erase(i);
+			return false;
+		}
+
+		ips = i->second.ips;
+		err = i->second.err;
+		return true;
+	}
+
+	void add(const string& name, int af, StringList&& ips, int err) {
+		auto now = GET_TICK();
+
+		Lock l(cs);
+		if(entries.size() >= MAX_ENTRIES) {
+			prune(now);
+		}
+
+		auto& entry = entries[make_pair(name, af)];
+		entry.ips = move(ips);
+		entry.err = err;
+		entry.expires = now + (err ? NEGATIVE_TTL : POSITIVE_TTL);
+	}
+
+private:
+	static const size_t MAX_ENTRIES = 512;
+	static const uint64_t POSITIVE_TTL = 10 * 60 * 1000;
+	static const uint64_t NEGATIVE_TTL = 60 * 1000;
+
+	struct Entry {
+		StringList ips;
+		int err;
+		uint64_t expires;
+	};
+
+	/** Remove expired entries; if none are, drop the one closest to expiring. */
+	void prune(uint64_t now) {
+		auto oldest = entries.end();
+		for(auto i = entries.begin(); i != entries.end();) {
+			if(i->second.expires < now) {
+				i = entries.erase(i);
+			} else {
+				if(oldest == entries.end() || i->second.expires < oldest->second.expires)
+					oldest = i;
+				++i;
+			}
+		}
+
+		if(entries.size() >= MAX_ENTRIES && oldest != entries.end()) {
+			entries.erase(oldest);
+		}
+	}
+
+	std::map<pair<string, int>, Entry> entries;
+	CriticalSection cs;
+} dnsCache;
+
+void freeAddrInfo(addrinfo* ai) {
+	::freeaddrinfo(ai);
+}
+
+/** Deleter for lists assembled out of several getaddrinfo results, each one a single node. */
+void freeAddrInfoList(addrinfo* ai) {
+	while(ai) {
+		auto next = ai->ai_next;
+		ai->ai_next = nullptr;
+		::freeaddrinfo(ai);
+		ai = next;
+	}
+}
+
+/** Resolve a numeric address (no network access involved). */
+addrinfo* numericAddr(const string& name, const char* port, const addrinfo& hints) {
+	addrinfo numericHints = hints;
+	numericHints.ai_flags |= AI_NUMERICHOST;
+
+	addrinfo* result = 0;
+	if(::getaddrinfo(name.c_str(), port, &numericHints, &result)) {
+		return 0;
+	}
+	return result;
+}
+
+} // namespace
+
+StringList Socket::resolveNames(const addrinfo* ai) {
+	StringList ret;
+	for(; ai; ai = ai->ai_next) {
+		try {
+			auto ip = resolveName(ai->ai_addr, ai->ai_addrlen);
+			if(find(ret.begin(), ret.end(), ip) == ret.end()) {
+				ret.push_back(move(ip));
+			}
+		} catch(const SocketException&) { }
+	}
+	return ret;
+}
+
+bool Socket::resolveCached(const string& aDns, int af, string& aIp) noexcept {
 	addrinfo hints = { 0 };
 	hints.ai_family = af;
 
-	addrinfo *result = 0;
+	if(auto numeric = numericAddr(aDns, NULL, hints)) {
+		try { aIp = resolveName(numeric->ai_addr, numeric->ai_addrlen); }
+		catch(const SocketException&) { aIp.clear(); }
+
+		::freeaddrinfo(numeric);
+		return true;
+	}
+
+	StringList ips;
+	int err = 0;
+	if(!dnsCache.find(aDns, af, ips, err)) {
+		return false;
+	}
+
+	if(ips.empty()) {
+		aIp.clear();
+	} else {
+		aIp = ips.front();
+	}
+	return true;
+}
 
+string Socket::resolve(const string& aDns, int af) noexcept {
 	string ret;
+	if(resolveCached(aDns, af, ret)) {
+		return ret;
+	}
 
-	if(!::getaddrinfo(aDns.c_str(), NULL, &hints, &result)) {
-		try { ret = resolveName(result->ai_addr, result->ai_addrlen); }
-		catch(const SocketException&) { }
+	addrinfo hints = { 0 };
+	hints.ai_family = af;
+
+	addrinfo *result = 0;
+
+	auto err = ::getaddrinfo(aDns.c_str(), NULL, &hints, &result);
+	if(!err) {
+		auto ips = resolveNames(result);
+		if(!ips.empty()) {
+			ret = ips.front();
+		}
+		dnsCache.add(aDns, af, move(ips), 0);
 
 		::freeaddrinfo(result);
+	} else {
+		dnsCache.add(aDns, af, StringList(), err);
 	}
 
 	return ret;
@@ -793,17 +940,60 @@ Socket::addrinfo_p Socket::resolveAddr(const string& name, const string& port, i
 	hints.ai_socktype = type == TYPE_TCP ? SOCK_STREAM : SOCK_DGRAM;
 	hints.ai_protocol = type;
 
+	auto aiPort = port.empty() ? NULL : port.c_str();
+
+	// local addresses to bind to are not worth caching.
+	bool cache = !name.empty() && !(flags & AI_PASSIVE);
+
+	if(cache) {
+		if(auto numeric = numericAddr(name, aiPort, hints)) {
+			return addrinfo_p(numeric, &freeAddrInfo);
+		}
+
+		StringList ips;
+		int err = 0;
+		if(dnsCache.find(name, family, ips, err)) {
+			if(err) {
+				throw SocketException(err);
+			}
+
+			addrinfo* head = nullptr;
+			addrinfo** tail = &head;
+			for(auto& ip: ips) {
+				if(auto ai = numericAddr(ip, aiPort, hints)) {
+					if(ai->ai_next) {
+						::freeaddrinfo(ai->ai_next);
+						ai->ai_next = nullptr;
+					}
+					*tail = ai;
+					tail = &ai->ai_next;
+				}
+			}
+
+			if(head) {
+				return addrinfo_p(head, &freeAddrInfoList);
+			}
+		}
+	}
+
 	addrinfo *result = 0;
 
-	auto err = ::getaddrinfo(name.c_str(), port.empty() ? NULL : port.c_str(), &hints, &result);
+	auto err = ::getaddrinfo(name.c_str(), aiPort, &hints, &result);
 	if(err) {
+		if(cache) {
+			dnsCache.add(name, family, StringList(), err);
+		}
 		throw SocketException(err);
 	}
 
 	dcdebug("Resolved %s:%s to %s, next is %p\n", name.c_str(), port.c_str(),
 		resolveName(result->ai_addr, result->ai_addrlen).c_str(), result->ai_next);
 
-	return addrinfo_p(result, &freeaddrinfo);
+	if(cache) {
+		dnsCache.add(name, family, resolveNames(result), 0);
+	}
+
+	return addrinfo_p(result, &freeAddrInfo);
 }
 
 string Socket::resolveName(const sockaddr* sa, socklen_t sa_len, int flags) {
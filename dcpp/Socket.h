@@ -153,8 +153,11 @@ public:
 
 	virtual std::pair<bool, bool> wait(uint32_t millis, bool checkRead, bool checkWrite);
 
-	typedef std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> addrinfo_p;
+	typedef std::unique_ptr<addrinfo, void (*)(addrinfo*)> addrinfo_p;
 	static string resolve(const string& aDns, int af = AF_UNSPEC) noexcept;
+	/** Like resolve(), but only consults the DNS cache and thus never blocks.
+	@return Whether the answer is known; aIp is left empty when the name could not be resolved. */
+	static bool resolveCached(const string& aDns, int af, string& aIp) noexcept;
 	addrinfo_p resolveAddr(const string& name, const string& port, int family = AF_UNSPEC, int flags = 0);
 
 	static uint64_t getTotalDown() { return stats.totalDown; }
@@ -224,6 +227,7 @@ private:
 	// Low level interface
 	socket_t create(const addrinfo& ai);
 	static string resolveName(const sockaddr* sa, socklen_t sa_len, int flags = NI_NUMERICHOST);
+	static StringList resolveNames(const addrinfo* ai);
 };
 
 } // namespace dcpp
@@ -19,10 +19,12 @@
 #define DCPLUSPLUS_DCPP_SPEAKER_H
 
 #include <boost/range/algorithm/find.hpp>
+#include <atomic>
 #include <utility>
 #include <vector>
 
 #include "CriticalSection.h"
+#include "Thread.h"
 
 namespace dcpp {
 
@@ -30,44 +32,220 @@ using std::forward;
 using std::vector;
 using boost::range::find;
 
+/** Dispatches events to listeners. fire() doesn't lock nor allocate: it reads the current
+snapshot of the listener list, which add / remove replace with an updated copy. Fires of one
+speaker from several threads run side by side; a listener removed while a fire() is in progress
+is not called by it anymore. Once removeListener returns, no other thread is running a callback
+of the removed listener, also when it is called from within a callback. The calling thread's own
+callbacks are not waited for, nor are those of other threads that are themselves waiting in
+add / remove from within a callback of the same speaker, unless they are running the listener
+being removed. */
 template<typename Listener>
 class Speaker {
 	typedef vector<Listener*> ListenerList;
 
 public:
-	Speaker() noexcept { }
-	virtual ~Speaker() { }
+	Speaker() noexcept : listeners(nullptr), listenerEpoch(0), listenerVersion(0) {
+		listenerReaders[0] = 0;
+		listenerReaders[1] = 0;
+	}
+	virtual ~Speaker() {
+		delete listeners.load();
+		for(auto& i: retiredListeners) {
+			delete i.first;
+		}
+	}
 
 	template<typename... T>
 	void fire(T&&... type) noexcept {
-		Lock l(listenerCS);
-		tmp = listeners;
-		for(auto i: tmp) {
+		Dispatcher d(*this);
+		auto l = listeners.load();
+		if(!l) {
+			return;
+		}
+		for(auto i: *l) {
+			// a callback, or another thread, may have removed the listeners still to come
+			auto cur = listeners.load();
+			if(cur != l && (!cur || find(*cur, i) == cur->end())) {
+				continue;
+			}
+			d.calling = i;
 			i->on(forward<T>(type)...);
 		}
 	}
 
 	void addListener(Listener* aListener) {
-		Lock l(listenerCS);
-		if(find(listeners, aListener) == listeners.end())
-			listeners.push_back(aListener);
+		uint64_t version;
+		{
+			Lock l(listenerCS);
+			auto cur = listeners.load();
+			if(cur && find(*cur, aListener) != cur->end())
+				return;
+
+			auto next = cur ? new ListenerList(*cur) : new ListenerList();
+			next->push_back(aListener);
+			version = publishListeners(next);
+		}
+		waitListeners(version, WAIT_NONE, nullptr);
 	}
 
 	void removeListener(Listener* aListener) {
-		Lock l(listenerCS);
-		auto it = find(listeners, aListener);
-		if(it != listeners.end())
-			listeners.erase(it);
+		uint64_t version;
+		{
+			Lock l(listenerCS);
+			auto cur = listeners.load();
+			if(!cur)
+				return;
+
+			auto it = find(*cur, aListener);
+			if(it == cur->end())
+				return;
+
+			ListenerList* next = nullptr;
+			if(cur->size() > 1) {
+				next = new ListenerList(*cur);
+				next->erase(next->begin() + (it - cur->begin()));
+			}
+			version = publishListeners(next);
+		}
+		waitListeners(version, WAIT_ONE, aListener);
 	}
 
 	void removeListeners() {
-		Lock l(listenerCS);
-		listeners.clear();
+		uint64_t version;
+		{
+			Lock l(listenerCS);
+			if(!listeners.load())
+				return;
+			version = publishListeners(nullptr);
+		}
+		waitListeners(version, WAIT_ALL, nullptr);
 	}
 
 protected:
-	ListenerList listeners;
-	ListenerList tmp;
+	/** Announces a fire() in progress, in one of two counters so that writers waiting for the
+	ones that might still use an old list aren't held off forever by new ones. */
+	struct Dispatcher {
+		Dispatcher(Speaker& speaker) noexcept : speaker(speaker), idx(speaker.listenerEpoch.load() & 1), prev(current()), calling(nullptr) {
+			speaker.listenerReaders[idx].fetch_add(1);
+			current() = this;
+		}
+		~Dispatcher() {
+			current() = prev;
+			speaker.listenerReaders[idx].fetch_sub(1);
+		}
+
+		/** Innermost dispatch of the calling thread, for any speaker of this listener type. */
+		static Dispatcher*& current() noexcept {
+			static thread_local Dispatcher* top = nullptr;
+			return top;
+		}
+
+		Speaker& speaker;
+		unsigned idx;
+		Dispatcher* prev;
+		/** Listener being called; read by other threads once this dispatch is parked. */
+		Listener* calling;
+	};
+
+	/** Which callbacks of other threads a change has to wait for. */
+	enum WaitFor {
+		WAIT_NONE,	///< none; the wait only frees the lists that were replaced
+		WAIT_ONE,	///< those of one listener
+		WAIT_ALL	///< those of any listener
+	};
+
+	/** Publish a new list and retire the old one. Call with listenerCS held.
+	@return The version to pass to waitListeners. */
+	uint64_t publishListeners(ListenerList* next) {
+		auto prev = listeners.exchange(next);
+		auto version = ++listenerVersion;
+		if(prev) {
+			retiredListeners.emplace_back(prev, version);
+		}
+		return version;
+	}
+
+	/** Wait until the dispatches that may still use the lists retired up to version are done,
+	then free those lists. Dispatches of the calling thread are skipped, and so are those of
+	threads that are waiting here from within a callback ("parked"), unless they are running a
+	listener being removed. Parked dispatches check the list again before their next callback.
+	When any dispatch had to be skipped, the lists are freed by a later call instead. Call
+	without listenerCS. */
+	void waitListeners(uint64_t version, WaitFor waitFor, Listener* removed) {
+		vector<Dispatcher*> own;
+		for(auto d = Dispatcher::current(); d; d = d->prev) {
+			if(&d->speaker == this) {
+				own.push_back(d);
+			}
+		}
+
+		if(!own.empty()) {
+			if(waitFor == WAIT_NONE) {
+				// a listener added from within a callback doesn't need anyone to finish.
+				return;
+			}
+			Lock l(listenerCS);
+			parkedDispatchers.insert(parkedDispatchers.end(), own.begin(), own.end());
+		}
+
+		bool skipped = !own.empty();
+
+		// each counter has to drain once; flipping the epoch first sends new dispatches to the
+		// other counter, so that a steady stream of them can't hold us off.
+		for(int round = 0; round < 2; ++round) {
+			auto idx = listenerEpoch.fetch_xor(1) & 1;
+			for(int spins = 0; ; ++spins) {
+				int skip = 0;
+				{
+					Lock l(listenerCS);
+					for(auto d: parkedDispatchers) {
+						if(d->idx == idx && (find(own, d) != own.end() ||
+							(waitFor != WAIT_ALL && d->calling != removed)))
+						{
+							++skip;
+						}
+					}
+				}
+
+				if(listenerReaders[idx].load() <= skip) {
+					skipped |= skip > 0;
+					break;
+				}
+
+				if(spins < 100) {
+					Thread::yield();
+				} else {
+					Thread::sleep(1);
+				}
+			}
+		}
+
+		Lock l(listenerCS);
+		for(auto d: own) {
+			parkedDispatchers.erase(find(parkedDispatchers, d));
+		}
+
+		if(skipped) {
+			return;
+		}
+
+		auto i = retiredListeners.begin();
+		for(; i != retiredListeners.end() && i->second <= version; ++i) {
+			delete i->first;
+		}
+		retiredListeners.erase(retiredListeners.begin(), i);
+	}
+
+	std::atomic<ListenerList*> listeners;
+	std::atomic<unsigned> listenerEpoch;
+	std::atomic<int> listenerReaders[2];
+
+	/** Replaced lists that a fire() may still be using, with the version that replaced them. */
+	vector<std::pair<ListenerList*, uint64_t>> retiredListeners;
+	uint64_t listenerVersion;
+	/** Dispatches whose thread is waiting in waitListeners from within a callback. */
+	vector<Dispatcher*> parkedDispatchers;
 	CriticalSection listenerCS;
 };
 
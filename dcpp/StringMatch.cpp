@@ -21,6 +21,7 @@
 #include "format.h"
 #include "LogManager.h"
 #include "StringTokenizer.h"
+#include "Util.h"
 
 namespace dcpp {
 
@@ -45,13 +46,10 @@ struct Prepare : boost::static_visitor<bool> {
 	Prepare(const string& pattern) : pattern(pattern) { }
 
 	bool operator()(StringSearch::List& s) const {
-		s.clear();
 		StringTokenizer<string> st(pattern, ' ');
-		for(auto& i: st.getTokens()) {
-			if(!i.empty()) {
-				s.emplace_back(i);
-			}
-		}
+		auto& terms = st.getTokens();
+		terms.erase(std::remove(terms.begin(), terms.end(), Util::emptyString), terms.end());
+		s.assign(terms.begin(), terms.end());
 		return true;
 	}
 
@@ -82,12 +80,7 @@ struct Match : boost::static_visitor<bool> {
 	Match(const string& str) : str(str) { }
 
 	bool operator()(const StringSearch::List& s) const {
-		for(auto& i: s) {
-			if(!i.match(str)) {
-				return false;
-			}
-		}
-		return !s.empty();
+		return !s.empty() && s.matchAll(str);
 	}
 
 	bool operator()(const string& s) const {
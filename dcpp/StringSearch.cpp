@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stdinc.h"
+#include "StringSearch.h"
+
+#include <deque>
+
+namespace dcpp {
+
+void StringSearch::List::emplace_back(const string& aPattern) {
+	patterns.emplace_back(aPattern);
+	build();
+}
+
+void StringSearch::List::clear() {
+	patterns.clear();
+	build();
+}
+
+void StringSearch::List::build() {
+	all = 0;
+	memset(classes, 0, sizeof(classes));
+	classCount = 1;
+	next.clear();
+	found.clear();
+	outputs.clear();
+	outputStart.clear();
+	firstOutput.clear();
+	nextOutput.clear();
+
+	for(size_t i = 0; i < patterns.size(); ++i) {
+		if(i < MASK_BITS) {
+			all |= static_cast<Mask>(1) << i;
+		}
+		for(auto c: patterns[i].getPattern()) {
+			auto& cls = classes[static_cast<uint8_t>(c)];
+			if(cls == 0) {
+				cls = static_cast<uint16_t>(classCount++);
+			}
+		}
+	}
+
+	// trie of the patterns; 0 doubles as "no transition yet" since nothing leads back to the root
+	vector<uint32_t> trie(classCount, 0);
+	vector<vector<uint32_t>> ends(1);
+	found.push_back(0);
+	for(size_t i = 0; i < patterns.size(); ++i) {
+		uint32_t state = 0;
+		for(auto c: patterns[i].getPattern()) {
+			auto& to = trie[state * classCount + classes[static_cast<uint8_t>(c)]];
+			if(to == 0) {
+				to = static_cast<uint32_t>(found.size());
+				found.push_back(0);
+				ends.emplace_back();
+				trie.resize(trie.size() + classCount, 0);
+			}
+			state = trie[state * classCount + classes[static_cast<uint8_t>(c)]];
+		}
+		if(i < MASK_BITS) {
+			found[state] |= static_cast<Mask>(1) << i;
+		}
+		ends[state].push_back(static_cast<uint32_t>(i));
+	}
+
+	for(auto& e: ends) {
+		outputStart.push_back(static_cast<uint32_t>(outputs.size()));
+		outputs.insert(outputs.end(), e.begin(), e.end());
+	}
+	outputStart.push_back(static_cast<uint32_t>(outputs.size()));
+
+	// breadth-first, turn the trie into a full automaton following suffix links
+	next = trie;
+	vector<uint32_t> suffix(found.size(), 0);
+	firstOutput.resize(found.size(), NONE);
+	nextOutput.resize(found.size(), NONE);
+	if(!ends[0].empty()) {
+		firstOutput[0] = 0;
+	}
+
+	std::deque<uint32_t> queue;
+	for(uint32_t cls = 0; cls < classCount; ++cls) {
+		if(next[cls] != 0) {
+			queue.push_back(next[cls]);
+		}
+	}
+
+	while(!queue.empty()) {
+		auto state = queue.front();
+		queue.pop_front();
+		found[state] |= found[suffix[state]];
+		nextOutput[state] = firstOutput[suffix[state]];
+		firstOutput[state] = ends[state].empty() ? nextOutput[state] : state;
+
+		for(uint32_t cls = 0; cls < classCount; ++cls) {
+			auto child = trie[state * classCount + cls];
+			if(child != 0) {
+				suffix[child] = next[suffix[state] * classCount + cls];
+				queue.push_back(child);
+				next[state * classCount + cls] = child;
+			} else {
+				next[state * classCount + cls] = next[suffix[state] * classCount + cls];
+			}
+		}
+	}
+}
+
+template<bool any>
+StringSearch::List::Mask StringSearch::List::scan(const string& lower, Mask wanted) const noexcept {
+	// empty patterns end at the root and are found right away
+	Mask ret = found[0];
+	uint32_t state = 0;
+	for(auto c: lower) {
+		if(any ? (ret & wanted) != 0 : (ret & wanted) == wanted) {
+			break;
+		}
+		state = next[state * classCount + classes[static_cast<uint8_t>(c)]];
+		ret |= found[state];
+	}
+	return ret;
+}
+
+StringSearch::List::Mask StringSearch::List::match(const string& aText) const noexcept {
+	if(patterns.empty()) {
+		return 0;
+	}
+
+	string lower;
+	return scan<false>(Text::toLower(aText, lower), all);
+}
+
+bool StringSearch::List::matchAll(const string& aText, Mask satisfied) const noexcept {
+	auto wanted = all & ~satisfied;
+	if(wanted) {
+		string lower;
+		if((scan<false>(Text::toLower(aText, lower), wanted) & wanted) != wanted) {
+			return false;
+		}
+	}
+
+	for(size_t i = MASK_BITS; i < patterns.size(); ++i) {
+		if(!patterns[i].match(aText)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool StringSearch::List::matchAny(const string& aText) const noexcept {
+	if(patterns.empty()) {
+		return false;
+	}
+
+	string lower;
+	if(scan<true>(Text::toLower(aText, lower), all) != 0) {
+		return true;
+	}
+
+	for(size_t i = MASK_BITS; i < patterns.size(); ++i) {
+		if(patterns[i].match(aText)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace dcpp
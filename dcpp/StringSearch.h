@@ -28,12 +28,11 @@ namespace dcpp {
  * A class that implements a fast substring search algo suited for matching
  * one pattern against many strings (currently Quick Search, a variant of
  * Boyer-Moore. Code based on "A very fast substring search algorithm" by
- * D. Sunday).
- * @todo Perhaps find an algo suitable for matching multiple substrings.
+ * D. Sunday). Use StringSearch::List to match several patterns at once.
  */
 class StringSearch {
 public:
-	typedef vector<StringSearch> List;
+	class List;
 
 	StringSearch() { }
 	StringSearch(const string& aPattern) noexcept : pattern(Text::toLower(aPattern)) {
@@ -113,6 +112,98 @@ private:
 	}
 };
 
+/**
+ * Several patterns matched together: the text is lower-cased once and scanned in a single pass
+ * by an Aho-Corasick automaton over UTF-8 bytes, which reports every pattern found in it.
+ * Patterns are added like to a vector; the automaton is rebuilt on each change, so lists are
+ * meant to be set up once, with assign when there are several patterns, and then matched many
+ * times.
+ */
+class StringSearch::List {
+public:
+	/** Bit n is set when pattern n is found. Patterns past the 64th have no bit; matchAll /
+	matchAny still take them into account, and find reports all patterns, but they can't be
+	marked as satisfied. */
+	typedef uint64_t Mask;
+	enum { MASK_BITS = 64 };
+
+	typedef vector<StringSearch>::const_iterator const_iterator;
+
+	List() : classCount(1) { build(); }
+
+	void emplace_back(const string& aPattern);
+	void clear();
+	/** Replace the patterns, building the automaton only once. */
+	template<typename It>
+	void assign(It first, It last) {
+		patterns.assign(first, last);
+		build();
+	}
+
+	bool empty() const { return patterns.empty(); }
+	size_t size() const { return patterns.size(); }
+	const_iterator begin() const { return patterns.begin(); }
+	const_iterator end() const { return patterns.end(); }
+
+	/** Bits of all the patterns. */
+	Mask getAll() const { return all; }
+
+	/** Patterns found in the text. */
+	Mask match(const string& aText) const noexcept;
+	/** Whether the text contains every pattern, except those whose bit is in satisfied. */
+	bool matchAll(const string& aText, Mask satisfied = 0) const noexcept;
+	/** Whether the text contains any of the patterns. */
+	bool matchAny(const string& aText) const noexcept;
+
+	/** Call f with the index of each pattern found in the text, once per occurrence. */
+	template<typename F>
+	void find(const string& aText, F f) const {
+		string lower;
+		Text::toLower(aText, lower);
+
+		report(0, f);
+		uint32_t state = 0;
+		for(auto c: lower) {
+			state = next[state * classCount + classes[static_cast<uint8_t>(c)]];
+			report(state, f);
+		}
+	}
+
+private:
+	enum : uint32_t { NONE = UINT32_MAX };
+
+	void build();
+	template<bool any> Mask scan(const string& lower, Mask wanted) const noexcept;
+
+	template<typename F>
+	void report(uint32_t state, F& f) const {
+		for(auto s = firstOutput[state]; s != NONE; s = nextOutput[s]) {
+			for(auto i = outputStart[s]; i < outputStart[s + 1]; ++i) {
+				f(outputs[i]);
+			}
+		}
+	}
+
+	vector<StringSearch> patterns;
+	Mask all;
+
+	/** Bytes that appear in no pattern share class 0, which keeps the transition table small. */
+	uint16_t classes[256];
+	uint32_t classCount;
+	/** Transitions, classCount per state; state 0 is the root. */
+	vector<uint32_t> next;
+	/** Bits of the patterns that end in each state, including through suffix links. */
+	vector<Mask> found;
+
+	/** Indexes of the patterns that end exactly in state s: outputs[outputStart[s] .. outputStart[s + 1]). */
+	vector<uint32_t> outputs;
+	vector<uint32_t> outputStart;
+	/** First state on the suffix chain of each state (itself included) that has outputs, and the
+	one after that; NONE at the end. */
+	vector<uint32_t> firstOutput;
+	vector<uint32_t> nextOutput;
+};
+
 } // namespace dcpp
 
 #endif // DCPLUSPLUS_DCPP_STRING_SEARCH_H
@@ -35,6 +35,11 @@
 
 #include "Util.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DCPP_TEXT_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace dcpp {
 
 namespace Text {
@@ -44,8 +49,145 @@ using std::abs;
 const string utf8 = "utf-8"; // optimization
 string systemCharset;
 
+namespace {
+
+wchar_t platformToLower(wchar_t c) noexcept {
+#ifdef _WIN32
+	return LOWORD(CharLowerW(reinterpret_cast<LPWSTR>(MAKELONG(c, 0))));
+#else
+	return (wchar_t)towlower(c);
+#endif
+}
+
+/** Case mapping of the Basic Multilingual Plane, taken from the platform once (it may depend on
+the locale, hence the rebuild in initialize()) instead of asking it for every character. */
+struct LowerTable {
+	LowerTable() { build(); }
+
+	void build() noexcept {
+		for(uint32_t c = 0; c < TABLE_SIZE; ++c) {
+			lower[c] = platformToLower(static_cast<wchar_t>(c));
+		}
+
+		// the vectorized paths only know about A-Z; leave them out for locales that differ.
+		simpleAscii = true;
+		for(wchar_t c = 1; c < 0x80; ++c) {
+			if(lower[c] != ((c >= 'A' && c <= 'Z') ? c + 0x20 : c)) {
+				simpleAscii = false;
+			}
+		}
+	}
+
+	static const uint32_t TABLE_SIZE = 0x10000;
+
+	wchar_t lower[TABLE_SIZE];
+	bool simpleAscii;
+};
+
+LowerTable& lowerTable() noexcept {
+	static LowerTable table;
+	return table;
+}
+
+inline bool isPlainAscii(char c) {
+	return c > 0; // excludes NUL and 0x80 - 0xff
+}
+
+#ifdef DCPP_TEXT_SSE2
+
+/** Mask of the bytes that are not plain ASCII characters (high bit set or NUL). */
+inline int nonAsciiMask(__m128i v) {
+	return _mm_movemask_epi8(v) | _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+}
+
+/** Lower-case 16 plain ASCII characters. */
+inline __m128i lowerAscii(__m128i v) {
+	auto upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+	return _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+#endif
+
+/** Whether all bytes are below 0x80, 16 at a time where available. */
+inline bool isAscii(const char* str, size_t len) {
+	size_t i = 0;
+#ifdef DCPP_TEXT_SSE2
+	for(; i + 16 <= len; i += 16) {
+		if(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i)))) {
+			return false;
+		}
+	}
+#endif
+	for(; i < len; ++i) {
+		if(static_cast<uint8_t>(str[i]) & 0x80) {
+			return false;
+		}
+	}
+	return true;
+}
+
+#ifndef _WIN32
+
+/** iconv descriptors are costly to open and keep a conversion state, so that they can't be shared
+between threads; each thread keeps those it has used open instead. */
+class Converters {
+public:
+	struct Converter {
+		string from;
+		string to;
+		iconv_t cd;
+		/// Whether ASCII comes out unchanged, so that pure ASCII text needs no conversion
+		bool asciiCompatible;
+	};
+
+	~Converters() {
+		for(auto& i: converters) {
+			if(i.cd != (iconv_t)-1) {
+				iconv_close(i.cd);
+			}
+		}
+	}
+
+	/** @return The converter, whose descriptor is (iconv_t)-1 when iconv can't convert between
+	these charsets. */
+	Converter& get(const string& from, const string& to) {
+		// a thread only ever deals with a few charsets
+		for(auto& i: converters) {
+			if(i.from == from && i.to == to) {
+				return i;
+			}
+		}
+
+		Converter c = { from, to, iconv_open(to.c_str(), from.c_str()), false };
+		if(c.cd != (iconv_t)-1) {
+			char ascii[127];
+			char out[sizeof(ascii)];
+			for(size_t i = 0; i < sizeof(ascii); ++i) {
+				ascii[i] = static_cast<char>(i + 1);
+			}
+			char* inbuf = ascii;
+			char* outbuf = out;
+			size_t inleft = sizeof(ascii), outleft = sizeof(out);
+			c.asciiCompatible = iconv(c.cd, (ICONV_CONST char **)&inbuf, &inleft, &outbuf, &outleft) != (size_t)-1 &&
+				inleft == 0 && outleft == 0 && memcmp(ascii, out, sizeof(ascii)) == 0;
+		}
+		converters.push_back(c);
+		return converters.back();
+	}
+
+private:
+	vector<Converter> converters;
+};
+
+thread_local Converters converters;
+
+#endif
+
+} // namespace
+
 void initialize() {
 	setlocale(LC_ALL, "");
+	lowerTable().build();
 
 #ifdef _WIN32
 	char *ctype = setlocale(LC_CTYPE, NULL);
@@ -250,10 +392,36 @@ const string& wideToAcp(const wstring& str, string& tmp, const string& toCharset
 }
 
 bool validateUtf8(const string& str) noexcept {
-	string::size_type i = 0;
-	while(i < str.length()) {
+	return validateUtf8(str.data(), str.size());
+}
+
+bool validateUtf8(const char* str, size_t len) noexcept {
+	size_t i = 0;
+	while(i < len) {
+#ifdef DCPP_TEXT_SSE2
+		// skip over plain ASCII 16 bytes at a time
+		while(i + 16 <= len && !_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i)))) {
+			i += 16;
+		}
+		if(i == len)
+			break;
+#endif
+
+		const auto c0 = static_cast<uint8_t>(str[i]);
+		if(c0 < 0x80) {
+			++i;
+			continue;
+		}
+
+		// utf8ToWc relies on a terminator to stop at; don't let it read past the end
 		wchar_t dummy = 0;
-		int j = utf8ToWc(&str[i], dummy);
+		char tail[5] = { };
+		const char* p = str + i;
+		if(len - i < 4) {
+			memcpy(tail, p, len - i);
+			p = tail;
+		}
+		int j = utf8ToWc(p, dummy);
 		if(j < 0)
 			return false;
 		i += j;
@@ -303,11 +471,69 @@ const wstring& utf8ToWide(const string& str, wstring& tgt) noexcept {
 }
 
 wchar_t toLower(wchar_t c) noexcept {
-#ifdef _WIN32
-	return LOWORD(CharLowerW(reinterpret_cast<LPWSTR>(MAKELONG(c, 0))));
-#else
-	return (wchar_t)towlower(c);
+	if(static_cast<uint32_t>(c) < LowerTable::TABLE_SIZE) {
+		return lowerTable().lower[c];
+	}
+	return platformToLower(c);
+}
+
+const wchar_t* getLowerTable() noexcept {
+	return lowerTable().lower;
+}
+
+size_t toLowerAscii(const char* str, size_t len, string& out) noexcept {
+	auto& table = lowerTable();
+	if(!table.simpleAscii) {
+		return 0;
+	}
+
+	size_t i = 0;
+
+#ifdef DCPP_TEXT_SSE2
+	for(; i + 16 <= len; i += 16) {
+		auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+		if(nonAsciiMask(v)) {
+			break;
+		}
+
+		char lower[16];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lower), lowerAscii(v));
+		out.append(lower, 16);
+	}
+#endif
+
+	for(; i < len && isPlainAscii(str[i]); ++i) {
+		out += static_cast<char>(table.lower[static_cast<uint8_t>(str[i])]);
+	}
+
+	return i;
+}
+
+size_t commonPrefixNoCaseAscii(const char* a, const char* b, size_t len) noexcept {
+	auto& table = lowerTable();
+	if(!table.simpleAscii) {
+		return 0;
+	}
+
+	size_t i = 0;
+
+#ifdef DCPP_TEXT_SSE2
+	for(; i + 16 <= len; i += 16) {
+		auto va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		if((nonAsciiMask(va) | nonAsciiMask(vb)) || _mm_movemask_epi8(_mm_cmpeq_epi8(lowerAscii(va), lowerAscii(vb))) != 0xffff) {
+			break;
+		}
+	}
 #endif
+
+	for(; i < len && isPlainAscii(a[i]) && isPlainAscii(b[i]); ++i) {
+		if(table.lower[static_cast<uint8_t>(a[i])] != table.lower[static_cast<uint8_t>(b[i])]) {
+			break;
+		}
+	}
+
+	return i;
 }
 
 const wstring& toLower(const wstring& str, wstring& tmp) noexcept {
@@ -324,9 +550,14 @@ const wstring& toLower(const wstring& str, wstring& tmp) noexcept {
 const string& toLower(const string& str, string& tmp) noexcept {
 	if(str.empty())
 		return Util::emptyString;
-	tmp.reserve(str.length());
+	tmp.reserve(tmp.length() + str.length());
 	const char* end = &str[0] + str.length();
 	for(const char* p = &str[0]; p < end;) {
+		p += toLowerAscii(p, end - p, tmp);
+		if(p == end) {
+			break;
+		}
+
 		wchar_t c = 0;
 		int n = utf8ToWc(p, c);
 		if(n < 0) {
@@ -384,9 +615,17 @@ const string& convert(const string& str, string& tmp, const string& fromCharset,
 	if(fromCharset == utf8 || toLower(fromCharset, tmp) == utf8)
 		return utf8ToAcp(str, tmp);
 #else
-	// Initialize the converter
-	iconv_t cd = iconv_open(toCharset.c_str(), fromCharset.c_str());
+	auto& converter = converters.get(fromCharset, toCharset);
+	iconv_t cd = converter.cd;
 	if (cd != (iconv_t)-1) {
+		// most of what goes through here (hub protocol, search results) is plain ASCII
+		if(converter.asciiCompatible && isAscii(str.data(), str.size())) {
+			return str;
+		}
+
+		// back to the initial shift state, should the previous string have left it elsewhere
+		iconv(cd, nullptr, nullptr, nullptr, nullptr);
+
 		size_t rv;
 		size_t len = str.length() * 2; // optimization
 		size_t inleft = str.length();
@@ -416,7 +655,6 @@ const string& convert(const string& str, string& tmp, const string& fromCharset,
 				}
 			}
 		}
-		iconv_close(cd);
 		if (outleft > 0) {
 			tmp.resize(len - outleft);
 		}
@@ -101,11 +101,24 @@ namespace Text {
 	}
 
 	bool validateUtf8(const string& str) noexcept;
+	bool validateUtf8(const char* str, size_t len) noexcept;
 
 	inline char asciiToLower(char c) { dcassert((((uint8_t)c) & 0x80) == 0); return (char)tolower(c); }
 
 	wchar_t toLower(wchar_t c) noexcept;
 
+	/** toLower(wchar_t) of each character of the Basic Multilingual Plane (below 0x10000). */
+	const wchar_t* getLowerTable() noexcept;
+
+	/** Lower-case the leading ASCII part of str, up to the first non-ASCII or NUL character, and
+	append it to out. Vectorized where available.
+	@return Number of characters handled. */
+	size_t toLowerAscii(const char* str, size_t len, string& out) noexcept;
+
+	/** Number of leading ASCII characters (NUL excluded) that a and b have in common, ignoring case.
+	Vectorized where available. */
+	size_t commonPrefixNoCaseAscii(const char* a, const char* b, size_t len) noexcept;
+
 	const wstring& toLower(const wstring& str, wstring& tmp) noexcept;
 	inline wstring toLower(const wstring& str) noexcept {
 		wstring tmp;
@@ -25,6 +25,7 @@
 #include "TimerManager.h"
 #include "UploadManager.h"
 #include "ClientManager.h"
+#include "Metrics.h"
 
 namespace dcpp {
 /**
@@ -32,6 +33,20 @@ namespace dcpp {
  * Inspired by Token Bucket algorithm: https://en.wikipedia.org/wiki/Token_bucket
  */
 
+namespace {
+
+/** Tokens are handed out in smaller portions several times a second to smooth transfers out. */
+const uint64_t REFILL_INTERVAL = 100;
+const int64_t REFILLS_PER_SECOND = 1000 / REFILL_INTERVAL;
+
+}
+
+ThrottleManager::ThrottleManager() : refills(0), throttling(false), downTokens(0), upTokens(0)
+{
+	TimerManager::getInstance()->addListener(this);
+	refillTask = TimerManager::getInstance()->scheduleEvery(REFILL_INTERVAL, [this](uint64_t) { refill(); });
+}
+
 /*
  * Throttles traffic and reads a packet from the network
  */
@@ -154,76 +169,59 @@ void ThrottleManager::setSetting(SettingsManager::IntSetting setting, int value)
 
 bool ThrottleManager::getCurThrottling() {
 	Lock l(stateCS);
-	return activeWaiter != -1;
+	return throttling;
 }
 
 void ThrottleManager::waitToken() {
+	static auto& waitTime = Metrics::histogram("throttle.wait_us");
+	ScopedTimer timer(waitTime);
+
 	// no tokens, wait for them, so long as throttling still active
-	// avoid keeping stateCS lock on whole function
-	CriticalSection *curCS = 0;
-	{
-		Lock l(stateCS);
-		if (activeWaiter != -1)
-			curCS = &waitCS[activeWaiter];
-	}
-	// possible post-CS aW shifts: 0->1/1->0: lock lands in wrong place, will
-	// either fall through immediately or wait depending on whether in
-	// stateCS-protected transition elsewhere; 0/1-> -1: falls through. Both harmless.
-	if (curCS)
-		Lock l(*curCS);
+	Lock l(stateCS);
+	auto refill = refills;
+	refilled.wait(l, [this, refill] { return !throttling || refills != refill; });
 }
 
 ThrottleManager::~ThrottleManager(void)
 {
+	TimerManager::getInstance()->cancel(refillTask);
 	shutdown();
 	TimerManager::getInstance()->removeListener(this);
 }
 
 void ThrottleManager::shutdown() {
 	Lock l(stateCS);
-	if (activeWaiter != -1) {
-		waitCS[activeWaiter].unlock();
-		activeWaiter = -1;
-	}
+	throttling = false;
+	refilled.notify_all();
 }
 
-// TimerManagerListener
-void ThrottleManager::on(TimerManagerListener::Second, uint64_t /* aTick */) noexcept
-{
-	int newSlots = SettingsManager::getInstance()->get(getCurSetting(SettingsManager::SLOTS));
-	if(newSlots != SETTING(SLOTS)) {
-		setSetting(SettingsManager::SLOTS, newSlots);
-	}
-
-	{
-		Lock l(stateCS);
-		if (activeWaiter == -1)
-			// This will create slight weirdness for the read/write calls between
-			// here and the first activeWaiter-toggle below.
-			waitCS[activeWaiter = 0].lock();
-	}
-
+void ThrottleManager::refill() {
 	// readd tokens
 	{
 		Lock l(downCS);
-		downTokens = getDownLimit() * 1024;
+		downTokens = getDownLimit() * 1024 / REFILLS_PER_SECOND;
 	}
 
 	{
 		Lock l(upCS);
-		upTokens = getUpLimit() * 1024;
+		upTokens = getUpLimit() * 1024 / REFILLS_PER_SECOND;
 	}
 
-	// let existing events drain out (fairness).
-	// www.cse.wustl.edu/~schmidt/win32-cv-1.html documents various
-	// fairer strategies, but when only broadcasting, irrelevant
+	// wake up everyone waiting for tokens
 	{
 		Lock l(stateCS);
+		throttling = true;
+		++refills;
+		refilled.notify_all();
+	}
+}
 
-		dcassert(activeWaiter == 0 || activeWaiter == 1);
-		waitCS[1-activeWaiter].lock();
-		activeWaiter = 1-activeWaiter;
-		waitCS[1-activeWaiter].unlock();
+// TimerManagerListener
+void ThrottleManager::on(TimerManagerListener::Second, uint64_t /* aTick */) noexcept
+{
+	int newSlots = SettingsManager::getInstance()->get(getCurSetting(SettingsManager::SLOTS));
+	if(newSlots != SETTING(SLOTS)) {
+		setSetting(SettingsManager::SLOTS, newSlots);
 	}
 }
 
@@ -23,6 +23,8 @@
 #include "TimerManager.h"
 #include "SettingsManager.h"
 
+#include <boost/thread/condition_variable.hpp>
+
 namespace dcpp
 {
 	/**
@@ -57,10 +59,13 @@ namespace dcpp
 		static const int MAX_LIMIT = 1024 * 1024; // 1 GiB/s
 
 	private:
-		// stack up throttled read & write threads
+		// stack up throttled read & write threads until the next refill
 		CriticalSection stateCS;
-		CriticalSection waitCS[2];
-		long activeWaiter;
+		boost::condition_variable_any refilled;
+		uint32_t refills;
+		bool throttling;
+
+		TimerManager::TaskId refillTask;
 
 		// download limiter
 		CriticalSection	downCS;
@@ -72,15 +77,13 @@ namespace dcpp
 
 		friend class Singleton<ThrottleManager>;
 
-		ThrottleManager() : activeWaiter(-1), downTokens(0), upTokens(0)
-		{
-			TimerManager::getInstance()->addListener(this);
-		}
+		ThrottleManager();
 
 		virtual ~ThrottleManager();
 
 		bool getCurThrottling();
 		void waitToken();
+		void refill();
 
 		// TimerManagerListener
 		void on(TimerManagerListener::Second, uint64_t /* aTick */) noexcept;
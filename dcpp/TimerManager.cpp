@@ -18,11 +18,31 @@
 #include "stdinc.h"
 #include "TimerManager.h"
 
+#include <algorithm>
+#include <limits>
+
 #include <boost/date_time/posix_time/ptime.hpp>
 
 namespace dcpp {
 
 using namespace boost::posix_time;
+using std::max;
+using std::min;
+
+namespace {
+
+/** Executors this many; tasks are expected to be short, they mostly hand work over to others. */
+const size_t EXECUTORS = 2;
+
+/** Longest the wheel thread sleeps when nothing is scheduled. */
+const uint32_t IDLE_WAIT = 60 * 1000;
+
+const uint64_t NEVER = std::numeric_limits<uint64_t>::max();
+
+/** Task being run by the current executor thread, so that tasks can cancel themselves. */
+thread_local TimerManager::TaskId currentTask = 0;
+
+}
 
 TimerManager::TimerManager() {
 	// This mutex will be unlocked only upon shutdown
@@ -30,10 +50,24 @@ TimerManager::TimerManager() {
 }
 
 TimerManager::~TimerManager() {
-	dcassert(listeners.size() == 0);
+	dcassert(!listeners.load());
+}
+
+TimerManager::TaskId TimerManager::schedule(uint64_t delay, Task f) {
+	return scheduler.add(delay, 0, std::move(f));
+}
+
+TimerManager::TaskId TimerManager::scheduleEvery(uint64_t interval, Task f) {
+	dcassert(interval > 0);
+	return scheduler.add(interval, max(interval, static_cast<uint64_t>(1)), std::move(f));
+}
+
+void TimerManager::cancel(TaskId id) {
+	scheduler.cancel(id);
 }
 
 void TimerManager::shutdown() {
+	scheduler.shutdown();
 	mtx.unlock();
 	join();
 }
@@ -65,6 +99,259 @@ int TimerManager::run() {
 	return 0;
 }
 
+TimerManager::Scheduler::Scheduler() : lastId(0), now(getTick()), wakeAt(NEVER), stop(false) {
+	start();
+	for(size_t i = 0; i < EXECUTORS; ++i) {
+		executors.push_back(std::unique_ptr<Executor>(new Executor(*this)));
+	}
+}
+
+TimerManager::Scheduler::~Scheduler() {
+	shutdown();
+}
+
+TimerManager::TaskId TimerManager::Scheduler::add(uint64_t delay, uint64_t interval, Task&& f) {
+	Lock l(cs);
+	if(stop) {
+		return 0;
+	}
+
+	auto id = ++lastId;
+	auto due = getTick() + delay;
+	timers[id] = Timer { due, interval, std::move(f), false, false };
+	insert(id, due);
+
+	if(due < wakeAt) {
+		wakeAt = due;
+		wake.signal();
+	}
+	return id;
+}
+
+void TimerManager::Scheduler::cancel(TaskId id) {
+	if(id == 0) {
+		return;
+	}
+
+	Lock l(cs);
+	auto i = timers.find(id);
+	if(i == timers.end()) {
+		return;
+	}
+
+	if(!i->second.running) {
+		// the slot still refers to the id; it's skipped once its time comes
+		timers.erase(i);
+		return;
+	}
+
+	i->second.cancelled = true;
+	if(currentTask == id) {
+		return;
+	}
+
+	// wait for the run in progress; done() removes the timer afterwards
+	while(timers.find(id) != timers.end()) {
+		l.unlock();
+		Thread::sleep(1);
+		l.lock();
+	}
+}
+
+void TimerManager::Scheduler::shutdown() {
+	{
+		Lock l(cs);
+		if(stop) {
+			return;
+		}
+		stop = true;
+	}
+
+	wake.signal();
+	for(size_t i = 0; i < executors.size(); ++i) {
+		readySem.signal();
+	}
+
+	join();
+	executors.clear();
+
+	Lock l(cs);
+	timers.clear();
+	ready.clear();
+}
+
+int TimerManager::Scheduler::run() {
+	while(true) {
+		uint32_t wait;
+		{
+			Lock l(cs);
+			if(stop) {
+				break;
+			}
+
+			auto tick = getTick();
+			advance(tick);
+
+			wakeAt = nextDue();
+			wait = wakeAt == NEVER ? IDLE_WAIT : static_cast<uint32_t>(min(wakeAt - tick, static_cast<uint64_t>(IDLE_WAIT)));
+		}
+
+		wake.wait(wait);
+	}
+	return 0;
+}
+
+void TimerManager::Scheduler::insert(TaskId id, uint64_t due) {
+	if(due < now) {
+		due = now;
+	}
+
+	auto delta = due - now;
+	for(int level = 0; level < LEVELS; ++level) {
+		auto bits = level == 0 ? ROOT_BITS : LEVEL_BITS;
+		if(delta < (static_cast<uint64_t>(1) << (shift(level) + bits))) {
+			slots[level][(due >> shift(level)) & ((1 << bits) - 1)].push_back(id);
+			return;
+		}
+	}
+
+	overflow.push_back(id);
+}
+
+void TimerManager::Scheduler::advance(uint64_t to) {
+	while(now <= to) {
+		if((now & ((1 << ROOT_BITS) - 1)) == 0) {
+			// entering a new block: move the tasks of the coarser levels that are getting close down
+			int level = 1;
+			for(; level < LEVELS; ++level) {
+				auto index = (now >> shift(level)) & ((1 << LEVEL_BITS) - 1);
+				cascade(slots[level][index]);
+				if(index != 0) {
+					break;
+				}
+			}
+			if(level == LEVELS) {
+				cascade(overflow);
+			}
+		}
+
+		auto& slot = slots[0][now & ((1 << ROOT_BITS) - 1)];
+		for(auto id: slot) {
+			if(timers.find(id) != timers.end()) {
+				ready.push_back(id);
+				readySem.signal();
+			}
+		}
+		slot.clear();
+
+		++now;
+	}
+}
+
+void TimerManager::Scheduler::cascade(std::vector<TaskId>& slot) {
+	std::vector<TaskId> ids;
+	ids.swap(slot);
+	for(auto id: ids) {
+		auto i = timers.find(id);
+		if(i != timers.end()) {
+			insert(id, i->second.due);
+		}
+	}
+}
+
+uint64_t TimerManager::Scheduler::nextDue() const {
+	// the finest level gives exact times
+	for(uint64_t i = 0; i < (1 << ROOT_BITS); ++i) {
+		if(!slots[0][(now + i) & ((1 << ROOT_BITS) - 1)].empty()) {
+			return now + i;
+		}
+	}
+
+	// for coarser levels, wake up when their next non-empty slot is cascaded
+	uint64_t next = NEVER;
+	for(int level = 1; level < LEVELS; ++level) {
+		auto s = shift(level);
+		for(uint64_t i = 1; i <= (1 << LEVEL_BITS); ++i) {
+			if(!slots[level][((now >> s) + i) & ((1 << LEVEL_BITS) - 1)].empty()) {
+				next = min(next, ((now >> s) + i) << s);
+				break;
+			}
+		}
+	}
+
+	if(!overflow.empty()) {
+		auto s = shift(LEVELS - 1) + LEVEL_BITS;
+		next = min(next, ((now >> s) + 1) << s);
+	}
+
+	return next;
+}
+
+TimerManager::Scheduler::Timer* TimerManager::Scheduler::nextReady(TaskId& id) {
+	Lock l(cs);
+	while(!stop && !ready.empty()) {
+		id = ready.front();
+		ready.pop_front();
+
+		auto i = timers.find(id);
+		if(i != timers.end()) {
+			i->second.running = true;
+			return &i->second;
+		}
+	}
+	return nullptr;
+}
+
+void TimerManager::Scheduler::done(TaskId id, Timer* timer) {
+	Lock l(cs);
+	timer->running = false;
+
+	if(timer->cancelled || timer->interval == 0 || stop) {
+		timers.erase(id);
+		return;
+	}
+
+	// skip the runs that have been missed while this one was busy
+	auto& due = timer->due;
+	due += timer->interval;
+	if(due < now) {
+		due += (now - due + timer->interval - 1) / timer->interval * timer->interval;
+	}
+	insert(id, due);
+
+	if(due < wakeAt) {
+		wakeAt = due;
+		wake.signal();
+	}
+}
+
+int TimerManager::Scheduler::Executor::run() {
+	while(true) {
+		scheduler.readySem.wait();
+
+		TaskId id;
+		auto timer = scheduler.nextReady(id);
+		if(!timer) {
+			Lock l(scheduler.cs);
+			if(scheduler.stop) {
+				break;
+			}
+			continue;
+		}
+
+		currentTask = id;
+		try {
+			timer->f(getTick());
+		} catch(const std::exception& e) {
+			dcdebug("TimerManager: task %u failed: %s\n", static_cast<unsigned>(id), e.what());
+		}
+		currentTask = 0;
+
+		scheduler.done(id, timer);
+	}
+	return 0;
+}
+
 uint64_t TimerManager::getTick() {
 	static ptime start = microsec_clock::universal_time();
 	return (microsec_clock::universal_time() - start).total_milliseconds();
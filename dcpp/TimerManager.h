@@ -18,10 +18,18 @@
 #ifndef DCPLUSPLUS_DCPP_TIMER_MANAGER_H
 #define DCPLUSPLUS_DCPP_TIMER_MANAGER_H
 
+#include "CriticalSection.h"
+#include "SemaphoreDCpp.h"
 #include "Thread.h"
 #include "Speaker.h"
 #include "Singleton.h"
 
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 #include <boost/thread/mutex.hpp>
 
 #ifndef _WIN32
@@ -45,6 +53,21 @@ public:
 class TimerManager : public Speaker<TimerManagerListener>, public Singleton<TimerManager>, public Thread
 {
 public:
+	/** Scheduled tasks get the tick they run at. */
+	typedef std::function<void (uint64_t)> Task;
+	typedef uint64_t TaskId;
+
+	/** Run a task once, delay milliseconds from now. Tasks run on a small pool of threads, not on
+	the thread firing the Second / Minute events.
+	@return Id to cancel the task with; 0 if the timer has been shut down. */
+	TaskId schedule(uint64_t delay, Task f);
+	/** Run a task every interval milliseconds, the first time interval milliseconds from now. A
+	task never runs twice at once; runs that are missed while it is busy are skipped. */
+	TaskId scheduleEvery(uint64_t interval, Task f);
+	/** Stop a scheduled task. Once this returns, the task is not running anymore and won't run
+	again, unless this is called from the task itself. */
+	void cancel(TaskId id);
+
 	void shutdown();
 
 	static time_t getTime() { return (time_t)time(NULL); }
@@ -53,6 +76,75 @@ private:
 	friend class Singleton<TimerManager>;
 	boost::timed_mutex mtx;
 
+	/** Hierarchical timing wheel: tasks due within 256 ms sit in 1 ms slots, later ones in coarser
+	levels of 64 slots each that are cascaded down as time goes by. The wheel thread only wakes up
+	when something is due, and hands tasks over to the executors. */
+	class Scheduler : public Thread {
+	public:
+		Scheduler();
+		virtual ~Scheduler();
+
+		TaskId add(uint64_t delay, uint64_t interval, Task&& f);
+		void cancel(TaskId id);
+		void shutdown();
+
+	private:
+		class Executor : public Thread {
+		public:
+			explicit Executor(Scheduler& scheduler) : scheduler(scheduler) { start(); }
+			virtual ~Executor() { join(); }
+
+		private:
+			virtual int run();
+
+			Scheduler& scheduler;
+		};
+
+		struct Timer {
+			uint64_t due;
+			uint64_t interval;
+			Task f;
+			bool cancelled;
+			bool running;
+		};
+
+		enum {
+			LEVELS = 4,
+			ROOT_BITS = 8,
+			LEVEL_BITS = 6
+		};
+
+		virtual int run();
+
+		void insert(TaskId id, uint64_t due);
+		void advance(uint64_t to);
+		void cascade(std::vector<TaskId>& slot);
+		uint64_t nextDue() const;
+		static int shift(int level) { return level == 0 ? 0 : ROOT_BITS + (level - 1) * LEVEL_BITS; }
+
+		Timer* nextReady(TaskId& id);
+		void done(TaskId id, Timer* timer);
+
+		std::unordered_map<TaskId, Timer> timers;
+		TaskId lastId;
+
+		/** Time of the first slot that hasn't been processed yet. */
+		uint64_t now;
+		uint64_t wakeAt;
+
+		std::vector<TaskId> slots[LEVELS][1 << ROOT_BITS];
+		std::vector<TaskId> overflow;
+
+		std::deque<TaskId> ready;
+
+		std::vector<std::unique_ptr<Executor>> executors;
+		bool stop;
+
+		CriticalSection cs;
+		Semaphore wake;
+		Semaphore readySem;
+	} scheduler;
+
 	TimerManager();
 	virtual ~TimerManager();
 
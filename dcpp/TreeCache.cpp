@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stdinc.h"
+#include "TreeCache.h"
+
+namespace dcpp {
+
+bool TreeCache::get(const TTHValue& root, TigerTree& tt) {
+	Lock l(cs);
+	auto i = index.find(root);
+	if(i == index.end()) {
+		return false;
+	}
+
+	trees.splice(trees.begin(), trees, i->second);
+	tt = *i->second;
+	return true;
+}
+
+void TreeCache::add(const TigerTree& tt) {
+	auto size = getBytes(tt);
+	if(size > maxBytes) {
+		return;
+	}
+
+	Lock l(cs);
+	auto i = index.find(tt.getRoot());
+	if(i != index.end()) {
+		trees.splice(trees.begin(), trees, i->second);
+		return;
+	}
+
+	while(bytes + size > maxBytes) {
+		auto& last = trees.back();
+		bytes -= getBytes(last);
+		index.erase(last.getRoot());
+		trees.pop_back();
+	}
+
+	trees.push_front(tt);
+	index.emplace(tt.getRoot(), trees.begin());
+	bytes += size;
+}
+
+void TreeCache::clear() {
+	Lock l(cs);
+	trees.clear();
+	index.clear();
+	bytes = 0;
+}
+
+} // namespace dcpp
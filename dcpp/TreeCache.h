@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_TREE_CACHE_H
+#define DCPLUSPLUS_DCPP_TREE_CACHE_H
+
+#include <list>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "CriticalSection.h"
+#include "MerkleTree.h"
+
+namespace dcpp {
+
+using std::list;
+
+/** The Tiger trees used last, so that uploads of trees and downloads going over the segments of
+a file don't read the hash data file each time. It is bounded by the size of the leaves held; the
+trees used least recently make room for new ones. */
+class TreeCache : boost::noncopyable
+{
+public:
+	explicit TreeCache(size_t aMaxBytes) : bytes(0), maxBytes(aMaxBytes) { }
+
+	bool get(const TTHValue& root, TigerTree& tt);
+	void add(const TigerTree& tt);
+	void clear();
+
+	size_t getCount() const { Lock l(cs); return trees.size(); }
+	size_t getBytes() const { Lock l(cs); return bytes; }
+
+private:
+	typedef list<TigerTree> List;
+
+	static size_t getBytes(const TigerTree& tt) { return tt.getLeaves().size() * TTHValue::BYTES; }
+
+	/// Most recently used first
+	List trees;
+	unordered_map<TTHValue, List::iterator> index;
+
+	size_t bytes;
+	const size_t maxBytes;
+
+	mutable CriticalSection cs;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_TREE_CACHE_H)
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stdinc.h"
+#include "TreeChecker.h"
+
+#include "File.h"
+#include "Util.h"
+
+namespace dcpp {
+
+TreeChecker::TreeChecker(const string& aPath, const TigerTree& aTree) :
+	path(aPath),
+	tree(aTree),
+	next(0),
+	stop(false)
+{
+}
+
+vector<Segment> TreeChecker::getRanges(int64_t fileSize, int64_t blockSize, const set<Segment>* done) {
+	vector<Segment> spans;
+	if(done) {
+		for(auto& i: *done) {
+			// only whole blocks, save for the last one of the file which may be short
+			auto start = Util::roundUp(i.getStart(), blockSize);
+			auto end = i.getEnd() >= fileSize ? fileSize : i.getEnd() - i.getEnd() % blockSize;
+			if(start < end) {
+				spans.emplace_back(start, end - start);
+			}
+		}
+	} else if(fileSize > 0) {
+		spans.emplace_back(0, fileSize);
+	}
+
+	auto rangeSize = Util::roundUp(RANGE_SIZE, blockSize);
+
+	vector<Segment> ret;
+	for(auto& i: spans) {
+		for(auto pos = i.getStart(); pos < i.getEnd(); pos += rangeSize) {
+			ret.emplace_back(pos, std::min(rangeSize, i.getEnd() - pos));
+		}
+	}
+	return ret;
+}
+
+bool TreeChecker::check(vector<Segment>&& aRanges, size_t threads, const Callback& f) {
+	ranges = move(aRanges);
+	callback = f;
+	next = 0;
+	stop = false;
+
+	threads = std::max<size_t>(1, std::min(threads, ranges.size()));
+
+	// this thread is one of the readers
+	vector<std::unique_ptr<Worker>> workers;
+	try {
+		for(size_t i = 1; i < threads; ++i) {
+			workers.emplace_back(new Worker(*this));
+		}
+	} catch(const ThreadException&) {
+		// make do with the ones started
+	}
+
+	work();
+	workers.clear();
+
+	return !stop;
+}
+
+void TreeChecker::work() {
+	const auto blockSize = tree.getBlockSize();
+
+	try {
+		File f(path, File::READ, File::OPEN | File::SHARED);
+		vector<uint8_t> buf(static_cast<size_t>(blockSize));
+
+		while(!stop) {
+			auto i = next++;
+			if(i >= ranges.size()) {
+				return;
+			}
+
+			vector<Segment> verified;
+			for(auto pos = ranges[i].getStart(); pos < ranges[i].getEnd() && !stop; pos += blockSize) {
+				auto n = static_cast<size_t>(std::min(blockSize, ranges[i].getEnd() - pos));
+				if(f.readAt(&buf[0], n, pos) != n) {
+					throw FileException(_("Unable to read the file"));
+				}
+
+				// the leaf of a block is the root of the tree of that block alone
+				TigerTree block(blockSize);
+				block.update(&buf[0], n);
+				block.finalize();
+
+				auto leaf = static_cast<size_t>(pos / blockSize);
+				if(leaf < tree.getLeaves().size() && block.getRoot() == tree.getLeaves()[leaf]) {
+					if(!verified.empty() && verified.back().getEnd() == pos) {
+						verified.back().setSize(verified.back().getSize() + n);
+					} else {
+						verified.emplace_back(pos, n);
+					}
+				}
+			}
+
+			Lock l(cs);
+			if(!stop && !callback(verified)) {
+				stop = true;
+			}
+		}
+	} catch(const FileException& e) {
+		dcdebug("TreeChecker: error while reading %s: %s\n", path.c_str(), e.getError().c_str());
+		stop = true;
+	}
+}
+
+} // namespace dcpp
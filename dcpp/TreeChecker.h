@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DCPLUSPLUS_DCPP_TREE_CHECKER_H
+#define DCPLUSPLUS_DCPP_TREE_CHECKER_H
+
+#include <atomic>
+#include <functional>
+#include <set>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "CriticalSection.h"
+#include "MerkleTree.h"
+#include "Segment.h"
+#include "Thread.h"
+
+namespace dcpp {
+
+using std::function;
+using std::set;
+
+/** Checks the blocks of a file against the leaves of its tree. The file is split into ranges of
+whole blocks which a few threads hash at once, each reading its own range; the blocks found good
+are reported range by range, as soon as each has been checked. */
+class TreeChecker : boost::noncopyable
+{
+public:
+	/** Called with the blocks of a range that match their leaves, one range at a time.
+	@return false to stop checking */
+	typedef function<bool (const vector<Segment>& verified)> Callback;
+
+	TreeChecker(const string& aPath, const TigerTree& aTree);
+
+	/** The ranges to check a file in.
+	@param done Only check the blocks entirely within these segments, when given */
+	static vector<Segment> getRanges(int64_t fileSize, int64_t blockSize, const set<Segment>* done = nullptr);
+
+	/** Check the ranges given, with up to that many threads reading the file.
+	@return Whether all ranges were checked, rather than stopped by the callback or a read error */
+	bool check(vector<Segment>&& aRanges, size_t threads, const Callback& f);
+
+private:
+	class Worker : public Thread {
+	public:
+		explicit Worker(TreeChecker& parent) : parent(parent) { start(); }
+		virtual ~Worker() { join(); }
+
+	private:
+		int run() { parent.work(); return 0; }
+
+		TreeChecker& parent;
+	};
+
+	/** Ranges are about this large, so that results come in often enough */
+	static const int64_t RANGE_SIZE = 16 * 1024 * 1024;
+
+	void work();
+
+	const string path;
+	const TigerTree& tree;
+
+	vector<Segment> ranges;
+	Callback callback;
+	std::atomic<size_t> next;
+	std::atomic<bool> stop;
+
+	/// Callbacks are made one at a time
+	CriticalSection cs;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_TREE_CHECKER_H)
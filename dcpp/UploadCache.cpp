@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "stdinc.h"
+#include "UploadCache.h"
+
+namespace dcpp {
+
+/** Reads a range of a file, a block at a time when the blocks go through the cache. */
+class UploadCache::Stream : public InputStream {
+public:
+	Stream(UploadCache& aCache, const shared_ptr<File>& aFile, const TTHValue* aTTH, int64_t aStart, int64_t aSize) :
+		cache(aCache), file(aFile), cached(aTTH != nullptr), pos(aStart), end(aStart + aSize), blockIndex(-1)
+	{
+		if(cached) {
+			tth = *aTTH;
+		}
+	}
+
+	virtual size_t read(void* buf, size_t& len) {
+		len = static_cast<size_t>(std::min(static_cast<int64_t>(len), end - pos));
+		if(len == 0) {
+			return 0;
+		}
+
+		auto i = pos / static_cast<int64_t>(BLOCK_SIZE);
+		if(i != blockIndex) {
+			blockIndex = i;
+			block = cached ? cache.getBlock(*file, tth, i) : Block();
+			readAhead(i + 1);
+		}
+
+		if(block) {
+			auto offset = static_cast<size_t>(pos - i * BLOCK_SIZE);
+			len = offset < block->size() ? std::min(len, block->size() - offset) : 0;
+			memcpy(buf, block->data() + offset, len);
+		} else {
+			len = file->readAt(buf, len, pos);
+		}
+
+		pos += len;
+		return len;
+	}
+
+private:
+	void readAhead(int64_t i) {
+		auto from = i * static_cast<int64_t>(BLOCK_SIZE);
+		if(from < end && !(cached && cache.hasBlock(tth, i))) {
+			file->prefetch(from, std::min(static_cast<int64_t>(BLOCK_SIZE), end - from));
+		}
+	}
+
+	UploadCache& cache;
+	shared_ptr<File> file;
+	TTHValue tth;
+	bool cached;
+
+	int64_t pos;
+	int64_t end;
+
+	int64_t blockIndex;
+	Block block;
+};
+
+shared_ptr<File> UploadCache::getFile(const string& aPath) {
+	Lock l(cs);
+	auto i = files.find(aPath);
+	if(i != files.end()) {
+		auto f = i->second.lock();
+		if(f) {
+			return f;
+		}
+	}
+
+	auto f = std::make_shared<File>(aPath, File::READ, File::OPEN);
+
+	// forget the files no upload has open anymore
+	for(auto j = files.begin(); j != files.end();) {
+		if(j->second.expired()) {
+			j = files.erase(j);
+		} else {
+			++j;
+		}
+	}
+
+	files[aPath] = f;
+	return f;
+}
+
+InputStream* UploadCache::open(const shared_ptr<File>& aFile, const TTHValue* aTTH, int64_t aStart, int64_t aSize) {
+	bool enabled = [this] { Lock l(cs); return maxBytes > 0; }();
+	return new Stream(*this, aFile, enabled ? aTTH : nullptr, aStart, aSize);
+}
+
+void UploadCache::setMaxBytes(size_t aMaxBytes) {
+	Lock l(cs);
+	maxBytes = aMaxBytes;
+	trim();
+}
+
+void UploadCache::clear() {
+	Lock l(cs);
+	blocks.clear();
+	index.clear();
+	bytes = 0;
+}
+
+size_t UploadCache::getFileCount() const {
+	Lock l(cs);
+	return std::count_if(files.begin(), files.end(), [](const pair<const string, weak_ptr<File>>& f) { return !f.second.expired(); });
+}
+
+UploadCache::Block UploadCache::getBlock(File& f, const TTHValue& tth, int64_t i) {
+	Key key(tth, i);
+
+	{
+		Lock l(cs);
+		auto j = index.find(key);
+		if(j != index.end()) {
+			blocks.splice(blocks.begin(), blocks, j->second);
+			++hits;
+			return j->second->second;
+		}
+	}
+
+	++misses;
+
+	// read without holding the lock, so that uploads served from memory don't wait on the disk
+	auto data = std::make_shared<string>(BLOCK_SIZE, '\0');
+	data->resize(f.readAt(&(*data)[0], BLOCK_SIZE, i * BLOCK_SIZE));
+	if(data->size() < BLOCK_SIZE) {
+		data->shrink_to_fit();
+	}
+	Block block = data;
+
+	Lock l(cs);
+	if(block->empty() || block->size() > maxBytes) {
+		return block;
+	}
+
+	auto j = index.find(key);
+	if(j != index.end()) {
+		// another upload read it in the meantime
+		blocks.splice(blocks.begin(), blocks, j->second);
+		return j->second->second;
+	}
+
+	blocks.emplace_front(key, block);
+	index.emplace(key, blocks.begin());
+	bytes += block->size();
+	trim();
+
+	return block;
+}
+
+bool UploadCache::hasBlock(const TTHValue& tth, int64_t i) const {
+	Lock l(cs);
+	return index.find(Key(tth, i)) != index.end();
+}
+
+void UploadCache::trim() {
+	while(bytes > maxBytes) {
+		auto& last = blocks.back();
+		bytes -= last.second->size();
+		index.erase(last.first);
+		blocks.pop_back();
+	}
+}
+
+} // namespace dcpp
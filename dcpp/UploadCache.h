@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2001-2025 Jacek Sieka, arnetheduck on gmail point com
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DCPLUSPLUS_DCPP_UPLOAD_CACHE_H
+#define DCPLUSPLUS_DCPP_UPLOAD_CACHE_H
+
+#include <atomic>
+#include <list>
+#include <memory>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "CriticalSection.h"
+#include "File.h"
+#include "MerkleTree.h"
+#include "Streams.h"
+
+namespace dcpp {
+
+using std::list;
+using std::pair;
+using std::shared_ptr;
+using std::weak_ptr;
+
+/** Blocks of the files being uploaded, kept in memory so that peers asking for different
+segments of the same popular file don't each send the disk looking for them. Blocks are keyed by
+the TTH of the file and their index; the blocks used least recently make room for new ones once
+the memory budget is reached. Uploads of the same file also share one open handle. */
+class UploadCache : boost::noncopyable
+{
+public:
+	static const size_t BLOCK_SIZE = 1024 * 1024;
+
+	/** @param aMaxBytes Memory budget of the blocks; 0 to read everything from the disk. */
+	explicit UploadCache(size_t aMaxBytes = 0) : bytes(0), maxBytes(aMaxBytes), hits(0), misses(0) { }
+
+	/** Open a file for reading, or share the handle another upload already has on it. */
+	shared_ptr<File> getFile(const string& aPath);
+
+	/** A stream over [aStart, aStart + aSize) of a file that goes through the cache when the TTH
+	of the file is known, and reads the next block ahead either way. */
+	InputStream* open(const shared_ptr<File>& aFile, const TTHValue* aTTH, int64_t aStart, int64_t aSize);
+
+	void setMaxBytes(size_t aMaxBytes);
+	void clear();
+
+	/** @return Number of blocks found in the cache / read from the disk. */
+	uint64_t getHits() const { return hits; }
+	uint64_t getMisses() const { return misses; }
+	size_t getBytes() const { Lock l(cs); return bytes; }
+	size_t getFileCount() const;
+
+private:
+	class Stream;
+
+	typedef shared_ptr<const string> Block;
+	typedef pair<TTHValue, int64_t> Key;
+
+	struct KeyHash {
+		size_t operator()(const Key& k) const { return std::hash<TTHValue>()(k.first) ^ static_cast<size_t>(k.second); }
+	};
+
+	typedef list<pair<Key, Block>> List;
+
+	Block getBlock(File& f, const TTHValue& tth, int64_t index);
+	bool hasBlock(const TTHValue& tth, int64_t index) const;
+	void trim();
+
+	/// Most recently used first
+	List blocks;
+	unordered_map<Key, List::iterator, KeyHash> index;
+
+	unordered_map<string, weak_ptr<File>> files;
+
+	size_t bytes;
+	size_t maxBytes;
+
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+
+	mutable CriticalSection cs;
+};
+
+} // namespace dcpp
+
+#endif // !defined(DCPLUSPLUS_DCPP_UPLOAD_CACHE_H)
@@ -22,6 +22,7 @@
 
 #include "ConnectionManager.h"
 #include "LogManager.h"
+#include "Metrics.h"
 #include "ShareManager.h"
 #include "ClientManager.h"
 #include "FilteredFile.h"
@@ -33,9 +34,17 @@
 #include "Upload.h"
 #include "UserConnection.h"
 #include "File.h"
+#include "QueueManager.h"
 
 namespace dcpp {
 
+namespace {
+
+/** How long a user notified of a free slot has to connect before the slot goes to someone else. */
+const uint64_t CONNECT_TIMEOUT = 90 * 1000;
+
+}
+
 UploadManager::UploadManager() noexcept:
 	running(0),
 	extra(0),
@@ -45,6 +54,10 @@ UploadManager::UploadManager() noexcept:
 	isFireball(false),
 	isFileServer(false)
 {
+	Metrics::addValue("upload.cache_hits", this, [this] { return static_cast<int64_t>(cache.getHits()); });
+	Metrics::addValue("upload.cache_misses", this, [this] { return static_cast<int64_t>(cache.getMisses()); });
+	Metrics::addValue("upload.cache_bytes", this, [this] { return static_cast<int64_t>(cache.getBytes()); });
+
 	ClientManager::getInstance()->addListener(this);
 	TimerManager::getInstance()->addListener(this);
 }
@@ -52,6 +65,11 @@ UploadManager::UploadManager() noexcept:
 UploadManager::~UploadManager() {
 	TimerManager::getInstance()->removeListener(this);
 	ClientManager::getInstance()->removeListener(this);
+
+	Metrics::removeValue("upload.cache_hits", this);
+	Metrics::removeValue("upload.cache_misses", this);
+	Metrics::removeValue("upload.cache_bytes", this);
+
 	while(true) {
 		{
 			Lock l(cs);
@@ -74,6 +92,7 @@ bool UploadManager::prepareFile(UserConnection& aSource, const string& aType, co
 	access. we want to know the type of the upload to see if the user deserves a mini-slot. */
 
 	bool miniSlot;
+	bool partial = false;
 
 	string sourceFile;
 	Transfer::Type type;
@@ -101,8 +120,21 @@ bool UploadManager::prepareFile(UserConnection& aSource, const string& aType, co
 			return false;
 		}
 	} catch(const ShareException& e) {
-		aSource.fileNotAvail(e.getError());
-		return false;
+		// not shared, but it may be being downloaded with the part asked for already there
+		auto isTree = aType == Transfer::names[Transfer::TYPE_TREE];
+		int64_t fileSize;
+		if(aFile.size() != 4 + 39 || aFile.compare(0, 4, "TTH/") != 0 ||
+			!(isTree || aType == Transfer::names[Transfer::TYPE_FILE]) ||
+			!QueueManager::getInstance()->getPartialFile(TTHValue(aFile.substr(4)), isTree ? 0 : aStartPos,
+				isTree ? 0 : aBytes, sourceFile, fileSize))
+		{
+			aSource.fileNotAvail(e.getError());
+			return false;
+		}
+
+		type = isTree ? Transfer::TYPE_TREE : Transfer::TYPE_FILE;
+		miniSlot = isTree || fileSize <= static_cast<int64_t>(SETTING(SET_MINISLOT_SIZE) * 1024);
+		partial = true;
 	}
 
 	/* let's see if a slot is available to serve the upload. */
@@ -125,7 +157,7 @@ bool UploadManager::prepareFile(UserConnection& aSource, const string& aType, co
 				// Check for tth root identifier
 				string tFile = aFile;
 				if (tFile.compare(0, 4, "TTH/") == 0)
-					tFile = ShareManager::getInstance()->toVirtual(TTHValue(aFile.substr(4)));
+					tFile = partial ? Util::getFileName(sourceFile) : ShareManager::getInstance()->toVirtual(TTHValue(aFile.substr(4)));
 
 				aSource.maxedOut(addFailedUpload(aSource, tFile +
 					" (" +  Util::formatBytes(aStartPos) + " - " + Util::formatBytes(aStartPos + aBytes) + ")"));
@@ -142,6 +174,7 @@ bool UploadManager::prepareFile(UserConnection& aSource, const string& aType, co
 	InputStream* is = 0;
 	int64_t start = 0;
 	int64_t size = 0;
+	optional<TTHValue> tth;
 
 	try {
 		switch(type) {
@@ -158,7 +191,11 @@ bool UploadManager::prepareFile(UserConnection& aSource, const string& aType, co
 					size = xml.size();
 
 				} else {
-					File* f = new File(sourceFile, File::READ, File::OPEN);
+					// a file being downloaded is still open for writing and lacks blocks, and file
+					// lists get replaced under the same name; neither goes through the cache
+					bool direct = partial || type == Transfer::TYPE_FULL_LIST;
+					auto f = direct ? std::make_shared<File>(sourceFile, File::READ, File::OPEN | (partial ? File::SHARED : 0)) :
+						cache.getFile(sourceFile);
 
 					start = aStartPos;
 					int64_t sz = f->getSize();
@@ -166,15 +203,17 @@ bool UploadManager::prepareFile(UserConnection& aSource, const string& aType, co
 
 					if((start + size) > sz) {
 						aSource.fileNotAvail();
-						delete f;
 						return false;
 					}
 
-					f->setPos(start);
-					is = f;
-					if((start + size) < sz) {
-						is = new LimitedInputStream<true>(is, size);
+					if(aFile.compare(0, 4, "TTH/") == 0) {
+						tth = TTHValue(aFile.substr(4));
+					} else {
+						tth = ShareManager::getInstance()->getTTH(aFile);
 					}
+
+					cache.setMaxBytes(static_cast<size_t>(SETTING(UPLOAD_CACHE_SIZE)) * 1024 * 1024);
+					is = cache.open(f, (tth && !direct) ? &*tth : nullptr, start, size);
 				}
 				break;
 			}
@@ -221,7 +260,7 @@ bool UploadManager::prepareFile(UserConnection& aSource, const string& aType, co
 
 	Lock l(cs);
 
-	Upload* u = new Upload(aSource, sourceFile, TTHValue());
+	Upload* u = new Upload(aSource, sourceFile, tth ? *tth : TTHValue());
 	u->setStream(is);
 	u->setSegment(Segment(start, size));
 
@@ -288,6 +327,11 @@ void UploadManager::removeUpload(Upload* aUpload) {
 	Lock l(cs);
 	dcassert(find(uploads.begin(), uploads.end(), aUpload) != uploads.end());
 	uploads.erase(remove(uploads.begin(), uploads.end(), aUpload), uploads.end());
+
+	if(aUpload->isSet(Upload::FLAG_ZUPLOAD) && aUpload->getType() == Transfer::TYPE_FILE) {
+		compressionStats.add(aUpload->getTTH(), aUpload->getPath(), aUpload->getPos(), aUpload->getActual());
+	}
+
 	delete aUpload;
 }
 
@@ -364,10 +408,16 @@ void UploadManager::on(AdcCommand::GET, UserConnection* aSource, const AdcComman
 			.addParam(Util::toString(u->getStartPos()))
 			.addParam(Util::toString(u->getSize()));
 
+		// files known not to compress are sent as they are, which the protocol allows
 		if(c.hasFlag("ZL", 4)) {
-			u->setStream(new FilteredInputStream<ZFilter, true>(u->getStream()));
-			u->setFlag(Upload::FLAG_ZUPLOAD);
-			cmd.addParam("ZL1");
+			if(u->getType() != Transfer::TYPE_FILE || compressionStats.worthCompressing(u->getTTH(), u->getPath())) {
+				u->setStream(new FilteredInputStream<ZFilter, true>(u->getStream()));
+				u->setFlag(Upload::FLAG_ZUPLOAD);
+				cmd.addParam("ZL1");
+			} else {
+				static auto& skipped = Metrics::counter("upload.compression_skipped");
+				skipped.add();
+			}
 		}
 
 		aSource->send(cmd);
@@ -502,7 +552,11 @@ void UploadManager::notifyQueuedUsers() {
 				WaitingUser wu = waitingUsers.front();
 				clearUserFiles(wu.user);
 				if(wu.user.user->isOnline()) {
-					connectingUsers[wu.user] = GET_TICK();
+					auto tick = GET_TICK();
+					connectingUsers[wu.user] = tick;
+					TimerManager::getInstance()->schedule(CONNECT_TIMEOUT, [this, user = wu.user.user, tick](uint64_t) {
+						expireConnecting(user, tick);
+					});
 					notifyList.push_back(wu);
 					freeslots--;
 				}
@@ -513,20 +567,28 @@ void UploadManager::notifyQueuedUsers() {
 		ClientManager::getInstance()->connect(it->user, it->token);
 }
 
-void UploadManager::on(TimerManagerListener::Minute, uint64_t  aTick ) noexcept {
-	UserList disconnects;
+void UploadManager::expireConnecting(const UserPtr& aUser, uint64_t aTick) {
 	{
 		Lock l(cs);
-
-		for(auto i = connectingUsers.begin(); i != connectingUsers.end();) {
-			if((i->second + (90 * 1000)) < aTick) {
-				clearUserFiles(i->first);
-				connectingUsers.erase(i++);
-			} else {
-				++i;
-			}
+		auto i = connectingUsers.find(aUser);
+		if(i == connectingUsers.end() || i->second != aTick) {
+			// the user has connected or has been granted a slot again since
+			return;
 		}
 
+		clearUserFiles(i->first);
+		connectingUsers.erase(i);
+	}
+
+	// give the slot to the next one in line
+	notifyQueuedUsers();
+}
+
+void UploadManager::on(TimerManagerListener::Minute, uint64_t /*aTick*/) noexcept {
+	UserList disconnects;
+	{
+		Lock l(cs);
+
 		if( SETTING(AUTO_KICK) ) {
 			for(auto u: uploads) {
 				if(u->getUser()->isOnline()) {
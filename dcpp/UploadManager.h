@@ -34,6 +34,8 @@
 #include "SettingsManager.h"
 #include "HintedUser.h"
 #include "UserConnection.h"
+#include "UploadCache.h"
+#include "CompressionStats.h"
 #include "GetSet.h"
 
 namespace dcpp {
@@ -89,6 +91,9 @@ public:
 	/** @internal */
 	void addConnection(UserConnectionPtr conn);
 
+	const UploadCache& getCache() const { return cache; }
+	const CompressionStats& getCompressionStats() const { return compressionStats; }
+
 	GETSET(int, running, Running);
 	GETSET(int, extra, Extra);
 	GETSET(uint64_t, lastGrant, LastGrant);
@@ -116,7 +121,12 @@ private:
 	WaitingUserList waitingUsers;		//this one merely lists the users waiting for slots
 	FilesMap waitingFiles;		//set of files which this user has asked for
 	size_t addFailedUpload(const UserConnection& source, string filename);
+
+	UploadCache cache;
+	CompressionStats compressionStats;
+
 	void notifyQueuedUsers();
+	void expireConnecting(const UserPtr& aUser, uint64_t aTick);
 
 	friend class Singleton<UploadManager>;
 	UploadManager() noexcept;
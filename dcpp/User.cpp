@@ -166,6 +166,11 @@ string Identity::get(const char* name) const {
 	return i == info.end() ? Util::emptyString : i->second;
 }
 
+const string& Identity::getRef(const char* name) const {
+	auto i = info.find(*(short*)name);
+	return i == info.end() ? Util::emptyString : i->second;
+}
+
 bool Identity::isSet(const char* name) const {
 	FastLock l(cs);
 	auto i = info.find(*(short*)name);
@@ -173,12 +178,41 @@ bool Identity::isSet(const char* name) const {
 }
 
 
+namespace {
+
+Identity::MatchField getMatchField(const char* name) {
+	auto is = [name](const char* field) { return name[0] == field[0] && name[1] == field[1]; };
+	if(is("NI")) {
+		return Identity::MATCH_NICK;
+	}
+	if(is("I4") || is("I6")) {
+		return Identity::MATCH_IP;
+	}
+	if(is("CT") || is("OP") || is("BO")) {
+		return Identity::MATCH_TYPE;
+	}
+	return Identity::MATCH_LAST;
+}
+
+} // unnamed namespace
+
 void Identity::set(const char* name, const string& val) {
 	FastLock l(cs);
-	if(val.empty())
-		info.erase(*(short*)name);
-	else
-		info[*(short*)name] = val;
+	bool changed;
+	if(val.empty()) {
+		changed = info.erase(*(short*)name) > 0;
+	} else {
+		auto& v = info[*(short*)name];
+		changed = v != val;
+		if(changed) {
+			v = val;
+		}
+	}
+
+	auto field = getMatchField(name);
+	if(changed && field != MATCH_LAST) {
+		++versions[field];
+	}
 }
 
 bool Identity::supports(const string& name) const {
@@ -229,6 +263,11 @@ void Identity::setNoChat(bool ignoreChat) {
 	}
 }
 
+void Identity::getVersions(uint32_t (&ret)[MATCH_LAST]) const {
+	FastLock l(cs);
+	std::copy(versions, versions + MATCH_LAST, ret);
+}
+
 Style Identity::getStyle() const {
 	FastLock l(cs);
 	return style;
@@ -38,31 +38,60 @@ bool UserMatch::empty() const {
 	return !isSet(FAVS) && !isSet(OPS) && !isSet(BOTS) && rules.empty();
 }
 
-bool UserMatch::match(OnlineUser& user) const {
+UserMatch::Fields::Fields(OnlineUser& user) : user(user) {
+}
+
+const string& UserMatch::Fields::get(int field) {
 	const auto& identity = user.getIdentity();
+	switch(field) {
+	case UserMatch::Rule::NICK: return identity.getRef("NI");
+	case UserMatch::Rule::CID:
+		if(cid.empty()) {
+			cid = identity.getUser()->getCID().toBase32();
+		}
+		return cid;
+	case UserMatch::Rule::IP:
+		{
+			auto& ip6 = identity.getRef("I6");
+			return ip6.empty() ? identity.getRef("I4") : ip6;
+		}
+	case UserMatch::Rule::HUB_ADDRESS: return user.getClient().getHubUrl();
+	}
+	return Util::emptyString;
+}
 
-	if(isSet(FAVS) && !FavoriteManager::getInstance()->isFavoriteUser(identity.getUser())) {
+bool UserMatch::Fields::isFavorite() {
+	return FavoriteManager::getInstance()->isFavoriteUser(user.getUser());
+}
+
+bool UserMatch::Fields::isOp() {
+	return user.getIdentity().isOp();
+}
+
+bool UserMatch::Fields::isBot() {
+	return user.getIdentity().isBot();
+}
+
+bool UserMatch::match(OnlineUser& user) const {
+	Fields fields(user);
+	return match(fields);
+}
+
+bool UserMatch::match(Fields& fields) const {
+	if(isSet(FAVS) && !fields.isFavorite()) {
 		return false;
 	}
 
-	if(isSet(OPS) && !identity.isOp()) {
+	if(isSet(OPS) && !fields.isOp()) {
 		return false;
 	}
 
-	if(isSet(BOTS) && !identity.isBot()) {
+	if(isSet(BOTS) && !fields.isBot()) {
 		return false;
 	}
 
 	for(auto& i: rules) {
-		string str;
-		switch(i.field) {
-		case UserMatch::Rule::NICK: str = identity.getNick(); break;
-		case UserMatch::Rule::CID: str = identity.getUser()->getCID().toBase32(); break;
-		case UserMatch::Rule::IP: str = identity.getIp(); break;
-		case UserMatch::Rule::HUB_ADDRESS: str = user.getClient().getHubUrl(); break;
-		case UserMatch::Rule::FIELD_LAST: break;
-		}
-		if(!i.match(str)) {
+		if(!i.match(fields.get(i.field))) {
 			return false;
 		}
 	}
@@ -70,4 +99,39 @@ bool UserMatch::match(OnlineUser& user) const {
 	return true;
 }
 
+int UserMatchCache::update(uint32_t aList, size_t definitions, const Identity& identity, uint32_t aFavorites) {
+	uint32_t cur[Identity::MATCH_LAST];
+	identity.getVersions(cur);
+
+	int changed = 0;
+	if(list != aList) {
+		changed = ~0;
+		list = aList;
+		results.assign(definitions, false);
+	} else {
+		if(cur[Identity::MATCH_NICK] != fields[Identity::MATCH_NICK]) { changed |= UserMatch::INPUT_NICK; }
+		if(cur[Identity::MATCH_IP] != fields[Identity::MATCH_IP]) { changed |= UserMatch::INPUT_IP; }
+		if(cur[Identity::MATCH_TYPE] != fields[Identity::MATCH_TYPE]) { changed |= UserMatch::INPUT_TYPE; }
+		if(aFavorites != favorites) { changed |= UserMatch::INPUT_FAVORITE; }
+	}
+
+	std::copy(cur, cur + Identity::MATCH_LAST, fields);
+	favorites = aFavorites;
+	return changed;
+}
+
+int UserMatch::getInputs() const {
+	int ret = 0;
+	if(isSet(FAVS)) { ret |= INPUT_FAVORITE; }
+	if(isSet(OPS) || isSet(BOTS)) { ret |= INPUT_TYPE; }
+	for(auto& i: rules) {
+		switch(i.field) {
+		case Rule::NICK: ret |= INPUT_NICK; break;
+		case Rule::IP: ret |= INPUT_IP; break;
+		default: break;
+		}
+	}
+	return ret;
+}
+
 } // namespace dcpp
@@ -82,7 +82,36 @@ struct UserMatch : public Flags {
 	void addRule(Rule&& rule);
 	bool empty() const;
 
+	/** Values of a user that definitions look at, only retrieved when a definition needs them.
+	Matching runs on the thread of the user's hub, so the identity's own strings are used. */
+	class Fields {
+	public:
+		explicit Fields(OnlineUser& user);
+
+		const string& get(int field);
+		bool isFavorite();
+		bool isOp();
+		bool isBot();
+
+	private:
+		OnlineUser& user;
+		/// The CID in base32, the only value that has to be made
+		string cid;
+	};
+
 	bool match(OnlineUser& user) const;
+	bool match(Fields& fields) const;
+
+	enum {
+		INPUT_NICK = 1 << 0,
+		INPUT_IP = 1 << 1,
+		INPUT_TYPE = 1 << 2,
+		INPUT_FAVORITE = 1 << 3
+	};
+
+	/** What this definition depends on, apart from the CID and the hub which don't change for an
+	online user; see the INPUT_* flags. */
+	int getInputs() const;
 };
 
 } // namespace dcpp
@@ -20,13 +20,14 @@
 
 #include "Client.h"
 #include "ClientManager.h"
+#include "FavoriteManager.h"
 #include "format.h"
 #include "SimpleXML.h"
 #include "version.h"
 
 namespace dcpp {
 
-UserMatchManager::UserMatchManager() {
+UserMatchManager::UserMatchManager() : version(1) {
 	SettingsManager::getInstance()->addListener(this);
 }
 
@@ -46,6 +47,12 @@ void UserMatchManager::setList(UserMatches&& newList, bool updateUsers) {
 	{
 		boost::unique_lock<boost::shared_mutex> lock(mutex);
 		const_cast<UserMatches&>(list) = move(newList);
+
+		inputs.clear();
+		for(auto& i: list) {
+			inputs.push_back(i.getInputs());
+		}
+		++version;
 	}
 
 	if(updateUsers) {
@@ -59,28 +66,53 @@ void UserMatchManager::match(OnlineUser& user) const {
 	boost::shared_lock<boost::shared_mutex> lock(mutex);
 
 	auto& identity = user.getIdentity();
+	auto& cache = user.getMatchCache();
+
+	// see which definitions have to be evaluated again
+	const int all = ~0;
+	auto changed = cache.update(version, list.size(), identity, FavoriteManager::getInstance()->getUsersVersion());
+	if(!changed) {
+		return;
+	}
+
+	bool modified = changed == all;
+	UserMatch::Fields values(user);
+	for(size_t i = 0, n = list.size(); i < n; ++i) {
+		if(changed == all || (inputs[i] & changed)) {
+			bool result = list[i].match(values);
+			if(result != cache.results[i]) {
+				cache.results[i] = result;
+				modified = true;
+			}
+		}
+	}
+
+	if(!modified) {
+		return;
+	}
 
 	bool chatSet = false;
 	Style style;
 
-	for(auto& i: list) {
-		if(i.match(user)) {
+	for(size_t i = 0, n = list.size(); i < n; ++i) {
+		if(cache.results[i]) {
+			auto& match = list[i];
 
-			if(!chatSet && (i.isSet(UserMatch::FORCE_CHAT) || i.isSet(UserMatch::IGNORE_CHAT))) {
-				identity.setNoChat(i.isSet(UserMatch::IGNORE_CHAT));
+			if(!chatSet && (match.isSet(UserMatch::FORCE_CHAT) || match.isSet(UserMatch::IGNORE_CHAT))) {
+				identity.setNoChat(match.isSet(UserMatch::IGNORE_CHAT));
 				chatSet = true;
 			}
 
-			if(style.font.empty() && !i.style.font.empty()) {
-				style.font = i.style.font;
+			if(style.font.empty() && !match.style.font.empty()) {
+				style.font = match.style.font;
 			}
 
-			if(style.textColor < 0 && i.style.textColor >= 0) {
-				style.textColor = i.style.textColor;
+			if(style.textColor < 0 && match.style.textColor >= 0) {
+				style.textColor = match.style.textColor;
 			}
 
-			if(style.bgColor < 0 && i.style.bgColor >= 0) {
-				style.bgColor = i.style.bgColor;
+			if(style.bgColor < 0 && match.style.bgColor >= 0) {
+				style.bgColor = match.style.bgColor;
 			}
 		}
 	}
@@ -51,7 +51,8 @@ public:
 	void setList(UserMatches&& newList, bool updateUsers = true);
 
 	/** Match the given user against current user matching definitions. The user's identity object
-	will be modified accordingly. */
+	will be modified accordingly. Only definitions that depend on fields which have changed since
+	the last time the user was matched are evaluated again. */
 	void match(OnlineUser& user) const;
 
 	/** Helper function that tells whether predefined definitions for favorites (pair.first) and
@@ -68,6 +69,8 @@ private:
 	friend class Singleton<UserMatchManager>;
 
 	const UserMatches list; // const to make sure only setList can change this.
+	vector<int> inputs; // what each definition depends on (UserMatch::INPUT_* flags).
+	uint32_t version; // changes along with the list, to invalidate what users have cached.
 	mutable boost::shared_mutex mutex; // shared to allow multiple readers (each hub).
 
 	UserMatchManager();
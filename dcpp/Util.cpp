@@ -58,6 +58,7 @@ namespace dcpp {
 
 using std::abs;
 using std::make_pair;
+using std::min;
 
 #ifndef _DEBUG
 FastCriticalSection FastAllocBase::cs;
@@ -832,8 +833,20 @@ wstring::size_type Util::findSubString(const wstring& aString, const wstring& aS
 }
 
 int Util::stricmp(const char* a, const char* b) {
+	auto lower = Text::getLowerTable();
 	wchar_t ca = 0, cb = 0;
 	while(*a) {
+		if(!(*a & 0x80) && !(*b & 0x80)) {
+			// ASCII on both sides; no need to decode
+			ca = lower[static_cast<uint8_t>(*a)];
+			cb = lower[static_cast<uint8_t>(*b)];
+			if(ca != cb) {
+				return (int)ca - (int)cb;
+			}
+			++a, ++b;
+			continue;
+		}
+
 		ca = cb = 0;
 		int na = Text::utf8ToWc(a, ca);
 		int nb = Text::utf8ToWc(b, cb);
@@ -852,9 +865,20 @@ int Util::stricmp(const char* a, const char* b) {
 }
 
 int Util::strnicmp(const char* a, const char* b, size_t n) {
+	auto lower = Text::getLowerTable();
 	const char* end = a + n;
 	wchar_t ca = 0, cb = 0;
 	while(*a && a < end) {
+		if(!(*a & 0x80) && !(*b & 0x80)) {
+			ca = lower[static_cast<uint8_t>(*a)];
+			cb = lower[static_cast<uint8_t>(*b)];
+			if(ca != cb) {
+				return (int)ca - (int)cb;
+			}
+			++a, ++b;
+			continue;
+		}
+
 		ca = cb = 0;
 		int na = Text::utf8ToWc(a, ca);
 		int nb = Text::utf8ToWc(b, cb);
@@ -872,6 +896,17 @@ int Util::strnicmp(const char* a, const char* b, size_t n) {
 	return (a >= end) ? 0 : ((int)Text::toLower(ca) - (int)Text::toLower(cb));
 }
 
+int Util::stricmp(const string& a, const string& b) {
+	// skip the common ASCII prefix in large steps
+	auto n = Text::commonPrefixNoCaseAscii(a.data(), b.data(), min(a.size(), b.size()));
+	return stricmp(a.c_str() + n, b.c_str() + n);
+}
+
+int Util::strnicmp(const string& a, const string& b, size_t n) {
+	auto common = Text::commonPrefixNoCaseAscii(a.data(), b.data(), min(n, min(a.size(), b.size())));
+	return strnicmp(a.c_str() + common, b.c_str() + common, n - common);
+}
+
 int compare(const std::string& a, const std::string& b) {
 	return compare(a.c_str(), b.c_str());
 }
@@ -1210,9 +1245,16 @@ bool Util::isNmdcsUrl(const string& aHubURL) {
 }
 
 size_t noCaseStringHash::operator()(const string& s) const {
+	auto lower = Text::getLowerTable();
 	size_t x = 0;
 	auto end = s.data() + s.size();
 	for(auto str = s.data(); str < end; ) {
+		if(!(*str & 0x80)) {
+			x = x * 32 - x + static_cast<size_t>(lower[static_cast<uint8_t>(*str)]);
+			++str;
+			continue;
+		}
+
 		wchar_t c = 0;
 		int n = Text::utf8ToWc(str, c);
 		if(n < 0) {
@@ -20,9 +20,11 @@
 
 #include "compiler.h"
 
+#include <charconv>
 #include <cstdlib>
 #include <ctime>
 #include <random>
+#include <string_view>
 
 #include <map>
 
@@ -265,6 +267,14 @@ public:
 #endif
 	}
 
+	/** For text that isn't null-terminated, such as attributes seen by SimpleXMLReader callbacks.
+	Only plain digits with an optional minus sign are understood. */
+	static int64_t toInt64(std::string_view aString) {
+		int64_t ret = 0;
+		std::from_chars(aString.data(), aString.data() + aString.size(), ret);
+		return ret;
+	}
+
 	static int toInt(const string& aString) {
 		return atoi(aString.c_str());
 	}
@@ -444,8 +454,8 @@ public:
 		return n == 0 ? 0 : ((int)Text::toLower(*a)) - ((int)Text::toLower(*b));
 	}
 
-	static int stricmp(const string& a, const string& b) { return stricmp(a.c_str(), b.c_str()); }
-	static int strnicmp(const string& a, const string& b, size_t n) { return strnicmp(a.c_str(), b.c_str(), n); }
+	static int stricmp(const string& a, const string& b);
+	static int strnicmp(const string& a, const string& b, size_t n);
 	static int stricmp(const wstring& a, const wstring& b) { return stricmp(a.c_str(), b.c_str()); }
 	static int strnicmp(const wstring& a, const wstring& b, size_t n) { return strnicmp(a.c_str(), b.c_str(), n); }
 
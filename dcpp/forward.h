@@ -40,6 +40,8 @@ class Client;
 
 class ClientManager;
 
+class CompactListing;
+
 class ConnectionQueueItem;
 
 class CRC32Filter;
@@ -90,6 +92,8 @@ typedef QueueItem* QueueItemPtr;
 class SearchResult;
 typedef boost::intrusive_ptr<SearchResult> SearchResultPtr;
 
+class SharedFile;
+
 class Socket;
 class SocketException;
 
@@ -17,3 +17,125 @@ TEST(testadc, test_adccommand)
 	ASSERT_EQ("DCTM " + sidStr + " " + sidStr2 + " param1 param2\n",
 		AdcCommand(AdcCommand::CMD_CTM, sid2, AdcCommand::TYPE_DIRECT).addParam("param1").addParam("param2").toString(sid));
 }
+
+namespace {
+
+// a slice of what a hub sends while users log in, search and answer searches
+const char* traffic[] = {
+	"BINF AAAB IDKAZGOXVHQDOL6QEKZX3LPLPOCUEQUG3WT5YHABDY PDUVXNLFGTSTTHAUZ4MIAJWJOHPGDJMHNIWBJNLAY NIsome\\suser\\swith\\sa\\sname "
+		"SS1256812349876 SF12345 VE++\\s0.868 SL3 HN5 HR0 HO1 US10485760 SUTCP4,UDP4,ADC0,SEGA I4192.168.1.12 U41412 "
+		"DEa\\sdescription\\\\with\\nescapes",
+	"BSCH AAAB TOauto1234 ANsome ANartist ANalbum NOflac EXmp3 EXflac GR2",
+	"BSCH AAAC TRKAZGOXVHQDOL6QEKZX3LPLPOCUEQUG3WT5YHABDY TOauto5678",
+	"DRES AAAB AAAC FN/Music/Some\\sArtist/Some\\sAlbum/01\\s-\\sA\\sTrack.flac SI31415926 SL3 TOauto1234 TRKAZGOXVHQDOL6QEKZX3LPLPOCUEQUG3WT5YHABDY",
+	"EMSG AAAB AAAC hello\\sthere,\\show\\sis\\sit\\sgoing? PMAAAB",
+	"IMSG Welcome\\sto\\sthe\\shub.\\nPlease\\sread\\sthe\\srules.",
+	"BINF AAAC SS1256812349900 SF12346",
+	"FSCH AAAD +TCP4-NAT0 TOauto91011 ANlinux ANiso",
+};
+
+}
+
+TEST(testadc, test_parse)
+{
+	AdcCommand c(traffic[0]);
+	ASSERT_EQ(uint32_t(AdcCommand::CMD_INF), c.getCommand());
+	ASSERT_EQ('B', c.getType());
+	ASSERT_EQ(AdcCommand::toFourCC("AAAB"), c.getFrom());
+
+	string nick;
+	ASSERT_TRUE(c.getParam("NI", 0, nick));
+	ASSERT_EQ("some user with a name", nick);
+	ASSERT_TRUE(c.getParam("DE", 0, nick));
+	ASSERT_EQ("a description\\with\nescapes", nick);
+	ASSERT_FALSE(c.getParam("XX", 0, nick));
+
+	AdcCommand d(traffic[3]);
+	ASSERT_EQ(AdcCommand::toFourCC("AAAC"), d.getTo());
+	ASSERT_EQ("FN/Music/Some Artist/Some Album/01 - A Track.flac", d.getParam(0));
+	ASSERT_EQ(5u, d.getParameters().size());
+
+	AdcCommand f(traffic[7]);
+	ASSERT_EQ(3u, f.getParameters().size());
+	ASSERT_EQ("TOauto91011", f.getParam(0));
+
+	// empty parameters in between are kept, a trailing one is not
+	ASSERT_EQ(3u, AdcCommand("HCMD a  b ").getParameters().size());
+
+	AdcCommand g("$ADCGET file a\\ b 0 -1", true);
+	ASSERT_EQ(uint32_t(AdcCommand::CMD_GET), g.getCommand());
+	ASSERT_EQ("a b", g.getParam(1));
+
+	ASSERT_THROW(AdcCommand("BIN"), ParseException);
+	ASSERT_THROW(AdcCommand("XINF AAAB"), ParseException);
+	ASSERT_THROW(AdcCommand("BINF AAA"), ParseException);
+	ASSERT_THROW(AdcCommand("DRES AAAB"), ParseException);
+	ASSERT_THROW(AdcCommand("BINF AAAB a\\"), ParseException);
+	ASSERT_THROW(AdcCommand("BINF AAAB a\\x"), ParseException);
+	ASSERT_THROW(AdcCommand("BGET AAAB a\\ b"), ParseException);
+}
+
+TEST(testadc, test_view)
+{
+	string line = traffic[0];
+	AdcCommand::View v(line);
+	ASSERT_EQ(uint32_t(AdcCommand::CMD_INF), v.getCommand());
+	ASSERT_EQ(AdcCommand::toFourCC("AAAB"), v.getFrom());
+	ASSERT_EQ("NIsome\\suser\\swith\\sa\\sname", v.getRawParam(2));
+	ASSERT_EQ(line.data() + line.find(" NI") + 1, v.getRawParam(2).data());
+
+	string value;
+	ASSERT_TRUE(v.getParam("NI", 0, value));
+	ASSERT_EQ("some user with a name", value);
+	ASSERT_TRUE(v.getParam("SL", 0, value));
+	ASSERT_EQ("3", value);
+	ASSERT_FALSE(v.getParam("SL", 9, value));
+	ASSERT_FALSE(v.hasFlag("SL", 0));
+
+	AdcCommand c(line);
+	ASSERT_EQ(c.getParameters().size(), v.getParamCount());
+	for(size_t i = 0; i < v.getParamCount(); ++i) {
+		v.getParam(i, value);
+		ASSERT_EQ(c.getParam(i), value);
+	}
+
+	// the view can be reused for the next line
+	v.parse(traffic[2]);
+	ASSERT_EQ(uint32_t(AdcCommand::CMD_SCH), v.getCommand());
+	ASSERT_EQ(2u, v.getParamCount());
+
+	v.parse(traffic[7]);
+	ASSERT_EQ("+TCP4-NAT0", v.getFeatures());
+
+	// a command made from a view is the one parsed from its line
+	AdcCommand fromView(v);
+	AdcCommand parsed(traffic[7]);
+	ASSERT_EQ(parsed.getCommand(), fromView.getCommand());
+	ASSERT_EQ(parsed.getFrom(), fromView.getFrom());
+	ASSERT_EQ(parsed.getParameters(), fromView.getParameters());
+	ASSERT_EQ(parsed.toString(AdcCommand::toFourCC("AAAB")), fromView.toString(AdcCommand::toFourCC("AAAB")));
+}
+
+TEST(testadc, test_escape)
+{
+	ASSERT_EQ("a\\sb\\nc\\\\d", AdcCommand::escape("a b\nc\\d", false));
+	ASSERT_EQ("a\\ b\\\nc\\\\d", AdcCommand::escape("a b\nc\\d", true));
+	ASSERT_EQ("plain", AdcCommand::escape("plain", false));
+
+	string out = "x";
+	AdcCommand::escape("y z", false, out);
+	ASSERT_EQ("xy\\sz", out);
+
+	// what is sent is parsed back the same
+	for(auto line: traffic) {
+		AdcCommand c(line);
+		if(c.getType() == AdcCommand::TYPE_FEATURE) {
+			continue;
+		}
+		ASSERT_EQ(string(line) + "\n", c.toString(c.getFrom()));
+
+		string reused;
+		c.toString(c.getFrom(), false, reused);
+		ASSERT_EQ(string(line) + "\n", reused);
+	}
+}
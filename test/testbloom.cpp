@@ -1,5 +1,6 @@
 #include "testbase.h"
 
+#include <dcpp/BloomFilter.h>
 #include <dcpp/HashBloom.h>
 #include <dcpp/HashValue.h>
 #include <dcpp/TigerHash.h>
@@ -122,3 +123,98 @@ TEST(testbloom, test_9)
 	ASSERT_EQ("AAAAAAACAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAABAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA",
 		HashValue<Hasher>(&v[0]).toBase32());
 }
+
+TEST(testbloom, test_match)
+{
+	HashBloom bloom;
+	bloom.reset(HashBloom::get_k(1000, 24), HashBloom::get_m(1000, HashBloom::get_k(1000, 24)), 24);
+
+	vector<TTHValue> added;
+	for(int i = 0; i < 1000; ++i) {
+		TigerHash th;
+		th.update(&i, sizeof(i));
+		added.push_back(TTHValue(th.finalize()));
+		bloom.add(added.back());
+	}
+	for(auto& tth: added) {
+		ASSERT_TRUE(bloom.match(tth));
+	}
+
+	ByteVector v;
+	bloom.copy_to(v);
+	ASSERT_EQ(bloom.get_m() / 8, v.size());
+
+	// clearing keeps the parameters
+	bloom.clear();
+	ASSERT_FALSE(bloom.match(added[0]));
+	ASSERT_EQ(24u, bloom.get_h());
+}
+
+TEST(testbloom, test_positions)
+{
+	// the bits of each hash, taken one at a time like the spec describes them
+	auto reference = [](const TTHValue& tth, size_t k, size_t m, size_t h) {
+		ByteVector v(m / 8);
+		for(size_t n = 0; n < k && (n + 1) * h <= TTHValue::BITS; ++n) {
+			uint64_t x = 0;
+			for(size_t i = 0; i < h; ++i) {
+				size_t bit = n * h + i;
+				if(tth.data[bit / 8] & (1 << (bit % 8))) {
+					x |= static_cast<uint64_t>(1) << i;
+				}
+			}
+			x %= m;
+			v[x / 8] |= 1 << (x % 8);
+		}
+		return v;
+	};
+
+	for(size_t h = 1; h <= 64; ++h) {
+		for(int i = 0; i < 20; ++i) {
+			TigerHash th;
+			th.update(&i, sizeof(i));
+			TTHValue tth(th.finalize());
+
+			size_t k = std::min(TTHValue::BITS / h, static_cast<size_t>(8));
+			size_t m = 64 * (7 + i);
+
+			HashBloom bloom;
+			bloom.reset(k, m, h);
+			bloom.add(tth);
+			ByteVector v;
+			bloom.copy_to(v);
+			ASSERT_EQ(reference(tth, k, m, h), v);
+		}
+	}
+}
+
+TEST(testbloom, test_filter)
+{
+	BloomFilter<5> bloom(1 << 16);
+	bloom.add("some artist - a track title.flac");
+	bloom.add("another file.mp3");
+
+	ASSERT_TRUE(bloom.match("artist"));
+	ASSERT_TRUE(bloom.match("track title"));
+	ASSERT_TRUE(bloom.match(StringList { "anoth", "file.mp3" }));
+	// too short to be filtered
+	ASSERT_TRUE(bloom.match("xyz"));
+	ASSERT_FALSE(bloom.match("nothing like it"));
+
+	bloom.clear();
+	ASSERT_FALSE(bloom.match("artist"));
+
+	// with 10000 names in a table of the default size, few of the strings that weren't added match
+	BloomFilter<5> share(1 << 20);
+	for(int i = 0; i < 10000; ++i) {
+		share.add("file number " + std::to_string(i) + ".ext");
+	}
+	for(int i = 0; i < 10000; ++i) {
+		ASSERT_TRUE(share.match("number " + std::to_string(i) + "."));
+	}
+	int hits = 0;
+	for(int i = 0; i < 10000; ++i) {
+		hits += share.match("other " + std::to_string(i) + " name");
+	}
+	ASSERT_LT(hits, 100);
+}
@@ -0,0 +1,137 @@
+#include "testbase.h"
+
+#include <dcpp/BZUtils.h>
+#include <dcpp/CompactListing.h>
+#include <dcpp/File.h>
+#include <dcpp/FilteredFile.h>
+#include <dcpp/SettingsManager.h>
+#include <dcpp/Streams.h>
+#include <dcpp/Util.h>
+
+using namespace dcpp;
+
+namespace {
+
+const string tth1 = "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA";
+const string tth2 = "BBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBB";
+
+void load(CompactListing& l, const string& xml) {
+	MemoryInputStream mis(xml);
+	l.loadXML(mis);
+}
+
+}
+
+TEST(testcompactlisting, test_load)
+{
+	CompactListing l(HintedUser(UserPtr(), Util::emptyString));
+	load(l, "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\"?>"
+		"<FileListing Version=\"1\" Base=\"/\">"
+		"<Directory Name=\"Music\">"
+			"<Directory Name=\"b\"><File Name=\"z.mp3\" Size=\"3\" TTH=\"" + tth1 + "\"/></Directory>"
+			"<Directory Name=\"A\" Incomplete=\"1\"/>"
+			"<File Name=\"cover.jpg\" Size=\"2\" TTH=\"" + tth2 + "\"/>"
+			"<File Name=\"Album.nfo\" Size=\"1\" TTH=\"" + tth1 + "\"/>"
+		"</Directory>"
+		"<Directory Name=\"Films\"/>"
+		"<File Name=\"readme.txt\" Size=\"4\" TTH=\"" + tth2 + "\"/>"
+		"</FileListing>");
+
+	ASSERT_EQ(5u, l.getDirectoryCount());
+	ASSERT_EQ(4u, l.getFileCount());
+
+	auto& root = l.getRoot();
+	ASSERT_TRUE(root.complete);
+	ASSERT_EQ(2u, root.dirCount);
+	ASSERT_EQ(1u, root.fileCount);
+
+	// children come sorted by name, without regard to case
+	auto dirs = l.getDirectories(root);
+	ASSERT_STREQ("Films", l.getName(dirs[0]));
+	ASSERT_STREQ("Music", l.getName(dirs[1]));
+
+	auto music = l.findDirectory("music\\");
+	ASSERT_TRUE(music);
+	ASSERT_EQ(&dirs[1], music);
+	ASSERT_EQ(&root, &l.getParent(*music));
+
+	auto sub = l.getDirectories(*music);
+	ASSERT_EQ(2u, sub.size());
+	ASSERT_STREQ("A", l.getName(sub[0]));
+	ASSERT_FALSE(sub[0].complete);
+	ASSERT_STREQ("b", l.getName(sub[1]));
+	ASSERT_TRUE(sub[1].complete);
+
+	auto files = l.getFiles(*music);
+	ASSERT_EQ(2u, files.size());
+	ASSERT_STREQ("Album.nfo", l.getName(files[0]));
+	ASSERT_EQ(1, files[0].size);
+	ASSERT_EQ(TTHValue(tth1), l.getTTH(files[0]));
+	ASSERT_STREQ("cover.jpg", l.getName(files[1]));
+	ASSERT_EQ(TTHValue(tth2), l.getTTH(files[1]));
+
+	auto b = l.findDirectory("Music\\B\\");
+	ASSERT_TRUE(b);
+	auto z = l.findFile(*b, "Z.MP3");
+	ASSERT_TRUE(z);
+	ASSERT_EQ(3, z->size);
+	ASSERT_EQ(b, &l.getParent(*z));
+
+	ASSERT_FALSE(l.findDirectory("Music\\c\\"));
+	ASSERT_FALSE(l.findFile(*b, "y.mp3"));
+	ASSERT_TRUE(l.findFile(root, "readme.txt"));
+}
+
+TEST(testcompactlisting, test_base)
+{
+	CompactListing l(HintedUser(UserPtr(), Util::emptyString));
+	load(l, "<FileListing Version=\"1\" Base=\"/Music/Rock/\">"
+		"<File Name=\"a.mp3\" Size=\"1\" TTH=\"" + tth1 + "\"/>"
+		"</FileListing>");
+
+	ASSERT_FALSE(l.getRoot().complete);
+	auto rock = l.findDirectory("Music\\Rock\\");
+	ASSERT_TRUE(rock);
+	ASSERT_TRUE(rock->complete);
+	ASSERT_TRUE(l.findFile(*rock, "a.mp3"));
+}
+
+TEST(testcompactlisting, test_duplicate)
+{
+	CompactListing l(HintedUser(UserPtr(), Util::emptyString));
+	ASSERT_THROW(load(l, "<FileListing Version=\"1\" Base=\"/\">"
+		"<File Name=\"a.mp3\" Size=\"1\" TTH=\"" + tth1 + "\"/>"
+		"<File Name=\"A.MP3\" Size=\"1\" TTH=\"" + tth1 + "\"/>"
+		"</FileListing>"), Exception);
+}
+
+TEST(testcompactlisting, test_load_bz2)
+{
+	SettingsManager::newInstance();
+
+	const string path = "test/data/out/compactlisting.xml";
+	const string xml = "<FileListing Version=\"1\" Base=\"/\">"
+		"<File Name=\"a.mp3\" Size=\"1\" TTH=\"" + tth1 + "\"/>"
+		"</FileListing>";
+	{
+		File f(path + ".bz2", File::WRITE, File::CREATE | File::TRUNCATE);
+		FilteredOutputStream<BZFilter, false> bz(&f);
+		bz.write(xml);
+		bz.flush();
+	}
+
+	CompactListing l(HintedUser(UserPtr(), Util::emptyString));
+	l.loadFile(path);
+	ASSERT_TRUE(l.findFile(l.getRoot(), "a.mp3"));
+
+	// the list is kept uncompressed
+	ASSERT_EQ(-1, File::getSize(path + ".bz2"));
+	ASSERT_EQ(xml, File(path, File::READ, File::OPEN).read());
+
+	CompactListing again(HintedUser(UserPtr(), Util::emptyString));
+	again.loadFile(path);
+	ASSERT_TRUE(again.findFile(again.getRoot(), "a.mp3"));
+
+	File::deleteFile(path);
+	SettingsManager::deleteInstance();
+}
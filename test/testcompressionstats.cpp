@@ -0,0 +1,57 @@
+#include "testbase.h"
+
+#include <dcpp/CompressionStats.h>
+
+using namespace dcpp;
+
+namespace {
+
+const TTHValue tth1("AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA");
+const TTHValue tth2("BBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBBB");
+const TTHValue tth3("CCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCCC");
+
+const int64_t MiB = 1024 * 1024;
+
+}
+
+TEST(testcompressionstats, test_files)
+{
+	CompressionStats stats;
+
+	// nothing known yet
+	ASSERT_TRUE(stats.worthCompressing(tth1, "/share/a.mkv"));
+
+	// too little read to tell
+	stats.add(tth1, "/share/a.mkv", 1000, 1000);
+	ASSERT_EQ(0u, stats.getFileCount());
+
+	stats.add(tth1, "/share/a.mkv", MiB / 2, MiB / 2);
+	ASSERT_FALSE(stats.worthCompressing(tth1, "/share/a.mkv"));
+	// the extension hasn't seen enough yet
+	ASSERT_TRUE(stats.worthCompressing(tth2, "/share/b.mkv"));
+
+	stats.add(tth2, "/share/b.MKV", MiB, MiB - 10);
+	ASSERT_FALSE(stats.worthCompressing(tth3, "/share/c.mkv"));
+
+	// the file has the last word over its extension
+	stats.add(tth3, "/share/c.mkv", MiB, MiB / 4);
+	ASSERT_TRUE(stats.worthCompressing(tth3, "/share/c.mkv"));
+
+	ASSERT_TRUE(stats.worthCompressing(tth3, "/share/d.txt"));
+	ASSERT_EQ(3u, stats.getFileCount());
+
+	stats.clear();
+	ASSERT_TRUE(stats.worthCompressing(tth1, "/share/a.mkv"));
+}
+
+TEST(testcompressionstats, test_limit)
+{
+	CompressionStats stats;
+
+	for(size_t i = 0; i < CompressionStats::MAX_FILES + 10; ++i) {
+		TigerHash t;
+		t.update(&i, sizeof(i));
+		stats.add(TTHValue(t.finalize()), "x.bin", MiB, MiB);
+	}
+	ASSERT_EQ(CompressionStats::MAX_FILES + 0, stats.getFileCount());
+}
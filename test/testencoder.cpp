@@ -0,0 +1,131 @@
+#include "testbase.h"
+
+#include <dcpp/CID.h>
+#include <dcpp/Encoder.h>
+#include <dcpp/MerkleTree.h>
+
+#include <random>
+
+using namespace dcpp;
+
+namespace {
+
+const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+
+// the bit by bit codec the encoder used to have
+string referenceTo(const uint8_t* src, size_t len) {
+	string dst;
+	size_t i, index;
+	uint8_t word;
+	for(i = 0, index = 0; i < len;) {
+		if(index > 3) {
+			word = (uint8_t)(src[i] & (0xFF >> index));
+			index = (index + 5) % 8;
+			word <<= index;
+			if((i + 1) < len)
+				word |= src[i + 1] >> (8 - index);
+			i++;
+		} else {
+			word = (uint8_t)(src[i] >> (8 - (index + 5))) & 0x1F;
+			index = (index + 5) % 8;
+			if(index == 0)
+				i++;
+		}
+		dst += alphabet[word];
+	}
+	return dst;
+}
+
+void referenceFrom(const string& src, uint8_t* dst, size_t len) {
+	size_t i, index, offset;
+	memset(dst, 0, len);
+	for(i = 0, index = 0, offset = 0; i < src.size(); i++) {
+		auto c = src[i];
+		int tmp = c >= 'A' && c <= 'Z' ? c - 'A' : c >= 'a' && c <= 'z' ? c - 'a' : c >= '2' && c <= '7' ? c - '2' + 26 : -1;
+		if(tmp == -1)
+			continue;
+		if(index <= 3) {
+			index = (index + 5) % 8;
+			if(index == 0) {
+				dst[offset] |= tmp;
+				offset++;
+				if(offset == len)
+					break;
+			} else {
+				dst[offset] |= tmp << (8 - index);
+			}
+		} else {
+			index = (index + 5) % 8;
+			dst[offset] |= (tmp >> index);
+			offset++;
+			if(offset == len)
+				break;
+			dst[offset] |= tmp << (8 - index);
+		}
+	}
+}
+
+}
+
+TEST(testencoder, test_base32)
+{
+	TTHValue tth("LWPNACQDBZRYXW3VHJVCJ64QBZNGHOHHHZWCLNQ");
+	ASSERT_EQ("LWPNACQDBZRYXW3VHJVCJ64QBZNGHOHHHZWCLNQ", tth.toBase32());
+	ASSERT_EQ(tth, TTHValue("lwpnacqdbzryxw3vhjvcj64qbznghohhhzwclnq"));
+
+	string out = "x";
+	uint8_t foo[] = { 'f', 'o', 'o' };
+	ASSERT_EQ("xMZXW6", Encoder::toBase32(foo, sizeof(foo), out));
+	ASSERT_EQ("", Encoder::toBase32(foo, 0));
+
+	uint8_t buf[TTHValue::BYTES];
+	ASSERT_TRUE(Encoder::fromBase32("LWPNACQDBZRYXW3VHJVCJ64QBZNGHOHHHZWCLNQ", 39, buf, sizeof(buf), true));
+	ASSERT_EQ(0, memcmp(buf, tth.data, sizeof(buf)));
+	// lowercase, wrong length, characters outside the alphabet and padding bits are only accepted leniently
+	ASSERT_FALSE(Encoder::fromBase32("lwpnacqdbzryxw3vhjvcj64qbznghohhhzwclnq", 39, buf, sizeof(buf), true));
+	ASSERT_FALSE(Encoder::fromBase32("LWPNACQDBZRYXW3VHJVCJ64QBZNGHOHHHZWCLN", 38, buf, sizeof(buf), true));
+	ASSERT_FALSE(Encoder::fromBase32("LWPNACQDBZRYXW3VHJVCJ64QBZNGHOHHHZWCLN1", 39, buf, sizeof(buf), true));
+	ASSERT_FALSE(Encoder::fromBase32("LWPNACQDBZRYXW3VHJVCJ64QBZNGHOHHHZWCLNR", 39, buf, sizeof(buf), true));
+	ASSERT_TRUE(Encoder::fromBase32("LWPNACQDBZRYXW3VHJVCJ64QBZNGHOHHHZWCLNR", 39, buf, sizeof(buf), false));
+	ASSERT_EQ(0, memcmp(buf, tth.data, sizeof(buf)));
+}
+
+TEST(testencoder, test_fuzz)
+{
+	std::mt19937 rng(42);
+	const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567abcxyz01189=\n\xc3\xa9";
+
+	for(int round = 0; round < 20000; ++round) {
+		size_t len = round % 3 == 0 ? TTHValue::BYTES : rng() % 64;
+		ByteVector data(len + 1);
+		for(auto& b: data) {
+			b = static_cast<uint8_t>(rng());
+		}
+
+		auto encoded = Encoder::toBase32(&data[0], len);
+		ASSERT_EQ(referenceTo(&data[0], len), encoded);
+
+		ByteVector decoded(len + 1, 0);
+		ASSERT_TRUE(Encoder::fromBase32(encoded.data(), encoded.size(), &decoded[0], len, true));
+		ASSERT_TRUE(std::equal(data.begin(), data.begin() + len, decoded.begin()));
+
+		// mangle the string: other characters, other lengths
+		string text = encoded;
+		switch(rng() % 4) {
+		case 0: if(!text.empty()) text[rng() % text.size()] = chars[rng() % (sizeof(chars) - 1)]; break;
+		case 1: text.insert(rng() % (text.size() + 1), 1, chars[rng() % (sizeof(chars) - 1)]); break;
+		case 2: if(!text.empty()) text.erase(rng() % text.size(), 1); break;
+		case 3: for(auto& c: text) c = chars[rng() % (sizeof(chars) - 1)]; break;
+		}
+
+		ByteVector lenient(len + 1, 0xff), expected(len + 1, 0xff);
+		ASSERT_TRUE(Encoder::fromBase32(text.data(), text.size(), &lenient[0], len, false));
+		referenceFrom(text, &expected[0], len);
+		ASSERT_EQ(expected, lenient);
+
+		// strictly, only what the encoder would have written is accepted
+		ByteVector strict(len + 1, 0);
+		bool accepted = Encoder::fromBase32(text.data(), text.size(), &strict[0], len, true);
+		ASSERT_EQ(accepted, text == Encoder::toBase32(&expected[0], len));
+	}
+}
@@ -0,0 +1,141 @@
+#include "testbase.h"
+
+#include <dcpp/File.h>
+#include <dcpp/Util.h>
+
+using namespace dcpp;
+
+namespace {
+
+string tempPath(const string& name) {
+#ifdef _WIN32
+	return Util::getTempPath() + name;
+#else
+	return "/tmp/dcpp-testfile-" + name;
+#endif
+}
+
+string makeData(size_t size) {
+	string data(size, 0);
+	uint32_t x = 1;
+	for(auto& c: data) {
+		x = x * 1103515245 + 12345;
+		c = static_cast<char>(x >> 24);
+	}
+	return data;
+}
+
+void writeFile(const string& path, const string& data) {
+	File f(path, File::WRITE, File::CREATE | File::TRUNCATE);
+	f.write(data);
+}
+
+}
+
+TEST(testfile, test_allocate)
+{
+	const int64_t size = 5 * 1024 * 1024 + 3;
+	auto path = tempPath("allocate");
+
+	for(auto allocation: { File::ALLOC_NONE, File::ALLOC_SPARSE, File::ALLOC_FULL }) {
+		{
+			File f(path, File::WRITE, File::CREATE | File::TRUNCATE);
+			f.setPos(10);
+			f.setSize(size, allocation);
+			ASSERT_EQ(size, f.getSize());
+			// the position is left alone
+			f.write("x", 1);
+			ASSERT_EQ(11, f.getPos());
+
+			// and so are the contents when growing a file already written to
+			f.setSize(size + 1, allocation);
+			ASSERT_EQ(size + 1, f.getSize());
+		}
+
+		File f(path, File::READ, File::OPEN);
+		auto data = f.read();
+		ASSERT_EQ(static_cast<size_t>(size + 1), data.size());
+		ASSERT_EQ('x', data[10]);
+		ASSERT_EQ(string(10, 0), data.substr(0, 10));
+		ASSERT_EQ(0, data[size]);
+	}
+
+#ifndef _WIN32
+	struct stat s;
+	{
+		File f(path, File::WRITE, File::CREATE | File::TRUNCATE);
+		f.setSize(size, File::ALLOC_SPARSE);
+	}
+	ASSERT_EQ(0, stat(path.c_str(), &s));
+	ASSERT_LT(s.st_blocks * 512, size);
+#endif
+
+	File::deleteFile(path);
+}
+
+TEST(testfile, test_copy)
+{
+	auto source = tempPath("source"), target = tempPath("target"), moved = tempPath("moved");
+
+	for(size_t size: { size_t(0), size_t(1), size_t(100000), size_t(40 * 1024 * 1024 + 7) }) {
+		auto data = makeData(size);
+		writeFile(source, data);
+
+		int64_t lastCopied = -1, lastTotal = -1;
+		int calls = 0;
+		File::copyFile(source, target, [&](int64_t copied, int64_t total) {
+			ASSERT_GT(copied, lastCopied);
+			lastCopied = copied;
+			lastTotal = total;
+			++calls;
+		});
+
+		ASSERT_EQ(data, File(target, File::READ, File::OPEN).read());
+		if(size > 0) {
+			// the last call has the whole file
+			ASSERT_EQ(static_cast<int64_t>(size), lastCopied);
+			ASSERT_EQ(static_cast<int64_t>(size), lastTotal);
+			ASSERT_LE(calls, 3);
+		}
+
+		// an existing target gets overwritten
+		File::copyFile(target, source);
+		ASSERT_EQ(data, File(source, File::READ, File::OPEN).read());
+	}
+
+	File::renameFile(target, moved);
+	ASSERT_EQ(-1, File::getSize(target));
+	ASSERT_EQ(40 * 1024 * 1024 + 7, File::getSize(moved));
+
+	ASSERT_THROW(File::copyFile(target, source), FileException);
+
+	File::deleteFile(source);
+	File::deleteFile(moved);
+}
+
+TEST(testfile, test_read_at)
+{
+	auto path = tempPath("readat");
+	auto data = makeData(100000);
+	writeFile(path, data);
+
+	File f(path, File::READ, File::OPEN);
+	f.setPos(10);
+
+	char buf[100];
+	ASSERT_EQ(sizeof(buf), f.readAt(buf, sizeof(buf), 50000));
+	ASSERT_EQ(data.substr(50000, sizeof(buf)), string(buf, sizeof(buf)));
+
+	// short at the end of the file
+	ASSERT_EQ(20u, f.readAt(buf, sizeof(buf), 100000 - 20));
+	ASSERT_EQ(data.substr(100000 - 20), string(buf, 20));
+	ASSERT_EQ(0u, f.readAt(buf, sizeof(buf), 200000));
+
+#ifndef _WIN32
+	// the file pointer is left alone
+	ASSERT_EQ(10, f.getPos());
+#endif
+
+	f.close();
+	File::deleteFile(path);
+}
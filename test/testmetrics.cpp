@@ -0,0 +1,83 @@
+#include "testbase.h"
+
+#include <dcpp/Metrics.h>
+
+using namespace dcpp;
+
+TEST(testmetrics, test_buckets)
+{
+	const size_t buckets = Histogram::BUCKETS;
+
+	// every value falls in the bucket whose range holds it
+	for(uint64_t v: { 0ull, 1ull, 7ull, 8ull, 9ull, 15ull, 16ull, 17ull, 100ull, 1000ull, 123456789ull, ~0ull }) {
+		auto b = Histogram::getBucket(v);
+		ASSERT_LT(b, buckets);
+		ASSERT_LE(Histogram::getLowest(b), v);
+		if(b + 1 < buckets) {
+			ASSERT_GT(Histogram::getLowest(b + 1), v);
+		}
+	}
+
+	// and buckets are no wider than an eighth of their values
+	for(size_t b = Histogram::SUB_BUCKETS; b + 1 < buckets; ++b) {
+		auto low = Histogram::getLowest(b), width = Histogram::getLowest(b + 1) - low;
+		ASSERT_LE(width * Histogram::SUB_BUCKETS, low);
+	}
+}
+
+TEST(testmetrics, test_histogram)
+{
+	Histogram h;
+	ASSERT_EQ(0u, h.getPercentile(0.5));
+
+	for(uint64_t i = 1; i <= 1000; ++i) {
+		h.record(i);
+	}
+
+	ASSERT_EQ(1000u, h.getCount());
+	ASSERT_EQ(500500u, h.getSum());
+	ASSERT_EQ(1000u, h.getMax());
+
+	auto p50 = h.getPercentile(0.5);
+	ASSERT_GE(p50, 500u);
+	ASSERT_LE(p50, 500u + 500u / Histogram::SUB_BUCKETS);
+	auto p99 = h.getPercentile(0.99);
+	ASSERT_GE(p99, 990u);
+	ASSERT_LE(p99, 1000u);
+	ASSERT_EQ(1000u, h.getPercentile(1));
+}
+
+TEST(testmetrics, test_registry)
+{
+	auto& c = Metrics::counter("test.counter");
+	ASSERT_EQ(&c, &Metrics::counter("test.counter"));
+	c.add();
+	c.add(2);
+	ASSERT_EQ(3, Metrics::getValue("test.counter"));
+
+	Metrics::gauge("test.gauge").set(-5);
+	ASSERT_EQ(-5, Metrics::getValue("test.gauge"));
+
+	Metrics::histogram("test.histogram").record(10);
+	ASSERT_EQ(1, Metrics::getValue("test.histogram"));
+
+	int a = 0, b = 0;
+	Metrics::addValue("test.value", &a, [] { return 42; });
+	ASSERT_EQ(42, Metrics::getValue("test.value"));
+
+	// replaced by another owner; the first one can't remove it anymore
+	Metrics::addValue("test.value", &b, [] { return 43; });
+	Metrics::removeValue("test.value", &a);
+	ASSERT_EQ(43, Metrics::getValue("test.value"));
+	Metrics::removeValue("test.value", &b);
+	ASSERT_EQ(0, Metrics::getValue("test.value"));
+
+	auto dump = Metrics::dump();
+	ASSERT_NE(string::npos, dump.find("counter test.counter 3\n"));
+	ASSERT_NE(string::npos, dump.find("gauge test.gauge -5\n"));
+	ASSERT_NE(string::npos, dump.find("histogram test.histogram count=1 sum=10 "));
+	ASSERT_EQ(string::npos, dump.find("test.value"));
+	// sorted by name
+	ASSERT_LT(dump.find("test.counter"), dump.find("test.gauge"));
+	ASSERT_LT(dump.find("test.gauge"), dump.find("test.histogram"));
+}
@@ -0,0 +1,95 @@
+#include "testbase.h"
+
+#include <dcpp/BZUtils.h>
+#include <dcpp/FilteredFile.h>
+#include <dcpp/ParallelUnBZ.h>
+#include <dcpp/Streams.h>
+#include <dcpp/Util.h>
+
+using namespace dcpp;
+
+namespace {
+
+/** Some file list like text, compressible but not too much. */
+string makeText(size_t size) {
+	string ret;
+	uint32_t x = 12345;
+	while(ret.size() < size) {
+		x = x * 1103515245 + 12345;
+		ret += "<File Name=\"" + Util::toString(x % 100000) + " - Some Artist - A Track Title.flac\" Size=\"" + Util::toString(x % 1000000007) + "\"/>\r\n";
+	}
+	return ret;
+}
+
+string compress(const string& text) {
+	MemoryInputStream mis(text);
+	FilteredInputStream<BZFilter, false> f(&mis);
+
+	string ret;
+	char buf[64 * 1024];
+	for(;;) {
+		size_t len = sizeof(buf);
+		auto n = f.read(buf, len);
+		if(n == 0) {
+			break;
+		}
+		ret.append(buf, n);
+	}
+	return ret;
+}
+
+string readAll(InputStream& is, size_t chunk) {
+	string ret;
+	string buf(chunk, '\0');
+	for(;;) {
+		size_t len = chunk;
+		auto n = is.read(&buf[0], len);
+		if(n == 0) {
+			break;
+		}
+		ret.append(buf, 0, n);
+	}
+	return ret;
+}
+
+}
+
+TEST(testparallelunbz, test_blocks)
+{
+	// several blocks of 900 KiB
+	auto text = makeText(5 * 1024 * 1024);
+	auto compressed = compress(text);
+
+	for(size_t threads = 1; threads <= 4; ++threads) {
+		ParallelUnBZ unbz(string(compressed), threads);
+		ASSERT_EQ(text, readAll(unbz, 1000 + threads));
+		ASSERT_EQ(static_cast<int64_t>(compressed.size()), unbz.getPos());
+	}
+}
+
+TEST(testparallelunbz, test_small)
+{
+	for(auto& text: { string(), string("x"), makeText(1000) }) {
+		ParallelUnBZ unbz(compress(text), 4);
+		ASSERT_EQ(text, readAll(unbz, 64 * 1024));
+	}
+}
+
+TEST(testparallelunbz, test_corrupt)
+{
+	auto text = makeText(3 * 1024 * 1024);
+	auto compressed = compress(text);
+
+	// damage the second block; whatever happens to be found, the result can't come out right
+	compressed[compressed.size() / 2] ^= 0x10;
+	ASSERT_THROW({
+		ParallelUnBZ unbz(string(compressed), 2);
+		readAll(unbz, 64 * 1024);
+	}, Exception);
+
+	// not bzip2 at all
+	ASSERT_THROW({
+		ParallelUnBZ unbz(string("<FileListing/>"), 2);
+		readAll(unbz, 64 * 1024);
+	}, Exception);
+}
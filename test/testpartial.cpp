@@ -0,0 +1,236 @@
+#include "testbase.h"
+
+#include <dcpp/ClientManager.h>
+#include <dcpp/File.h>
+#include <dcpp/HashManager.h>
+#include <dcpp/QueueItem.h>
+#include <dcpp/QueueManager.h>
+#include <dcpp/SearchManager.h>
+#include <dcpp/SettingsManager.h>
+#include <dcpp/SimpleXML.h>
+#include <dcpp/TimerManager.h>
+#include <dcpp/Util.h>
+#include <dcpp/version.h>
+
+using namespace dcpp;
+
+namespace {
+
+const int64_t blockSize = 64 * 1024;
+
+typedef QueueItem::PartsInfo PartsInfo;
+
+string tempPath(const string& name) {
+#ifdef _WIN32
+	return Util::getTempPath() + "dcpp-testpartial-" + name;
+#else
+	return "/tmp/dcpp-testpartial-" + name;
+#endif
+}
+
+QueueItem makeItem(int64_t size, const vector<Segment>& done = vector<Segment>()) {
+	QueueItem qi(tempPath("file"), size, QueueItem::NORMAL, 0, 0, TTHValue());
+	for(auto& i: done) {
+		qi.addSegment(i);
+	}
+	return qi;
+}
+
+}
+
+TEST(testpartial, test_parts_info)
+{
+	// whole blocks only, save for the short last one of the file
+	auto qi = makeItem(10 * blockSize + 100, {
+		Segment(0, 3 * blockSize + 10),
+		Segment(5 * blockSize - 1, 2 * blockSize + 1),
+		Segment(8 * blockSize + 1, blockSize),
+		Segment(10 * blockSize, 100)
+	});
+	ASSERT_EQ(PartsInfo({ 0, 3, 5, 7, 10, 11 }), qi.getPartsInfo(blockSize));
+
+	ASSERT_TRUE(makeItem(10 * blockSize).getPartsInfo(blockSize).empty());
+
+	// adjacent segments are merged into one part
+	auto merged = makeItem(10 * blockSize, { Segment(0, blockSize), Segment(blockSize, blockSize) });
+	ASSERT_EQ(PartsInfo({ 0, 2 }), merged.getPartsInfo(blockSize));
+
+	// no more than fit in a UDP packet
+	vector<Segment> done;
+	for(int64_t i = 0; i < 1000; i += 2) {
+		done.emplace_back(i * blockSize, blockSize);
+	}
+	auto parts = makeItem(1000 * blockSize, done).getPartsInfo(blockSize);
+	ASSERT_EQ(255u * 2, parts.size());
+	ASSERT_EQ(508, parts[parts.size() - 2]);
+	ASSERT_EQ(509, parts.back());
+}
+
+TEST(testpartial, test_is_done)
+{
+	auto qi = makeItem(10 * blockSize, { Segment(blockSize, 2 * blockSize), Segment(5 * blockSize, 5 * blockSize) });
+
+	ASSERT_TRUE(qi.isDone(0, 0));
+	ASSERT_TRUE(qi.isDone(blockSize, 2 * blockSize));
+	ASSERT_TRUE(qi.isDone(blockSize + 10, 10));
+	ASSERT_TRUE(qi.isDone(5 * blockSize, 5 * blockSize));
+
+	ASSERT_FALSE(qi.isDone(0, 1));
+	ASSERT_FALSE(qi.isDone(blockSize - 1, 2));
+	ASSERT_FALSE(qi.isDone(2 * blockSize, 2 * blockSize));
+	ASSERT_FALSE(qi.isDone(blockSize, 5 * blockSize));
+	ASSERT_FALSE(qi.isDone(9 * blockSize, 2 * blockSize));
+
+	// filling the gap makes the range between them done
+	qi.addSegment(Segment(3 * blockSize, 2 * blockSize));
+	ASSERT_TRUE(qi.isDone(blockSize, 9 * blockSize));
+}
+
+TEST(testpartial, test_next_segment)
+{
+	SettingsManager::newInstance();
+
+	// only blocks the source has are asked for
+	auto qi = makeItem(8 * blockSize);
+	PartsInfo parts { 2, 3, 6, 8 };
+	ASSERT_EQ(Segment(2 * blockSize, blockSize), qi.getNextSegment(blockSize, blockSize, &parts));
+	ASSERT_EQ(Segment(0, blockSize), qi.getNextSegment(blockSize, blockSize));
+
+	qi.addSegment(Segment(2 * blockSize, blockSize));
+	ASSERT_EQ(Segment(6 * blockSize, blockSize), qi.getNextSegment(blockSize, blockSize, &parts));
+
+	qi.addSegment(Segment(6 * blockSize, 2 * blockSize));
+	ASSERT_EQ(0, qi.getNextSegment(blockSize, blockSize, &parts).getSize());
+
+	// the last block of the file may be short
+	auto shortLast = makeItem(7 * blockSize + 10);
+	parts = { 7, 8 };
+	ASSERT_EQ(Segment(7 * blockSize, 10), shortLast.getNextSegment(blockSize, blockSize, &parts));
+
+	// partial sources are only used when downloading in segments
+	SettingsManager::getInstance()->set(SettingsManager::SEGMENTED_DL, false);
+	ASSERT_EQ(0, shortLast.getNextSegment(blockSize, blockSize, &parts).getSize());
+	ASSERT_EQ(Segment(0, 7 * blockSize + 10), shortLast.getNextSegment(blockSize, blockSize));
+
+	SettingsManager::deleteInstance();
+}
+
+TEST(testpartial, test_psr)
+{
+	TimerManager::newInstance();
+	SearchManager::newInstance();
+
+	auto tth = TTHValue("LWPNACQDBZRYXW3VHJVCJ64QBZNGHOHHHZWCLNQ").toBase32();
+	PartsInfo parts { 0, 3, 5, 7, 10, 11 };
+
+	auto cmd = SearchManager::getInstance()->toPSR(false, "nick", "1.2.3.4:411", tth, parts);
+	ASSERT_TRUE(cmd.getCommand() == AdcCommand::CMD_PSR);
+
+	// as it goes over the wire
+	AdcCommand received(cmd.toString(CID::generate()));
+	string udpPort, nick, hubIpPort, gotTth;
+	PartsInfo gotParts;
+	ASSERT_TRUE(SearchManager::parsePSR(received, udpPort, nick, hubIpPort, gotTth, gotParts));
+	ASSERT_EQ("0", udpPort);
+	ASSERT_EQ("nick", nick);
+	ASSERT_EQ("1.2.3.4:411", hubIpPort);
+	ASSERT_EQ(tth, gotTth);
+	ASSERT_EQ(parts, gotParts);
+
+	// ADC users are known by their SID, they don't send a nick
+	cmd = SearchManager::getInstance()->toPSR(false, Util::emptyString, Util::emptyString, tth, parts);
+	nick.clear(); hubIpPort.clear(); gotTth.clear(); gotParts.clear();
+	ASSERT_TRUE(SearchManager::parsePSR(cmd, udpPort, nick, hubIpPort, gotTth, gotParts));
+	ASSERT_TRUE(nick.empty());
+	ASSERT_TRUE(hubIpPort.empty());
+	ASSERT_EQ(parts, gotParts);
+
+	// malformed ones are dropped
+	auto parse = [](const string& params) {
+		string udpPort, nick, hubIpPort, tth;
+		PartsInfo parts;
+		return SearchManager::parsePSR(AdcCommand("UPSR " + params + "\n"), udpPort, nick, hubIpPort, tth, parts);
+	};
+	ASSERT_TRUE(parse("U40 TR" + tth + " PC1 PI0,1"));
+	ASSERT_FALSE(parse("U40 TRshort PC1 PI0,1"));
+	ASSERT_FALSE(parse("U40 TR" + tth + " PC2 PI0,1"));
+	ASSERT_FALSE(parse("U40 TR" + tth + " PC0 PI"));
+	ASSERT_FALSE(parse("U40 PC1 PI0,1"));
+
+	SearchManager::deleteInstance();
+	TimerManager::deleteInstance();
+}
+
+TEST(testpartial, test_queue)
+{
+	auto config = tempPath("config") + PATH_SEPARATOR_STR;
+	File::deleteFile(config + "Queue.xml");
+	File::deleteFile(config + "HashData.dat");
+	Util::initialize({ { Util::PATH_USER_CONFIG, config }, { Util::PATH_USER_LOCAL, config } });
+
+	SettingsManager::newInstance();
+	TimerManager::newInstance();
+	SearchManager::newInstance();
+	ClientManager::newInstance();
+	HashManager::newInstance();
+	QueueManager::newInstance();
+
+	// the parts can only be told apart once the tree is known
+	TigerTree tt(blockSize);
+	string data(4 * blockSize + 100, 'x');
+	tt.update(data.data(), data.size());
+	tt.finalize();
+	ASSERT_TRUE(HashManager::getInstance()->addTree(tt));
+	auto tth = tt.getRoot();
+
+	// what is downloaded so far is in the temporary file
+	auto tempTarget = tempPath("file.dctmp");
+	{
+		auto target = tempPath("file"), escapedTemp = tempTarget;
+		File f(config + "Queue.xml", File::WRITE, File::CREATE | File::TRUNCATE);
+		f.write(SimpleXML::utf8Header);
+		f.write("<Downloads Version=\"" VERSIONSTRING "\">\r\n"
+			"<Download Target=\"" + SimpleXML::escape(target, true) + "\" TempTarget=\"" +
+			SimpleXML::escape(escapedTemp, true) + "\" Size=\"" + Util::toString(tt.getFileSize()) +
+			"\" Priority=\"3\" Added=\"1\" TTH=\"" + tth.toBase32() + "\">\r\n"
+			"<Segment Start=\"0\" Size=\"" + Util::toString(2 * blockSize) + "\"/>\r\n"
+			"<Segment Start=\"" + Util::toString(3 * blockSize) + "\" Size=\"" + Util::toString(blockSize + 100) + "\"/>\r\n"
+			"</Download>\r\n"
+			"</Downloads>\r\n");
+	}
+	auto qm = QueueManager::getInstance();
+	qm->loadQueue([](float) { });
+
+	PartsInfo parts;
+	string path;
+	int64_t size;
+
+	// not shared unless the user wants to
+	ASSERT_FALSE(qm->getPartsInfo(tth, parts));
+	ASSERT_FALSE(qm->getPartialFile(tth, 0, blockSize, path, size));
+
+	SettingsManager::getInstance()->set(SettingsManager::SHARE_PARTIAL_FILES, true);
+
+	ASSERT_TRUE(qm->getPartsInfo(tth, parts));
+	ASSERT_EQ(PartsInfo({ 0, 2, 3, 5 }), parts);
+	ASSERT_FALSE(qm->getPartsInfo(TTHValue(), parts));
+
+	ASSERT_TRUE(qm->getPartialFile(tth, 0, 2 * blockSize, path, size));
+	ASSERT_EQ(tempTarget, path);
+	ASSERT_EQ(tt.getFileSize(), size);
+	ASSERT_TRUE(qm->getPartialFile(tth, 3 * blockSize, -1, path, size));
+	ASSERT_TRUE(qm->getPartialFile(tth, 0, 0, path, size));
+	ASSERT_FALSE(qm->getPartialFile(tth, blockSize, 2 * blockSize, path, size));
+	ASSERT_FALSE(qm->getPartialFile(tth, 0, -1, path, size));
+	ASSERT_FALSE(qm->getPartialFile(TTHValue(), 0, 0, path, size));
+
+	QueueManager::deleteInstance();
+	HashManager::deleteInstance();
+	ClientManager::deleteInstance();
+	SearchManager::deleteInstance();
+	TimerManager::deleteInstance();
+	SettingsManager::deleteInstance();
+
+	File::deleteFile(config + "Queue.xml");
+	File::deleteFile(config + "HashData.dat");
+}
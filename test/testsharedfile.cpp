@@ -0,0 +1,68 @@
+#include "testbase.h"
+
+#include <dcpp/SharedFile.h>
+#include <dcpp/Util.h>
+
+#include <thread>
+
+using namespace dcpp;
+
+namespace {
+
+string tempPath(const string& name) {
+#ifdef _WIN32
+	return Util::getTempPath() + name;
+#else
+	return "/tmp/dcpp-testsharedfile-" + name;
+#endif
+}
+
+}
+
+TEST(testsharedfile, test_segments)
+{
+	auto path = tempPath("segments");
+	File::deleteFile(path);
+
+	const int SEGMENTS = 4;
+	const size_t SEGMENT_SIZE = 1024 * 1024;
+	const int64_t size = SEGMENTS * SEGMENT_SIZE;
+
+	auto file = std::make_shared<SharedFile>();
+
+	// resuming needs the file to be there already
+	ASSERT_THROW(file->open(path, size, File::ALLOC_NONE, true), Exception);
+
+	ASSERT_TRUE(file->open(path, size, File::ALLOC_SPARSE, false));
+	ASSERT_EQ(size, File::getSize(path));
+
+	// the others share the handle opened by the first one
+	ASSERT_TRUE(file->open(path, size, File::ALLOC_SPARSE, true));
+	ASSERT_FALSE(file->open(path + ".other", size, File::ALLOC_SPARSE, false));
+
+	// each segment writes its own part, in small pieces, at the same time as the others
+	std::vector<std::thread> threads;
+	for(int i = 0; i < SEGMENTS; ++i) {
+		threads.emplace_back([file, i, SEGMENT_SIZE] {
+			SharedFileStream s(file, i * SEGMENT_SIZE);
+			string piece(1000, static_cast<char>('a' + i));
+			for(size_t pos = 0; pos < SEGMENT_SIZE; pos += piece.size()) {
+				s.write(piece.data(), std::min(piece.size(), SEGMENT_SIZE - pos));
+			}
+		});
+	}
+	for(auto& t: threads) {
+		t.join();
+	}
+
+	ASSERT_EQ(1, file.use_count());
+	file.reset();
+
+	auto data = File(path, File::READ, File::OPEN).read();
+	ASSERT_EQ(static_cast<size_t>(size), data.size());
+	for(int i = 0; i < SEGMENTS; ++i) {
+		ASSERT_EQ(string(SEGMENT_SIZE, static_cast<char>('a' + i)), data.substr(i * SEGMENT_SIZE, SEGMENT_SIZE));
+	}
+
+	File::deleteFile(path);
+}
@@ -0,0 +1,237 @@
+#include "testbase.h"
+
+#include <dcpp/Speaker.h>
+#include <dcpp/Thread.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+using namespace dcpp;
+
+struct CountListener {
+	template<int I> struct X { enum { TYPE = I }; };
+
+	typedef X<0> Event;
+
+	CountListener() : calls(0), speaker(nullptr), removeSelf(false) { }
+	virtual ~CountListener() { }
+
+	virtual void on(Event, int n) noexcept {
+		calls += n;
+		if(removeSelf) {
+			speaker->removeListener(this);
+		}
+	}
+
+	std::atomic<int> calls;
+	Speaker<CountListener>* speaker;
+	bool removeSelf;
+};
+
+struct Runner : public Thread {
+	Runner(std::function<void ()> f) : f(f) { start(); }
+	~Runner() { join(); }
+
+	int run() { f(); return 0; }
+
+	std::function<void ()> f;
+};
+
+TEST(testspeaker, test_fire)
+{
+	Speaker<CountListener> speaker;
+	CountListener a, b;
+
+	speaker.fire(CountListener::Event(), 1);
+
+	speaker.addListener(&a);
+	speaker.addListener(&a);
+	speaker.addListener(&b);
+	speaker.fire(CountListener::Event(), 1);
+	ASSERT_EQ(a.calls, 1);
+	ASSERT_EQ(b.calls, 1);
+
+	speaker.removeListener(&a);
+	speaker.fire(CountListener::Event(), 1);
+	ASSERT_EQ(a.calls, 1);
+	ASSERT_EQ(b.calls, 2);
+
+	speaker.removeListeners();
+	speaker.fire(CountListener::Event(), 1);
+	ASSERT_EQ(b.calls, 2);
+}
+
+TEST(testspeaker, test_remove_from_listener)
+{
+	Speaker<CountListener> speaker;
+	CountListener a, b;
+	a.speaker = &speaker;
+	a.removeSelf = true;
+
+	speaker.addListener(&a);
+	speaker.addListener(&b);
+
+	// the dispatch in progress still reaches b
+	speaker.fire(CountListener::Event(), 1);
+	speaker.fire(CountListener::Event(), 1);
+	ASSERT_EQ(a.calls, 1);
+	ASSERT_EQ(b.calls, 2);
+}
+
+TEST(testspeaker, test_remove_other_from_listener)
+{
+	// a removes b, which comes after it: the dispatch in progress doesn't call b anymore
+	struct RemoveOther : CountListener {
+		void on(Event, int n) noexcept {
+			calls += n;
+			speaker->removeListener(other);
+		}
+
+		CountListener* other;
+	};
+
+	Speaker<CountListener> speaker;
+	RemoveOther a;
+	CountListener b;
+	a.speaker = &speaker;
+	a.other = &b;
+
+	speaker.addListener(&a);
+	speaker.addListener(&b);
+	speaker.fire(CountListener::Event(), 1);
+	ASSERT_EQ(a.calls, 1);
+	ASSERT_EQ(b.calls, 0);
+}
+
+TEST(testspeaker, test_remove_from_listener_waits_for_others)
+{
+	// blocks in its callback on one thread...
+	struct Blocking : CountListener {
+		Blocking() : entered(false), release(false), finished(false) { }
+
+		void on(Event, int n) noexcept {
+			if(n != 1) {
+				return;
+			}
+			entered = true;
+			while(!release) {
+				Thread::yield();
+			}
+			finished = true;
+		}
+
+		std::atomic<bool> entered, release, finished;
+	};
+
+	// ...while a callback on another thread removes it; removeListener has to wait until the
+	// first thread is done with it, as it could be deleted right after.
+	struct Remover : CountListener {
+		Remover() : finishedWhenRemoved(false) { }
+
+		void on(Event, int n) noexcept {
+			if(n != 2) {
+				return;
+			}
+			speaker->removeListener(blocking);
+			finishedWhenRemoved = blocking->finished.load();
+		}
+
+		Blocking* blocking;
+		bool finishedWhenRemoved;
+	};
+
+	Speaker<CountListener> speaker;
+	Blocking blocking;
+	Remover remover;
+	remover.speaker = &speaker;
+	remover.blocking = &blocking;
+	speaker.addListener(&blocking);
+	speaker.addListener(&remover);
+
+	{
+		Runner firing([&] { speaker.fire(CountListener::Event(), 1); });
+		while(!blocking.entered) {
+			Thread::yield();
+		}
+
+		Runner releasing([&] {
+			Thread::sleep(100);
+			blocking.release = true;
+		});
+
+		speaker.fire(CountListener::Event(), 2);
+	}
+
+	ASSERT_TRUE(remover.finishedWhenRemoved);
+}
+
+TEST(testspeaker, test_remove_while_firing)
+{
+	Speaker<CountListener> speaker;
+	std::atomic<bool> stop(false);
+
+	{
+		std::vector<std::unique_ptr<Runner>> firing;
+		for(int i = 0; i < 4; ++i) {
+			firing.emplace_back(new Runner([&] {
+				while(!stop) {
+					speaker.fire(CountListener::Event(), 1);
+				}
+			}));
+		}
+
+		// once removeListener returns, the listener must not be called anymore
+		for(int i = 0; i < 50; ++i) {
+			CountListener l;
+			speaker.addListener(&l);
+			speaker.removeListener(&l);
+			int calls = l.calls;
+			Thread::yield();
+			ASSERT_EQ(l.calls, calls);
+		}
+
+		stop = true;
+	}
+}
+
+TEST(testspeaker, test_change_from_concurrent_fires)
+{
+	// listeners changing the list from fires running on several threads at once used to deadlock,
+	// each waiting for the other's dispatch to finish.
+	struct ToggleListener : CountListener {
+		void on(Event, int n) noexcept {
+			calls += n;
+			speaker->removeListener(&other);
+			speaker->addListener(&other);
+		}
+
+		CountListener other;
+	};
+
+	Speaker<CountListener> speaker;
+	ToggleListener toggle;
+	toggle.speaker = &speaker;
+	speaker.addListener(&toggle);
+
+	{
+		std::vector<std::unique_ptr<Runner>> firing;
+		for(int i = 0; i < 4; ++i) {
+			firing.emplace_back(new Runner([&] {
+				for(int j = 0; j < 20000; ++j) {
+					speaker.fire(CountListener::Event(), 1);
+				}
+			}));
+		}
+
+		// and from outside of any fire
+		for(int i = 0; i < 1000; ++i) {
+			CountListener l;
+			speaker.addListener(&l);
+			speaker.removeListener(&l);
+		}
+	}
+
+	ASSERT_EQ(toggle.calls, 4 * 20000);
+	speaker.removeListeners();
+}
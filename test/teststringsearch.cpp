@@ -0,0 +1,124 @@
+#include "testbase.h"
+
+#include <dcpp/StringSearch.h>
+#include <dcpp/Text.h>
+#include <dcpp/Util.h>
+
+using namespace dcpp;
+
+TEST(teststringsearch, test_single)
+{
+	StringSearch s("Abc");
+	ASSERT_TRUE(s.match("xxABCxx"));
+	ASSERT_TRUE(s.match("abc"));
+	ASSERT_FALSE(s.match("ab"));
+	ASSERT_FALSE(s.match("xxabxcx"));
+}
+
+TEST(teststringsearch, test_list)
+{
+	Text::initialize();
+
+	StringSearch::List l;
+	ASSERT_EQ(0u, l.match("anything"));
+	ASSERT_FALSE(l.matchAny("anything"));
+	ASSERT_TRUE(l.matchAll("anything"));
+
+	l.emplace_back("artist");
+	l.emplace_back("ALBUM");
+	l.emplace_back("\xc3\x84rger");
+	l.emplace_back("flac");
+	ASSERT_EQ(4u, l.size());
+	ASSERT_EQ(0xfu, l.getAll());
+
+	ASSERT_EQ(0x3u, l.match("Some Artist - Some Album"));
+	ASSERT_EQ(0x4u, l.match("\xc3\xa4RGER"));
+	ASSERT_EQ(0x9u, l.match("artist.flac"));
+	ASSERT_EQ(0u, l.match("artis albu"));
+
+	ASSERT_TRUE(l.matchAny("01 - Track.FLAC"));
+	ASSERT_FALSE(l.matchAny("01 - Track.mp3"));
+
+	ASSERT_FALSE(l.matchAll("Artist - Album - \xc3\x84rger.mp3"));
+	ASSERT_TRUE(l.matchAll("Artist - Album - \xc3\x84rger.flac"));
+	// terms already found elsewhere (in a directory name, say) don't need to be there again
+	ASSERT_TRUE(l.matchAll("\xc3\x84rger.flac", 0x3));
+
+	l.clear();
+	ASSERT_TRUE(l.empty());
+	ASSERT_EQ(0u, l.match("artist"));
+}
+
+TEST(teststringsearch, test_overlapping)
+{
+	// patterns that are prefixes / suffixes / parts of each other
+	StringSearch::List l;
+	l.emplace_back("he");
+	l.emplace_back("she");
+	l.emplace_back("his");
+	l.emplace_back("hers");
+	l.emplace_back("s");
+
+	ASSERT_EQ(0x1bu, l.match("ushers"));
+	ASSERT_EQ(0x14u, l.match("this"));
+	ASSERT_EQ(0x0u, l.match("hx"));
+}
+
+TEST(teststringsearch, test_same_as_single)
+{
+	const char* words[] = { "a", "ab", "abc", "bca", "cab", "b", "ba", "aa", "\xc3\xa4", "\xc3\x84" "b", "c" };
+	const size_t n = sizeof(words) / sizeof(words[0]);
+
+	StringSearch::List l;
+	for(auto w: words) {
+		l.emplace_back(w);
+	}
+
+	for(int i = 0; i < 5000; ++i) {
+		string text;
+		auto len = Util::rand(0, 12);
+		for(uint32_t j = 0; j < len; ++j) {
+			text += words[Util::rand(0, n - 1)];
+		}
+
+		StringSearch::List::Mask expected = 0;
+		for(size_t j = 0; j < n; ++j) {
+			if(StringSearch(words[j]).match(text)) {
+				expected |= static_cast<StringSearch::List::Mask>(1) << j;
+			}
+		}
+		ASSERT_EQ(expected, l.match(text)) << text;
+
+		StringSearch::List::Mask reported = 0;
+		l.find(text, [&](size_t i) { reported |= static_cast<StringSearch::List::Mask>(1) << i; });
+		ASSERT_EQ(expected, reported) << text;
+	}
+}
+
+TEST(teststringsearch, test_many)
+{
+	// past the bits of the mask, patterns are only reported by find
+	StringSearch::List l;
+	for(int i = 0; i < 70; ++i) {
+		l.emplace_back("p" + Util::toString(i) + "_");
+	}
+
+	string all;
+	for(int i = 0; i < 70; ++i) {
+		all += "P" + Util::toString(i) + "_ ";
+	}
+
+	ASSERT_EQ(~static_cast<StringSearch::List::Mask>(0), l.match(all));
+	ASSERT_TRUE(l.matchAll(all));
+	ASSERT_FALSE(l.matchAll(all.substr(0, all.size() - 5)));
+	ASSERT_TRUE(l.matchAny("p69_"));
+
+	// satisfied covers the first 64 patterns; the others are still looked for
+	auto satisfied = l.getAll();
+	ASSERT_TRUE(l.matchAll("p64_ p65_ p66_ p67_ p68_ p69_", satisfied));
+	ASSERT_FALSE(l.matchAll("p64_ p65_ p66_ p67_ p68_", satisfied));
+
+	vector<size_t> reported;
+	l.find("xP69_P1_p69_", [&](size_t i) { reported.push_back(i); });
+	ASSERT_EQ(vector<size_t>({ 69, 1, 69 }), reported);
+}
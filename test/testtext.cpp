@@ -1,6 +1,7 @@
 #include "testbase.h"
 
 #include <dcpp/Text.h>
+#include <dcpp/Util.h>
 
 using namespace dcpp;
 
@@ -16,3 +17,64 @@ TEST(testtext, test_tolower)
 
 	ASSERT_EQ('a', Text::toLower('A'));
 }
+
+TEST(testtext, test_tolower_utf8)
+{
+	Text::initialize();
+
+	// long enough for the vectorized path, with non-ASCII characters in between
+	ASSERT_EQ("some.artist - some album (2004) [flac]/01 - \xc3\xa4\xc3\xb6\xc3\xbc track one.flac",
+		Text::toLower("Some.Artist - Some Album (2004) [FLAC]/01 - \xc3\x84\xc3\x96\xc3\x9c Track One.FLAC"));
+	ASSERT_EQ("\xd0\xbc\xd1\x83\xd0\xb7\xd1\x8b\xd0\xba\xd0\xb0", Text::toLower("\xd0\x9c\xd1\x83\xd0\xb7\xd1\x8b\xd0\xba\xd0\xb0"));
+
+	// invalid sequences are replaced
+	ASSERT_EQ("abc_def", Text::toLower("ABC\xff" "DEF"));
+
+	// results are appended
+	string tmp = "x";
+	ASSERT_EQ("xabc", Text::toLower("ABC", tmp));
+}
+
+TEST(testtext, test_stricmp)
+{
+	Text::initialize();
+
+	ASSERT_EQ(0, Util::stricmp("Some Long Directory Name - With Many Words", "some long directory name - with many words"));
+	ASSERT_LT(Util::stricmp("Some Long Directory Name - With Many Words", "some long directory name - with many wordz"), 0);
+	ASSERT_GT(Util::stricmp(string("Some Long Directory Name - With Many Words!"), string("some long directory name - with many words")), 0);
+	ASSERT_EQ(0, Util::stricmp(string("\xc3\x84rger im B\xc3\xbcro"), string("\xc3\xa4RGER IM B\xc3\x9cRO")));
+	ASSERT_EQ(0, Util::strnicmp(string("Some Long Directory Name - One"), string("some long directory name - two"), 27));
+	ASSERT_NE(0, Util::strnicmp(string("Some Long Directory Name - One"), string("some long directory name - two"), 28));
+
+	// the string and the C string versions agree, even with an embedded NUL
+	string a("abc\0def", 7), b("ABC\0xyz", 7);
+	ASSERT_EQ(Util::stricmp(a.c_str(), b.c_str()), Util::stricmp(a, b));
+
+	ASSERT_EQ(noCaseStringHash()(string("\xc3\x84rger.MP3")), noCaseStringHash()(string("\xc3\xa4rger.mp3")));
+}
+
+TEST(testtext, test_convert)
+{
+	Text::initialize();
+
+	string tmp;
+	string ascii = "$Search Hub:someone F?T?0?9?TTH:LWPNACQDBZRYXW3VHJVCJ64QBZNGHOHHHZWCLNQ";
+	// pure ASCII is handed back as it is
+	ASSERT_EQ(&ascii, &Text::toUtf8(ascii, "CP1252", tmp));
+	ASSERT_EQ(&ascii, &Text::fromUtf8(ascii, "ISO-8859-1", tmp));
+
+	ASSERT_EQ("caf\xc3\xa9", Text::toUtf8("caf\xe9", "CP1252"));
+	ASSERT_EQ("caf\xe9", Text::fromUtf8("caf\xc3\xa9", "CP1252"));
+	ASSERT_EQ("\xd0\xbf\xd1\x80\xd0\xb8", Text::toUtf8("\xef\xf0\xe8", "CP1251"));
+
+	// charsets that don't keep ASCII as it is still get converted
+	ASSERT_EQ(string("a\0b\0", 4), Text::fromUtf8("ab", "UTF-16LE"));
+	ASSERT_EQ("ab", Text::toUtf8(string("a\0b\0", 4), "UTF-16LE"));
+
+	// converters are kept per thread; they must not carry state from one string to the next
+	for(int i = 0; i < 3; ++i) {
+		ASSERT_EQ("caf\xc3\xa9", Text::toUtf8("caf\xe9", "CP1252"));
+	}
+
+	ASSERT_EQ("", Text::convert("abc", "utf-8", "no-such-charset"));
+}
@@ -0,0 +1,135 @@
+#include "testbase.h"
+
+#include <dcpp/TimerManager.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+using namespace dcpp;
+
+namespace {
+
+typedef vector<pair<string, uint64_t>> EventList;
+
+/** Records what the timer threads did, so that the test can wait for it instead of sleeping. */
+class Events {
+public:
+	void add(const string& name, uint64_t tick) {
+		{
+			std::lock_guard<std::mutex> l(mtx);
+			events.emplace_back(name, tick);
+		}
+		cv.notify_all();
+	}
+
+	/** Wait until name has been recorded n times; the limit is only there so that a broken
+	timer fails the test instead of hanging it. */
+	bool waitFor(const string& name, size_t n) {
+		std::unique_lock<std::mutex> l(mtx);
+		return cv.wait_for(l, std::chrono::minutes(1), [&] { return count(name) >= n; });
+	}
+
+	EventList get() {
+		std::lock_guard<std::mutex> l(mtx);
+		return events;
+	}
+
+	size_t get(const string& name) {
+		std::lock_guard<std::mutex> l(mtx);
+		return count(name);
+	}
+
+private:
+	size_t count(const string& name) const {
+		return std::count_if(events.begin(), events.end(), [&](const pair<string, uint64_t>& e) { return e.first == name; });
+	}
+
+	EventList events;
+	std::mutex mtx;
+	std::condition_variable cv;
+};
+
+}
+
+TEST(testtimer, test_schedule)
+{
+	TimerManager::newInstance();
+	auto tm = TimerManager::getInstance();
+
+	Events events;
+	auto start = GET_TICK();
+
+	// lands on a coarser level of the wheel and has to be cascaded down
+	tm->schedule(600, [&](uint64_t tick) { events.add("far", tick); });
+	tm->cancel(tm->schedule(50, [&](uint64_t tick) { events.add("cancelled", tick); }));
+	tm->schedule(20, [&](uint64_t tick) { events.add("near", tick); });
+
+	ASSERT_TRUE(events.waitFor("far", 1));
+
+	// tasks are handed over in the order they are due, and never early
+	auto got = events.get();
+	ASSERT_EQ(2u, got.size());
+	ASSERT_EQ("near", got[0].first);
+	ASSERT_EQ("far", got[1].first);
+	ASSERT_GE(got[0].second, start + 20);
+	ASSERT_GE(got[1].second, start + 600);
+
+	tm->shutdown();
+	ASSERT_EQ(0u, events.get("cancelled"));
+	TimerManager::deleteInstance();
+}
+
+TEST(testtimer, test_schedule_every)
+{
+	TimerManager::newInstance();
+	auto tm = TimerManager::getInstance();
+
+	Events events;
+	auto start = GET_TICK();
+	auto id = tm->scheduleEvery(50, [&](uint64_t tick) { events.add("every", tick); });
+
+	// the task cancels itself; its id is published before it can run
+	std::mutex selfMtx;
+	TimerManager::TaskId self = 0;
+	int selfRuns = 0;
+	{
+		std::lock_guard<std::mutex> l(selfMtx);
+		self = tm->scheduleEvery(10, [&](uint64_t tick) {
+			std::lock_guard<std::mutex> l(selfMtx);
+			if(++selfRuns == 3) {
+				TimerManager::getInstance()->cancel(self);
+				events.add("self", tick);
+			}
+		});
+	}
+
+	ASSERT_TRUE(events.waitFor("every", 3));
+	tm->cancel(id);
+	ASSERT_TRUE(events.waitFor("self", 1));
+
+	// runs that were missed get skipped, so the n-th run is never earlier than its n-th due time
+	auto got = events.get();
+	size_t seen = 0;
+	for(auto& e: got) {
+		if(e.first == "every") {
+			ASSERT_GE(e.second, start + 50 * ++seen);
+		}
+	}
+	ASSERT_GE(seen, 3u);
+
+	// once cancel has returned, neither task runs again; by the time this one has run, both
+	// would have been due a few more times
+	tm->schedule(200, [&](uint64_t tick) { events.add("later", tick); });
+	ASSERT_TRUE(events.waitFor("later", 1));
+	ASSERT_EQ(seen, events.get("every"));
+	ASSERT_EQ(1u, events.get("self"));
+	{
+		std::lock_guard<std::mutex> l(selfMtx);
+		ASSERT_EQ(3, selfRuns);
+	}
+
+	tm->shutdown();
+	ASSERT_EQ(tm->schedule(10, [](uint64_t) { }), 0u);
+	TimerManager::deleteInstance();
+}
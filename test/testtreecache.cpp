@@ -0,0 +1,73 @@
+#include "testbase.h"
+
+#include <dcpp/TreeCache.h>
+
+using namespace dcpp;
+
+namespace {
+
+TigerTree makeTree(int n, size_t leaves) {
+	const int64_t blockSize = 64 * 1024;
+
+	TigerTree tt(blockSize);
+	string block(blockSize, static_cast<char>(n));
+	for(size_t i = 0; i < leaves; ++i) {
+		tt.update(block.data(), block.size());
+	}
+	tt.finalize();
+	return tt;
+}
+
+}
+
+TEST(testtreecache, test_get)
+{
+	TreeCache cache(1024 * 1024);
+	auto a = makeTree(1, 4), b = makeTree(2, 3);
+
+	TigerTree tt;
+	ASSERT_FALSE(cache.get(a.getRoot(), tt));
+
+	cache.add(a);
+	cache.add(b);
+	cache.add(a);
+	ASSERT_EQ(2u, cache.getCount());
+	ASSERT_EQ(7 * TTHValue::BYTES, cache.getBytes());
+
+	ASSERT_TRUE(cache.get(a.getRoot(), tt));
+	ASSERT_EQ(a.getRoot(), tt.getRoot());
+	ASSERT_EQ(a.getLeaves(), tt.getLeaves());
+	ASSERT_EQ(a.getBlockSize(), tt.getBlockSize());
+	ASSERT_EQ(a.getFileSize(), tt.getFileSize());
+
+	cache.clear();
+	ASSERT_FALSE(cache.get(b.getRoot(), tt));
+	ASSERT_EQ(0u, cache.getBytes());
+}
+
+TEST(testtreecache, test_evict)
+{
+	// room for 3 trees of 2 leaves
+	TreeCache cache(6 * TTHValue::BYTES);
+	auto a = makeTree(1, 2), b = makeTree(2, 2), c = makeTree(3, 2), d = makeTree(4, 2);
+
+	cache.add(a);
+	cache.add(b);
+	cache.add(c);
+
+	// a is used, so b is the least recently used one
+	TigerTree tt;
+	ASSERT_TRUE(cache.get(a.getRoot(), tt));
+	cache.add(d);
+
+	ASSERT_EQ(3u, cache.getCount());
+	ASSERT_TRUE(cache.get(a.getRoot(), tt));
+	ASSERT_FALSE(cache.get(b.getRoot(), tt));
+	ASSERT_TRUE(cache.get(c.getRoot(), tt));
+	ASSERT_TRUE(cache.get(d.getRoot(), tt));
+
+	// too large to be kept at all
+	cache.add(makeTree(5, 7));
+	ASSERT_EQ(3u, cache.getCount());
+	ASSERT_TRUE(cache.get(d.getRoot(), tt));
+}
@@ -0,0 +1,151 @@
+#include "testbase.h"
+
+#include <dcpp/File.h>
+#include <dcpp/TreeChecker.h>
+#include <dcpp/Util.h>
+
+using namespace dcpp;
+
+namespace {
+
+const int64_t blockSize = 64 * 1024;
+
+string tempPath(const string& name) {
+#ifdef _WIN32
+	return Util::getTempPath() + name;
+#else
+	return "/tmp/dcpp-testtreechecker-" + name;
+#endif
+}
+
+string makeData(size_t size) {
+	string data(size, 0);
+	uint32_t x = 1;
+	for(auto& c: data) {
+		x = x * 1103515245 + 12345;
+		c = static_cast<char>(x >> 24);
+	}
+	return data;
+}
+
+TigerTree makeTree(const string& data, int64_t aBlockSize) {
+	TigerTree tt(aBlockSize);
+	tt.update(data.data(), data.size());
+	tt.finalize();
+	return tt;
+}
+
+void writeFile(const string& path, const string& data) {
+	File f(path, File::WRITE, File::CREATE | File::TRUNCATE);
+	f.write(data);
+}
+
+/** Check a file, collecting the blocks found good. */
+set<Segment> check(const string& path, const TigerTree& tt, vector<Segment>&& ranges, size_t threads) {
+	set<Segment> ret;
+	EXPECT_TRUE(TreeChecker(path, tt).check(move(ranges), threads, [&](const vector<Segment>& verified) {
+		ret.insert(verified.begin(), verified.end());
+		return true;
+	}));
+	return ret;
+}
+
+int64_t total(const set<Segment>& segments) {
+	int64_t ret = 0;
+	for(auto& i: segments) {
+		ret += i.getSize();
+	}
+	return ret;
+}
+
+}
+
+TEST(testtreechecker, test_ranges)
+{
+	// whole files in ranges of 16 MiB
+	auto ranges = TreeChecker::getRanges(40 * 1024 * 1024 + 5, blockSize);
+	ASSERT_EQ(3u, ranges.size());
+	ASSERT_EQ(Segment(0, 16 * 1024 * 1024), ranges[0]);
+	ASSERT_EQ(Segment(32 * 1024 * 1024, 8 * 1024 * 1024 + 5), ranges[2]);
+
+	ASSERT_TRUE(TreeChecker::getRanges(0, blockSize).empty());
+
+	// only whole blocks of what's done, save for the end of the file
+	const int64_t size = 10 * blockSize + 100;
+	set<Segment> done;
+	done.insert(Segment(10, blockSize));
+	done.insert(Segment(2 * blockSize - 1, 3 * blockSize + 2));
+	done.insert(Segment(9 * blockSize + 1, blockSize + 99));
+	done.insert(Segment(8 * blockSize, blockSize + 1));
+
+	ranges = TreeChecker::getRanges(size, blockSize, &done);
+	ASSERT_EQ(3u, ranges.size());
+	ASSERT_EQ(Segment(2 * blockSize, 3 * blockSize), ranges[0]);
+	ASSERT_EQ(Segment(8 * blockSize, blockSize), ranges[1]);
+	ASSERT_EQ(Segment(10 * blockSize, 100), ranges[2]);
+}
+
+TEST(testtreechecker, test_check)
+{
+	auto path = tempPath("check");
+	const size_t size = 40 * blockSize + 1000;
+	auto data = makeData(size);
+	auto tt = makeTree(data, blockSize);
+
+	// a good file
+	writeFile(path, data);
+	for(size_t threads: { 1, 3 }) {
+		auto good = check(path, tt, TreeChecker::getRanges(size, blockSize), threads);
+		ASSERT_EQ(1u, good.size());
+		ASSERT_EQ(Segment(0, size), *good.begin());
+	}
+
+	// one bad block in the middle, one at the end
+	data[7 * blockSize + 5] ^= 1;
+	data[size - 1] ^= 1;
+	writeFile(path, data);
+
+	auto good = check(path, tt, TreeChecker::getRanges(size, blockSize), 4);
+	ASSERT_EQ(2u, good.size());
+	ASSERT_EQ(Segment(0, 7 * blockSize), *good.begin());
+	ASSERT_EQ(Segment(8 * blockSize, 32 * blockSize), *good.rbegin());
+
+	// only what's done
+	set<Segment> done;
+	done.insert(Segment(blockSize, 2 * blockSize));
+	done.insert(Segment(6 * blockSize, 3 * blockSize));
+	good = check(path, tt, TreeChecker::getRanges(size, blockSize, &done), 4);
+	ASSERT_EQ(3u, good.size());
+	ASSERT_EQ(5 * blockSize - blockSize, total(good));
+	ASSERT_FALSE(good.count(Segment(7 * blockSize, blockSize)));
+
+	// a single leaf tree
+	auto small = makeData(1000);
+	writeFile(path, small);
+	good = check(path, makeTree(small, blockSize), TreeChecker::getRanges(1000, blockSize), 4);
+	ASSERT_EQ(1u, good.size());
+	ASSERT_EQ(1000, good.begin()->getSize());
+
+	File::deleteFile(path);
+}
+
+TEST(testtreechecker, test_stop)
+{
+	auto path = tempPath("stop");
+	const size_t size = 40 * 1024 * 1024;
+	auto data = makeData(size);
+	writeFile(path, data);
+
+	auto tt = makeTree(data, 1024 * 1024);
+	int calls = 0;
+	ASSERT_FALSE(TreeChecker(path, tt).check(TreeChecker::getRanges(size, tt.getBlockSize()), 2, [&](const vector<Segment>&) {
+		return ++calls < 1;
+	}));
+	ASSERT_EQ(1, calls);
+
+	// a file that can't be read
+	ASSERT_FALSE(TreeChecker(tempPath("missing"), tt).check(TreeChecker::getRanges(size, tt.getBlockSize()), 2,
+		[](const vector<Segment>&) { return true; }));
+
+	File::deleteFile(path);
+}
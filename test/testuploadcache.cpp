@@ -0,0 +1,125 @@
+#include "testbase.h"
+
+#include <dcpp/UploadCache.h>
+#include <dcpp/Util.h>
+
+#include <memory>
+
+using namespace dcpp;
+
+namespace {
+
+string tempPath(const string& name) {
+#ifdef _WIN32
+	return Util::getTempPath() + name;
+#else
+	return "/tmp/dcpp-testuploadcache-" + name;
+#endif
+}
+
+string makeData(size_t size) {
+	string data(size, 0);
+	uint32_t x = 1;
+	for(auto& c: data) {
+		x = x * 1103515245 + 12345;
+		c = static_cast<char>(x >> 24);
+	}
+	return data;
+}
+
+string readAll(InputStream* is, size_t chunk) {
+	std::unique_ptr<InputStream> holder(is);
+	string ret;
+	string buf(chunk, 0);
+	for(;;) {
+		size_t len = chunk;
+		auto n = is->read(&buf[0], len);
+		if(n == 0) {
+			break;
+		}
+		ret.append(buf, 0, n);
+	}
+	return ret;
+}
+
+const TTHValue tth("AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA");
+
+}
+
+TEST(testuploadcache, test_read)
+{
+	const size_t size = 3 * UploadCache::BLOCK_SIZE + 1000;
+	auto path = tempPath("read");
+	auto data = makeData(size);
+	{
+		File f(path, File::WRITE, File::CREATE | File::TRUNCATE);
+		f.write(data);
+	}
+
+	UploadCache cache(8 * UploadCache::BLOCK_SIZE);
+	auto f = cache.getFile(path);
+	ASSERT_EQ(f, cache.getFile(path));
+	ASSERT_EQ(1u, cache.getFileCount());
+
+	// a range across blocks, read in odd chunks
+	const int64_t start = UploadCache::BLOCK_SIZE - 100, len = UploadCache::BLOCK_SIZE;
+	ASSERT_EQ(data.substr(start, len), readAll(cache.open(f, &tth, start, len), 7777));
+	ASSERT_EQ(0u, cache.getHits());
+	ASSERT_EQ(2u, cache.getMisses());
+	ASSERT_EQ(2 * UploadCache::BLOCK_SIZE, cache.getBytes());
+
+	// the second reader gets the same blocks from memory
+	ASSERT_EQ(data.substr(start, len), readAll(cache.open(f, &tth, start, len), 65536));
+	ASSERT_EQ(2u, cache.getHits());
+	ASSERT_EQ(2u, cache.getMisses());
+
+	// the whole file, with its short last block
+	ASSERT_EQ(data, readAll(cache.open(f, &tth, 0, size), 65536));
+	ASSERT_EQ(4u, cache.getHits());
+	ASSERT_EQ(4u, cache.getMisses());
+	ASSERT_EQ(3 * UploadCache::BLOCK_SIZE + 1000, cache.getBytes());
+
+	// without a TTH, nothing is cached
+	ASSERT_EQ(data.substr(10, 20), readAll(cache.open(f, nullptr, 10, 20), 65536));
+	ASSERT_EQ(4u, cache.getHits());
+	ASSERT_EQ(4u, cache.getMisses());
+
+	f.reset();
+	ASSERT_EQ(0u, cache.getFileCount());
+
+	File::deleteFile(path);
+}
+
+TEST(testuploadcache, test_evict)
+{
+	const size_t size = 4 * UploadCache::BLOCK_SIZE;
+	auto path = tempPath("evict");
+	auto data = makeData(size);
+	{
+		File f(path, File::WRITE, File::CREATE | File::TRUNCATE);
+		f.write(data);
+	}
+
+	UploadCache cache(2 * UploadCache::BLOCK_SIZE);
+	auto f = cache.getFile(path);
+
+	ASSERT_EQ(data, readAll(cache.open(f, &tth, 0, size), 65536));
+	ASSERT_EQ(2 * UploadCache::BLOCK_SIZE, cache.getBytes());
+
+	// the last two blocks stayed
+	ASSERT_EQ(data.substr(2 * UploadCache::BLOCK_SIZE), readAll(cache.open(f, &tth, 2 * UploadCache::BLOCK_SIZE, 2 * UploadCache::BLOCK_SIZE), 65536));
+	ASSERT_EQ(2u, cache.getHits());
+	ASSERT_EQ(4u, cache.getMisses());
+
+	cache.setMaxBytes(UploadCache::BLOCK_SIZE);
+	ASSERT_EQ(1 * UploadCache::BLOCK_SIZE, cache.getBytes());
+
+	// turned off, reads still go through
+	cache.setMaxBytes(0);
+	ASSERT_EQ(0u, cache.getBytes());
+	ASSERT_EQ(data.substr(5, 3 * UploadCache::BLOCK_SIZE), readAll(cache.open(f, &tth, 5, 3 * UploadCache::BLOCK_SIZE), 65536));
+	ASSERT_EQ(0u, cache.getBytes());
+
+	f.reset();
+	File::deleteFile(path);
+}
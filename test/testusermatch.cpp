@@ -0,0 +1,69 @@
+#include "testbase.h"
+
+#include <dcpp/OnlineUser.h>
+#include <dcpp/UserMatch.h>
+
+using namespace dcpp;
+
+TEST(testusermatch, test_inputs)
+{
+	UserMatch m;
+	ASSERT_EQ(0, m.getInputs());
+
+	m.setFlag(UserMatch::FAVS);
+	UserMatch::Rule rule;
+	rule.field = UserMatch::Rule::NICK;
+	rule.pattern = "nick";
+	m.addRule(std::move(rule));
+	rule = UserMatch::Rule();
+	rule.field = UserMatch::Rule::CID;
+	rule.pattern = "cid";
+	m.addRule(std::move(rule));
+
+	// the CID doesn't change for an online user
+	ASSERT_EQ(UserMatch::INPUT_FAVORITE | UserMatch::INPUT_NICK, m.getInputs());
+
+	UserMatch ops;
+	ops.setFlag(UserMatch::OPS);
+	ASSERT_EQ(UserMatch::INPUT_TYPE, ops.getInputs());
+}
+
+TEST(testusermatch, test_cache)
+{
+	Identity identity(UserPtr(), 0);
+	identity.setNick("nick");
+	identity.setIp4("1.2.3.4");
+
+	UserMatchCache cache;
+
+	// never matched: everything is evaluated
+	ASSERT_EQ(~0, cache.update(1, 3, identity, 1));
+	ASSERT_EQ(vector<bool>(3, false), cache.results);
+	cache.results[1] = true;
+
+	// nothing changed: the results are reused as they are
+	ASSERT_EQ(0, cache.update(1, 3, identity, 1));
+	ASSERT_TRUE(cache.results[1]);
+
+	// setting a field to the value it already has isn't a change
+	identity.setNick("nick");
+	identity.setDescription("a field no definition looks at");
+	ASSERT_EQ(0, cache.update(1, 3, identity, 1));
+
+	identity.setNick("other");
+	ASSERT_EQ(UserMatch::INPUT_NICK, cache.update(1, 3, identity, 1));
+	ASSERT_EQ(0, cache.update(1, 3, identity, 1));
+
+	identity.setIp4("4.3.2.1");
+	identity.setOp(true);
+	ASSERT_EQ(UserMatch::INPUT_IP | UserMatch::INPUT_TYPE, cache.update(1, 3, identity, 1));
+
+	// favorite users added or removed
+	ASSERT_EQ(UserMatch::INPUT_FAVORITE, cache.update(1, 3, identity, 2));
+	ASSERT_TRUE(cache.results[1]);
+
+	// new definitions: the results start over
+	ASSERT_EQ(~0, cache.update(2, 2, identity, 2));
+	ASSERT_EQ(vector<bool>(2, false), cache.results);
+	ASSERT_EQ(0, cache.update(2, 2, identity, 2));
+}
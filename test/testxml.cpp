@@ -137,3 +137,58 @@ TEST(testxml, test_utf_validation)
 	ASSERT_EQ(collector.attribValues["_Name"], 1);
 #endif
 }
+
+class ViewCollector : public SimpleXMLReader::CallBack {
+public:
+	void startTag(std::string_view name, const AttribViewList& attribs, bool simple) {
+		tags.emplace_back(name);
+		for(auto& i: attribs) {
+			values.emplace_back(std::string(i.first) + "=" + std::string(i.second));
+		}
+		last = std::string(getAttrib(attribs, "b", 1));
+	}
+
+	void data(const std::string& data) {
+		content += data;
+	}
+
+	StringList tags;
+	StringList values;
+	std::string last;
+	std::string content;
+};
+
+TEST(testxml, test_views)
+{
+	const char xml[] = "<root a='x&lt;y' b=\"&#123;&quot;z\" c='plain'><child b='1' a=\"&amp;\"/>"
+		"text &amp; more text long enough to go over a few blocks of sixteen characters</root>";
+
+	// one character at a time, so that every tag has to be kept across reads
+	ViewCollector collector;
+	SimpleXMLReader reader(&collector);
+	for(size_t i = 0, iend = sizeof(xml); i < iend; ++i) {
+		reader.parse(xml + i, 1);
+	}
+
+	ASSERT_EQ(collector.tags, StringList({ "root", "child" }));
+	ASSERT_EQ(collector.values, StringList({ "a=x<y", "b=\"z", "c=plain", "b=1", "a=&" }));
+	ASSERT_EQ(collector.last, "1");
+	ASSERT_EQ(collector.content, "text & more text long enough to go over a few blocks of sixteen characters");
+}
+
+#include <dcpp/Streams.h>
+
+TEST(testxml, test_long_attrib)
+{
+	// a tag larger than what is read at once
+	std::string value(60000, 'v');
+	value[12345] = '"';
+	std::string xml = "<root><a x='" + value + "' y='&amp;'/><a x='1'/></root>";
+
+	ViewCollector collector;
+	SimpleXMLReader reader(&collector);
+	MemoryInputStream mis(xml);
+	reader.parse(mis);
+
+	ASSERT_EQ(collector.values, StringList({ "x=" + value, "y=&", "x=1" }));
+}
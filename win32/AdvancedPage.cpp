@@ -50,6 +50,7 @@ AdvancedPage::ListItem AdvancedPage::listItems[] = {
 	{ SettingsManager::USE_SYSTEM_ICONS, N_("Use system icons when browsing files (slows browsing down a bit)"), IDH_SETTINGS_ADVANCED_USE_SYSTEM_ICONS },
 	{ SettingsManager::CLICKABLE_CHAT_LINKS, N_("Clickable chat links (disable on Wine)"), IDH_SETTINGS_CLICKABLE_CHAT_LINKS },
 	{ SettingsManager::SEGMENTED_DL, N_("Enable segmented downloads"), IDH_SETTINGS_ADVANCED_SEGMENTED_DL },
+	{ SettingsManager::SHARE_PARTIAL_FILES, N_("Share the parts of files being downloaded"), IDH_SETTINGS_ADVANCED_SHARE_PARTIAL_FILES },
 	{ SettingsManager::REGISTER_SYSTEM_STARTUP, N_("Start FearDC when Windows starts"), IDH_SETTINGS_ADVANCED_REGISTER_SYSTEM_STARTUP },
 	{ SettingsManager::TESTING_STATUS, N_("Show testing release announcements and information"), IDH_SETTINGS_ADVANCED_DISPLAY_TESTING_NAGS,
 		[]() { return SETTING(TESTING_STATUS) != SettingsManager::TESTING_DISABLED; }, // custom read
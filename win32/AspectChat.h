@@ -127,7 +127,7 @@ protected:
 		try {
 			const int MAX_SIZE = 32 * 1024;
 
-			File f(logPath.empty() ? t().getLogPath() : logPath, File::READ, File::OPEN);
+			File f(logPath.empty() ? t().getLogPath() : logPath, File::READ, File::OPEN | File::SHARED);
 			if(f.getSize() > MAX_SIZE) {
 				f.setEndPos(-MAX_SIZE + 1);
 			}
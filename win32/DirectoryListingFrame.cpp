@@ -607,6 +607,7 @@ void DirectoryListingFrame::loadFile(const tstring& dir) {
 		addRecent();
 		refreshTree(dir);
 		initStatusText();
+		status->setText(STATUS_STATUS, str(TF_("File list loaded in %1% ms") % dl->getLoadTime()));
 	}); }, [this, finishLoad](tstring s) { callAsync([=, this] {
 		// error callback
 		error = std::move(s);
@@ -836,7 +837,8 @@ void DirectoryListingFrame::updateTitle() {
 	if(loaded) {
 		setText(text);
 	} else {
-		BaseType::setText(loading ? str(TF_("Loading file list: %1%") % text) : text);
+		BaseType::setText(loading ? str(TF_("Loading file list: %1% (%2%%%)") % text %
+			static_cast<int>(dl->getLoadProgress() * 100)) : text);
 	}
 
 	dirs->getData(treeRoot)->setText(text);
@@ -1220,6 +1222,12 @@ void DirectoryListingFrame::initStatusText() {
 }
 
 void DirectoryListingFrame::updateStatus() {
+	if(loading) {
+		// show how far the file list has been loaded.
+		updateTitle();
+		return;
+	}
+
 	if(!searching && !updating) {
 		int cnt = files->countSelected();
 		int64_t total = 0;
@@ -33,7 +33,7 @@ using dwt::GridInfo;
 using dwt::Label;
 
 ExpertsPage::ExpertsPage(dwt::Widget* parent) :
-PropPage(parent, 7, 2),
+PropPage(parent, 9, 2),
 modifyWhitelistButton(nullptr)
 {
 	setHelpId(IDH_EXPERTSPAGE);
@@ -54,6 +54,10 @@ modifyWhitelistButton(nullptr)
 	addItem(T_("Socket write buffer"), SettingsManager::SOCKET_OUT_BUFFER, true, IDH_SETTINGS_EXPERT_SOCKET_OUT_BUFFER, T_("B"));
 	addItem(T_("Max PM windows"), SettingsManager::MAX_PM_WINDOWS, true, IDH_SETTINGS_EXPERT_MAX_PM_WINDOWS);
 	addItem(T_("Max protocol command length"), SettingsManager::MAX_COMMAND_LENGTH, true, IDH_SETTINGS_EXPERT_MAX_COMMAND_LENGTH, T_("B"));
+	addItem(T_("Concurrent connection attempts"), SettingsManager::CONCURRENT_CONNECT_ATTEMPTS, true, IDH_SETTINGS_EXPERT_CONCURRENT_CONNECT_ATTEMPTS);
+	addItem(T_("Upload cache size"), SettingsManager::UPLOAD_CACHE_SIZE, true, IDH_SETTINGS_EXPERT_UPLOAD_CACHE_SIZE, T_("MiB"));
+	addItem(T_("Metrics dump interval"), SettingsManager::METRICS_INTERVAL, true, IDH_SETTINGS_EXPERT_METRICS_INTERVAL, T_("minutes"));
+	addItem(T_("Preallocate downloads"), SettingsManager::PREALLOCATION, true, IDH_SETTINGS_EXPERT_PREALLOCATION, T_("0: no, 1: sparse, 2: full"));
 
 	AddWhitelistUI();
 
@@ -76,6 +80,14 @@ void ExpertsPage::write() {
 
 	if(SETTING(AUTO_SEARCH_INTERVAL) < 120)
 		settings->set(SettingsManager::AUTO_SEARCH_INTERVAL, 120);
+
+	if(SETTING(CONCURRENT_CONNECT_ATTEMPTS) < 1)
+		settings->set(SettingsManager::CONCURRENT_CONNECT_ATTEMPTS, 1);
+
+	if(SETTING(PREALLOCATION) > SettingsManager::PREALLOCATION_FULL)
+		settings->set(SettingsManager::PREALLOCATION, SettingsManager::PREALLOCATION_FULL);
+	else if(SETTING(PREALLOCATION) < SettingsManager::PREALLOCATION_NONE)
+		settings->set(SettingsManager::PREALLOCATION, SettingsManager::PREALLOCATION_NONE);
 }
 
 void ExpertsPage::addItem(const tstring& text, int setting, bool isInt, unsigned helpId, const tstring& text2) {
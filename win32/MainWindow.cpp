@@ -21,6 +21,7 @@
 
 #include <dcpp/Client.h>
 #include <dcpp/ClientManager.h>
+#include <dcpp/CompactListing.h>
 #include <dcpp/ConnectionManager.h>
 #include <dcpp/ConnectivityManager.h>
 #include <dcpp/Download.h>
@@ -1459,7 +1460,7 @@ public:
 			if (!u)
 				continue;
 			HintedUser user(u, Util::emptyString);
-			DirectoryListing dl(user);
+			CompactListing dl(user);
 			try {
 				dl.loadFile(i);
 				int matched = QueueManager::getInstance()->matchListing(dl);
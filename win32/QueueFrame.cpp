@@ -473,6 +473,10 @@ void QueueFrame::QueueItemInfo::recheck() {
 	QueueManager::getInstance()->recheck(getTarget());
 }
 
+void QueueFrame::QueueItemInfo::recheckDone() {
+	QueueManager::getInstance()->recheck(getTarget(), true);
+}
+
 void QueueFrame::QueueItemInfo::remove() {
 	QueueManager::getInstance()->remove(getTarget());
 }
@@ -765,6 +769,10 @@ void QueueFrame::handleRecheck() {
 	files->forEachSelected(&QueueItemInfo::recheck);
 }
 
+void QueueFrame::handleRecheckDone() {
+	files->forEachSelected(&QueueItemInfo::recheckDone);
+}
+
 void QueueFrame::handleMove() {
 	usingDirMenu ? moveSelectedDir() : moveSelected();
 }
@@ -930,6 +938,7 @@ MenuPtr QueueFrame::makeSingleMenu(QueueItemInfo* qii) {
 	WinUtil::addHashItems(menu.get(), qii->getTTH(), Text::toT(Util::getFileName(qii->getTarget())), qii->getSize());
 	menu->appendItem(T_("&Move/Rename"), [this] { handleMove(); });
 	menu->appendItem(T_("Re&check integrity"), [this] { handleRecheck(); });
+	menu->appendItem(T_("Recheck &downloaded parts"), [this] { handleRecheckDone(); });
 	addPriorityMenu(menu.get());
 	addBrowseMenu(menu.get(), qii);
 	addPMMenu(menu.get(), qii);
@@ -949,6 +958,7 @@ MenuPtr QueueFrame::makeMultiMenu() {
 
 	menu->appendItem(T_("&Move/Rename"), [this] { handleMove(); });
 	menu->appendItem(T_("Re&check integrity"), [this] { handleRecheck(); });
+	menu->appendItem(T_("Recheck &downloaded parts"), [this] { handleRecheckDone(); });
 	addPriorityMenu(menu.get());
 	menu->appendSeparator();
 	menu->appendItem(T_("&Remove"), [this] { handleRemove(); });
@@ -1205,3 +1215,8 @@ void QueueFrame::on(QueueManagerListener::RecheckAlreadyFinished, const string&
 void QueueFrame::on(QueueManagerListener::RecheckDone, const string& target) noexcept {
 	onRechecked(target, T_("Done."));
 }
+
+void QueueFrame::on(QueueManagerListener::FileMoving, const string& target, int64_t copied, int64_t total) noexcept {
+	callAsync([=, this] { status->setText(STATUS_STATUS, str(TF_("Moving %1% (%2% of %3%)") % Text::toT(target) %
+		Text::toT(Util::formatBytes(copied)) % Text::toT(Util::formatBytes(total))), false); });
+}
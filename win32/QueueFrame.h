@@ -125,6 +125,7 @@ private:
 
 		void update();
 		void recheck();
+		void recheckDone();
 		void remove();
 
 		// TypedTable functions
@@ -275,6 +276,7 @@ private:
 	void handleMove();
 	void handleRemove();
 	void handleRecheck();
+	void handleRecheckDone();
 	void handlePriority(QueueItem::Priority p);
 	void handlePM(const HintedUser& user);
 	void handleRemoveSource(const HintedUser& user);
@@ -305,6 +307,8 @@ private:
 	virtual void on(QueueManagerListener::RecheckNoTree, const string& target) noexcept;
 	virtual void on(QueueManagerListener::RecheckAlreadyFinished, const string& target) noexcept;
 	virtual void on(QueueManagerListener::RecheckDone, const string& target) noexcept;
+
+	virtual void on(QueueManagerListener::FileMoving, const string& target, int64_t copied, int64_t total) noexcept;
 };
 
 #endif // !defined(QUEUE_FRAME_H)
@@ -834,6 +834,12 @@ void WinUtil::searchHub(const tstring& aUrl) {
 	SearchFrame::openWindow(mainWindow->getTabView(), Util::emptyStringT, SearchManager::TYPE_ANY, aUrl);
 }
 
+bool WinUtil::checkTTH(const tstring& aText) {
+	auto text = Text::fromT(aText);
+	TTHValue tth;
+	return Encoder::fromBase32(text.data(), text.size(), tth.data, TTHValue::BYTES, true);
+}
+
 void WinUtil::addLastDir(const tstring& dir) {
 	auto i = find(lastDirs.begin(), lastDirs.end(), dir);
 	if(i != lastDirs.end()) {
@@ -281,7 +281,7 @@ public:
 	static void searchAny(const tstring& aSearch);
 	static void searchHash(const TTHValue& aHash);
 	static void searchHub(const tstring& aUrl);
-	static bool checkTTH(const tstring& aText) { return aText.size() == 39 && Encoder::isBase32(Text::fromT(aText)); }
+	static bool checkTTH(const tstring& aText);
 
 	static string makeMagnet(const TTHValue& aHash, const string& aFile, int64_t size);
 